@@ -88,6 +88,7 @@
 #include <capchild/capture_sync.h>
 
 #include "sync_pipe.h"
+#include "sync_ring.h"
 
 #ifdef _WIN32
 #include "capture-wpcap.h"
@@ -138,6 +139,21 @@ capture_session_init(capture_session *cap_session, void *cf)
     cap_session->group                           = getgid();
 #endif
     cap_session->session_started                 = FALSE;
+    cap_session->packet_ring                     = NULL;
+}
+
+/* Get rid of the packet ring, if any, once the child is gone */
+static void
+sync_pipe_free_packet_ring(capture_session *cap_session)
+{
+#ifdef HAVE_SYNC_RING
+    if (cap_session->packet_ring != NULL) {
+        sync_ring_free(cap_session->packet_ring);
+        cap_session->packet_ring = NULL;
+    }
+#else
+    (void)cap_session;
+#endif
 }
 
 /* Append an arg (realloc) to an argc/argv array */
@@ -360,6 +376,9 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, voi
 #if defined(_WIN32) || defined(HAVE_PCAP_CREATE)
     char buffer_size[ARGV_NUMBER_LEN];
 #endif
+#ifdef HAVE_SYNC_RING
+    char sring_fd[ARGV_NUMBER_LEN];
+#endif
 
 #ifdef _WIN32
     HANDLE sync_pipe_read;                  /* pipe used to send messages from child to parent */
@@ -542,6 +561,26 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, voi
         argv = sync_pipe_add_arg(argv, &argc, "-w");
         argv = sync_pipe_add_arg(argv, &argc, capture_opts->save_file);
     }
+
+#ifdef HAVE_SYNC_RING
+    /* Have the child hand us the packets through shared memory as well,
+       so that we don't have to read them back from the file. */
+    sync_pipe_free_packet_ring(cap_session);
+    if (capture_opts->use_packet_ring) {
+        int ring_err;
+
+        cap_session->packet_ring = sync_ring_create(SYNC_RING_DEFAULT_SIZE, &ring_err);
+        if (cap_session->packet_ring != NULL) {
+            g_snprintf(sring_fd, ARGV_NUMBER_LEN, "%d",
+                       sync_ring_get_fd(cap_session->packet_ring));
+            argv = sync_pipe_add_arg(argv, &argc, "--packet-ring");
+            argv = sync_pipe_add_arg(argv, &argc, sring_fd);
+        } else {
+            g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_WARNING,
+                  "Couldn't create packet ring: %s", g_strerror(ring_err));
+        }
+    }
+#endif
     for (i = 0; i < argc; i++) {
         g_log(LOG_DOMAIN_CAPTURE, G_LOG_LEVEL_DEBUG, "argv[%d]: %s", i, argv[i]);
     }
@@ -638,6 +677,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, voi
             g_free( (gpointer) argv[i]);
         }
         g_free(argv);
+        sync_pipe_free_packet_ring(cap_session);
         return FALSE;
     }
 
@@ -667,6 +707,12 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, voi
         fetch_dumpcap_pid(cap_session->fork_child);
 
     sync_pipe_read_fd = sync_pipe[PIPE_READ];
+
+#ifdef HAVE_SYNC_RING
+    /* The child has its own copy of the ring's descriptor now. */
+    if (cap_session->packet_ring != NULL)
+        sync_ring_close_fd(cap_session->packet_ring);
+#endif
 #endif
 
     for (i = 0; i < argc; i++) {
@@ -694,6 +740,7 @@ sync_pipe_start(capture_options *capture_opts, capture_session *cap_session, voi
 #ifdef _WIN32
         ws_close(cap_session->signal_pipe_write_fd);
 #endif
+        sync_pipe_free_packet_ring(cap_session);
         return FALSE;
     }
 
@@ -1741,6 +1788,7 @@ sync_pipe_input_cb(gint source, gpointer user_data)
 #ifdef _WIN32
         ws_close(cap_session->signal_pipe_write_fd);
 #endif
+        sync_pipe_free_packet_ring(cap_session);
         capture_input_closed(cap_session, primary_msg);
         g_free(primary_msg);
         return FALSE;
@@ -1769,6 +1817,7 @@ sync_pipe_input_cb(gint source, gpointer user_data)
                This can also happen if the user specified "-", meaning
                "standard output", as the capture file. */
             sync_pipe_stop(cap_session);
+            sync_pipe_free_packet_ring(cap_session);
             capture_input_closed(cap_session, NULL);
             return FALSE;
         }
@@ -99,6 +99,7 @@
 #endif /* _WIN32 */
 
 #include "version.h"
+#include "flow_index.h"
 
 /*
  * By default capinfos now continues processing
@@ -122,6 +123,13 @@ static gchar field_separator       = '\t';  /* Use TAB as field separator by def
 static gchar quote_char            = '\0';  /* Do NOT quote fields by default        */
 static gboolean machine_readable   = FALSE; /* Display machine-readable numbers      */
 
+/*
+ * flow index query; if given, only the flow indexes written next to
+ * the capture files are read
+ */
+
+static flow_query *flow_index_query = NULL;
+
 /*
  * capinfos has the ability to report on a number of
  * various characteristics ("infos") for each input file.
@@ -1001,6 +1009,53 @@ print_version(FILE *output)
       "\n", VERSION);
 }
 
+/*
+ * List the flows in the flow index of a capture file that match the
+ * query; the capture file itself isn't read
+ */
+static int
+process_flow_index(const char *filename, const flow_query *query)
+{
+  GPtrArray        *entries;
+  flow_index_entry *entry;
+  gchar            *flow_str;
+  guint             i, j;
+  int               err;
+
+  if (!flow_index_read(filename, &entries, &err)) {
+    if (err == 0)
+      fprintf(stderr, "capinfos: The flow index for %s is malformed\n", filename);
+    else
+      fprintf(stderr, "capinfos: Can't read the flow index for %s: %s\n",
+          filename, g_strerror(err));
+    return 1;
+  }
+
+  for (i = 0; i < entries->len; i++) {
+    entry = (flow_index_entry *)g_ptr_array_index(entries, i);
+    if (!flow_query_match(query, &entry->key))
+      continue;
+    flow_str = flow_key_to_str(&entry->key);
+    printf("%s%c%s%c%" G_GINT64_MODIFIER "u%c%" G_GINT64_MODIFIER "u%c"
+           "%" G_GINT64_MODIFIER "u.%09u%c%" G_GINT64_MODIFIER "u.%09u%c",
+           filename, field_separator, flow_str, field_separator,
+           entry->packets, field_separator, entry->bytes, field_separator,
+           entry->first_ts / 1000000000, (guint)(entry->first_ts % 1000000000),
+           field_separator,
+           entry->last_ts / 1000000000, (guint)(entry->last_ts % 1000000000),
+           field_separator);
+    for (j = 0; j < entry->nranges; j++) {
+      printf("%s%" G_GINT64_MODIFIER "u-%" G_GINT64_MODIFIER "u", j ? "," : "",
+          entry->ranges[2 * j], entry->ranges[2 * j + 1]);
+    }
+    printf("\n");
+    g_free(flow_str);
+  }
+
+  flow_index_entries_free(entries);
+  return 0;
+}
+
 static void
 usage(gboolean is_error)
 {
@@ -1064,6 +1119,11 @@ usage(gboolean is_error)
   fprintf(output, "  -q quote infos with single quotes (')\n");
   fprintf(output, "  -Q quote infos with double quotes (\")\n");
   fprintf(output, "\n");
+  fprintf(output, "Flow index query:\n");
+  fprintf(output, "  -F <query> list the flows matching <query>, e.g. \"host=10.0.0.1,port=53\",\n");
+  fprintf(output, "             from the flow indexes dumpcap wrote next to the files, with\n");
+  fprintf(output, "             their packets, bytes, first and last time and byte ranges\n");
+  fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h display this help and exit\n");
   fprintf(output, "  -C cancel processing if file open fails (default is to continue)\n");
@@ -1211,7 +1271,7 @@ main(int argc, char *argv[])
   g_option_context_free(ctx);
 
 #endif /* USE_GOPTION */
-  while ((opt = getopt(argc, argv, "tEcs" FILE_HASH_OPT "dluaeyizvhxokCALTMRrSNqQBmb")) !=-1) {
+  while ((opt = getopt(argc, argv, "tEcs" FILE_HASH_OPT "dluaeyizvhxokCALTMRrSNqQBmbF:")) !=-1) {
 
     switch (opt) {
 
@@ -1353,6 +1413,20 @@ main(int argc, char *argv[])
         field_separator = ' ';
         break;
 
+      case 'F':
+      {
+        char *query_err;
+
+        flow_query_free(flow_index_query);
+        flow_index_query = flow_query_new(optarg, &query_err);
+        if (flow_index_query == NULL) {
+          fprintf(stderr, "capinfos: %s\n", query_err);
+          g_free(query_err);
+          exit(1);
+        }
+        break;
+      }
+
       case 'h':
         usage(FALSE);
         exit(0);
@@ -1398,6 +1472,15 @@ main(int argc, char *argv[])
 
   for (opt = optind; opt < argc; opt++) {
 
+    if (flow_index_query != NULL) {
+      if (process_flow_index(argv[opt], flow_index_query) != 0) {
+        overall_error_status = 1;
+        if (!continue_after_wtap_open_offline_failure)
+          exit(1);
+      }
+      continue;
+    }
+
 #ifdef HAVE_LIBGCRYPT
     g_strlcpy(file_sha1, "<unknown>", HASH_STR_SIZE);
     g_strlcpy(file_rmd160, "<unknown>", HASH_STR_SIZE);
@@ -0,0 +1,362 @@
+/* capture_filter_cache.c
+ * Cache of the code compiled for capture filters
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_LIBPCAP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include <pcap.h>
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/filesystem.h>
+
+#include "capture_filter_cache.h"
+
+/*
+ * The file starts with a line naming the libpcap that compiled the code,
+ *
+ *   # <pcap_lib_version()>
+ *
+ * and each line after that is
+ *
+ *   <linktype> <snaplen> <netmask> <live> <count> <insn> ... <filter>
+ *
+ * with the netmask in hex, <live> 1 for code compiled for a capture
+ * device and 0 for code compiled for a capture file, and each
+ * instruction as <code>:<jt>:<jf>:<k> in hex.  Code from another
+ * libpcap is ignored.  The whole file is written again whenever code
+ * is added; once it has CFILTER_CACHE_MAX entries, it's started over.
+ */
+#define CFILTER_CACHE_NAME      "cfilter_code"
+#define CFILTER_CACHE_MAX       256
+#define CFILTER_CACHE_MAX_INSNS 65536
+
+/* Older libpcaps don't know about the modulus instruction, but the
+   kernel might. */
+#ifndef BPF_MOD
+#define BPF_MOD         0x90
+#endif
+
+typedef struct {
+    int              linktype;
+    int              snaplen;
+    guint32          netmask;
+    gboolean         live;
+    char            *cfilter;
+    guint            len;
+    struct bpf_insn *insns;
+} cache_entry;
+
+static GHashTable *cache = NULL;    /* key string -> cache_entry */
+
+static void
+cache_entry_free(gpointer data)
+{
+    cache_entry *entry = (cache_entry *)data;
+
+    g_free(entry->cfilter);
+    g_free(entry->insns);
+    g_free(entry);
+}
+
+/* Code compiled by one libpcap may not be what another one would
+   compile, and code for a capture device may use loads a capture file
+   can't (Linux sockets compile "vlan" to use the packet's metadata). */
+static char *
+cache_key(int linktype, int snaplen, guint32 netmask, gboolean live, const char *cfilter)
+{
+    return g_strdup_printf("%s\n%d %d %x %d %s", pcap_lib_version(), linktype, snaplen,
+                           netmask, live ? 1 : 0, cfilter);
+}
+
+static void
+cache_insert(int linktype, int snaplen, guint32 netmask, gboolean live,
+             const char *cfilter, guint len, struct bpf_insn *insns)
+{
+    cache_entry *entry;
+
+    entry = g_new(cache_entry, 1);
+    entry->linktype = linktype;
+    entry->snaplen = snaplen;
+    entry->netmask = netmask;
+    entry->live = live;
+    entry->cfilter = g_strdup(cfilter);
+    entry->len = len;
+    entry->insns = insns;
+    g_hash_table_replace(cache, cache_key(linktype, snaplen, netmask, live, cfilter), entry);
+}
+
+/* Get a number followed by "sep" */
+static gboolean
+cache_get_num(char **p, int base, unsigned long *val, char sep)
+{
+    char *end;
+
+    *val = strtoul(*p, &end, base);
+    if (end == *p || *end != sep)
+        return FALSE;
+    *p = end + 1;
+    return TRUE;
+}
+
+static void
+cache_parse_line(char *line)
+{
+    char            *p = line;
+    unsigned long    linktype, snaplen, netmask, live, count, code, jt, jf, k;
+    unsigned long    i;
+    struct bpf_insn *insns;
+
+    if (!cache_get_num(&p, 10, &linktype, ' ') ||
+        !cache_get_num(&p, 10, &snaplen, ' ') ||
+        !cache_get_num(&p, 16, &netmask, ' ') ||
+        !cache_get_num(&p, 10, &live, ' ') ||
+        !cache_get_num(&p, 10, &count, ' ') ||
+        live > 1 || count == 0 || count > CFILTER_CACHE_MAX_INSNS)
+        return;
+
+    insns = g_new(struct bpf_insn, count);
+    for (i = 0; i < count; i++) {
+        if (!cache_get_num(&p, 16, &code, ':') ||
+            !cache_get_num(&p, 16, &jt, ':') ||
+            !cache_get_num(&p, 16, &jf, ':') ||
+            !cache_get_num(&p, 16, &k, ' ') ||
+            code > G_MAXUINT16 || jt > G_MAXUINT8 || jf > G_MAXUINT8 ||
+            k > G_MAXUINT32) {
+            g_free(insns);
+            return;
+        }
+        insns[i].code = (u_short)code;
+        insns[i].jt = (u_char)jt;
+        insns[i].jf = (u_char)jf;
+        insns[i].k = (bpf_u_int32)k;
+    }
+    /* Don't trust the file any more than we have to. */
+    if (*p == '\0' || !capture_filter_code_is_valid(insns, (guint)count)) {
+        g_free(insns);
+        return;
+    }
+
+    cache_insert((int)linktype, (int)snaplen, (guint32)netmask, live != 0, p,
+                 (guint)count, insns);
+}
+
+static void
+cache_load(void)
+{
+    char   *path;
+    gchar  *contents;
+    gchar **lines;
+    gchar  *version;
+    int     i;
+
+    cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, cache_entry_free);
+
+    path = get_persconffile_path(CFILTER_CACHE_NAME, TRUE);
+    if (g_file_get_contents(path, &contents, NULL, NULL)) {
+        lines = g_strsplit(contents, "\n", 0);
+        version = g_strdup_printf("# %s", pcap_lib_version());
+        if (lines[0] != NULL && strcmp(lines[0], version) == 0) {
+            for (i = 1; lines[i] != NULL; i++)
+                cache_parse_line(lines[i]);
+        }
+        g_free(version);
+        g_strfreev(lines);
+        g_free(contents);
+    }
+    g_free(path);
+}
+
+static void
+cache_write_entry(gpointer key _U_, gpointer value, gpointer user_data)
+{
+    cache_entry *entry = (cache_entry *)value;
+    FILE        *fh = (FILE *)user_data;
+    guint        i;
+
+    fprintf(fh, "%d %d %x %d %u", entry->linktype, entry->snaplen, entry->netmask,
+            entry->live ? 1 : 0, entry->len);
+    for (i = 0; i < entry->len; i++) {
+        fprintf(fh, " %x:%x:%x:%x", entry->insns[i].code, entry->insns[i].jt,
+                entry->insns[i].jf, entry->insns[i].k);
+    }
+    fprintf(fh, " %s\n", entry->cfilter);
+}
+
+/* Write the cache file.  It's written to a file of our own and renamed
+   into place, so that another dumpcap never sees half of it, and two
+   of them adding code at the same time don't mix their lines. */
+static void
+cache_save(void)
+{
+    char     *pf_dir_path;
+    char     *path, *tmp_path;
+    int       fd;
+    FILE     *fh;
+    gboolean  ok;
+
+    if (create_persconffile_dir(&pf_dir_path) == -1) {
+        g_free(pf_dir_path);
+        return;
+    }
+    path = get_persconffile_path(CFILTER_CACHE_NAME, TRUE);
+    tmp_path = g_strdup_printf("%s.%08x", path, g_random_int());
+    fd = ws_open(tmp_path, O_WRONLY|O_CREAT|O_EXCL|O_BINARY, 0644);
+    if (fd == -1) {
+        g_free(tmp_path);
+        g_free(path);
+        return;
+    }
+    fh = ws_fdopen(fd, "wb");
+    if (fh == NULL) {
+        ws_close(fd);
+        ws_unlink(tmp_path);
+        g_free(tmp_path);
+        g_free(path);
+        return;
+    }
+
+    fprintf(fh, "# %s\n", pcap_lib_version());
+    g_hash_table_foreach(cache, cache_write_entry, fh);
+    ok = !ferror(fh);
+    if (fclose(fh) == EOF)
+        ok = FALSE;
+    if (!ok || ws_rename(tmp_path, path) == -1)
+        ws_unlink(tmp_path);
+    g_free(tmp_path);
+    g_free(path);
+}
+
+gboolean
+capture_filter_cache_lookup(int linktype, int snaplen, guint32 netmask, gboolean live,
+                            const char *cfilter, struct bpf_program *fcode)
+{
+    char        *key;
+    cache_entry *entry;
+
+    if (cache == NULL)
+        cache_load();
+
+    key = cache_key(linktype, snaplen, netmask, live, cfilter);
+    entry = (cache_entry *)g_hash_table_lookup(cache, key);
+    g_free(key);
+    if (entry == NULL)
+        return FALSE;
+
+    fcode->bf_len = entry->len;
+    fcode->bf_insns = (struct bpf_insn *)g_memdup(entry->insns,
+                                                  entry->len * (guint)sizeof (struct bpf_insn));
+    return TRUE;
+}
+
+void
+capture_filter_cache_add(int linktype, int snaplen, guint32 netmask, gboolean live,
+                         const char *cfilter, const struct bpf_program *fcode)
+{
+    /* A filter has to fit on a line. */
+    if (strchr(cfilter, '\n') != NULL || strchr(cfilter, '\r') != NULL ||
+        fcode->bf_len == 0 || fcode->bf_len > CFILTER_CACHE_MAX_INSNS)
+        return;
+
+    if (cache == NULL)
+        cache_load();
+
+    if (g_hash_table_size(cache) >= CFILTER_CACHE_MAX)
+        g_hash_table_remove_all(cache);
+    cache_insert(linktype, snaplen, netmask, live, cfilter, fcode->bf_len,
+                 (struct bpf_insn *)g_memdup(fcode->bf_insns,
+                                             fcode->bf_len * (guint)sizeof (struct bpf_insn)));
+    cache_save();
+}
+
+gboolean
+capture_filter_code_is_valid(const struct bpf_insn *insns, guint len)
+{
+    const struct bpf_insn *p;
+    guint                  i, left;
+
+    if (len == 0)
+        return FALSE;
+
+    for (i = 0; i < len; i++) {
+        p = &insns[i];
+        left = len - i - 1;     /* instructions after this one */
+        switch (BPF_CLASS(p->code)) {
+
+        case BPF_JMP:
+            if (BPF_OP(p->code) == BPF_JA) {
+                if (p->k >= left)
+                    return FALSE;
+            } else if (p->jt >= left || p->jf >= left) {
+                return FALSE;
+            }
+            break;
+
+        case BPF_LD:
+        case BPF_LDX:
+            if (BPF_MODE(p->code) == BPF_MEM && p->k >= BPF_MEMWORDS)
+                return FALSE;
+            break;
+
+        case BPF_ST:
+        case BPF_STX:
+            if (p->k >= BPF_MEMWORDS)
+                return FALSE;
+            break;
+
+        case BPF_ALU:
+            if ((BPF_OP(p->code) == BPF_DIV || BPF_OP(p->code) == BPF_MOD) &&
+                BPF_SRC(p->code) == BPF_K && p->k == 0)
+                return FALSE;
+            break;
+
+        default:
+            break;
+        }
+    }
+    return BPF_CLASS(insns[len - 1].code) == BPF_RET;
+}
+
+#endif /* HAVE_LIBPCAP */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
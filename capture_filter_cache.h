@@ -0,0 +1,71 @@
+/* capture_filter_cache.h
+ * Declarations for caching the code compiled for capture filters
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CAPTURE_FILTER_CACHE_H__
+#define __CAPTURE_FILTER_CACHE_H__
+
+#include <glib.h>
+
+struct bpf_insn;
+struct bpf_program;
+
+/** @file
+ *
+ *  BPF code compiled for capture filters is kept in the "cfilter_code"
+ *  file in the personal configuration directory, keyed by the libpcap
+ *  that compiled it, the link-layer type, snapshot length and netmask it
+ *  was compiled for, whether it was compiled for a capture device or a
+ *  capture file, and the text of the filter, so that complex filters
+ *  needn't be compiled and optimized again at every capture start.
+ */
+
+/** Get the code compiled for a capture filter before.
+ *
+ * @param linktype The DLT_ value the code was compiled for.
+ * @param snaplen The snapshot length the code was compiled for.
+ * @param netmask The netmask the code was compiled with.
+ * @param live TRUE if the code was compiled for a capture device, FALSE
+ *        for a capture file.
+ * @param cfilter The capture filter.
+ * @param fcode Filled in with a g_malloc()ed copy of the code if found.
+ * @return TRUE if the code was found.
+ */
+gboolean capture_filter_cache_lookup(int linktype, int snaplen, guint32 netmask,
+                                     gboolean live, const char *cfilter,
+                                     struct bpf_program *fcode);
+
+/** Remember the code compiled for a capture filter, in memory and in
+ *  the cache file.  Failing to write the file isn't an error; the code
+ *  is compiled again next time.
+ */
+void capture_filter_cache_add(int linktype, int snaplen, guint32 netmask,
+                              gboolean live, const char *cfilter,
+                              const struct bpf_program *fcode);
+
+/** Check that BPF code can be run safely: all jumps stay within the
+ *  program, scratch memory accesses are in range, there are no
+ *  divisions or modulus operations by a zero constant, and the last
+ *  instruction returns.
+ */
+gboolean capture_filter_code_is_valid(const struct bpf_insn *insns, guint len);
+
+#endif /* __CAPTURE_FILTER_CACHE_H__ */
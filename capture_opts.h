@@ -256,6 +256,8 @@ typedef struct capture_options_tag {
     gchar    *save_file;            /**< the capture file name */
     gboolean group_read_access;     /**< TRUE is group read permission needs to be set */
     gboolean use_pcapng;            /**< TRUE if file format is pcapng */
+    gboolean use_packet_ring;       /**< TRUE if the capture child should also hand
+                                         packets over through shared memory */
 
     /* GUI related */
     gboolean real_time_mode;        /**< Update list of packets in real time */
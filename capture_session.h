@@ -52,6 +52,7 @@ typedef struct {
     gboolean session_started;
     capture_options *capture_opts;  /**< options for this capture */
     void *cf;                       /**< handle to cfile (note: untyped handle) */
+    struct sync_ring *packet_ring;  /**< ring the child also puts packets into, or NULL */
 } capture_session;
 
 extern void
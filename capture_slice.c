@@ -0,0 +1,256 @@
+/* capture_slice.c
+ * Slicing packets down to their headers at capture time
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_LIBPCAP
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <pcap.h>
+
+#include <glib.h>
+
+#include <wsutil/pint.h>
+
+#include "capture_slice.h"
+
+/* The headers a rule can refer to, from the outermost in */
+typedef enum {
+    SLICE_LINK,
+    SLICE_IP,
+    SLICE_TCP,
+    SLICE_UDP,
+    SLICE_ZEP,
+    SLICE_NUM_HEADERS
+} slice_header;
+
+static const char *slice_header_names[SLICE_NUM_HEADERS] = {
+    "link", "ip", "tcp", "udp", "zep"
+};
+
+#define SLICE_NO_RULE       -1
+
+struct capture_slice {
+    gint32 keep[SLICE_NUM_HEADERS];   /* bytes to keep after each header, or SLICE_NO_RULE */
+};
+
+#define ETHERTYPE_IP        0x0800
+#define ETHERTYPE_IPv6      0x86DD
+#define ETHERTYPE_VLAN      0x8100
+#define ETHERTYPE_QINQ      0x88A8
+
+#define IP_PROTO_HOPOPTS    0
+#define IP_PROTO_TCP        6
+#define IP_PROTO_UDP        17
+#define IP_PROTO_ROUTING    43
+#define IP_PROTO_FRAGMENT   44
+#define IP_PROTO_DSTOPTS    60
+
+#define UDP_PORT_ZEP        17754
+
+capture_slice *
+capture_slice_new(const char *spec, char **err_msg)
+{
+    capture_slice *slice;
+    gchar        **rules, *colon, *end;
+    long           keep;
+    guint          i, h;
+
+    slice = g_new(capture_slice, 1);
+    for (h = 0; h < SLICE_NUM_HEADERS; h++) {
+        slice->keep[h] = SLICE_NO_RULE;
+    }
+
+    rules = g_strsplit(spec, ",", -1);
+    for (i = 0; rules[i] != NULL; i++) {
+        colon = strchr(rules[i], ':');
+        if (colon == NULL) {
+            *err_msg = g_strdup_printf("Slicing rule \"%s\" isn't of the form <header>:<bytes>",
+                                       rules[i]);
+            goto fail;
+        }
+        *colon = '\0';
+        for (h = 0; h < SLICE_NUM_HEADERS; h++) {
+            if (strcmp(rules[i], slice_header_names[h]) == 0)
+                break;
+        }
+        if (h == SLICE_NUM_HEADERS) {
+            *err_msg = g_strdup_printf("Unknown header \"%s\" in slicing rule; "
+                                       "use link, ip, tcp, udp or zep", rules[i]);
+            goto fail;
+        }
+        errno = 0;
+        keep = strtol(colon + 1, &end, 10);
+        if (colon[1] == '\0' || *end != '\0' || errno != 0 || keep < 0 ||
+            keep > G_MAXINT32) {
+            *err_msg = g_strdup_printf("Invalid byte count \"%s\" in slicing rule for %s",
+                                       colon + 1, rules[i]);
+            goto fail;
+        }
+        slice->keep[h] = (gint32)keep;
+    }
+    if (i == 0) {
+        *err_msg = g_strdup("Empty slicing program");
+        goto fail;
+    }
+    g_strfreev(rules);
+    return slice;
+
+fail:
+    g_strfreev(rules);
+    g_free(slice);
+    return NULL;
+}
+
+void
+capture_slice_free(capture_slice *slice)
+{
+    g_free(slice);
+}
+
+guint32
+capture_slice_len(const capture_slice *slice, int linktype,
+                  const guint8 *pd, guint32 caplen)
+{
+    gint64  keep = -1;   /* keep the whole packet */
+    guint32 off;
+    guint32 hlen;
+    guint16 ethertype;
+    guint8  proto;
+    guint16 sport, dport;
+
+    /* Link-layer header */
+    switch (linktype) {
+
+    case DLT_EN10MB:
+        if (caplen < 14)
+            return caplen;
+        ethertype = pntoh16(pd + 12);
+        off = 14;
+        while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) &&
+               caplen >= off + 4) {
+            ethertype = pntoh16(pd + off + 2);
+            off += 4;
+        }
+        break;
+
+#ifdef DLT_LINUX_SLL
+    case DLT_LINUX_SLL:
+        if (caplen < 16)
+            return caplen;
+        ethertype = pntoh16(pd + 14);
+        off = 16;
+        break;
+#endif
+
+    case DLT_RAW:
+        if (caplen < 1)
+            return caplen;
+        ethertype = ((pd[0] >> 4) == 6) ? ETHERTYPE_IPv6 : ETHERTYPE_IP;
+        off = 0;
+        break;
+
+    default:
+        return caplen;
+    }
+    if (slice->keep[SLICE_LINK] != SLICE_NO_RULE)
+        keep = (gint64)off + slice->keep[SLICE_LINK];
+
+    /* IP header */
+    if (ethertype == ETHERTYPE_IP) {
+        if (caplen < off + 20 || (pd[off] >> 4) != 4)
+            goto done;
+        hlen = (pd[off] & 0x0F) * 4;
+        if (hlen < 20 || caplen < off + hlen)
+            goto done;
+        proto = pd[off + 9];
+        /* only the first fragment has the transport-layer header */
+        if ((pntoh16(pd + off + 6) & 0x1FFF) != 0)
+            proto = IP_PROTO_FRAGMENT;
+        off += hlen;
+    } else if (ethertype == ETHERTYPE_IPv6) {
+        if (caplen < off + 40 || (pd[off] >> 4) != 6)
+            goto done;
+        proto = pd[off + 6];
+        off += 40;
+        while (proto == IP_PROTO_HOPOPTS || proto == IP_PROTO_ROUTING ||
+               proto == IP_PROTO_DSTOPTS) {
+            if (caplen < off + 8)
+                goto done;
+            proto = pd[off];
+            off += (pd[off + 1] + 1) * 8;
+        }
+        if (caplen < off)
+            goto done;
+    } else {
+        goto done;
+    }
+    if (slice->keep[SLICE_IP] != SLICE_NO_RULE)
+        keep = (gint64)off + slice->keep[SLICE_IP];
+
+    /* Transport-layer header */
+    if (proto == IP_PROTO_TCP) {
+        if (caplen < off + 20)
+            goto done;
+        hlen = (pd[off + 12] >> 4) * 4;
+        if (hlen < 20 || caplen < off + hlen)
+            goto done;
+        off += hlen;
+        if (slice->keep[SLICE_TCP] != SLICE_NO_RULE)
+            keep = (gint64)off + slice->keep[SLICE_TCP];
+        goto done;
+    }
+    if (proto != IP_PROTO_UDP || caplen < off + 8)
+        goto done;
+    sport = pntoh16(pd + off);
+    dport = pntoh16(pd + off + 2);
+    off += 8;
+    if (slice->keep[SLICE_UDP] != SLICE_NO_RULE)
+        keep = (gint64)off + slice->keep[SLICE_UDP];
+
+    /* ZEP header: "EX", version 1 with 16 bytes, or version 2 with
+       32 bytes for data and 8 bytes for acknowledgements */
+    if ((sport != UDP_PORT_ZEP && dport != UDP_PORT_ZEP) ||
+        caplen < off + 4 || pd[off] != 'E' || pd[off + 1] != 'X')
+        goto done;
+    if (pd[off + 2] == 1)
+        hlen = 16;
+    else if (pd[off + 2] == 2)
+        hlen = (pd[off + 3] == 2) ? 8 : 32;
+    else
+        goto done;
+    if (caplen < off + hlen)
+        goto done;
+    off += hlen;
+    if (slice->keep[SLICE_ZEP] != SLICE_NO_RULE)
+        keep = (gint64)off + slice->keep[SLICE_ZEP];
+
+done:
+    if (keep < 0 || keep >= caplen)
+        return caplen;
+    return (guint32)keep;
+}
+
+#endif /* HAVE_LIBPCAP */
@@ -0,0 +1,64 @@
+/* capture_slice.h
+ * Declarations for slicing packets down to their headers at capture time
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __CAPTURE_SLICE_H__
+#define __CAPTURE_SLICE_H__
+
+#include <glib.h>
+
+/** A compiled slicing program.
+ *
+ * The program is a comma-separated list of "<header>:<bytes>" rules,
+ * for example "udp:0,tcp:0,zep:24,ip:64".  The headers are "link"
+ * (the link-layer header, including any VLAN tags), "ip" (IPv4 or
+ * IPv6, including IPv6 extension headers), "tcp", "udp" and "zep"
+ * (a ZigBee Encapsulation Protocol header in UDP).  A packet is cut
+ * <bytes> bytes after the end of the innermost of its headers that has
+ * a rule; packets without any header with a rule are kept whole.
+ */
+typedef struct capture_slice capture_slice;
+
+/** Compile a slicing program.
+ *
+ * @param spec The program, as described above.
+ * @param err_msg Set to a g_malloc()ed message on error.
+ * @return The compiled program, or NULL on error.
+ */
+capture_slice *capture_slice_new(const char *spec, char **err_msg);
+
+/** Free a compiled slicing program. */
+void capture_slice_free(capture_slice *slice);
+
+/** Return how much of a packet to keep.
+ *
+ * @param slice The compiled program.
+ * @param linktype The DLT_ value of the interface the packet came from;
+ *        packets of link types other than Ethernet, Linux cooked and
+ *        raw IP are kept whole.
+ * @param pd The packet data.
+ * @param caplen The number of bytes captured.
+ * @return The number of bytes to write, at most caplen.
+ */
+guint32 capture_slice_len(const capture_slice *slice, int linktype,
+                          const guint8 *pd, guint32 caplen);
+
+#endif /* __CAPTURE_SLICE_H__ */
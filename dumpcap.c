@@ -88,7 +88,27 @@
 # include <sys/capability.h>
 #endif
 
+/*
+ * On Linux, we can capture with a TPACKET_V3 ring of our own rather
+ * than through libpcap; see tpacket_open().  The ring size comes from
+ * the -B buffer size, which we only have with pcap_create().
+ */
+#if defined(__linux__) && defined(HAVE_PCAP_CREATE)
+# include <linux/if_packet.h>
+# ifdef TPACKET3_HDRLEN
+#  define HAVE_TPACKET3
+#  include <linux/if_ether.h>
+#  include <linux/filter.h>
+#  include <net/if.h>
+#  include <poll.h>
+#  include <sys/mman.h>
+# endif
+#endif
+
 #include "ringbuffer.h"
+#include "capture_slice.h"
+#include "flow_index.h"
+#include "capture_filter_cache.h"
 #include "clopts_common.h"
 #include "cmdarg_err.h"
 #include "version_info.h"
@@ -116,6 +136,7 @@
 #include <wsutil/privileges.h>
 
 #include "sync_pipe.h"
+#include "sync_ring.h"
 
 #include "capture_opts.h"
 #include "capture_session.h"
@@ -153,12 +174,18 @@ FILE *debug_log;   /* for logging debug messages to  */
                    /*  is defined                    */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static gint64 pcap_queue_bytes;
-static gint64 pcap_queue_packets;
+/*
+ * With threads, each capture thread queues its packets in a ring of its
+ * own (see pcap_ring below); these limit the size of each ring.
+ */
 static gint64 pcap_queue_byte_limit = 0;
 static gint64 pcap_queue_packet_limit = 0;
 
+/* for waking up the writer thread when the rings are empty */
+static GMutex *pcap_ring_mtx;
+static GCond *pcap_ring_cond;
+static volatile gint pcap_ring_writer_waiting;
+
 static gboolean capture_child = FALSE; /* FALSE: standalone call, TRUE: this is an Wireshark capture child */
 #ifdef _WIN32
 static gchar *sig_pipe_name = NULL;
@@ -190,13 +217,19 @@ enable_kernel_bpf_jit_compiler(void)
 {
     int fd;
     ssize_t written _U_;
+    char enabled;
     static const char file[] = "/proc/sys/net/core/bpf_jit_enable";
 
-    fd = open(file, O_WRONLY);
+    fd = open(file, O_RDWR);
     if (fd < 0)
         return;
 
-    written = write(fd, "1", strlen("1"));
+    /* Leave it alone if it's already enabled, possibly with debugging
+       output ("2"). */
+    if (read(fd, &enabled, 1) != 1 || enabled == '0') {
+        if (lseek(fd, 0, SEEK_SET) == 0)
+            written = write(fd, "1", strlen("1"));
+    }
 
     close(fd);
 }
@@ -279,6 +312,9 @@ typedef enum {
     PIPNEXIST
 } cap_pipe_err_t;
 
+struct _pcap_ring;
+struct _tpacket_ring;
+
 typedef struct _pcap_options {
     guint32                      received;
     guint32                      dropped;
@@ -290,6 +326,11 @@ typedef struct _pcap_options {
     gboolean                     pcap_err;
     guint                        interface_id;
     GThread                     *tid;
+    struct _pcap_ring           *ring;                   /**< packets queued by the capture thread */
+    struct _tpacket_ring        *tpacket;                /**< our own TPACKET_V3 ring, if we're not using libpcap to capture */
+    gint                         isb_stats_known;        /**< TRUE once the capture thread has published statistics */
+    gint                         isb_stats_drop;         /**< ps_drop, as last published by the capture thread */
+    guint64                      isb_stats_time;         /**< when the capture thread last published them */
     int                          snaplen;
     int                          linktype;
     gboolean                     ts_nsec;                /**< TRUE if we're using nanosecond precision. */
@@ -333,17 +374,49 @@ typedef struct _loop_data {
 #endif
     GArray   *pcaps;
     /* output file(s) */
-    FILE     *pdh;
+    pcapio_writer *pdh;
     int       save_file_fd;
     guint64   bytes_written;
     guint32   autostop_files;
+    flow_index *flow_index;     /**< flow index for the current file, or NULL */
 } loop_data;
 
-typedef struct _pcap_queue_element {
-    pcap_options       *pcap_opts;
-    struct pcap_pkthdr  phdr;
-    u_char             *pd;
-} pcap_queue_element;
+/*
+ * A single-producer, single-consumer ring of captured packets.
+ *
+ * Each capture thread puts its packets, header and data inline, into
+ * its own ring, and the writer thread takes them out, so that neither
+ * has to allocate memory or take a lock per packet.  head and tail
+ * count the bytes ever put into and taken out of the ring; only the
+ * capture thread changes head, and only the writer thread changes tail.
+ * size is a power of 2, so the counters can wrap around freely.
+ */
+#define PCAP_RING_ALIGN     8
+#define PCAP_RING_MIN_SIZE  (64*1024)
+#define PCAP_RING_MAX_SIZE  (1024*1024*1024)
+
+typedef struct _pcap_ring_rec {
+    guint32             reclen;     /**< length of the record, padded to PCAP_RING_ALIGN */
+    guint32             wrap;       /**< TRUE if this just fills out the end of the buffer */
+    struct pcap_pkthdr  phdr;       /**< followed by the packet data */
+} pcap_ring_rec;
+
+typedef struct _pcap_ring {
+    guchar             *buf;
+    guint               size;       /**< size of buf, a power of 2 */
+    guint               limit;      /**< most bytes we'll queue at once */
+    guint               packet_limit; /**< most packets we'll queue at once, or 0 */
+    /* changed by the capture thread */
+    volatile gint       head;
+    volatile gint       packets_in;
+    guint               dropped;    /**< packets dropped because the ring was full */
+    guint               peak;       /**< most bytes ever queued at once */
+    /* keep the writer's counters out of the capture thread's cache line */
+    guchar              pad[64];
+    /* changed by the writer thread */
+    volatile gint       tail;
+    volatile gint       packets_out;
+} pcap_ring;
 
 /*
  * Standard secondary message for unexpected errors.
@@ -394,6 +467,7 @@ static gboolean need_timeout_workaround;
 #endif
 
 #define WRITER_THREAD_TIMEOUT 100000 /* usecs */
+#define WRITER_BATCH_PACKETS  256    /* packets written per pass of the capture loop */
 
 static void
 console_log_handler(const char *log_domain, GLogLevelFlags log_level,
@@ -405,6 +479,31 @@ static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
 static guint64 start_time;
 
+/* output stream options */
+#define LONGOPT_WRITE_BUFFER    MIN_NON_CAPTURE_LONGOPT
+#define LONGOPT_DIRECT_IO       (MIN_NON_CAPTURE_LONGOPT + 1)
+#define LONGOPT_TPACKET         (MIN_NON_CAPTURE_LONGOPT + 2)
+#define LONGOPT_COMPRESS_ROTATED (MIN_NON_CAPTURE_LONGOPT + 3)
+#define LONGOPT_FSYNC_ROTATED   (MIN_NON_CAPTURE_LONGOPT + 4)
+#define LONGOPT_SLICE           (MIN_NON_CAPTURE_LONGOPT + 5)
+#define LONGOPT_FLOW_INDEX      (MIN_NON_CAPTURE_LONGOPT + 6)
+#define LONGOPT_ISB_INTERVAL    (MIN_NON_CAPTURE_LONGOPT + 7)
+#define LONGOPT_PACKET_RING     (MIN_NON_CAPTURE_LONGOPT + 8)
+#define LONGOPT_BENCH_FILTER    (MIN_NON_CAPTURE_LONGOPT + 9)
+static size_t write_buffer_size = PCAPIO_DEFAULT_BUFFER_SIZE;
+static guint write_flags = PCAPIO_WRITER_THREADED;
+static ringbuf_compression rotated_compression = RINGBUF_COMPRESS_NONE;
+static gboolean fsync_rotated = FALSE;
+static capture_slice *capture_slicer = NULL;
+static gboolean use_flow_index = FALSE;
+static gint32 isb_interval = 0;
+#ifdef HAVE_SYNC_RING
+static sync_ring *packet_ring = NULL;
+#endif
+#ifdef HAVE_TPACKET3
+static gboolean use_tpacket = FALSE;
+#endif
+
 static void capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
                                          const u_char *pd);
 static void capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
@@ -514,6 +613,14 @@ print_usage(gboolean print_ver)
     fprintf(output, "  -k                       set channel on wifi interface <freq>,[<type>]\n");
     fprintf(output, "  -S                       print statistics for each interface once per second\n");
     fprintf(output, "  -M                       for -D, -L, and -S, produce machine-readable output\n");
+#ifndef _WIN32
+    fprintf(output, "  --bench-filter <file>    run the packets in <file> through the code for the\n");
+    fprintf(output, "                           capture filter and print the time per packet\n");
+#endif
+#ifdef HAVE_TPACKET3
+    fprintf(output, "  --tpacket                capture Ethernet interfaces with a TPACKET_V3 ring\n");
+    fprintf(output, "                           of dumpcap's own, sized by -B, instead of libpcap\n");
+#endif
     fprintf(output, "\n");
 #ifdef HAVE_PCAP_REMOTE
     fprintf(output, "RPCAP options:\n");
@@ -538,15 +645,39 @@ print_usage(gboolean print_ver)
     fprintf(output, "  -b <ringbuffer opt.> ... duration:NUM - switch to next file after NUM secs\n");
     fprintf(output, "                           filesize:NUM - switch to next file after NUM KB\n");
     fprintf(output, "                              files:NUM - ringbuffer: replace after NUM files\n");
+#if defined(HAVE_LIBZ) || defined(HAVE_ZSTD)
+    fprintf(output, "  --compress-rotated <type>\n");
+    fprintf(output, "                           compress each file switched away from with -b,\n");
+#if defined(HAVE_LIBZ) && defined(HAVE_ZSTD)
+    fprintf(output, "                           type gzip or zstd\n");
+#elif defined(HAVE_LIBZ)
+    fprintf(output, "                           type gzip\n");
+#else
+    fprintf(output, "                           type zstd\n");
+#endif
+#endif
+    fprintf(output, "  --fsync-rotated          sync each file with -b to disk before closing it\n");
     fprintf(output, "  -n                       use pcapng format instead of pcap (default)\n");
     fprintf(output, "  -P                       use libpcap format instead of pcapng\n");
+    fprintf(output, "  --slice <header>:<bytes>[,<header>:<bytes>...]\n");
+    fprintf(output, "                           only keep <bytes> bytes after the innermost of the\n");
+    fprintf(output, "                           link, ip, tcp, udp and zep headers with a rule\n");
+    fprintf(output, "  --flow-index             write an index of the flows in each file to\n");
+    fprintf(output, "                           <file>%s\n", FLOW_INDEX_SUFFIX);
+    fprintf(output, "  --isb-interval <secs>    also write interface statistics every <secs> seconds\n");
+    fprintf(output, "                           and before switching files (only for pcapng)\n");
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+    fprintf(output, "  --write-buffer <size>    size of each of the two output buffers in KiB\n");
+    fprintf(output, "                           (def: %dKiB)\n", PCAPIO_DEFAULT_BUFFER_SIZE / 1024);
+    fprintf(output, "  --direct-io              write the output file(s) with direct I/O,\n");
+    fprintf(output, "                           bypassing the page cache, if possible\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
-    fprintf(output, "  -N <packet_limit>        maximum number of packets buffered within dumpcap\n");
+    fprintf(output, "  -N <packet_limit>        maximum number of packets buffered for each interface\n");
     fprintf(output, "  -C <byte_limit>          maximum number of bytes used for buffering packets\n");
+    fprintf(output, "                           for each interface\n");
     fprintf(output, "                           within dumpcap\n");
     fprintf(output, "  -t                       use a separate thread per interface\n");
     fprintf(output, "  -q                       don't report packet capture counts\n");
@@ -876,14 +1007,22 @@ set_pcap_linktype(pcap_t *pcap_h, int linktype, char *name,
     return FALSE;
 }
 
+/* Compile a capture filter for "pcap_h"; "iface" is NULL if it's not a
+   capture device.  The code is g_malloc()ed, whether it was compiled or
+   taken from the cache of code compiled before. */
 static gboolean
 compile_capture_filter(const char *iface, pcap_t *pcap_h,
                        struct bpf_program *fcode, const char *cfilter)
 {
-    bpf_u_int32 netnum, netmask;
-    gchar       lookup_net_err_str[PCAP_ERRBUF_SIZE];
-
-    if (pcap_lookupnet(iface, &netnum, &netmask, lookup_net_err_str) < 0) {
+    bpf_u_int32        netnum, netmask;
+    gchar              lookup_net_err_str[PCAP_ERRBUF_SIZE];
+    struct bpf_program code;
+    int                linktype  = pcap_datalink(pcap_h);
+    int                snaplen   = pcap_snapshot(pcap_h);
+    gboolean           use_cache;
+
+    if (iface == NULL ||
+        pcap_lookupnet(iface, &netnum, &netmask, lookup_net_err_str) < 0) {
         /*
          * Well, we can't get the netmask for this interface; it's used
          * only for filters that check for broadcast IP addresses, so
@@ -903,8 +1042,26 @@ compile_capture_filter(const char *iface, pcap_t *pcap_h,
      * third argument to pcap_compile() as a const pointer.  Cast
      * away the warning.
      */
-    if (pcap_compile(pcap_h, fcode, (char *)cfilter, 1, netmask) < 0)
+    /* Complex filters take a while to compile and optimize, so reuse
+       code compiled before for the same link-layer type, snapshot length
+       and netmask, and for a capture device or a file as we have here.
+       Leave the user's files alone while we're running with special
+       privileges, though. */
+    use_cache = !running_with_special_privs();
+    if (use_cache &&
+        capture_filter_cache_lookup(linktype, snaplen, netmask, iface != NULL, cfilter, fcode))
+        return TRUE;
+
+    if (pcap_compile(pcap_h, &code, (char *)cfilter, 1, netmask) < 0)
         return FALSE;
+    fcode->bf_len = code.bf_len;
+    fcode->bf_insns = (struct bpf_insn *)g_memdup(code.bf_insns,
+                                                  code.bf_len * (guint)sizeof (struct bpf_insn));
+#ifdef HAVE_PCAP_FREECODE
+    pcap_freecode(&code);
+#endif
+    if (use_cache)
+        capture_filter_cache_add(linktype, snaplen, netmask, iface != NULL, cfilter, fcode);
     return TRUE;
 }
 
@@ -960,6 +1117,7 @@ show_filter_code(capture_options *capture_opts)
 
         for (i = 0; i < fcode.bf_len; insn++, i++)
             printf("%s\n", bpf_image(insn, i));
+        g_free(fcode.bf_insns);
     }
     /* If not using libcap: we now can now set euid/egid to ruid/rgid         */
     /*  to remove any suid privileges.                                        */
@@ -979,6 +1137,113 @@ show_filter_code(capture_options *capture_opts)
 }
 #endif
 
+#ifndef _WIN32
+#define BENCH_MAX_BYTES     (256*1024*1024)     /* packet data we read in */
+#define BENCH_MIN_USECS     1000000             /* how long we run the filter */
+
+typedef struct {
+    guint32  caplen;
+    guint32  len;
+    guint8  *data;
+} bench_packet;
+
+/*
+ * Run the packets of a capture file through the code compiled for a
+ * capture filter, in user space, over and over for at least a second,
+ * and report how long the filter takes per packet, so that filters can
+ * be tuned without capturing.
+ */
+static int
+bench_capture_filter(const char *fname, const char *cfilter)
+{
+    pcap_t             *pcap_h;
+    gchar               errbuf[PCAP_ERRBUF_SIZE];
+    struct bpf_program  fcode;
+    struct pcap_pkthdr  hdr;
+    const u_char       *pd;
+    GArray             *packets;
+    bench_packet        pkt;
+    bench_packet       *p;
+    guint64             bytes   = 0;
+    guint64             runs    = 0;
+    guint64             elapsed = 0;
+    guint               i, matched = 0;
+    struct timeval      start, now;
+#ifdef __linux__
+    FILE               *fh;
+    int                 jit     = -1;
+#endif
+
+    /* We only read a file; don't do that with special privileges. */
+#ifndef HAVE_LIBCAP
+    relinquish_special_privs_perm();
+#else
+    relinquish_all_capabilities();
+#endif
+
+    pcap_h = pcap_open_offline(fname, errbuf);
+    if (pcap_h == NULL) {
+        cmdarg_err("Can't open \"%s\": %s", fname, errbuf);
+        return 2;
+    }
+    if (!compile_capture_filter(NULL, pcap_h, &fcode, cfilter)) {
+        cmdarg_err("Invalid capture filter \"%s\": %s", cfilter, pcap_geterr(pcap_h));
+        pcap_close(pcap_h);
+        return 2;
+    }
+
+    packets = g_array_new(FALSE, FALSE, sizeof (bench_packet));
+    while (bytes < BENCH_MAX_BYTES && (pd = pcap_next(pcap_h, &hdr)) != NULL) {
+        pkt.caplen = hdr.caplen;
+        pkt.len = hdr.len;
+        pkt.data = (guint8 *)g_memdup(pd, hdr.caplen);
+        g_array_append_val(packets, pkt);
+        bytes += hdr.caplen;
+    }
+    pcap_close(pcap_h);
+
+    if (packets->len != 0) {
+        gettimeofday(&start, NULL);
+        do {
+            for (i = 0; i < packets->len; i++) {
+                p = &g_array_index(packets, bench_packet, i);
+                if (bpf_filter(fcode.bf_insns, p->data, p->len, p->caplen) != 0 && runs == 0)
+                    matched++;
+            }
+            runs++;
+            gettimeofday(&now, NULL);
+            elapsed = (guint64)((now.tv_sec - start.tv_sec) * 1000000 +
+                                (now.tv_usec - start.tv_usec));
+        } while (elapsed < BENCH_MIN_USECS);
+    }
+
+    printf("Filter:       %s\n", cfilter);
+    printf("Instructions: %u (%s)\n", fcode.bf_len,
+           capture_filter_code_is_valid(fcode.bf_insns, fcode.bf_len) ? "valid" : "invalid");
+    printf("Packets:      %u, %u matched\n", packets->len, matched);
+    if (packets->len != 0) {
+        printf("Time:         %.1f ns/packet, over %" G_GINT64_MODIFIER "u runs\n",
+               (double)elapsed * 1000.0 / ((double)runs * packets->len), runs);
+    }
+#ifdef __linux__
+    /* The kernel may run the code a lot faster than we can. */
+    fh = ws_fopen("/proc/sys/net/core/bpf_jit_enable", "r");
+    if (fh != NULL) {
+        if (fscanf(fh, "%d", &jit) != 1)
+            jit = -1;
+        fclose(fh);
+    }
+    printf("Kernel JIT:   %s\n", jit > 0 ? "enabled" : jit == 0 ? "disabled" : "unknown");
+#endif
+
+    for (i = 0; i < packets->len; i++)
+        g_free(g_array_index(packets, bench_packet, i).data);
+    g_array_free(packets, TRUE);
+    g_free(fcode.bf_insns);
+    return 0;
+}
+#endif
+
 /*
  * capture_interface_list() is expected to do the right thing to get
  * a list of interfaces.
@@ -2526,6 +2791,324 @@ cap_pipe_dispatch(loop_data *ld, pcap_options *pcap_opts, guchar *data, char *er
 }
 
 
+#ifdef HAVE_TPACKET3
+/*
+ * Capturing with a TPACKET_V3 ring of our own.
+ *
+ * The kernel fills blocks of the ring with packets and hands each
+ * block over when it's full or when tp_retire_blk_tov expires.  We
+ * write (or queue) the packets straight out of the block, and give
+ * the block back to the kernel once all of its packets have been
+ * written, so a packet is copied only once, into the output buffer.
+ *
+ * libpcap is still used to open the device, check the link-layer
+ * type and compile the capture filter; its handle is closed once our
+ * socket has the filter attached, so that it doesn't get a copy of
+ * every packet as well.
+ */
+#define TPACKET_BLOCK_SIZE      (1024*1024)
+#define TPACKET_MIN_BLOCKS      4
+#define TPACKET_FRAME_SIZE      2048
+
+typedef struct _tpacket_ring {
+    int         fd;
+    int         ifindex;
+    guint8     *map;            /**< the ring, mapped from the kernel */
+    size_t      map_len;
+    guint       block_nr;
+    guint       block_idx;      /**< next block to look at */
+    guint64     packets;        /**< totals from PACKET_STATISTICS, which */
+    guint64     drops;          /**< resets its counters when read */
+    guint8     *vlan_buf;       /**< a packet with its VLAN tag put back */
+} tpacket_ring;
+
+/* Set up a ring on a packet socket for the interface; this has to be
+   done before we give up our privileges.  The socket doesn't get any
+   packets until tpacket_start() binds it to the interface. */
+static tpacket_ring *
+tpacket_open(interface_options *interface_opts, int *err)
+{
+    tpacket_ring      *tr;
+    struct tpacket_req3 req;
+    int                version = TPACKET_V3;
+
+    tr = g_new0(tpacket_ring, 1);
+    tr->ifindex = if_nametoindex(interface_opts->name);
+    if (tr->ifindex == 0) {
+        *err = errno;
+        g_free(tr);
+        return NULL;
+    }
+    /* Protocol 0, so that nothing arrives before we bind */
+    tr->fd = socket(PF_PACKET, SOCK_RAW, 0);
+    if (tr->fd == -1) {
+        *err = errno;
+        g_free(tr);
+        return NULL;
+    }
+    if (setsockopt(tr->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof version) == -1)
+        goto fail;
+
+    tr->block_nr = interface_opts->buffer_size * 1024 * 1024 / TPACKET_BLOCK_SIZE;
+    if (tr->block_nr < TPACKET_MIN_BLOCKS)
+        tr->block_nr = TPACKET_MIN_BLOCKS;
+    memset(&req, 0, sizeof req);
+    req.tp_block_size = TPACKET_BLOCK_SIZE;
+    req.tp_block_nr = tr->block_nr;
+    req.tp_frame_size = TPACKET_FRAME_SIZE;
+    req.tp_frame_nr = (TPACKET_BLOCK_SIZE / TPACKET_FRAME_SIZE) * tr->block_nr;
+    req.tp_retire_blk_tov = CAP_READ_TIMEOUT;
+    if (setsockopt(tr->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req) == -1)
+        goto fail;
+
+    tr->map_len = (size_t)TPACKET_BLOCK_SIZE * tr->block_nr;
+    tr->map = (guint8 *)mmap(NULL, tr->map_len, PROT_READ|PROT_WRITE, MAP_SHARED, tr->fd, 0);
+    if (tr->map == MAP_FAILED)
+        goto fail;
+    tr->vlan_buf = (guint8 *)g_malloc(WTAP_MAX_PACKET_SIZE + 4);
+    return tr;
+
+fail:
+    *err = errno;
+    ws_close(tr->fd);
+    g_free(tr);
+    return NULL;
+}
+
+/* Attach the capture filter to the socket, or one that just truncates
+   packets to the snapshot length if there's no filter, and start
+   capturing.  The libpcap handle is closed on success. */
+static gboolean
+tpacket_start(pcap_options *pcap_opts, interface_options *interface_opts,
+              char *errmsg, int errmsg_len)
+{
+    tpacket_ring       *tr = pcap_opts->tpacket;
+    struct bpf_program  fcode;
+    struct sock_filter  snap_insn;
+    struct sock_fprog   prog;
+    struct packet_mreq  mreq;
+    struct sockaddr_ll  sll;
+    gboolean            have_fcode = FALSE;
+    int                 ret;
+
+    pcap_opts->snaplen = pcap_snapshot(pcap_opts->pcap_h);
+    if (interface_opts->cfilter != NULL && interface_opts->cfilter[0] != '\0') {
+        /* capture_loop_init_filter() has already checked it */
+        if (!compile_capture_filter(interface_opts->name, pcap_opts->pcap_h,
+                                    &fcode, interface_opts->cfilter)) {
+            g_snprintf(errmsg, errmsg_len, "%s", pcap_geterr(pcap_opts->pcap_h));
+            return FALSE;
+        }
+        have_fcode = TRUE;
+        /* struct bpf_insn and struct sock_filter have the same layout */
+        prog.len = fcode.bf_len;
+        prog.filter = (struct sock_filter *)(void *)fcode.bf_insns;
+    } else {
+        snap_insn.code = BPF_RET|BPF_K;
+        snap_insn.jt = 0;
+        snap_insn.jf = 0;
+        snap_insn.k = pcap_opts->snaplen;
+        prog.len = 1;
+        prog.filter = &snap_insn;
+    }
+    ret = setsockopt(tr->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof prog);
+    if (have_fcode)
+        g_free(fcode.bf_insns);
+    if (ret == -1) {
+        g_snprintf(errmsg, errmsg_len, "Can't install filter (%s).", g_strerror(errno));
+        return FALSE;
+    }
+
+    if (interface_opts->promisc_mode) {
+        memset(&mreq, 0, sizeof mreq);
+        mreq.mr_ifindex = tr->ifindex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(tr->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof mreq) == -1) {
+            g_snprintf(errmsg, errmsg_len,
+                       "Couldn't put %s into promiscuous mode: %s",
+                       interface_opts->name, g_strerror(errno));
+            return FALSE;
+        }
+    }
+
+    memset(&sll, 0, sizeof sll);
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex = tr->ifindex;
+    if (bind(tr->fd, (struct sockaddr *)&sll, sizeof sll) == -1) {
+        g_snprintf(errmsg, errmsg_len, "Couldn't bind to %s: %s",
+                   interface_opts->name, g_strerror(errno));
+        return FALSE;
+    }
+
+    pcap_close(pcap_opts->pcap_h);
+    pcap_opts->pcap_h = NULL;
+#ifdef MUST_DO_SELECT
+    pcap_opts->pcap_fd = -1;
+#endif
+    return TRUE;
+}
+
+static void
+tpacket_close(tpacket_ring *tr)
+{
+    munmap(tr->map, tr->map_len);
+    ws_close(tr->fd);
+    g_free(tr->vlan_buf);
+    g_free(tr);
+}
+
+static gboolean
+tpacket_stats(tpacket_ring *tr, struct pcap_stat *ps)
+{
+    struct tpacket_stats_v3 st;
+    socklen_t               len = sizeof st;
+
+    if (getsockopt(tr->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == -1)
+        return FALSE;
+    tr->packets += st.tp_packets;
+    tr->drops += st.tp_drops;
+    ps->ps_recv = (u_int)tr->packets;
+    ps->ps_drop = (u_int)tr->drops;
+    ps->ps_ifdrop = 0;
+    return TRUE;
+}
+
+/* Wait for the kernel to hand us a block, then write or queue the
+   packets of all the blocks it has handed us.  Returns the number of
+   packets seen, or -1 on error. */
+static int
+tpacket_dispatch(loop_data *ld, pcap_options *pcap_opts, char *errmsg, int errmsg_len)
+{
+    tpacket_ring              *tr = pcap_opts->tpacket;
+    struct tpacket_block_desc *bd;
+    struct tpacket3_hdr       *hdr;
+    struct pcap_pkthdr         phdr;
+    const guint8              *pd;
+    struct pollfd              pfd;
+    guint32                    i, num_pkts;
+    int                        inpkts = 0;
+    int                        ret, sock_err;
+    socklen_t                  len;
+
+    bd = (struct tpacket_block_desc *)(tr->map + (size_t)tr->block_idx * TPACKET_BLOCK_SIZE);
+    if (!(g_atomic_int_get((gint *)&bd->hdr.bh1.block_status) & TP_STATUS_USER)) {
+        pfd.fd = tr->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        ret = poll(&pfd, 1, CAP_READ_TIMEOUT);
+        if (ret == -1) {
+            if (errno == EINTR)
+                return 0;
+            g_snprintf(errmsg, errmsg_len,
+                       "Unexpected error from poll: %s", g_strerror(errno));
+            report_capture_error(errmsg, please_report);
+            return -1;
+        }
+        if (pfd.revents & POLLERR) {
+            len = sizeof sock_err;
+            if (getsockopt(tr->fd, SOL_SOCKET, SO_ERROR, &sock_err, &len) == -1)
+                sock_err = errno;
+            if (sock_err == ENETDOWN || sock_err == ENXIO || sock_err == ENODEV) {
+                report_capture_error("The network adapter on which the capture was being done "
+                                     "is no longer running; the capture has stopped.",
+                                     "");
+            } else {
+                g_snprintf(errmsg, errmsg_len, "Error while capturing packets: %s",
+                           g_strerror(sock_err));
+                report_capture_error(errmsg, please_report);
+            }
+            return -1;
+        }
+    }
+
+    while (g_atomic_int_get((gint *)&bd->hdr.bh1.block_status) & TP_STATUS_USER) {
+        num_pkts = bd->hdr.bh1.num_pkts;
+        hdr = (struct tpacket3_hdr *)((guint8 *)bd + bd->hdr.bh1.offset_to_first_pkt);
+        for (i = 0; i < num_pkts; i++) {
+            phdr.ts.tv_sec = hdr->tp_sec;
+            phdr.ts.tv_usec = hdr->tp_nsec;         /* pcap_opts->ts_nsec is set */
+            phdr.caplen = hdr->tp_snaplen;
+            phdr.len = hdr->tp_len;
+            pd = (const guint8 *)hdr + hdr->tp_mac;
+#ifdef TP_STATUS_VLAN_VALID
+            /* The kernel strips VLAN tags; put them back, as libpcap does */
+            if ((hdr->hv1.tp_vlan_tci != 0 || (hdr->tp_status & TP_STATUS_VLAN_VALID)) &&
+                phdr.caplen >= 12 && phdr.caplen <= WTAP_MAX_PACKET_SIZE) {
+                guint16 tpid = 0x8100;
+
+#ifdef TP_STATUS_VLAN_TPID_VALID
+                if (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID)
+                    tpid = hdr->hv1.tp_vlan_tpid;
+#endif
+                memcpy(tr->vlan_buf, pd, 12);
+                tr->vlan_buf[12] = tpid >> 8;
+                tr->vlan_buf[13] = tpid & 0xff;
+                tr->vlan_buf[14] = hdr->hv1.tp_vlan_tci >> 8;
+                tr->vlan_buf[15] = hdr->hv1.tp_vlan_tci & 0xff;
+                memcpy(tr->vlan_buf + 16, pd + 12, phdr.caplen - 12);
+                pd = tr->vlan_buf;
+                phdr.caplen += 4;
+                phdr.len += 4;
+            }
+#endif
+            if (use_threads) {
+                capture_loop_queue_packet_cb((u_char *)pcap_opts, &phdr, pd);
+            } else {
+                capture_loop_write_packet_cb((u_char *)pcap_opts, &phdr, pd);
+            }
+            hdr = (struct tpacket3_hdr *)((guint8 *)hdr + hdr->tp_next_offset);
+        }
+        inpkts += num_pkts;
+
+        /* All of its packets have been written; give it back */
+        g_atomic_int_set((gint *)&bd->hdr.bh1.block_status, TP_STATUS_KERNEL);
+        tr->block_idx = (tr->block_idx + 1) % tr->block_nr;
+        bd = (struct tpacket_block_desc *)(tr->map + (size_t)tr->block_idx * TPACKET_BLOCK_SIZE);
+        if (!ld->go)
+            break;
+    }
+    return inpkts;
+}
+#endif /* HAVE_TPACKET3 */
+
+/* Get the capture statistics for an interface, from libpcap or from
+   our own ring.  Returns TRUE on success. */
+static gboolean
+capture_loop_get_stats(pcap_options *pcap_opts, struct pcap_stat *ps)
+{
+#ifdef HAVE_TPACKET3
+    if (pcap_opts->tpacket != NULL)
+        return tpacket_stats(pcap_opts->tpacket, ps);
+#endif
+    if (pcap_opts->pcap_h == NULL)
+        return FALSE;
+    return pcap_stats(pcap_opts->pcap_h, ps) >= 0;
+}
+
+/* How often, in milliseconds, a capture thread publishes the statistics
+   of its interface for the periodic interface statistics blocks */
+#define ISB_STATS_UPD_TIME 500
+
+/* While a capture thread is in pcap_dispatch(), nobody else may call
+   pcap_stats() on its pcap_t, so in threaded mode the capture thread
+   gets the statistics itself, between dispatches, and publishes them
+   for capture_loop_write_isbs(). */
+static void
+capture_loop_publish_stats(pcap_options *pcap_opts)
+{
+    struct pcap_stat stats;
+    guint64          now = create_timestamp();
+
+    if (now - pcap_opts->isb_stats_time < ISB_STATS_UPD_TIME*1000)
+        return;
+    pcap_opts->isb_stats_time = now;
+    if (capture_loop_get_stats(pcap_opts, &stats)) {
+        g_atomic_int_set(&pcap_opts->isb_stats_drop, (gint)stats.ps_drop);
+        g_atomic_int_set(&pcap_opts->isb_stats_known, TRUE);
+    }
+}
+
 /** Open the capture input file (pcap or capture pipe).
  *  Returns TRUE if it succeeds, FALSE otherwise. */
 static gboolean
@@ -2617,6 +3200,11 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
         pcap_opts->pcap_err = FALSE;
         pcap_opts->interface_id = i;
         pcap_opts->tid = NULL;
+        pcap_opts->ring = NULL;
+        pcap_opts->tpacket = NULL;
+        pcap_opts->isb_stats_known = FALSE;
+        pcap_opts->isb_stats_drop = 0;
+        pcap_opts->isb_stats_time = 0;
         pcap_opts->snaplen = 0;
         pcap_opts->linktype = -1;
         pcap_opts->ts_nsec = FALSE;
@@ -2708,6 +3296,22 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
                 return FALSE;
             }
             pcap_opts->linktype = get_pcap_linktype(pcap_opts->pcap_h, interface_opts.name);
+#ifdef HAVE_TPACKET3
+            if (use_tpacket && pcap_opts->linktype == DLT_EN10MB &&
+                !interface_opts.monitor_mode) {
+                int tpacket_err;
+
+                pcap_opts->tpacket = tpacket_open(&interface_opts, &tpacket_err);
+                if (pcap_opts->tpacket != NULL) {
+                    /* The kernel gives us nanosecond time stamps */
+                    pcap_opts->ts_nsec = TRUE;
+                } else {
+                    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+                          "Couldn't set up a TPACKET_V3 ring for %s (%s); capturing with libpcap.",
+                          interface_opts.name, g_strerror(tpacket_err));
+                }
+            }
+#endif
         } else {
             /* We couldn't open "iface" as a network device. */
             /* Try to open it as a pipe */
@@ -2802,6 +3406,16 @@ static void capture_loop_close_input(loop_data *ld)
             pcap_close(pcap_opts->pcap_h);
             pcap_opts->pcap_h = NULL;
         }
+        if (pcap_opts->ring != NULL) {
+            pcap_ring_free(pcap_opts->ring);
+            pcap_opts->ring = NULL;
+        }
+#ifdef HAVE_TPACKET3
+        if (pcap_opts->tpacket != NULL) {
+            tpacket_close(pcap_opts->tpacket);
+            pcap_opts->tpacket = NULL;
+        }
+#endif
     }
 
     ld->go = FALSE;
@@ -2832,14 +3446,10 @@ capture_loop_init_filter(pcap_t *pcap_h, gboolean from_cap_pipe,
             return INITFILTER_BAD_FILTER;
         }
         if (pcap_setfilter(pcap_h, &fcode) < 0) {
-#ifdef HAVE_PCAP_FREECODE
-            pcap_freecode(&fcode);
-#endif
+            g_free(fcode.bf_insns);
             return INITFILTER_OTHER_ERROR;
         }
-#ifdef HAVE_PCAP_FREECODE
-        pcap_freecode(&fcode);
-#endif
+        g_free(fcode.bf_insns);
     }
 
     return INITFILTER_NO_ERROR;
@@ -2867,14 +3477,17 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
 
     /* Set up to write to the capture file. */
     if (capture_opts->multi_files_on) {
-        ld->pdh = ringbuf_init_libpcap_fdopen(&err);
+        ld->pdh = ringbuf_init_libpcap_fdopen(write_buffer_size, write_flags, &err);
     } else {
-        ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
-        if (ld->pdh == NULL) {
-            err = errno;
-        }
+        ld->pdh = pcapio_writer_fdopen(ld->save_file_fd, write_buffer_size,
+                                       write_flags, &err);
     }
     if (ld->pdh) {
+        if ((write_flags & PCAPIO_WRITER_DIRECT) &&
+            !(pcapio_writer_get_flags(ld->pdh) & PCAPIO_WRITER_DIRECT)) {
+            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+                  "Direct I/O isn't supported for the capture file; writing it through the page cache.");
+        }
         if (capture_opts->use_pcapng) {
             char appname[100];
             GString             *os_info_str;
@@ -2897,7 +3510,8 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
                 pcap_opts = g_array_index(ld->pcaps, pcap_options *, i);
                 if (pcap_opts->from_cap_pipe) {
                     pcap_opts->snaplen = pcap_opts->cap_pipe_hdr.snaplen;
-                } else {
+                } else if (pcap_opts->pcap_h != NULL) {
+                    /* else it's a TPACKET_V3 ring; tpacket_start() set it */
                     pcap_opts->snaplen = pcap_snapshot(pcap_opts->pcap_h);
                 }
                 successful = pcapng_write_interface_description_block(global_ld.pdh,
@@ -2920,14 +3534,20 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
             pcap_opts = g_array_index(ld->pcaps, pcap_options *, 0);
             if (pcap_opts->from_cap_pipe) {
                 pcap_opts->snaplen = pcap_opts->cap_pipe_hdr.snaplen;
-            } else {
+            } else if (pcap_opts->pcap_h != NULL) {
                 pcap_opts->snaplen = pcap_snapshot(pcap_opts->pcap_h);
             }
             successful = libpcap_write_file_header(ld->pdh, pcap_opts->linktype, pcap_opts->snaplen,
                                                    pcap_opts->ts_nsec, &ld->bytes_written, &err);
         }
         if (!successful) {
-            fclose(ld->pdh);
+            int close_err;
+
+            /* With a ringbuffer, ringbuf_error_cleanup() closes it. */
+            if (!capture_opts->multi_files_on) {
+                pcapio_writer_close(ld->pdh, &close_err);
+                ld->save_file_fd = -1;
+            }
             ld->pdh = NULL;
         }
     }
@@ -2958,49 +3578,71 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     return TRUE;
 }
 
+/* Write an Interface Statistics Block, with the counters since the
+   start of the capture, for each interface that isn't a pipe. */
 static gboolean
-capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err_close)
+capture_loop_write_isbs(loop_data *ld, int *err)
 {
-
     unsigned int  i;
     pcap_options *pcap_opts;
     guint64       end_time = create_timestamp();
 
+    for (i = 0; i < ld->pcaps->len; i++) {
+        pcap_opts = g_array_index(ld->pcaps, pcap_options *, i);
+        if (!pcap_opts->from_cap_pipe) {
+            guint64 isb_ifrecv, isb_ifdrop;
+            struct pcap_stat stats;
+            gboolean stats_known;
+
+            if (pcap_opts->tid != NULL) {
+                /* its capture thread is running; use what it published */
+                stats_known = g_atomic_int_get(&pcap_opts->isb_stats_known);
+                stats.ps_drop = (u_int)g_atomic_int_get(&pcap_opts->isb_stats_drop);
+            } else {
+                stats_known = capture_loop_get_stats(pcap_opts, &stats);
+            }
+            if (stats_known) {
+                isb_ifrecv = pcap_opts->received;
+                isb_ifdrop = stats.ps_drop + pcap_opts->dropped + pcap_opts->flushed;
+           } else {
+                isb_ifrecv = G_MAXUINT64;
+                isb_ifdrop = G_MAXUINT64;
+            }
+            if (!pcapng_write_interface_statistics_block(ld->pdh,
+                                                         i,
+                                                         &ld->bytes_written,
+                                                         "Counters provided by dumpcap",
+                                                         start_time,
+                                                         end_time,
+                                                         isb_ifrecv,
+                                                         isb_ifdrop,
+                                                         err))
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static gboolean
+capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err_close)
+{
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_close_output");
 
     if (capture_opts->multi_files_on) {
-        return ringbuf_libpcap_dump_close(&capture_opts->save_file, err_close);
+        gboolean isbs_ok = TRUE;
+
+        if (isb_interval != 0 && ld->pdh != NULL)
+            isbs_ok = capture_loop_write_isbs(ld, err_close);
+        /* close the file even if writing the statistics failed */
+        if (!ringbuf_libpcap_dump_close(&capture_opts->save_file,
+                                        isbs_ok ? err_close : NULL))
+            return FALSE;
+        return isbs_ok;
     } else {
         if (capture_opts->use_pcapng) {
-            for (i = 0; i < global_ld.pcaps->len; i++) {
-                pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
-                if (!pcap_opts->from_cap_pipe) {
-                    guint64 isb_ifrecv, isb_ifdrop;
-                    struct pcap_stat stats;
-
-                    if (pcap_stats(pcap_opts->pcap_h, &stats) >= 0) {
-                        isb_ifrecv = pcap_opts->received;
-                        isb_ifdrop = stats.ps_drop + pcap_opts->dropped + pcap_opts->flushed;
-                   } else {
-                        isb_ifrecv = G_MAXUINT64;
-                        isb_ifdrop = G_MAXUINT64;
-                    }
-                    pcapng_write_interface_statistics_block(ld->pdh,
-                                                            i,
-                                                            &ld->bytes_written,
-                                                            "Counters provided by dumpcap",
-                                                            start_time,
-                                                            end_time,
-                                                            isb_ifrecv,
-                                                            isb_ifdrop,
-                                                            err_close);
-                }
-            }
+            capture_loop_write_isbs(ld, err_close);
         }
-        if (fclose(ld->pdh) == EOF) {
-            if (err_close != NULL) {
-                *err_close = errno;
-            }
+        if (!pcapio_writer_close(ld->pdh, err_close)) {
             return (FALSE);
         } else {
             return (TRUE);
@@ -3008,6 +3650,20 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
     }
 }
 
+/* Write out everything written to the capture file so far, so that
+   whoever's reading it sees it.  Errors stop the capture, just as
+   errors writing packets do. */
+static void
+capture_loop_flush_output(void)
+{
+    int err;
+
+    if (!pcapio_writer_flush(global_ld.pdh, &err)) {
+        global_ld.go = FALSE;
+        global_ld.err = err;
+    }
+}
+
 /* dispatch incoming packets (pcap or capture pipe)
  *
  * Waits for incoming packets to be available, and calls pcap_dispatch()
@@ -3058,6 +3714,19 @@ capture_loop_dispatch(loop_data *ld,
         }
 #endif
     }
+#ifdef HAVE_TPACKET3
+    else if (pcap_opts->tpacket != NULL)
+    {
+        /* dispatch from our own TPACKET_V3 ring */
+#ifdef LOG_CAPTURE_VERBOSE
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_dispatch: from TPACKET_V3 ring");
+#endif
+        inpkts = tpacket_dispatch(ld, pcap_opts, errmsg, errmsg_len);
+        if (inpkts < 0) {
+            ld->go = FALSE;
+        }
+    }
+#endif
     else
     {
         /* dispatch from pcap */
@@ -3265,6 +3934,9 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
 
                 /* we need the ringbuf name */
                 if (*save_file_fd != -1) {
+                    ringbuf_set_rotation(rotated_compression, fsync_rotated);
+                    if (use_flow_index)
+                        ringbuf_set_companion_suffix(FLOW_INDEX_SUFFIX);
                     g_free(capfile_name);
                     capfile_name = g_strdup(ringbuf_current_filename());
                 }
@@ -3341,6 +4013,109 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
 }
 
 
+/* Add a packet written at "offset" in the current file to its flow index */
+static void
+capture_loop_index_packet(pcap_options *pcap_opts, const struct pcap_pkthdr *phdr,
+                          const u_char *pd, guint32 caplen, guint64 offset)
+{
+    flow_link_type link;
+    flow_key       key;
+    guint64        ts;
+
+    switch (pcap_opts->linktype) {
+
+    case DLT_EN10MB:
+        link = FLOW_LINK_ETHERNET;
+        break;
+
+#ifdef DLT_LINUX_SLL
+    case DLT_LINUX_SLL:
+        link = FLOW_LINK_LINUX_SLL;
+        break;
+#endif
+
+    case DLT_RAW:
+        link = FLOW_LINK_RAW_IP;
+        break;
+
+#ifdef DLT_IEEE802_15_4
+    case DLT_IEEE802_15_4:
+#endif
+#ifdef DLT_IEEE802_15_4_NOFCS
+    case DLT_IEEE802_15_4_NOFCS:
+#endif
+        link = FLOW_LINK_IEEE802_15_4;
+        break;
+
+    default:
+        return;
+    }
+
+    if (!flow_key_from_packet(&key, link, pd, caplen))
+        return;
+    ts = (guint64)phdr->ts.tv_sec * 1000000000 +
+         (guint64)phdr->ts.tv_usec * (pcap_opts->ts_nsec ? 1 : 1000);
+    flow_index_add(global_ld.flow_index, &key, offset,
+                   (guint32)(global_ld.bytes_written - offset), phdr->len, ts);
+}
+
+#ifdef HAVE_SYNC_RING
+/* Hand a packet written at "offset" in the current file to our parent
+   through the packet ring as well.  The parent makes up the packet's
+   record from the link-layer type alone, so a packet of a type that
+   needs a pseudo-header is left for it to read from the file, and so
+   is everything after it. */
+static void
+capture_loop_ring_packet(pcap_options *pcap_opts, const struct pcap_pkthdr *phdr,
+                         const u_char *pd, guint32 caplen, guint64 offset)
+{
+    guint32 ts_nsec;
+
+    switch (pcap_opts->linktype) {
+
+    case DLT_NULL:
+    case DLT_EN10MB:
+    case DLT_RAW:
+#ifdef DLT_LINUX_SLL
+    case DLT_LINUX_SLL:
+#endif
+#ifdef DLT_IEEE802_15_4
+    case DLT_IEEE802_15_4:
+#endif
+#ifdef DLT_IEEE802_15_4_NOFCS
+    case DLT_IEEE802_15_4_NOFCS:
+#endif
+        break;
+
+    default:
+        sync_ring_shut(packet_ring);
+        return;
+    }
+
+    ts_nsec = (guint32)phdr->ts.tv_usec * (pcap_opts->ts_nsec ? 1 : 1000);
+    sync_ring_put(packet_ring, pcap_opts->interface_id, pcap_opts->linktype,
+                  (gint64)phdr->ts.tv_sec, ts_nsec, caplen, phdr->len,
+                  offset, pd);
+}
+#endif
+
+/* Write the flow index of the file we've been writing to, if we keep
+   one.  The index only helps finding packets, so failing to write it
+   doesn't stop the capture. */
+static void
+capture_loop_write_flow_index(const char *save_file)
+{
+    int err;
+
+    if (global_ld.flow_index == NULL)
+        return;
+    if (!flow_index_write(global_ld.flow_index, save_file, &err)) {
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_WARNING,
+              "Couldn't write the flow index for \"%s\": %s",
+              save_file, g_strerror(err));
+    }
+}
+
 /* Do the work of handling either the file size or file duration capture
    conditions being reached, and switching files or stopping. */
 static gboolean
@@ -3362,7 +4137,15 @@ do_file_switch_or_stop(capture_options *capture_opts,
             return FALSE;
         }
 
+        /* Finish this file off with the interface statistics so far, if
+           we're writing them periodically */
+        if (isb_interval != 0 && !capture_loop_write_isbs(&global_ld, &global_ld.err)) {
+            global_ld.go = FALSE;
+            return FALSE;
+        }
+
         /* Switch to the next ringbuffer file */
+        capture_loop_write_flow_index(capture_opts->save_file);
         if (ringbuf_switch_file(&global_ld.pdh, &capture_opts->save_file,
                                 &global_ld.save_file_fd, &global_ld.err)) {
 
@@ -3410,7 +4193,8 @@ do_file_switch_or_stop(capture_options *capture_opts,
                                                        pcap_opts->ts_nsec, &global_ld.bytes_written, &global_ld.err);
             }
             if (!successful) {
-                fclose(global_ld.pdh);
+                /* The ringbuffer still owns the stream;
+                   capture_loop_close_output() will close it. */
                 global_ld.pdh = NULL;
                 global_ld.go = FALSE;
                 return FALSE;
@@ -3419,7 +4203,7 @@ do_file_switch_or_stop(capture_options *capture_opts,
                 cnd_reset(cnd_autostop_size);
             if (cnd_file_duration)
                 cnd_reset(cnd_file_duration);
-            fflush(global_ld.pdh);
+            capture_loop_flush_output();
             if (!quiet)
                 report_packet_count(global_ld.inpkts_to_sync_pipe);
             global_ld.inpkts_to_sync_pipe = 0;
@@ -3437,6 +4221,226 @@ do_file_switch_or_stop(capture_options *capture_opts,
     return TRUE;
 }
 
+#define PCAP_RING_RECLEN(caplen) \
+    ((guint)((sizeof(pcap_ring_rec) + (caplen) + PCAP_RING_ALIGN - 1) & ~(PCAP_RING_ALIGN - 1)))
+
+/* Allocate a ring for an interface with the given snapshot length. */
+static pcap_ring *
+pcap_ring_new(int snaplen)
+{
+    pcap_ring *ring;
+    guint64    want;
+    guint      size;
+
+    if (snaplen <= 0 || snaplen > WTAP_MAX_PACKET_SIZE)
+        snaplen = WTAP_MAX_PACKET_SIZE;
+    if (pcap_queue_byte_limit > 0)
+        want = (guint64)pcap_queue_byte_limit;
+    else
+        want = (guint64)pcap_queue_packet_limit * snaplen;
+    if (pcap_queue_packet_limit > 0)
+        want += (guint64)pcap_queue_packet_limit * PCAP_RING_RECLEN(0);
+    /* room for the largest packet, and the filler before it when wrapping */
+    want += 2 * (guint64)PCAP_RING_RECLEN(snaplen);
+    if (want > PCAP_RING_MAX_SIZE)
+        want = PCAP_RING_MAX_SIZE;
+
+    for (size = PCAP_RING_MIN_SIZE; size < want; size <<= 1)
+        ;
+
+    ring = (pcap_ring *)g_malloc0(sizeof (pcap_ring));
+    ring->buf = (guchar *)g_malloc(size);
+    ring->size = size;
+    ring->limit = (guint)want;
+    ring->packet_limit = (guint)pcap_queue_packet_limit;
+    return ring;
+}
+
+static void
+pcap_ring_free(pcap_ring *ring)
+{
+    g_free(ring->buf);
+    g_free(ring);
+}
+
+/*
+ * Put a packet into the ring; called from the capture thread.
+ * Returns FALSE if there's no room for it.
+ */
+static gboolean
+pcap_ring_put(pcap_ring *ring, const struct pcap_pkthdr *phdr, const u_char *pd)
+{
+    guint          head = (guint)ring->head;
+    guint          used = head - (guint)g_atomic_int_get(&ring->tail);
+    guint          reclen = PCAP_RING_RECLEN(phdr->caplen);
+    guint          off = head & (ring->size - 1);
+    guint          fill = 0;
+    pcap_ring_rec *rec;
+
+    if (ring->packet_limit != 0 &&
+        (guint)ring->packets_in - (guint)g_atomic_int_get(&ring->packets_out) >= ring->packet_limit)
+        return FALSE;
+
+    /* records don't wrap around; fill out the end of the buffer if need be */
+    if (off + reclen > ring->size)
+        fill = ring->size - off;
+    if (used + fill + reclen > ring->limit)
+        return FALSE;
+
+    if (fill != 0) {
+        rec = (pcap_ring_rec *)(void *)(ring->buf + off);
+        rec->reclen = fill;
+        rec->wrap = TRUE;
+        off = 0;
+    }
+    rec = (pcap_ring_rec *)(void *)(ring->buf + off);
+    rec->reclen = reclen;
+    rec->wrap = FALSE;
+    rec->phdr = *phdr;
+    memcpy(rec + 1, pd, phdr->caplen);
+
+    used += fill + reclen;
+    if (used > ring->peak)
+        ring->peak = used;
+
+    /* make it visible to the writer thread */
+    g_atomic_int_set(&ring->head, (gint)(head + fill + reclen));
+    g_atomic_int_set(&ring->packets_in, ring->packets_in + 1);
+    return TRUE;
+}
+
+/*
+ * Get the oldest packet in the ring, without removing it; called from
+ * the writer thread.  Returns NULL if the ring is empty.
+ */
+static pcap_ring_rec *
+pcap_ring_peek(pcap_ring *ring)
+{
+    guint          head = (guint)g_atomic_int_get(&ring->head);
+    guint          tail = (guint)ring->tail;
+    pcap_ring_rec *rec;
+
+    while (tail != head) {
+        rec = (pcap_ring_rec *)(void *)(ring->buf + (tail & (ring->size - 1)));
+        if (!rec->wrap)
+            return rec;
+        /* skip the filler at the end of the buffer */
+        tail += rec->reclen;
+        g_atomic_int_set(&ring->tail, (gint)tail);
+    }
+    return NULL;
+}
+
+/* Remove the packet pcap_ring_peek() returned; called from the writer thread. */
+static void
+pcap_ring_release(pcap_ring *ring, pcap_ring_rec *rec)
+{
+    g_atomic_int_set(&ring->packets_out, ring->packets_out + 1);
+    g_atomic_int_set(&ring->tail, (gint)((guint)ring->tail + rec->reclen));
+}
+
+/*
+ * Take the oldest of the packets at the front of the capture threads'
+ * rings, and write it out.  Returns the number of packets written,
+ * i.e. 0 if the rings are empty, 1 otherwise.
+ */
+static int
+capture_loop_write_ring_packet(void)
+{
+    pcap_options  *pcap_opts, *oldest_opts = NULL;
+    pcap_ring_rec *rec, *oldest = NULL;
+    guint32        ts_nsec, oldest_ts_nsec = 0;
+    guint          i;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+        if (pcap_opts->ring == NULL)
+            continue;
+        rec = pcap_ring_peek(pcap_opts->ring);
+        if (rec == NULL)
+            continue;
+        /* Some interfaces give us microseconds, others nanoseconds. */
+        ts_nsec = (guint32)rec->phdr.ts.tv_usec * (pcap_opts->ts_nsec ? 1 : 1000);
+        if (oldest == NULL ||
+            rec->phdr.ts.tv_sec < oldest->phdr.ts.tv_sec ||
+            (rec->phdr.ts.tv_sec == oldest->phdr.ts.tv_sec &&
+             ts_nsec < oldest_ts_nsec)) {
+            oldest = rec;
+            oldest_opts = pcap_opts;
+            oldest_ts_nsec = ts_nsec;
+        }
+    }
+    if (oldest == NULL)
+        return 0;
+
+    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+          "Dequeued a packet of length %d captured on interface %d.",
+          oldest->phdr.caplen, oldest_opts->interface_id);
+    capture_loop_write_packet_cb((u_char *)oldest_opts, &oldest->phdr,
+                                 (const u_char *)(oldest + 1));
+    pcap_ring_release(oldest_opts->ring, oldest);
+    return 1;
+}
+
+/*
+ * Write out up to WRITER_BATCH_PACKETS of the packets queued by the
+ * capture threads, oldest first, so that the capture loop's checks
+ * are done once per batch rather than once per packet.  Returns the
+ * number of packets written.
+ */
+static int
+capture_loop_write_ring_packets(void)
+{
+    int n = 0;
+
+    while (n < WRITER_BATCH_PACKETS && capture_loop_write_ring_packet() != 0) {
+        n++;
+        if (!global_ld.go)
+            break;
+    }
+    return n;
+}
+
+/*
+ * Wait, for at most WRITER_THREAD_TIMEOUT, for a capture thread to
+ * queue a packet.
+ */
+static void
+capture_loop_wait_for_ring_packet(void)
+{
+    pcap_options *pcap_opts;
+    guint         i;
+    gboolean      empty = TRUE;
+#if GLIB_CHECK_VERSION(2,31,18)
+    gint64        end_time = g_get_monotonic_time() + WRITER_THREAD_TIMEOUT;
+#else
+    GTimeVal      write_thread_time;
+
+    g_get_current_time(&write_thread_time);
+    g_time_val_add(&write_thread_time, WRITER_THREAD_TIMEOUT);
+#endif
+
+    g_mutex_lock(pcap_ring_mtx);
+    /* From here on, capture threads will wake us up. */
+    g_atomic_int_set(&pcap_ring_writer_waiting, TRUE);
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+        if (pcap_opts->ring != NULL && pcap_ring_peek(pcap_opts->ring) != NULL) {
+            empty = FALSE;
+            break;
+        }
+    }
+    if (empty) {
+#if GLIB_CHECK_VERSION(2,31,18)
+        g_cond_wait_until(pcap_ring_cond, pcap_ring_mtx, end_time);
+#else
+        g_cond_timed_wait(pcap_ring_cond, pcap_ring_mtx, &write_thread_time);
+#endif
+    }
+    g_atomic_int_set(&pcap_ring_writer_waiting, FALSE);
+    g_mutex_unlock(pcap_ring_mtx);
+}
+
 static void *
 pcap_read_handler(void* arg)
 {
@@ -3451,6 +4455,8 @@ pcap_read_handler(void* arg)
     while (global_ld.go) {
         /* dispatch incoming packets */
         capture_loop_dispatch(&global_ld, errmsg, sizeof(errmsg), pcap_opts);
+        if (isb_interval != 0 && !pcap_opts->from_cap_pipe)
+            capture_loop_publish_stats(pcap_opts);
     }
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Stopped thread for interface %d.",
           pcap_opts->interface_id);
@@ -3474,6 +4480,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     condition         *cnd_autostop_files    = NULL;
     condition         *cnd_autostop_size     = NULL;
     condition         *cnd_autostop_duration = NULL;
+    condition         *cnd_isb_interval      = NULL;
     gboolean           write_ok;
     gboolean           close_ok;
     gboolean           cfilter_error         = FALSE;
@@ -3501,6 +4508,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     global_ld.pdh                 = NULL;
     global_ld.autostop_files      = 0;
     global_ld.save_file_fd        = -1;
+    global_ld.flow_index          = NULL;
 
     /* We haven't yet gotten the capture statistics. */
     *stats_known      = FALSE;
@@ -3541,6 +4549,13 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             g_snprintf(secondary_errmsg, sizeof(secondary_errmsg), "%s", please_report);
             goto error;
         }
+#ifdef HAVE_TPACKET3
+        if (pcap_opts->tpacket != NULL &&
+            !tpacket_start(pcap_opts, &interface_opts, errmsg, sizeof(errmsg))) {
+            g_snprintf(secondary_errmsg, sizeof(secondary_errmsg), "%s", please_report);
+            goto error;
+        }
+#endif
     }
 
     /* If we're supposed to write to a capture file, open it for output
@@ -3557,6 +4572,9 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             goto error;
         }
 
+        if (use_flow_index && !capture_opts->output_to_pipe)
+            global_ld.flow_index = flow_index_new();
+
         /* XXX - capture SIGTERM and close the capture, in case we're on a
            Linux 2.0[.x] system and you have to explicitly close the capture
            stream in order to turn promiscuous mode off?  We need to do that
@@ -3570,7 +4588,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
            message to our parent so that they'll open the capture file and
            update its windows to indicate that we have a live capture in
            progress. */
-        fflush(global_ld.pdh);
+        capture_loop_flush_output();
         report_new_capture_file(capture_opts->save_file);
     }
 
@@ -3597,6 +4615,8 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             cnd_autostop_files =
                 cnd_new(CND_CLASS_CAPTURESIZE, capture_opts->autostop_files);
     }
+    if (isb_interval != 0 && capture_opts->saving_to_file)
+        cnd_isb_interval = cnd_new(CND_CLASS_TIMEOUT, isb_interval);
 
     /* init the time values */
 #ifdef WIN32
@@ -3610,9 +4630,20 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
+#if GLIB_CHECK_VERSION(2,31,0)
+        pcap_ring_mtx = (GMutex *)g_malloc(sizeof(GMutex));
+        g_mutex_init(pcap_ring_mtx);
+        pcap_ring_cond = (GCond *)g_malloc(sizeof(GCond));
+        g_cond_init(pcap_ring_cond);
+#else
+        pcap_ring_mtx = g_mutex_new();
+        pcap_ring_cond = g_cond_new();
+#endif
+        pcap_ring_writer_waiting = FALSE;
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+            pcap_opts->ring = pcap_ring_new(pcap_opts->snaplen);
+        }
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
 #if GLIB_CHECK_VERSION(2,31,0)
@@ -3626,38 +4657,9 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     while (global_ld.go) {
         /* dispatch incoming packets */
         if (use_threads) {
-            pcap_queue_element *queue_element;
-#if GLIB_CHECK_VERSION(2,31,18)
-
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-#else
-            GTimeVal write_thread_time;
-
-            g_get_current_time(&write_thread_time);
-            g_time_val_add(&write_thread_time, WRITER_THREAD_TIMEOUT);
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timed_pop_unlocked(pcap_queue, &write_thread_time);
-#endif
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element) {
-                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                      "Dequeued a packet of length %d captured on interface %d.",
-                      queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-
-                capture_loop_write_packet_cb((u_char *) queue_element->pcap_opts,
-                                             &queue_element->phdr,
-                                             queue_element->pd);
-                g_free(queue_element->pd);
-                g_free(queue_element);
-                inpkts = 1;
-            } else {
-                inpkts = 0;
-            }
+            inpkts = capture_loop_write_ring_packets();
+            if (inpkts == 0)
+                capture_loop_wait_for_ring_packet();
         } else {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, 0);
             inpkts = capture_loop_dispatch(&global_ld, errmsg,
@@ -3691,7 +4693,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                     continue;
             } /* cnd_autostop_size */
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                capture_loop_flush_output();
             }
         } /* inpkts */
 
@@ -3719,8 +4721,13 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 #endif
             /* Let the parent process know. */
             if (global_ld.inpkts_to_sync_pipe) {
-                /* do sync here */
-                fflush(global_ld.pdh);
+                /* do sync here, unless our parent gets the packets through
+                   the packet ring; it only reads the file once the ring
+                   has been shut, and we flush then */
+#ifdef HAVE_SYNC_RING
+                if (packet_ring == NULL || !sync_ring_is_open(packet_ring))
+#endif
+                    capture_loop_flush_output();
 
                 /* Send our parent a message saying we've written out
                    "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
@@ -3730,6 +4737,16 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 global_ld.inpkts_to_sync_pipe = 0;
             }
 
+            /* check interface statistics interval condition */
+            if (cnd_isb_interval != NULL && global_ld.pdh != NULL &&
+                cnd_eval(cnd_isb_interval)) {
+                if (!capture_loop_write_isbs(&global_ld, &global_ld.err)) {
+                    global_ld.go = FALSE;
+                    continue;
+                }
+                cnd_reset(cnd_isb_interval);
+            }
+
             /* check capture duration condition */
             if (cnd_autostop_duration != NULL && cnd_eval(cnd_autostop_duration)) {
                 /* The maximum capture time has elapsed; stop the capture. */
@@ -3749,40 +4766,39 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopping ...");
     if (use_threads) {
-        pcap_queue_element *queue_element;
-
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Waiting for thread of interface %u...",
                   pcap_opts->interface_id);
             g_thread_join(pcap_opts->tid);
+            pcap_opts->tid = NULL;
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Thread of interface %u terminated.",
                   pcap_opts->interface_id);
         }
-        while (1) {
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_try_pop_unlocked(pcap_queue);
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element == NULL) {
-                break;
-            }
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                  "Dequeued a packet of length %d captured on interface %d.",
-                  queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-            capture_loop_write_packet_cb((u_char *)queue_element->pcap_opts,
-                                         &queue_element->phdr,
-                                         queue_element->pd);
-            g_free(queue_element->pd);
-            g_free(queue_element);
-            global_ld.inpkts_to_sync_pipe += 1;
+        while ((inpkts = capture_loop_write_ring_packets()) != 0) {
+            global_ld.inpkts_to_sync_pipe += inpkts;
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                capture_loop_flush_output();
             }
         }
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+                  "Ring of interface %u: %u bytes, at most %u used, %u packets dropped because it was full.",
+                  pcap_opts->interface_id, pcap_opts->ring->size,
+                  pcap_opts->ring->peak, pcap_opts->ring->dropped);
+        }
+#if GLIB_CHECK_VERSION(2,31,0)
+        g_mutex_clear(pcap_ring_mtx);
+        g_free(pcap_ring_mtx);
+        g_cond_clear(pcap_ring_cond);
+        g_free(pcap_ring_cond);
+#else
+        g_mutex_free(pcap_ring_mtx);
+        g_cond_free(pcap_ring_cond);
+#endif
+        pcap_ring_mtx = NULL;
+        pcap_ring_cond = NULL;
     }
 
 
@@ -3795,6 +4811,8 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         cnd_delete(cnd_autostop_size);
     if (cnd_autostop_duration != NULL)
         cnd_delete(cnd_autostop_duration);
+    if (cnd_isb_interval != NULL)
+        cnd_delete(cnd_isb_interval);
 
     /* did we have a pcap (input) error? */
     for (i = 0; i < capture_opts->ifaces->len; i++) {
@@ -3848,6 +4866,9 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     if (capture_opts->saving_to_file) {
         /* close the output file */
         close_ok = capture_loop_close_output(capture_opts, &global_ld, &err_close);
+        capture_loop_write_flow_index(capture_opts->save_file);
+        flow_index_free(global_ld.flow_index);
+        global_ld.flow_index = NULL;
     } else
         close_ok = TRUE;
 
@@ -3859,6 +4880,13 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         global_ld.inpkts_to_sync_pipe = 0;
     }
 
+#ifdef HAVE_SYNC_RING
+    if (packet_ring != NULL) {
+        sync_ring_free(packet_ring);
+        packet_ring = NULL;
+    }
+#endif
+
     /* If we've displayed a message about a write error, there's no point
        in displaying another message about an error on close. */
     if (!close_ok && write_ok) {
@@ -3894,13 +4922,16 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
              * platforms; initialize it to 0 to handle that.
              */
             stats->ps_ifdrop = 0;
-            if (pcap_stats(pcap_opts->pcap_h, stats) >= 0) {
+            if (capture_loop_get_stats(pcap_opts, stats)) {
                 *stats_known = TRUE;
                 /* Let the parent process know. */
                 pcap_dropped += stats->ps_drop;
             } else {
                 g_snprintf(errmsg, sizeof(errmsg),
                            "Can't get packet-drop statistics: %s",
+#ifdef HAVE_TPACKET3
+                           pcap_opts->tpacket != NULL ? g_strerror(errno) :
+#endif
                            pcap_geterr(pcap_opts->pcap_h));
                 report_capture_error(errmsg, please_report);
             }
@@ -3921,7 +4952,7 @@ error:
         /* cleanup ringbuffer */
         ringbuf_error_cleanup();
     } else {
-        /* We can't use the save file, and we have no FILE * for the stream
+        /* We can't use the save file, and we have no output stream
            to close in order to close it, so close the FD directly. */
         if (global_ld.save_file_fd != -1) {
             ws_close(global_ld.save_file_fd);
@@ -4019,6 +5050,8 @@ capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
     pcap_options *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
     int           err;
     guint         ts_mul    = pcap_opts->ts_nsec ? 1000000000 : 1000000;
+    guint32       caplen    = phdr->caplen;
+    guint64       offset    = global_ld.bytes_written;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4031,6 +5064,11 @@ capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
     if (global_ld.pdh) {
         gboolean successful;
 
+        /* Cut off what the user doesn't want to keep; the original
+           length is still recorded. */
+        if (capture_slicer != NULL)
+            caplen = capture_slice_len(capture_slicer, pcap_opts->linktype, pd, caplen);
+
         /* We're supposed to write the packet to a file; do so.
            If this fails, set "ld->go" to FALSE, to stop the capture, and set
            "ld->err" to the error. */
@@ -4038,7 +5076,7 @@ capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
             successful = pcapng_write_enhanced_packet_block(global_ld.pdh,
                                                             NULL,
                                                             phdr->ts.tv_sec, (gint32)phdr->ts.tv_usec,
-                                                            phdr->caplen, phdr->len,
+                                                            caplen, phdr->len,
                                                             pcap_opts->interface_id,
                                                             ts_mul,
                                                             pd, 0,
@@ -4046,7 +5084,7 @@ capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         } else {
             successful = libpcap_write_packet(global_ld.pdh,
                                               phdr->ts.tv_sec, (gint32)phdr->ts.tv_usec,
-                                              phdr->caplen, phdr->len,
+                                              caplen, phdr->len,
                                               pd,
                                               &global_ld.bytes_written, &err);
         }
@@ -4058,7 +5096,13 @@ capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
 #if defined(DEBUG_DUMPCAP) || defined(DEBUG_CHILD_DUMPCAP)
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
                   "Wrote a packet of length %d captured on interface %u.",
-                   phdr->caplen, pcap_opts->interface_id);
+                   caplen, pcap_opts->interface_id);
+#endif
+            if (global_ld.flow_index != NULL)
+                capture_loop_index_packet(pcap_opts, phdr, pd, caplen, offset);
+#ifdef HAVE_SYNC_RING
+            if (packet_ring != NULL && sync_ring_is_open(packet_ring))
+                capture_loop_ring_packet(pcap_opts, phdr, pd, caplen, offset);
 #endif
             global_ld.packet_count++;
             pcap_opts->received++;
@@ -4075,9 +5119,7 @@ static void
 capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
                              const u_char *pd)
 {
-    pcap_options       *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
-    pcap_queue_element *queue_element;
-    gboolean            limit_reached;
+    pcap_options *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4087,49 +5129,22 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
-    if (queue_element == NULL) {
-       pcap_opts->dropped++;
-       return;
-    }
-    queue_element->pcap_opts = pcap_opts;
-    queue_element->phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
+    if (!pcap_ring_put(pcap_opts->ring, phdr, pd)) {
+        pcap_opts->ring->dropped++;
         pcap_opts->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
-        pcap_opts->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
               "Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_opts->interface_id);
-    } else {
-        pcap_opts->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a packet of length %d captured on interface %u.",
-              phdr->caplen, pcap_opts->interface_id);
+        return;
+    }
+    pcap_opts->received++;
+
+    /* If the writer thread is waiting for packets, wake it up. */
+    if (g_atomic_int_get(&pcap_ring_writer_waiting)) {
+        g_mutex_lock(pcap_ring_mtx);
+        g_cond_signal(pcap_ring_cond);
+        g_mutex_unlock(pcap_ring_mtx);
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
-    g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
 }
 
 static int
@@ -4199,6 +5214,22 @@ main(int argc, char *argv[])
     static const struct option long_options[] = {
         {(char *)"help", no_argument, NULL, 'h'},
         {(char *)"version", no_argument, NULL, 'v'},
+        {(char *)"write-buffer", required_argument, NULL, LONGOPT_WRITE_BUFFER},
+        {(char *)"direct-io", no_argument, NULL, LONGOPT_DIRECT_IO},
+        {(char *)"compress-rotated", required_argument, NULL, LONGOPT_COMPRESS_ROTATED},
+        {(char *)"fsync-rotated", no_argument, NULL, LONGOPT_FSYNC_ROTATED},
+        {(char *)"slice", required_argument, NULL, LONGOPT_SLICE},
+        {(char *)"flow-index", no_argument, NULL, LONGOPT_FLOW_INDEX},
+        {(char *)"isb-interval", required_argument, NULL, LONGOPT_ISB_INTERVAL},
+#ifndef _WIN32
+        {(char *)"bench-filter", required_argument, NULL, LONGOPT_BENCH_FILTER},
+#endif
+#ifdef HAVE_SYNC_RING
+        {(char *)"packet-ring", required_argument, NULL, LONGOPT_PACKET_RING},
+#endif
+#ifdef HAVE_TPACKET3
+        {(char *)"tpacket", no_argument, NULL, LONGOPT_TPACKET},
+#endif
         LONGOPT_CAPTURE_COMMON
         {0, 0, 0, 0 }
     };
@@ -4219,6 +5250,9 @@ main(int argc, char *argv[])
     gboolean          list_link_layer_types = FALSE;
 #ifdef HAVE_BPF_IMAGE
     gboolean          print_bpf_code        = FALSE;
+#endif
+#ifndef _WIN32
+    const char       *bench_filter_file     = NULL;
 #endif
     gboolean          set_chan              = FALSE;
     gchar            *set_chan_arg          = NULL;
@@ -4648,6 +5682,77 @@ main(int argc, char *argv[])
         case 'N':
             pcap_queue_packet_limit = get_positive_int(optarg, "packet_limit");
             break;
+        case LONGOPT_WRITE_BUFFER:
+            write_buffer_size = (size_t)get_positive_int(optarg, "write buffer size") * 1024;
+            break;
+        case LONGOPT_DIRECT_IO:
+            write_flags |= PCAPIO_WRITER_DIRECT;
+            break;
+        case LONGOPT_COMPRESS_ROTATED:
+#ifdef HAVE_LIBZ
+            if (strcmp(optarg, "gzip") == 0) {
+                rotated_compression = RINGBUF_COMPRESS_GZIP;
+                break;
+            }
+#endif
+#ifdef HAVE_ZSTD
+            if (strcmp(optarg, "zstd") == 0) {
+                rotated_compression = RINGBUF_COMPRESS_ZSTD;
+                break;
+            }
+#endif
+            cmdarg_err("Unsupported compression type for rotated files: \"%s\"", optarg);
+            exit_main(1);
+            break;
+        case LONGOPT_FSYNC_ROTATED:
+            fsync_rotated = TRUE;
+            break;
+        case LONGOPT_SLICE:
+        {
+            char *slice_err;
+
+            capture_slice_free(capture_slicer);
+            capture_slicer = capture_slice_new(optarg, &slice_err);
+            if (capture_slicer == NULL) {
+                cmdarg_err("%s", slice_err);
+                g_free(slice_err);
+                exit_main(1);
+            }
+            break;
+        }
+        case LONGOPT_FLOW_INDEX:
+            use_flow_index = TRUE;
+            break;
+        case LONGOPT_ISB_INTERVAL:
+            isb_interval = get_positive_int(optarg, "interface statistics interval");
+            break;
+#ifndef _WIN32
+        case LONGOPT_BENCH_FILTER:
+            bench_filter_file = optarg;
+            run_once_args++;
+            break;
+#endif
+#ifdef HAVE_SYNC_RING
+        case LONGOPT_PACKET_RING:
+        {
+            int ring_fd = get_natural_int(optarg, "packet ring descriptor");
+            int ring_err;
+
+            /* Not being able to use the ring isn't fatal; our parent
+               reads the packets from the capture file instead. */
+            packet_ring = sync_ring_attach(ring_fd, &ring_err);
+            if (packet_ring == NULL)
+                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+                      "Couldn't attach to packet ring: %s",
+                      ring_err != 0 ? g_strerror(ring_err) : "not a packet ring");
+            break;
+        }
+#endif
+#ifdef HAVE_TPACKET3
+        case LONGOPT_TPACKET:
+            use_tpacket = TRUE;
+            break;
+#endif
         default:
             cmdarg_err("Invalid Option: %s", argv[optind-1]);
             /* FALLTHROUGH */
@@ -4715,6 +5820,18 @@ main(int argc, char *argv[])
             exit_main(1);
         }
 
+        if (isb_interval != 0 && !global_capture_opts.use_pcapng) {
+            cmdarg_err("Interface statistics can only be written periodically to pcapng files.");
+            exit_main(1);
+        }
+
+        if (use_flow_index &&
+            (global_capture_opts.save_file == NULL ||
+             strcmp(global_capture_opts.save_file, "-") == 0)) {
+            cmdarg_err("A flow index can only be written if the capture is saved to a permanent file.");
+            exit_main(1);
+        }
+
         /* Was the ring buffer option specified and, if so, does it make sense? */
         if (global_capture_opts.multi_files_on) {
             /* Ring buffer works only under certain conditions:
@@ -4800,6 +5917,26 @@ main(int argc, char *argv[])
         exit_main(status);
     }
 
+#ifndef _WIN32
+    /*
+     * "--bench-filter" reads packets from a file rather than from an
+     * interface; the filter may have been given with or without one.
+     */
+    if (bench_filter_file != NULL) {
+        const char *cfilter = global_capture_opts.default_options.cfilter;
+
+        if (global_capture_opts.ifaces->len > 0 &&
+            g_array_index(global_capture_opts.ifaces, interface_options, 0).cfilter != NULL)
+            cfilter = g_array_index(global_capture_opts.ifaces, interface_options, 0).cfilter;
+        if (cfilter == NULL) {
+            cmdarg_err("A capture filter has to be given with -f for --bench-filter.");
+            exit_main(1);
+        }
+        status = bench_capture_filter(bench_filter_file, cfilter);
+        exit_main(status);
+    }
+#endif
+
     /*
      * "-L", "-d", and capturing act on a particular interface, so we have to
      * have an interface; if none was specified, pick a default.
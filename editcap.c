@@ -863,6 +863,7 @@ main(int argc, char *argv[])
     nstime_t      block_start;
     gchar        *fprefix            = NULL;
     gchar        *fsuffix            = NULL;
+    wtap_compression_type compression_type = WTAP_UNCOMPRESSED;
 
     const struct wtap_pkthdr    *phdr;
     struct wtap_pkthdr           snap_phdr;
@@ -1185,6 +1186,14 @@ main(int argc, char *argv[])
         if (out_frame_type == -2)
             out_frame_type = wtap_file_encap(wth);
 
+        /* Compress the output if its name says it's compressed. */
+        compression_type = wtap_extension_to_compression_type(argv[optind+1]);
+        if (!wtap_can_write_compression_type(compression_type)) {
+            fprintf(stderr, "editcap: This version of editcap can't write %s-compressed files\n",
+                    wtap_compression_type_name(compression_type));
+            exit(1);
+        }
+
         for (i = optind + 2; i < argc; i++)
             if (add_selection(argv[i]) == FALSE)
                 break;
@@ -1218,9 +1227,9 @@ main(int argc, char *argv[])
                     shb_hdr->shb_user_appl = "Editcap " VERSION;
                 }
 
-                pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                        snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                        FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                compression_type, shb_hdr, idb_inf, &err);
 
                 if (pdh == NULL) {
                     fprintf(stderr, "editcap: Can't open or create %s: %s\n",
@@ -1259,9 +1268,9 @@ main(int argc, char *argv[])
                         if (verbose)
                             fprintf(stderr, "Continuing writing in file %s\n", filename);
 
-                        pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                                snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                                FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                        pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                        snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                        compression_type, shb_hdr, idb_inf, &err);
 
                         if (pdh == NULL) {
                             fprintf(stderr, "editcap: Can't open or create %s: %s\n",
@@ -1288,9 +1297,9 @@ main(int argc, char *argv[])
                     if (verbose)
                         fprintf(stderr, "Continuing writing in file %s\n", filename);
 
-                    pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                            snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                            FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                    pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                    snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                    compression_type, shb_hdr, idb_inf, &err);
                     if (pdh == NULL) {
                         fprintf(stderr, "editcap: Can't open or create %s: %s\n",
                                 filename, wtap_strerror(err));
@@ -1611,9 +1620,9 @@ main(int argc, char *argv[])
             g_free (filename);
             filename = g_strdup(argv[optind+1]);
 
-            pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                    snaplen ? MIN(snaplen, wtap_snapshot_length(wth)): wtap_snapshot_length(wth),
-                                    FALSE /* compressed */, shb_hdr, idb_inf, &err);
+            pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                            snaplen ? MIN(snaplen, wtap_snapshot_length(wth)): wtap_snapshot_length(wth),
+                                            compression_type, shb_hdr, idb_inf, &err);
             if (pdh == NULL) {
                 fprintf(stderr, "editcap: Can't open or create %s: %s\n",
                         filename, wtap_strerror(err));
@@ -59,6 +59,7 @@ struct epan_column_info {
   const gchar       **col_data;             /**< Column data */
   gchar             **col_buf;              /**< Buffer into which to copy data for column */
   int                *col_fence;            /**< Stuff in column buffer before this index is immutable */
+  col_pending_t      *col_pending;          /**< Values of columns col_fill_in() left to be formatted on demand */
   col_expr_t          col_expr;             /**< Column expressions and values */
   gboolean            writable;             /**< writable or not @todo Are we still writing to the columns? */
 };
@@ -43,6 +43,37 @@
 #include <epan/emem.h>
 #include <epan/epan.h>
 
+/*
+ * col_fill_in() doesn't format the address, port and frame data columns
+ * itself; it records the values they are made from and leaves the
+ * formatting (and address resolution) to the first col_get_data() or
+ * col_get_text() call for the column.  A packet list that only shows, or
+ * only re-dissects for, a single column then doesn't pay for the others.
+ * The values are copied so that the packet's memory may go away first.
+ *
+ * Column expressions are wanted when a single packet is being looked at
+ * closely, so with fill_col_exprs everything is still done right away.
+ */
+typedef enum {
+  COL_PENDING_NONE,
+  COL_PENDING_ADDR,
+  COL_PENDING_PORT,
+  COL_PENDING_FRAME_DATA
+} col_pending_type_t;
+
+#define COL_PENDING_ADDR_LEN 64
+
+struct _col_pending {
+  col_pending_type_t type;
+  gboolean           is_src;
+  gboolean           res;
+  address            addr;
+  guint8             addr_data[COL_PENDING_ADDR_LEN];
+  guint32            port;
+  port_type          ptype;
+  frame_data         fd;
+};
+
 /* Allocate all the data structures for constructing column data, given
    the number of columns. */
 void
@@ -63,6 +94,7 @@ col_setup(column_info *cinfo, const gint num_cols)
   cinfo->col_data              = g_new(const gchar*, num_cols);
   cinfo->col_buf               = g_new(gchar*, num_cols);
   cinfo->col_fence             = g_new(int, num_cols);
+  cinfo->col_pending           = g_new(col_pending_t, num_cols);
   cinfo->col_expr.col_expr     = g_new(const gchar*, num_cols + 1);
   cinfo->col_expr.col_expr_val = g_new(gchar*, num_cols + 1);
 
@@ -70,6 +102,8 @@ col_setup(column_info *cinfo, const gint num_cols)
     cinfo->col_first[i] = -1;
     cinfo->col_last[i] = -1;
   }
+  for (i = 0; i < num_cols; i++)
+    cinfo->col_pending[i].type = COL_PENDING_NONE;
 }
 
 /* Cleanup all the data structures for constructing column data; undoes
@@ -96,6 +130,7 @@ col_cleanup(column_info *cinfo)
   g_free((gchar **)cinfo->col_data);
   g_free(cinfo->col_buf);
   g_free(cinfo->col_fence);
+  g_free(cinfo->col_pending);
   /* XXX - see above */
   g_free((gchar **)cinfo->col_expr.col_expr);
   g_free(cinfo->col_expr.col_expr_val);
@@ -114,6 +149,7 @@ col_init(column_info *cinfo, const struct epan_session *epan)
     cinfo->col_buf[i][0] = '\0';
     cinfo->col_data[i] = cinfo->col_buf[i];
     cinfo->col_fence[i] = 0;
+    cinfo->col_pending[i].type = COL_PENDING_NONE;
     cinfo->col_expr.col_expr[i] = "";
     cinfo->col_expr.col_expr_val[i][0] = '\0';
   }
@@ -188,7 +224,7 @@ col_get_text(column_info *cinfo, const gint el)
 
   for (i = cinfo->col_first[el]; i <= cinfo->col_last[el]; i++) {
     if (cinfo->fmt_matx[i][el]) {
-      text = (cinfo->col_data[i]);
+      text = col_get_data(cinfo, i);
     }
   }
   return text;
@@ -1659,7 +1695,7 @@ col_set_time(column_info *cinfo, const gint el, const nstime_t *ts, const char *
 }
 
 static void
-col_set_addr(packet_info *pinfo, const int col, const address *addr, const gboolean is_src,
+col_set_addr(column_info *cinfo, const int col, const address *addr, const gboolean is_src,
              const gboolean fill_col_exprs, const gboolean res)
 {
   const char *name;
@@ -1670,10 +1706,10 @@ col_set_addr(packet_info *pinfo, const int col, const address *addr, const gbool
   }
 
   if (res && (name = get_addr_name(addr)) != NULL)
-    pinfo->cinfo->col_data[col] = name;
+    cinfo->col_data[col] = name;
   else {
-    pinfo->cinfo->col_data[col] = pinfo->cinfo->col_buf[col];
-    address_to_str_buf(addr, pinfo->cinfo->col_buf[col], COL_MAX_LEN);
+    cinfo->col_data[col] = cinfo->col_buf[col];
+    address_to_str_buf(addr, cinfo->col_buf[col], COL_MAX_LEN);
   }
 
   if (!fill_col_exprs)
@@ -1682,58 +1718,58 @@ col_set_addr(packet_info *pinfo, const int col, const address *addr, const gbool
   switch (addr->type) {
   case AT_AX25:
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "ax25.src";
+      cinfo->col_expr.col_expr[col] = "ax25.src";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "ax25.dst";
-    g_strlcpy(pinfo->cinfo->col_expr.col_expr_val[col], ax25_to_str((const guint8 *)addr->data), COL_MAX_LEN);
+      cinfo->col_expr.col_expr[col] = "ax25.dst";
+    g_strlcpy(cinfo->col_expr.col_expr_val[col], ax25_to_str((const guint8 *)addr->data), COL_MAX_LEN);
     break;
 
   case AT_ETHER:
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "eth.src";
+      cinfo->col_expr.col_expr[col] = "eth.src";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "eth.dst";
-    address_to_str_buf(addr, pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+      cinfo->col_expr.col_expr[col] = "eth.dst";
+    address_to_str_buf(addr, cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     break;
 
   case AT_IPv4:
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "ip.src";
+      cinfo->col_expr.col_expr[col] = "ip.src";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "ip.dst";
-    ip_to_str_buf((const guint8 *)addr->data, pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+      cinfo->col_expr.col_expr[col] = "ip.dst";
+    ip_to_str_buf((const guint8 *)addr->data, cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     break;
 
   case AT_IPv6:
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "ipv6.src";
+      cinfo->col_expr.col_expr[col] = "ipv6.src";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "ipv6.dst";
-    address_to_str_buf(addr, pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+      cinfo->col_expr.col_expr[col] = "ipv6.dst";
+    address_to_str_buf(addr, cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     break;
 
   case AT_ATALK:
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "ddp.src";
+      cinfo->col_expr.col_expr[col] = "ddp.src";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "ddp.dst";
-    g_strlcpy(pinfo->cinfo->col_expr.col_expr_val[col], pinfo->cinfo->col_buf[col], COL_MAX_LEN);
+      cinfo->col_expr.col_expr[col] = "ddp.dst";
+    g_strlcpy(cinfo->col_expr.col_expr_val[col], cinfo->col_buf[col], COL_MAX_LEN);
     break;
 
   case AT_ARCNET:
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "arcnet.src";
+      cinfo->col_expr.col_expr[col] = "arcnet.src";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "arcnet.dst";
-    g_strlcpy(pinfo->cinfo->col_expr.col_expr_val[col], pinfo->cinfo->col_buf[col], COL_MAX_LEN);
+      cinfo->col_expr.col_expr[col] = "arcnet.dst";
+    g_strlcpy(cinfo->col_expr.col_expr_val[col], cinfo->col_buf[col], COL_MAX_LEN);
     break;
 
   case AT_URI:
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "uri.src";
+      cinfo->col_expr.col_expr[col] = "uri.src";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "uri.dst";
-    address_to_str_buf(addr, pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+      cinfo->col_expr.col_expr[col] = "uri.dst";
+    address_to_str_buf(addr, cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     break;
 
   default:
@@ -1747,99 +1783,93 @@ col_set_addr(packet_info *pinfo, const int col, const address *addr, const gbool
    * with their specific one here. See bug #7728 for further discussion.
    * https://bugs.wireshark.org/bugzilla/show_bug.cgi?id=7728 */
   if (addr->hf != -1) {
-    pinfo->cinfo->col_expr.col_expr[col] = proto_registrar_get_nth(addr->hf)->abbrev;
+    cinfo->col_expr.col_expr[col] = proto_registrar_get_nth(addr->hf)->abbrev;
   }
 
 }
 
 /* ------------------------ */
 static void
-col_set_port(packet_info *pinfo, const int col, const gboolean is_res, const gboolean is_src, const gboolean fill_col_exprs _U_)
+col_set_port(column_info *cinfo, const int col, const guint32 port, const port_type ptype,
+             const gboolean is_res, const gboolean is_src, const gboolean fill_col_exprs _U_)
 {
-  guint32 port;
-
-  if (is_src)
-    port = pinfo->srcport;
-  else
-    port = pinfo->destport;
-
   /* TODO: Use fill_col_exprs */
 
-  switch (pinfo->ptype) {
+  switch (ptype) {
   case PT_SCTP:
     if (is_res)
-      g_strlcpy(pinfo->cinfo->col_buf[col], ep_sctp_port_to_display(port), COL_MAX_LEN);
+      g_strlcpy(cinfo->col_buf[col], ep_sctp_port_to_display(port), COL_MAX_LEN);
     else
-      guint32_to_str_buf(port, pinfo->cinfo->col_buf[col], COL_MAX_LEN);
+      guint32_to_str_buf(port, cinfo->col_buf[col], COL_MAX_LEN);
     break;
 
   case PT_TCP:
-    guint32_to_str_buf(port, pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+    guint32_to_str_buf(port, cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     if (is_res)
-      g_strlcpy(pinfo->cinfo->col_buf[col], ep_tcp_port_to_display(port), COL_MAX_LEN);
+      g_strlcpy(cinfo->col_buf[col], ep_tcp_port_to_display(port), COL_MAX_LEN);
     else
-      g_strlcpy(pinfo->cinfo->col_buf[col], pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+      g_strlcpy(cinfo->col_buf[col], cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "tcp.srcport";
+      cinfo->col_expr.col_expr[col] = "tcp.srcport";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "tcp.dstport";
+      cinfo->col_expr.col_expr[col] = "tcp.dstport";
     break;
 
   case PT_UDP:
-    guint32_to_str_buf(port, pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+    guint32_to_str_buf(port, cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     if (is_res)
-      g_strlcpy(pinfo->cinfo->col_buf[col], ep_udp_port_to_display(port), COL_MAX_LEN);
+      g_strlcpy(cinfo->col_buf[col], ep_udp_port_to_display(port), COL_MAX_LEN);
     else
-      g_strlcpy(pinfo->cinfo->col_buf[col], pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+      g_strlcpy(cinfo->col_buf[col], cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "udp.srcport";
+      cinfo->col_expr.col_expr[col] = "udp.srcport";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "udp.dstport";
+      cinfo->col_expr.col_expr[col] = "udp.dstport";
     break;
 
   case PT_DDP:
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "ddp.src_socket";
+      cinfo->col_expr.col_expr[col] = "ddp.src_socket";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "ddp.dst_socket";
-    guint32_to_str_buf(port, pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
-    g_strlcpy(pinfo->cinfo->col_buf[col], pinfo->cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+      cinfo->col_expr.col_expr[col] = "ddp.dst_socket";
+    guint32_to_str_buf(port, cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
+    g_strlcpy(cinfo->col_buf[col], cinfo->col_expr.col_expr_val[col], COL_MAX_LEN);
     break;
 
   case PT_IPX:
     /* XXX - resolve IPX socket numbers */
-    g_snprintf(pinfo->cinfo->col_buf[col], COL_MAX_LEN, "0x%04x", port);
-    g_strlcpy(pinfo->cinfo->col_expr.col_expr_val[col], pinfo->cinfo->col_buf[col],COL_MAX_LEN);
+    g_snprintf(cinfo->col_buf[col], COL_MAX_LEN, "0x%04x", port);
+    g_strlcpy(cinfo->col_expr.col_expr_val[col], cinfo->col_buf[col],COL_MAX_LEN);
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "ipx.src.socket";
+      cinfo->col_expr.col_expr[col] = "ipx.src.socket";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "ipx.dst.socket";
+      cinfo->col_expr.col_expr[col] = "ipx.dst.socket";
     break;
 
   case PT_IDP:
     /* XXX - resolve IDP socket numbers */
-    g_snprintf(pinfo->cinfo->col_buf[col], COL_MAX_LEN, "0x%04x", port);
-    g_strlcpy(pinfo->cinfo->col_expr.col_expr_val[col], pinfo->cinfo->col_buf[col],COL_MAX_LEN);
+    g_snprintf(cinfo->col_buf[col], COL_MAX_LEN, "0x%04x", port);
+    g_strlcpy(cinfo->col_expr.col_expr_val[col], cinfo->col_buf[col],COL_MAX_LEN);
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "idp.src.socket";
+      cinfo->col_expr.col_expr[col] = "idp.src.socket";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "idp.dst.socket";
+      cinfo->col_expr.col_expr[col] = "idp.dst.socket";
     break;
 
   case PT_USB:
     /* XXX - resolve USB endpoint numbers */
-    g_snprintf(pinfo->cinfo->col_buf[col], COL_MAX_LEN, "0x%08x", port);
-    g_strlcpy(pinfo->cinfo->col_expr.col_expr_val[col], pinfo->cinfo->col_buf[col],COL_MAX_LEN);
+    g_snprintf(cinfo->col_buf[col], COL_MAX_LEN, "0x%08x", port);
+    g_strlcpy(cinfo->col_expr.col_expr_val[col], cinfo->col_buf[col],COL_MAX_LEN);
     if (is_src)
-      pinfo->cinfo->col_expr.col_expr[col] = "usb.src.endpoint";
+      cinfo->col_expr.col_expr[col] = "usb.src.endpoint";
     else
-      pinfo->cinfo->col_expr.col_expr[col] = "usb.dst.endpoint";
+      cinfo->col_expr.col_expr[col] = "usb.dst.endpoint";
     break;
 
   default:
     break;
   }
-  pinfo->cinfo->col_data[col] = pinfo->cinfo->col_buf[col];
+  cinfo->col_data[col] = cinfo->col_buf[col];
 }
 
 gboolean
@@ -1941,6 +1971,97 @@ col_fill_in_frame_data(const frame_data *fd, column_info *cinfo, const gint col,
   }
 }
 
+static void
+col_defer_addr(column_info *cinfo, const int col, const address *addr, const gboolean is_src,
+               const gboolean fill_col_exprs, const gboolean res)
+{
+  col_pending_t *pending = &cinfo->col_pending[col];
+
+  if (addr->type == AT_NONE) {
+    /* No address, nothing to do */
+    return;
+  }
+
+  if (fill_col_exprs || addr->len < 0 || addr->len > COL_PENDING_ADDR_LEN) {
+    col_set_addr(cinfo, col, addr, is_src, fill_col_exprs, res);
+    return;
+  }
+
+  pending->type = COL_PENDING_ADDR;
+  pending->is_src = is_src;
+  pending->res = res;
+  if (addr->len > 0)
+    memcpy(pending->addr_data, addr->data, addr->len);
+  pending->addr = *addr;
+  pending->addr.data = pending->addr_data;
+}
+
+static void
+col_defer_port(column_info *cinfo, const int col, const guint32 port, const port_type ptype,
+               const gboolean is_res, const gboolean is_src, const gboolean fill_col_exprs)
+{
+  col_pending_t *pending = &cinfo->col_pending[col];
+
+  if (fill_col_exprs) {
+    col_set_port(cinfo, col, port, ptype, is_res, is_src, fill_col_exprs);
+    return;
+  }
+
+  pending->type = COL_PENDING_PORT;
+  pending->is_src = is_src;
+  pending->res = is_res;
+  pending->port = port;
+  pending->ptype = ptype;
+}
+
+static void
+col_defer_frame_data(column_info *cinfo, const int col, const frame_data *fd, const gboolean fill_col_exprs)
+{
+  col_pending_t *pending = &cinfo->col_pending[col];
+
+  if (fill_col_exprs) {
+    col_fill_in_frame_data(fd, cinfo, col, fill_col_exprs);
+    return;
+  }
+
+  pending->type = COL_PENDING_FRAME_DATA;
+  pending->fd = *fd;
+}
+
+static void
+col_fill_in_pending(column_info *cinfo, const int col)
+{
+  col_pending_t *pending = &cinfo->col_pending[col];
+
+  switch (pending->type) {
+  case COL_PENDING_ADDR:
+    col_set_addr(cinfo, col, &pending->addr, pending->is_src, FALSE, pending->res);
+    break;
+
+  case COL_PENDING_PORT:
+    col_set_port(cinfo, col, pending->port, pending->ptype, pending->res, pending->is_src, FALSE);
+    break;
+
+  case COL_PENDING_FRAME_DATA:
+    col_fill_in_frame_data(&pending->fd, cinfo, col, FALSE);
+    break;
+
+  default:
+    break;
+  }
+  pending->type = COL_PENDING_NONE;
+}
+
+/* Gets the text of column number col */
+const gchar *
+col_get_data(column_info *cinfo, const gint col)
+{
+  if (cinfo->col_pending[col].type != COL_PENDING_NONE)
+    col_fill_in_pending(cinfo, col);
+
+  return cinfo->col_data[col];
+}
+
 void
 col_fill_in(packet_info *pinfo, const gboolean fill_col_exprs, const gboolean fill_fd_colums)
 {
@@ -1950,81 +2071,83 @@ col_fill_in(packet_info *pinfo, const gboolean fill_col_exprs, const gboolean fi
     return;
 
   for (i = 0; i < pinfo->cinfo->num_cols; i++) {
+    pinfo->cinfo->col_pending[i].type = COL_PENDING_NONE;
+
     if (col_based_on_frame_data(pinfo->cinfo, i)) {
       if (fill_fd_colums)
-        col_fill_in_frame_data(pinfo->fd, pinfo->cinfo, i, fill_col_exprs);
+        col_defer_frame_data(pinfo->cinfo, i, pinfo->fd, fill_col_exprs);
     } else {
       switch (pinfo->cinfo->col_fmt[i]) {
       case COL_DEF_SRC:
       case COL_RES_SRC:   /* COL_DEF_SRC is currently just like COL_RES_SRC */
-        col_set_addr(pinfo, i, &pinfo->src, TRUE, fill_col_exprs, TRUE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->src, TRUE, fill_col_exprs, TRUE);
         break;
 
       case COL_UNRES_SRC:
-        col_set_addr(pinfo, i, &pinfo->src, TRUE, fill_col_exprs, FALSE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->src, TRUE, fill_col_exprs, FALSE);
         break;
 
       case COL_DEF_DL_SRC:
       case COL_RES_DL_SRC:
-        col_set_addr(pinfo, i, &pinfo->dl_src, TRUE, fill_col_exprs, TRUE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->dl_src, TRUE, fill_col_exprs, TRUE);
         break;
 
       case COL_UNRES_DL_SRC:
-        col_set_addr(pinfo, i, &pinfo->dl_src, TRUE, fill_col_exprs, FALSE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->dl_src, TRUE, fill_col_exprs, FALSE);
         break;
 
       case COL_DEF_NET_SRC:
       case COL_RES_NET_SRC:
-        col_set_addr(pinfo, i, &pinfo->net_src, TRUE, fill_col_exprs, TRUE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->net_src, TRUE, fill_col_exprs, TRUE);
         break;
 
       case COL_UNRES_NET_SRC:
-        col_set_addr(pinfo, i, &pinfo->net_src, TRUE, fill_col_exprs, FALSE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->net_src, TRUE, fill_col_exprs, FALSE);
         break;
 
       case COL_DEF_DST:
       case COL_RES_DST:   /* COL_DEF_DST is currently just like COL_RES_DST */
-        col_set_addr(pinfo, i, &pinfo->dst, FALSE, fill_col_exprs, TRUE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->dst, FALSE, fill_col_exprs, TRUE);
         break;
 
       case COL_UNRES_DST:
-        col_set_addr(pinfo, i, &pinfo->dst, FALSE, fill_col_exprs, FALSE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->dst, FALSE, fill_col_exprs, FALSE);
         break;
 
       case COL_DEF_DL_DST:
       case COL_RES_DL_DST:
-        col_set_addr(pinfo, i, &pinfo->dl_dst, FALSE, fill_col_exprs, TRUE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->dl_dst, FALSE, fill_col_exprs, TRUE);
         break;
 
       case COL_UNRES_DL_DST:
-        col_set_addr(pinfo, i, &pinfo->dl_dst, FALSE, fill_col_exprs, FALSE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->dl_dst, FALSE, fill_col_exprs, FALSE);
         break;
 
       case COL_DEF_NET_DST:
       case COL_RES_NET_DST:
-        col_set_addr(pinfo, i, &pinfo->net_dst, FALSE, fill_col_exprs, TRUE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->net_dst, FALSE, fill_col_exprs, TRUE);
         break;
 
       case COL_UNRES_NET_DST:
-        col_set_addr(pinfo, i, &pinfo->net_dst, FALSE, fill_col_exprs, FALSE);
+        col_defer_addr(pinfo->cinfo, i, &pinfo->net_dst, FALSE, fill_col_exprs, FALSE);
         break;
 
       case COL_DEF_SRC_PORT:
       case COL_RES_SRC_PORT:  /* COL_DEF_SRC_PORT is currently just like COL_RES_SRC_PORT */
-        col_set_port(pinfo, i, TRUE, TRUE, fill_col_exprs);
+        col_defer_port(pinfo->cinfo, i, pinfo->srcport, pinfo->ptype, TRUE, TRUE, fill_col_exprs);
         break;
 
       case COL_UNRES_SRC_PORT:
-        col_set_port(pinfo, i, FALSE, TRUE, fill_col_exprs);
+        col_defer_port(pinfo->cinfo, i, pinfo->srcport, pinfo->ptype, FALSE, TRUE, fill_col_exprs);
         break;
 
       case COL_DEF_DST_PORT:
       case COL_RES_DST_PORT:  /* COL_DEF_DST_PORT is currently just like COL_RES_DST_PORT */
-        col_set_port(pinfo, i, TRUE, FALSE, fill_col_exprs);
+        col_defer_port(pinfo->cinfo, i, pinfo->destport, pinfo->ptype, TRUE, FALSE, fill_col_exprs);
         break;
 
       case COL_UNRES_DST_PORT:
-        col_set_port(pinfo, i, FALSE, FALSE, fill_col_exprs);
+        col_defer_port(pinfo->cinfo, i, pinfo->destport, pinfo->ptype, FALSE, FALSE, fill_col_exprs);
         break;
 
       case NUM_COL_FMTS:  /* keep compiler happy - shouldn't get here */
@@ -2058,6 +2181,8 @@ col_fill_in_error(column_info *cinfo, frame_data *fdata, const gboolean fill_col
     return;
 
   for (i = 0; i < cinfo->num_cols; i++) {
+    cinfo->col_pending[i].type = COL_PENDING_NONE;
+
     if (col_based_on_frame_data(cinfo, i)) {
       if (fill_fd_colums)
         col_fill_in_frame_data(fdata, cinfo, i, fill_col_exprs);
@@ -41,6 +41,9 @@ struct epan_dissect;
 struct epan_column_info;
 typedef struct epan_column_info column_info;
 
+struct _col_pending;
+typedef struct _col_pending col_pending_t;
+
 /**
  * All of the possible columns in summary listing.
  *
@@ -144,11 +147,27 @@ extern void	col_init(column_info *cinfo, const struct epan_session *epan);
 WS_DLL_PUBLIC void col_fill_in_frame_data(const frame_data *fd, column_info *cinfo, const gint col, gboolean const fill_col_exprs);
 
 /** Fill in all columns of the given packet.
+ *
+ * Unless fill_col_exprs is set, the address, port and frame data columns
+ * are only formatted when their text is asked for with col_get_data()
+ * or col_get_text().
  *
  * Internal, don't use this in dissectors!
  */
 WS_DLL_PUBLIC void	col_fill_in(packet_info *pinfo, const gboolean fill_col_exprs, const gboolean fill_fd_colums);
 
+/** Get the text of a column after col_fill_in(); use this rather than
+ * reading cinfo->col_data directly.
+ *
+ * Internal, don't use this in dissectors!
+ *
+ * @param cinfo the current packet row
+ * @param col the column number (not format)
+ *
+ * @return the text string
+ */
+WS_DLL_PUBLIC const gchar *col_get_data(column_info *cinfo, const gint col);
+
 /** Fill in columns if we got an error reading the packet.
  * We set most columns to "???", and set the Info column to an error
  * message.
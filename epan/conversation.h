@@ -24,6 +24,7 @@
 #define __CONVERSATION_H__
 
 #include "ws_symbol_export.h"
+#include "wmem/wmem.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -182,16 +183,16 @@ extern void conversation_set_port2(conversation_t *conv, const guint32 port);
 extern void conversation_set_addr2(conversation_t *conv, const address *addr);
 
 WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_exact(void);
+wmem_map_t *get_conversation_hashtable_exact(void);
 
 WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_no_addr2(void);
+wmem_map_t *get_conversation_hashtable_no_addr2(void);
 
 WS_DLL_PUBLIC
-GHashTable * get_conversation_hashtable_no_port2(void);
+wmem_map_t *get_conversation_hashtable_no_port2(void);
 
 WS_DLL_PUBLIC
-GHashTable *get_conversation_hashtable_no_addr2_or_port2(void);
+wmem_map_t *get_conversation_hashtable_no_addr2_or_port2(void);
 
 
 #ifdef __cplusplus
@@ -1505,10 +1505,11 @@ static guint32 dissect_ies(tvbuff_t *tvb, packet_info *pinfo, guint32 offset,
 
         /* if the representation of the item has already been set, use that;
            else we have to allocate a block to put the text into */
-        if (ie_finfo && ie_finfo->rep != NULL)
+        if (ie_finfo && ie_finfo->rep != NULL) {
+          proto_item_render_label(ie_finfo);
           proto_item_set_text(ti, "Information Element: %s",
                               ie_finfo->rep->representation);
-        else {
+        } else {
           guint8 *ie_val = NULL;
           ie_val = (guint8 *)wmem_alloc(wmem_packet_scope(), ITEM_LABEL_LENGTH);
           proto_item_fill_label(ie_finfo, ie_val);
@@ -204,13 +204,13 @@ typedef struct {
 
     /* Command ID (only if frame_type == 0x3) */
     guint8      command_id;
-    GHashTable *short_table;
+    wmem_map_t *short_table;
 } ieee802154_packet;
 
 /* Structure for two-way mapping table */
 typedef struct {
-    GHashTable *long_table;
-    GHashTable *short_table;
+    wmem_map_t *long_table;
+    wmem_map_t *short_table;
 } ieee802154_map_tab_t;
 
 /* Key used by the short address hash table. */
@@ -837,7 +837,7 @@ dissect_ieee802154e_common(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
                 if (ieee_hints) {
                     ieee_hints->src16 = packet->src16;
                     ieee_hints->map_rec = (ieee802154e_map_rec *)
-                        g_hash_table_lookup(ieee802154e_map.short_table, &addr16);
+                        wmem_map_lookup(ieee802154e_map.short_table, &addr16);
                 }
             }
         }
@@ -2389,12 +2389,12 @@ ieee802154e_map_rec *ieee802154e_addr_update(ieee802154e_map_tab_t *au_ieee80215
 {
     ieee802154e_short_addr  addr16;
     ieee802154e_map_rec    *p_map_rec;
-    gpointer               old_key;
+    const void            *old_key;
 
     /* Look up short address hash */
     addr16.pan = pan;
     addr16.addr = short_addr;
-    p_map_rec = (ieee802154e_map_rec *)g_hash_table_lookup(au_ieee802154e_map->short_table, &addr16);
+    p_map_rec = (ieee802154e_map_rec *)wmem_map_lookup(au_ieee802154e_map->short_table, &addr16);
 
     /* Update mapping record */
     if (p_map_rec) {
@@ -2417,20 +2417,20 @@ ieee802154e_map_rec *ieee802154e_addr_update(ieee802154e_map_tab_t *au_ieee80215
     p_map_rec->addr64 = long_addr;
 
     /* link new mapping record to addr hash tables */
-    if ( g_hash_table_lookup_extended(au_ieee802154e_map->short_table, &addr16, &old_key, NULL) ) {
+    if ( wmem_map_lookup_extended(au_ieee802154e_map->short_table, &addr16, &old_key, NULL) ) {
         /* update short addr hash table, reusing pointer to old key */
-        g_hash_table_insert(au_ieee802154e_map->short_table, &old_key, p_map_rec);
+        wmem_map_insert(au_ieee802154e_map->short_table, old_key, p_map_rec);
     } else {
         /* create new hash entry */
-        g_hash_table_insert(au_ieee802154e_map->short_table, wmem_memdup(wmem_file_scope(), &addr16, sizeof(addr16)), p_map_rec);
+        wmem_map_insert(au_ieee802154e_map->short_table, wmem_memdup(wmem_file_scope(), &addr16, sizeof(addr16)), p_map_rec);
     }
 
-    if ( g_hash_table_lookup_extended(au_ieee802154e_map->long_table, &long_addr, &old_key, NULL) ) {
+    if ( wmem_map_lookup_extended(au_ieee802154e_map->long_table, &long_addr, &old_key, NULL) ) {
         /* update long addr hash table, reusing pointer to old key */
-        g_hash_table_insert(au_ieee802154e_map->long_table, &old_key, p_map_rec);
+        wmem_map_insert(au_ieee802154e_map->long_table, old_key, p_map_rec);
     } else {
         /* create new hash entry */
-        g_hash_table_insert(au_ieee802154e_map->long_table, wmem_memdup(wmem_file_scope(), &long_addr, sizeof(long_addr)), p_map_rec);
+        wmem_map_insert(au_ieee802154e_map->long_table, wmem_memdup(wmem_file_scope(), &long_addr, sizeof(long_addr)), p_map_rec);
     }
 
     return p_map_rec;
@@ -2460,7 +2460,7 @@ gboolean ieee802154e_short_addr_invalidate(guint16 short_addr, guint16 pan, guin
     addr16.pan = pan;
     addr16.addr = short_addr;
 
-    map_rec = (ieee802154e_map_rec *)g_hash_table_lookup(ieee802154e_map.short_table, &addr16);
+    map_rec = (ieee802154e_map_rec *)wmem_map_lookup(ieee802154e_map.short_table, &addr16);
     if ( map_rec ) {
         /* indicates this mapping is invalid at frame fnum */
         map_rec->end_fnum = fnum;
@@ -2489,7 +2489,7 @@ gboolean ieee802154e_long_addr_invalidate(guint64 long_addr, guint fnum)
 {
     ieee802154e_map_rec   *map_rec;
 
-    map_rec = (ieee802154e_map_rec *)g_hash_table_lookup(ieee802154e_map.long_table, &long_addr);
+    map_rec = (ieee802154e_map_rec *)wmem_map_lookup(ieee802154e_map.long_table, &long_addr);
     if ( map_rec ) {
         /* indicates this mapping is invalid at frame fnum */
         map_rec->end_fnum = fnum;
@@ -2519,15 +2519,10 @@ proto_init_ieee802154e(void)
 {
     guint       i;
 
-    /* Destroy hash tables, if they exist. */
-    if (ieee802154e_map.short_table)
-        g_hash_table_destroy(ieee802154e_map.short_table);
-    if (ieee802154e_map.long_table)
-        g_hash_table_destroy(ieee802154e_map.long_table);
-
-    /* Create the hash tables. */
-    ieee802154e_map.short_table = g_hash_table_new(ieee802154e_short_addr_hash, ieee802154e_short_addr_equal);
-    ieee802154e_map.long_table = g_hash_table_new(ieee802154e_long_addr_hash, ieee802154e_long_addr_equal);
+    /* Create the hash tables. They live in file scope, so the previous
+     * capture's tables were released along with the mapping records. */
+    ieee802154e_map.short_table = wmem_map_new(wmem_file_scope(), ieee802154e_short_addr_hash, ieee802154e_short_addr_equal);
+    ieee802154e_map.long_table = wmem_map_new(wmem_file_scope(), ieee802154e_long_addr_hash, ieee802154e_long_addr_equal);
     /* Re-load the hash table from the static address UAT. */
     for (i=0; (i<num_static_addrs) && (static_addrs); i++) {
         ieee802154e_addr_update(&ieee802154e_map,(guint16)static_addrs[i].addr16, (guint16)static_addrs[i].pan,
@@ -793,6 +793,7 @@ proto_item_get_text(proto_item *item)
     if (fi->rep == NULL)
         return NULL;
 
+    proto_item_render_label(fi);
 
     result = wmem_strdup(wmem_packet_scope(), fi->rep->representation);
     return result;
@@ -572,9 +572,9 @@ dissect_zbee_nwk_full(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void
                 addr16.addr = packet.src;
 
 #ifdef HAVE_WPANE		
-                map_rec = (ieee802154e_map_rec *) g_hash_table_lookup(zbee_nwk_map.short_table, &addr16);
+                map_rec = (ieee802154e_map_rec *) wmem_map_lookup(zbee_nwk_map.short_table, &addr16);
 #else		
-                map_rec = (ieee802154_map_rec *) g_hash_table_lookup(zbee_nwk_map.short_table, &addr16);
+                map_rec = (ieee802154_map_rec *) wmem_map_lookup(zbee_nwk_map.short_table, &addr16);
 #endif		
                 if (map_rec) {
                     /* found a nwk mapping record */
@@ -583,9 +583,9 @@ dissect_zbee_nwk_full(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void
                 else {
                     /* does ieee layer know? */
 #ifdef HAVE_WPANE			
-                    map_rec = (ieee802154e_map_rec *) g_hash_table_lookup(ieee_packet->short_table, &addr16);
+                    map_rec = (ieee802154e_map_rec *) wmem_map_lookup(ieee_packet->short_table, &addr16);
 #else		    
-                    map_rec = (ieee802154_map_rec *) g_hash_table_lookup(ieee_packet->short_table, &addr16);
+                    map_rec = (ieee802154_map_rec *) wmem_map_lookup(ieee_packet->short_table, &addr16);
 #endif      
       		    if (map_rec) nwk_hints->map_rec = map_rec;
                 }
@@ -616,9 +616,9 @@ dissect_zbee_nwk_full(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void
                 addr16.pan = ieee_packet->src_pan;
                 addr16.addr = ieee_packet->src16;
 #ifdef HAVE_WPANE
-		map_rec = (ieee802154e_map_rec *) g_hash_table_lookup(zbee_nwk_map.short_table, &addr16);
+		map_rec = (ieee802154e_map_rec *) wmem_map_lookup(zbee_nwk_map.short_table, &addr16);
 #else
-		map_rec = (ieee802154_map_rec *) g_hash_table_lookup(zbee_nwk_map.short_table, &addr16);
+		map_rec = (ieee802154_map_rec *) wmem_map_lookup(zbee_nwk_map.short_table, &addr16);
 #endif		
 
                 if (map_rec) {
@@ -2127,19 +2127,17 @@ static void
 proto_init_zbee_nwk(void)
 {
     /* Destroy the hash tables, if they exist. */
-    if (zbee_nwk_map.short_table) g_hash_table_destroy(zbee_nwk_map.short_table);
-    if (zbee_nwk_map.long_table) g_hash_table_destroy(zbee_nwk_map.long_table);
     if (zbee_table_nwk_keyring) g_hash_table_destroy(zbee_table_nwk_keyring);
 
 #ifdef HAVE_PANE    
     /* (Re)create the hash tables. */
-    zbee_nwk_map.short_table = g_hash_table_new(ieee802154e_short_addr_hash, ieee802154e_short_addr_equal);
-    zbee_nwk_map.long_table = g_hash_table_new(ieee802154e_long_addr_hash, ieee802154e_long_addr_equal);
+    zbee_nwk_map.short_table = wmem_map_new(wmem_file_scope(), ieee802154e_short_addr_hash, ieee802154e_short_addr_equal);
+    zbee_nwk_map.long_table = wmem_map_new(wmem_file_scope(), ieee802154e_long_addr_hash, ieee802154e_long_addr_equal);
     zbee_table_nwk_keyring  = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, free_keyring_val);
 #else
     /* (Re)create the hash tables. */
-    zbee_nwk_map.short_table = g_hash_table_new(ieee802154_short_addr_hash, ieee802154_short_addr_equal);
-    zbee_nwk_map.long_table = g_hash_table_new(ieee802154_long_addr_hash, ieee802154_long_addr_equal);
+    zbee_nwk_map.short_table = wmem_map_new(wmem_file_scope(), ieee802154_short_addr_hash, ieee802154_short_addr_equal);
+    zbee_nwk_map.long_table = wmem_map_new(wmem_file_scope(), ieee802154_long_addr_hash, ieee802154_long_addr_equal);
     zbee_table_nwk_keyring  = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, free_keyring_val);
 #endif
 } /* proto_init_zbee_nwk */
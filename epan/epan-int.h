@@ -31,6 +31,7 @@ struct epan_session {
 	const nstime_t *(*get_frame_ts)(void *data, guint32 frame_num);
 	const char *(*get_interface_name)(void *data, guint32 interface_id);
 	const char *(*get_user_comment)(void *data, const frame_data *fd);
+	const nstime_t *(*get_frame_shift_offset)(void *data, const frame_data *fd);
 };
 
 #endif
@@ -194,6 +194,18 @@ epan_get_frame_ts(const epan_t *session, guint32 frame_num)
 	return abs_ts;
 }
 
+const nstime_t *
+epan_get_frame_shift_offset(const epan_t *session, const frame_data *fd)
+{
+	static const nstime_t zero_offset = { 0, 0 };
+	const nstime_t *offset = NULL;
+
+	if (session->get_frame_shift_offset)
+		offset = session->get_frame_shift_offset(session->data, fd);
+
+	return offset ? offset : &zero_offset;
+}
+
 void
 epan_free(epan_t *session)
 {
@@ -138,6 +138,8 @@ const char *epan_get_interface_name(const epan_t *session, guint32 interface_id)
 
 const nstime_t *epan_get_frame_ts(const epan_t *session, guint32 frame_num);
 
+const nstime_t *epan_get_frame_shift_offset(const epan_t *session, const frame_data *fd);
+
 WS_DLL_PUBLIC void epan_free(epan_t *session);
 
 WS_DLL_PUBLIC const gchar*
@@ -41,11 +41,22 @@
 #define LOG2_NODES_PER_LEVEL	10
 #define NODES_PER_LEVEL		(1<<LOG2_NODES_PER_LEVEL)
 
+/*
+ * Every frame_data lives in the tree for the whole life of the capture
+ * file, so fields that only a handful of frames ever use are kept out
+ * of it.  They are stored in sparse side tables keyed by frame number,
+ * with a flag bit in the frame_data saying whether there's an entry.
+ */
 struct _frame_data_sequence {
   guint32      count;           /* Total number of frames */
   void        *ptree_root;      /* Pointer to the root node */
+  nstime_t     shift_offset;    /* Time shift offset of the other frames up to shift_count */
+  guint32      shift_count;     /* Number of frames when the capture was last shifted */
+  GHashTable  *shift_offsets;   /* Frames shifted by a different offset */
 };
 
+static const nstime_t zero_shift_offset = { 0, 0 };
+
 /*
  * For a given frame number, calculate the indices into a level 3
  * node, a level 2 node, a level 1 node, and a leaf node.
@@ -67,6 +78,9 @@ new_frame_data_sequence(void)
 	fds = (frame_data_sequence *)g_malloc(sizeof *fds);
 	fds->count = 0;
 	fds->ptree_root = NULL;
+	nstime_set_zero(&fds->shift_offset);
+	fds->shift_count = 0;
+	fds->shift_offsets = NULL;
 	return fds;
 }
 
@@ -305,10 +319,140 @@ free_frame_data_sequence(frame_data_sequence *fds)
     free_frame_data_array(fds->ptree_root, fds->count, levels, TRUE);
   }
 
+  if (fds->shift_offsets) {
+    g_hash_table_destroy(fds->shift_offsets);
+  }
+
   /* free the header struct */
   g_free(fds);
 }
 
+/*
+ * The offset of a frame without an entry in the side table.  Frames
+ * added after the whole capture was last shifted, as in a live capture,
+ * weren't shifted by it.
+ */
+static const nstime_t *
+default_shift_offset(const frame_data_sequence *fds, guint32 num)
+{
+  return num <= fds->shift_count ? &fds->shift_offset : &zero_shift_offset;
+}
+
+/*
+ * Frames added since the whole capture was last shifted keep a zero
+ * offset; give them entries of their own before the offset of the
+ * capture changes again.
+ */
+static void
+cover_new_frames(frame_data_sequence *fds)
+{
+  frame_data *fdata;
+  guint32     num = fds->shift_count;
+
+  fds->shift_count = fds->count;
+  if (nstime_is_zero(&fds->shift_offset))
+    return;
+  for (num++; num <= fds->count; num++) {
+    if ((fdata = frame_data_sequence_find(fds, num)) != NULL &&
+        !fdata->flags.has_shift_offset)
+      frame_data_sequence_set_shift_offset(fds, fdata, &zero_shift_offset);
+  }
+}
+
+/*
+ * Get the time shift offset of a frame.
+ */
+const nstime_t *
+frame_data_sequence_get_shift_offset(frame_data_sequence *fds,
+    const frame_data *fdata)
+{
+  const nstime_t *offset = NULL;
+
+  if (fdata->flags.has_shift_offset && fds->shift_offsets) {
+    offset = (const nstime_t *)g_hash_table_lookup(fds->shift_offsets,
+                                                   GUINT_TO_POINTER(fdata->num));
+  }
+
+  return offset ? offset : default_shift_offset(fds, fdata->num);
+}
+
+/*
+ * Set the time shift offset of a single frame.  Only frames whose offset
+ * differs from that of the whole capture get an entry in the side table.
+ */
+void
+frame_data_sequence_set_shift_offset(frame_data_sequence *fds,
+    frame_data *fdata, const nstime_t *offset)
+{
+  nstime_t *stored;
+
+  if (nstime_cmp(offset, default_shift_offset(fds, fdata->num)) == 0) {
+    if (fdata->flags.has_shift_offset && fds->shift_offsets) {
+      g_hash_table_remove(fds->shift_offsets, GUINT_TO_POINTER(fdata->num));
+    }
+    fdata->flags.has_shift_offset = 0;
+    return;
+  }
+
+  if (!fds->shift_offsets) {
+    fds->shift_offsets = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                               NULL, g_free);
+  }
+
+  stored = (nstime_t *)g_hash_table_lookup(fds->shift_offsets,
+                                           GUINT_TO_POINTER(fdata->num));
+  if (!stored) {
+    stored = g_new(nstime_t, 1);
+    g_hash_table_insert(fds->shift_offsets, GUINT_TO_POINTER(fdata->num),
+                        stored);
+  }
+  nstime_copy(stored, offset);
+  fdata->flags.has_shift_offset = 1;
+}
+
+static void
+add_shift_offset(gpointer key _U_, gpointer value, gpointer user_data)
+{
+  nstime_add((nstime_t *)value, (const nstime_t *)user_data);
+}
+
+/*
+ * Add "delta" to the time shift offset of every frame.
+ */
+void
+frame_data_sequence_add_shift_offset(frame_data_sequence *fds,
+    const nstime_t *delta)
+{
+  cover_new_frames(fds);
+  nstime_add(&fds->shift_offset, delta);
+  if (fds->shift_offsets) {
+    g_hash_table_foreach(fds->shift_offsets, add_shift_offset, (gpointer)delta);
+  }
+}
+
+/*
+ * Give every frame the same time shift offset, dropping the per-frame
+ * ones.
+ */
+void
+frame_data_sequence_set_all_shift_offsets(frame_data_sequence *fds,
+    const nstime_t *offset)
+{
+  frame_data *fdata;
+  guint32     num;
+
+  nstime_copy(&fds->shift_offset, offset);
+  fds->shift_count = fds->count;
+  if (fds->shift_offsets) {
+    for (num = 1; num <= fds->count; num++) {
+      if ((fdata = frame_data_sequence_find(fds, num)) != NULL)
+        fdata->flags.has_shift_offset = 0;
+    }
+    g_hash_table_destroy(fds->shift_offsets);
+    fds->shift_offsets = NULL;
+  }
+}
+
 void
 find_and_mark_frame_depended_upon(gpointer data, gpointer user_data)
 {
@@ -45,6 +45,30 @@ WS_DLL_PUBLIC frame_data *frame_data_sequence_find(frame_data_sequence *fds,
  */
 WS_DLL_PUBLIC void free_frame_data_sequence(frame_data_sequence *fds);
 
+/*
+ * Get and set the time shift offset of a frame.  The sequence keeps one
+ * offset for the frames it had when the whole capture was last shifted,
+ * plus a sparse side table holding the frames whose offset differs from
+ * it.  Frames added after that have a zero offset.
+ */
+WS_DLL_PUBLIC const nstime_t *frame_data_sequence_get_shift_offset(
+    frame_data_sequence *fds, const frame_data *fdata);
+
+WS_DLL_PUBLIC void frame_data_sequence_set_shift_offset(
+    frame_data_sequence *fds, frame_data *fdata, const nstime_t *offset);
+
+/*
+ * Shift every frame by "delta", on top of its current offset.
+ */
+WS_DLL_PUBLIC void frame_data_sequence_add_shift_offset(
+    frame_data_sequence *fds, const nstime_t *delta);
+
+/*
+ * Give every frame the same time shift offset.
+ */
+WS_DLL_PUBLIC void frame_data_sequence_set_all_shift_offsets(
+    frame_data_sequence *fds, const nstime_t *offset);
+
 WS_DLL_PUBLIC void find_and_mark_frame_depended_upon(gpointer data, gpointer user_data);
 
 
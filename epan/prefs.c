@@ -2244,6 +2244,12 @@ prefs_register_modules(void)
                                    10,
                                    &prefs.gui_fileopen_preview);
 
+    prefs_register_bool_preference(gui_module, "fileopen.seek_index",
+                                   "Keep seek indices for big gzipped files",
+                                   "Keep an index of where to start reading large gzip-compressed capture files"
+                                   " in your cache directory, so they open faster the next time?",
+                                   &prefs.gui_fileopen_seek_index);
+
     prefs_register_bool_preference(gui_module, "ask_unsaved",
                                    "Ask to save unsaved capture files",
                                    "Ask to save unsaved capture files?",
@@ -2962,6 +2968,7 @@ pre_init_prefs(void)
   prefs.gui_recent_files_count_max = 10;
   prefs.gui_fileopen_dir           = (char *) get_persdatafile_dir();
   prefs.gui_fileopen_preview       = 3;
+  prefs.gui_fileopen_seek_index    = FALSE;
   prefs.gui_ask_unsaved            = TRUE;
   prefs.gui_find_wrap              = TRUE;
   prefs.gui_use_pref_save          = FALSE;
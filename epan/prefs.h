@@ -169,6 +169,7 @@ typedef struct _e_prefs {
   guint        gui_fileopen_style;
   gchar       *gui_fileopen_dir;
   guint        gui_fileopen_preview;
+  gboolean     gui_fileopen_seek_index;
   gboolean     gui_ask_unsaved;
   gboolean     gui_find_wrap;
   gboolean     gui_use_pref_save;
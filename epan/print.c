@@ -179,6 +179,7 @@ proto_tree_print_node(proto_node *node, gpointer data)
 
     /* was a free format label produced? */
     if (fi->rep) {
+        proto_item_render_label(fi);
         label_ptr = fi->rep->representation;
     }
     else { /* no, make a generic label */
@@ -327,6 +328,7 @@ proto_tree_write_node_pdml(proto_node *node, gpointer data)
     if (fi->hfinfo->id == hf_text_only) {
         /* Get the text */
         if (fi->rep) {
+            proto_item_render_label(fi);
             label_ptr = fi->rep->representation;
         }
         else {
@@ -394,6 +396,7 @@ proto_tree_write_node_pdml(proto_node *node, gpointer data)
 #endif
 
         if (fi->rep) {
+            proto_item_render_label(fi);
             fputs("\" showname=\"", pdata->fh);
             print_escaped_xml(pdata->fh, fi->rep->representation);
         }
@@ -649,7 +652,7 @@ proto_tree_write_psml(epan_dissect_t *edt, FILE *fh)
 
     for (i = 0; i < edt->pi.cinfo->num_cols; i++) {
         fprintf(fh, "<section>");
-        print_escaped_xml(fh, edt->pi.cinfo->col_data[i]);
+        print_escaped_xml(fh, col_get_data(edt->pi.cinfo, i));
         fprintf(fh, "</section>\n");
     }
 
@@ -714,8 +717,8 @@ proto_tree_write_csv(epan_dissect_t *edt, FILE *fh)
     }
 
     for (i = 0; i < edt->pi.cinfo->num_cols - 1; i++)
-        csv_write_str(edt->pi.cinfo->col_data[i], ',', fh);
-    csv_write_str(edt->pi.cinfo->col_data[i], '\n', fh);
+        csv_write_str(col_get_data(edt->pi.cinfo, i), ',', fh);
+    csv_write_str(col_get_data(edt->pi.cinfo, i), '\n', fh);
 }
 
 void
@@ -1697,7 +1700,7 @@ void proto_tree_write_fields(output_fields_t *fields, epan_dissect_t *edt, colum
             field_index = g_hash_table_lookup(fields->field_indicies, col_name);
 
             if (NULL != field_index) {
-                format_field_values(fields, field_index, g_strdup(cinfo->col_data[col]));
+                format_field_values(fields, field_index, g_strdup(col_get_data(cinfo, col)));
             }
         }
     }
@@ -1742,6 +1745,7 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
         /* Text label.
          * Get the text */
         if (fi->rep) {
+            proto_item_render_label(fi);
             return g_strdup(fi->rep->representation);
         }
         else {
@@ -1762,6 +1766,7 @@ gchar* get_node_field_value(field_info* fi, epan_dissect_t* edt)
         case FT_PROTOCOL:
             /* Print out the full details for the protocol. */
             if (fi->rep) {
+                proto_item_render_label(fi);
                 return g_strdup(fi->rep->representation);
             } else {
                 /* Just print out the protocol abbreviation */
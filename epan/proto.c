@@ -284,10 +284,37 @@ struct _protocol {
 /* List of all protocols */
 static GList *protocols = NULL;
 
+/*
+ * A proto_item and the field_info it encapsulates are allocated together,
+ * from chunks of items owned by the tree.  Items are created in more or
+ * less the order in which the tree is traversed, so this keeps a walk
+ * over the tree moving forward through a few contiguous blocks of memory
+ * rather than hopping between separately allocated nodes and field_infos,
+ * and it lets us release the items' values with a linear scan.
+ */
+typedef struct {
+	proto_node node;
+	field_info finfo;
+} proto_item_cell_t;
+
+typedef struct _proto_item_chunk {
+	struct _proto_item_chunk *next;
+	guint                     used;
+	guint                     size;
+	proto_item_cell_t         cells[1];
+} proto_item_chunk_t;
+
+/* Chunks start small, for trees of a couple of items, and double up to
+ * PROTO_ITEM_CHUNK_MAX items. */
+#define PROTO_ITEM_CHUNK_MIN	16
+#define PROTO_ITEM_CHUNK_MAX	1024
+
+#define PROTO_ITEM_CELL(fi) \
+	((proto_item_cell_t *)((char *)(fi) - G_STRUCT_OFFSET(proto_item_cell_t, finfo)))
+
 /* Contains information about a field when a dissector calls
  * proto_tree_add_item.  */
-#define FIELD_INFO_NEW(pool, fi)  fi = wmem_new(pool, field_info)
-#define FIELD_INFO_FREE(pool, fi) wmem_free(pool, fi)
+#define FIELD_INFO_NEW(tree, fi)  fi = &proto_tree_new_item_cell(tree)->finfo
 
 /* Contains the space for proto_nodes. */
 #define PROTO_NODE_INIT(node)			\
@@ -295,9 +322,6 @@ static GList *protocols = NULL;
 	node->last_child = NULL;		\
 	node->next = NULL;
 
-#define PROTO_NODE_FREE(pool, node)			\
-	wmem_free(pool, node)
-
 /* String space for protocol and field items for the GUI */
 #define ITEM_LABEL_NEW(pool, il)			\
 	il = wmem_new(pool, item_label_t);
@@ -639,14 +663,40 @@ free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
 	g_ptr_array_free(ptrs, TRUE);
 }
 
-static void
-proto_tree_free_node(proto_node *node, gpointer data _U_)
+static proto_item_cell_t *
+proto_tree_new_item_cell(proto_tree *tree)
 {
-	field_info *finfo  = PNODE_FINFO(node);
+	tree_data_t        *tree_data = PTREE_DATA(tree);
+	proto_item_chunk_t *chunk     = tree_data->item_chunks;
+
+	if (chunk == NULL || chunk->used == chunk->size) {
+		guint size = chunk ? MIN(chunk->size * 2, PROTO_ITEM_CHUNK_MAX) : PROTO_ITEM_CHUNK_MIN;
+
+		chunk = (proto_item_chunk_t *)wmem_alloc(PNODE_POOL(tree),
+			G_STRUCT_OFFSET(proto_item_chunk_t, cells) + size * sizeof(proto_item_cell_t));
+		chunk->next = tree_data->item_chunks;
+		chunk->used = 0;
+		chunk->size = size;
+		tree_data->item_chunks = chunk;
+	}
+
+	return &chunk->cells[chunk->used++];
+}
 
-	proto_tree_children_foreach(node, proto_tree_free_node, NULL);
+/* Release the values of all items created for the tree, including
+ * those never added to it because an exception was thrown first;
+ * the chunks themselves go away with the packet's pool. */
+static void
+proto_tree_free_items(tree_data_t *tree_data)
+{
+	proto_item_chunk_t *chunk;
+	guint               i;
 
-	FVALUE_CLEANUP(&finfo->value);
+	for (chunk = tree_data->item_chunks; chunk != NULL; chunk = chunk->next) {
+		for (i = 0; i < chunk->used; i++)
+			FVALUE_CLEANUP(&chunk->cells[i].finfo.value);
+	}
+	tree_data->item_chunks = NULL;
 }
 
 void
@@ -654,7 +704,7 @@ proto_tree_reset(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
 
-	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
+	proto_tree_free_items(tree_data);
 
 	/* free tree data */
 	if (tree_data->interesting_hfids) {
@@ -678,7 +728,7 @@ proto_tree_free(proto_tree *tree)
 {
 	tree_data_t *tree_data = PTREE_DATA(tree);
 
-	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
+	proto_tree_free_items(tree_data);
 
 	/* free tree data */
 	if (tree_data->interesting_hfids) {
@@ -3071,6 +3121,8 @@ proto_item_append_string(proto_item *pi, const char *str)
 		new_str = ep_strconcat(old_str, str, NULL);
 	else
 		new_str = str;
+	/* a deferred default label must show the value it was created with */
+	proto_item_render_label(fi);
 	fvalue_set_string(&fi->value, new_str);
 }
 
@@ -3784,7 +3836,7 @@ proto_tree_add_node(proto_tree *tree, field_info *fi)
 		/* XXX - is it safe to continue here? */
 	}
 
-	pnode = wmem_new(PNODE_POOL(tree), proto_node);
+	pnode = &PROTO_ITEM_CELL(fi)->node;
 	PROTO_NODE_INIT(pnode);
 	pnode->parent = tnode;
 	PNODE_FINFO(pnode) = fi;
@@ -3950,7 +4002,11 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 {
 	field_info *fi;
 
-	FIELD_INFO_NEW(PNODE_POOL(tree), fi);
+	FIELD_INFO_NEW(tree, fi);
+
+	/* the value is released by proto_tree_free_items() even if we
+	 * don't get as far as adding the item to the tree */
+	fvalue_init(&fi->value, hfinfo->type);
 
 	fi->hfinfo     = hfinfo;
 	fi->start      = start;
@@ -3960,7 +4016,6 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	fi->flags      = 0;
 	if (!PTREE_DATA(tree)->visible)
 		FI_SET_FLAG(fi, FI_HIDDEN);
-	fvalue_init(&fi->value, fi->hfinfo->type);
 	fi->rep        = NULL;
 
 	/* add the data source tvbuff */
@@ -3972,6 +4027,508 @@ new_field_info(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *tvb,
 	return fi;
 }
 
+/*
+ * Deferred item labels.
+ *
+ * Most items get a label whether or not anybody ever looks at it, and
+ * running the printf machinery for each of them is a noticeable part of
+ * dissecting into a visible tree.  Instead of formatting right away, the
+ * label buffer is used to record what is needed to format it later:
+ *
+ *   byte 0     LABEL_DEFER_xxx, what goes in front of the first segment
+ *   byte 1     number of segments
+ *   byte 2     offset of the first free byte
+ *   segments   NUL-terminated format string followed by a copy of each
+ *              argument it consumes, in order
+ *
+ * Integers are widened to 64 bits (after applying their length modifier),
+ * strings are copied, so nothing the dissector frees afterwards is
+ * referenced.  Anything the parser below does not know about (positional
+ * arguments, %n, long double, wide characters, ...) or that does not fit
+ * in the buffer is formatted immediately, as before.
+ */
+
+#define LABEL_DEFER_PLAIN	1	/* proto_item_set_text() and friends */
+#define LABEL_DEFER_VALUE	2	/* "<bitfield> <field name>: " prefix */
+#define LABEL_DEFER_FILL	3	/* proto_item_fill_label() prefix */
+
+#define LABEL_DEFER_HEADER_LEN	3
+
+#define LABEL_ARG_NONE	-1
+#define LABEL_ARG_STAR	-2
+
+enum {
+	LABEL_LEN_NONE,
+	LABEL_LEN_HH,
+	LABEL_LEN_H,
+	LABEL_LEN_L,
+	LABEL_LEN_LL,
+	LABEL_LEN_SIZE
+};
+
+typedef struct {
+	char flags[8];
+	int  width;
+	int  precision;
+	int  length;
+	char conversion;
+} label_spec_t;
+
+/* Parse a conversion specification; p points just past the '%'.
+ * Returns a pointer past the conversion character or NULL if the
+ * specification is not one we know how to defer. */
+static const char *
+label_parse_spec(const char *p, label_spec_t *spec)
+{
+	guint nflags = 0;
+
+	while (*p != '\0' && strchr("-+ #0", *p) != NULL) {
+		if (nflags == sizeof(spec->flags) - 1)
+			return NULL;
+		spec->flags[nflags++] = *p++;
+	}
+	spec->flags[nflags] = '\0';
+
+	spec->width = LABEL_ARG_NONE;
+	if (*p == '*') {
+		spec->width = LABEL_ARG_STAR;
+		p++;
+	} else if (g_ascii_isdigit(*p)) {
+		spec->width = 0;
+		while (g_ascii_isdigit(*p)) {
+			spec->width = spec->width * 10 + (*p++ - '0');
+			if (spec->width >= ITEM_LABEL_LENGTH)
+				return NULL;
+		}
+		if (*p == '$')
+			return NULL;
+	}
+
+	spec->precision = LABEL_ARG_NONE;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->precision = LABEL_ARG_STAR;
+			p++;
+		} else {
+			spec->precision = 0;
+			while (g_ascii_isdigit(*p)) {
+				spec->precision = spec->precision * 10 + (*p++ - '0');
+				if (spec->precision >= ITEM_LABEL_LENGTH)
+					return NULL;
+			}
+		}
+	}
+
+	spec->length = LABEL_LEN_NONE;
+	switch (*p) {
+	case 'h':
+		p++;
+		spec->length = LABEL_LEN_H;
+		if (*p == 'h') {
+			p++;
+			spec->length = LABEL_LEN_HH;
+		}
+		break;
+	case 'l':
+		p++;
+		spec->length = LABEL_LEN_L;
+		if (*p == 'l') {
+			p++;
+			spec->length = LABEL_LEN_LL;
+		}
+		break;
+	case 'q':
+		p++;
+		spec->length = LABEL_LEN_LL;
+		break;
+	case 'z':
+		p++;
+		spec->length = LABEL_LEN_SIZE;
+		break;
+	case 'I':
+		/* MSVC: I64, I32 and I (size_t) */
+		p++;
+		if (p[0] == '6' && p[1] == '4') {
+			p += 2;
+			spec->length = LABEL_LEN_LL;
+		} else if (p[0] == '3' && p[1] == '2') {
+			p += 2;
+		} else {
+			spec->length = LABEL_LEN_SIZE;
+		}
+		break;
+	}
+
+	spec->conversion = *p;
+	switch (*p) {
+	case 'd': case 'i':
+	case 'o': case 'u': case 'x': case 'X':
+		break;
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+		if (spec->length != LABEL_LEN_NONE && spec->length != LABEL_LEN_L)
+			return NULL;
+		break;
+	case 'c': case 's': case 'p':
+		if (spec->length != LABEL_LEN_NONE)
+			return NULL;
+		break;
+	default:
+		return NULL;
+	}
+
+	return p + 1;
+}
+
+#define LABEL_DEFER_PUT(label, pos, val) \
+	do { \
+		if ((pos) + sizeof(val) > ITEM_LABEL_LENGTH) \
+			return FALSE; \
+		memcpy((label) + (pos), &(val), sizeof(val)); \
+		(pos) += sizeof(val); \
+	} while (0)
+
+#define LABEL_DEFER_GET(label, pos, val) \
+	do { \
+		memcpy(&(val), (label) + (pos), sizeof(val)); \
+		(pos) += sizeof(val); \
+	} while (0)
+
+/* Record format and the arguments it consumes from ap as a new segment.
+ * On failure the label is left as it was (ap is not, so the caller must
+ * hand us a copy). */
+static gboolean
+label_defer_segment(char *label, const char *format, va_list ap)
+{
+	gsize         pos = (guint8)label[2];
+	gsize         len = strlen(format);
+	const char   *p;
+	label_spec_t  spec;
+
+	if (pos + len + 1 > ITEM_LABEL_LENGTH)
+		return FALSE;
+	memcpy(label + pos, format, len + 1);
+	pos += len + 1;
+
+	for (p = strchr(format, '%'); p != NULL; p = strchr(p, '%')) {
+		int precision;
+
+		p++;
+		if (*p == '%') {
+			p++;
+			continue;
+		}
+		p = label_parse_spec(p, &spec);
+		if (p == NULL)
+			return FALSE;
+
+		if (spec.width == LABEL_ARG_STAR) {
+			int width = va_arg(ap, int);
+			LABEL_DEFER_PUT(label, pos, width);
+		}
+		precision = spec.precision;
+		if (precision == LABEL_ARG_STAR) {
+			precision = va_arg(ap, int);
+			LABEL_DEFER_PUT(label, pos, precision);
+		}
+
+		switch (spec.conversion) {
+		case 'd': case 'i':
+		{
+			gint64 val;
+
+			switch (spec.length) {
+			case LABEL_LEN_HH:   val = (signed char)va_arg(ap, int); break;
+			case LABEL_LEN_H:    val = (short)va_arg(ap, int); break;
+			case LABEL_LEN_L:    val = va_arg(ap, long); break;
+			case LABEL_LEN_LL:   val = va_arg(ap, gint64); break;
+			case LABEL_LEN_SIZE: val = va_arg(ap, gssize); break;
+			default:             val = va_arg(ap, int); break;
+			}
+			LABEL_DEFER_PUT(label, pos, val);
+			break;
+		}
+		case 'o': case 'u': case 'x': case 'X':
+		{
+			guint64 val;
+
+			switch (spec.length) {
+			case LABEL_LEN_HH:   val = (unsigned char)va_arg(ap, unsigned int); break;
+			case LABEL_LEN_H:    val = (unsigned short)va_arg(ap, unsigned int); break;
+			case LABEL_LEN_L:    val = va_arg(ap, unsigned long); break;
+			case LABEL_LEN_LL:   val = va_arg(ap, guint64); break;
+			case LABEL_LEN_SIZE: val = va_arg(ap, gsize); break;
+			default:             val = va_arg(ap, unsigned int); break;
+			}
+			LABEL_DEFER_PUT(label, pos, val);
+			break;
+		}
+		case 'c':
+		{
+			int val = va_arg(ap, int);
+			LABEL_DEFER_PUT(label, pos, val);
+			break;
+		}
+		case 'p':
+		{
+			void *val = va_arg(ap, void *);
+			LABEL_DEFER_PUT(label, pos, val);
+			break;
+		}
+		case 's':
+		{
+			const char *str = va_arg(ap, const char *);
+			const char *end;
+
+			if (pos + 1 > ITEM_LABEL_LENGTH)
+				return FALSE;
+			if (str == NULL) {
+				label[pos++] = '\0';
+				break;
+			}
+			label[pos++] = '\1';
+
+			if (precision >= 0) {
+				end = (const char *)memchr(str, '\0', precision);
+				len = end ? (gsize)(end - str) : (gsize)precision;
+			} else {
+				len = strlen(str);
+			}
+			if (pos + len + 1 > ITEM_LABEL_LENGTH)
+				return FALSE;
+			memcpy(label + pos, str, len);
+			label[pos + len] = '\0';
+			pos += len + 1;
+			break;
+		}
+		default:
+		{
+			double val = va_arg(ap, double);
+			LABEL_DEFER_PUT(label, pos, val);
+			break;
+		}
+		}
+	}
+
+	label[1]++;
+	label[2] = (char)pos;
+	return TRUE;
+}
+
+/* Format the segment starting at *pos into out, advancing *pos past it.
+ * Returns the length the complete text would have had, like g_snprintf(). */
+static gsize
+label_format_segment(char *out, gsize size, const char *label, gsize *pos)
+{
+	const char   *p = label + *pos;
+	gsize         apos = *pos + strlen(p) + 1;
+	gsize         len = 0;
+	label_spec_t  spec;
+
+	while (*p != '\0') {
+		char  fmt[32];
+		char *f;
+		int   width, precision;
+
+		if (*p != '%' || p[1] == '%') {
+			if (len + 1 < size)
+				out[len] = *p;
+			len++;
+			p += (*p == '%') ? 2 : 1;
+			continue;
+		}
+
+		/* the spec was validated when the segment was recorded */
+		p = label_parse_spec(p + 1, &spec);
+
+		f = fmt;
+		*f++ = '%';
+		f += g_strlcpy(f, spec.flags, sizeof(spec.flags));
+
+		width = spec.width;
+		if (width == LABEL_ARG_STAR) {
+			LABEL_DEFER_GET(label, apos, width);
+			if (width < 0) {
+				/* a negative '*' width means left-justified */
+				*f++ = '-';
+				width = -width;
+			}
+		}
+		precision = spec.precision;
+		if (precision == LABEL_ARG_STAR)
+			LABEL_DEFER_GET(label, apos, precision);
+		if (width >= 0)
+			f += g_snprintf(f, 8, "%d", width);
+		if (precision >= 0)
+			f += g_snprintf(f, 8, ".%d", precision);
+		if (strchr("diouxX", spec.conversion) != NULL)
+			f += g_strlcpy(f, G_GINT64_MODIFIER, 4);
+		*f++ = spec.conversion;
+		*f = '\0';
+
+#define LABEL_FORMAT_ARG(val) \
+		do { \
+			if (len < size) \
+				len += g_snprintf(out + len, (gulong)(size - len), fmt, val); \
+			else \
+				len += 1; \
+		} while (0)
+
+		switch (spec.conversion) {
+		case 'd': case 'i':
+		{
+			gint64 val;
+			LABEL_DEFER_GET(label, apos, val);
+			LABEL_FORMAT_ARG(val);
+			break;
+		}
+		case 'o': case 'u': case 'x': case 'X':
+		{
+			guint64 val;
+			LABEL_DEFER_GET(label, apos, val);
+			LABEL_FORMAT_ARG(val);
+			break;
+		}
+		case 'c':
+		{
+			int val;
+			LABEL_DEFER_GET(label, apos, val);
+			LABEL_FORMAT_ARG(val);
+			break;
+		}
+		case 'p':
+		{
+			void *val;
+			LABEL_DEFER_GET(label, apos, val);
+			LABEL_FORMAT_ARG(val);
+			break;
+		}
+		case 's':
+		{
+			const char *val = NULL;
+
+			if (label[apos++] != '\0') {
+				val = label + apos;
+				apos += strlen(val) + 1;
+			}
+			LABEL_FORMAT_ARG(val);
+			break;
+		}
+		default:
+		{
+			double val;
+			LABEL_DEFER_GET(label, apos, val);
+			LABEL_FORMAT_ARG(val);
+			break;
+		}
+		}
+#undef LABEL_FORMAT_ARG
+	}
+
+	if (size > 0)
+		out[MIN(len, size - 1)] = '\0';
+	*pos = apos;
+	return len;
+}
+
+/* Start a deferred label in fi->rep and record format/ap as its first
+ * segment.  Returns FALSE if the label has to be formatted right away. */
+static gboolean
+label_defer(field_info *fi, guint8 kind, const char *format, va_list ap)
+{
+	va_list ap_copy;
+	gboolean ret;
+
+	fi->rep->representation[0] = (char)kind;
+	fi->rep->representation[1] = 0;
+	fi->rep->representation[2] = LABEL_DEFER_HEADER_LEN;
+
+	G_VA_COPY(ap_copy, ap);
+	ret = label_defer_segment(fi->rep->representation, format, ap_copy);
+	va_end(ap_copy);
+
+	if (ret)
+		FI_SET_FLAG(fi, FI_DEFERRED_LABEL);
+	return ret;
+}
+
+/* Put the bitfield and "<field name>: " in front of a value label;
+ * returns the length written (or that would have been written). */
+static int
+label_value_prefix(field_info *fi, char *label_str)
+{
+	header_field_info *hf = fi->hfinfo;
+	int                ret = 0;
+
+	if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
+		guint32 val;
+		char *p;
+
+		val = fvalue_get_uinteger(&fi->value);
+		val <<= hfinfo_bitshift(hf);
+
+		p = decode_bitfield_value(label_str, val, hf->bitmask, hfinfo_bitwidth(hf));
+		ret = (int) (p - label_str);
+	}
+
+	/* put in the hf name */
+	ret += g_snprintf(label_str + ret, ITEM_LABEL_LENGTH - ret, "%s: ", hf->name);
+
+	return ret;
+}
+
+void
+proto_item_render_label(field_info *fi)
+{
+	char        label_str[ITEM_LABEL_LENGTH];
+	const char *label;
+	gsize       pos = LABEL_DEFER_HEADER_LEN;
+	gsize       ret = 0;
+	guint       nseg, i;
+
+	if (!fi || !fi->rep || !FI_GET_FLAG(fi, FI_DEFERRED_LABEL))
+		return;
+
+	label = fi->rep->representation;
+	nseg = (guint8)label[1];
+	i = 0;
+
+	switch (label[0]) {
+	case LABEL_DEFER_FILL:
+		proto_item_fill_label(fi, label_str);
+		break;
+
+	case LABEL_DEFER_VALUE:
+		ret = label_value_prefix(fi, label_str);
+		/* FALLTHROUGH */
+	default:
+		/* If possible, put in the value of the string */
+		if (ret < ITEM_LABEL_LENGTH)
+			ret += label_format_segment(label_str + ret, ITEM_LABEL_LENGTH - ret, label, &pos);
+		else
+			label_format_segment(NULL, 0, label, &pos);
+		i++;
+		if (ret >= ITEM_LABEL_LENGTH) {
+			/* Uh oh, we don't have enough room.  Tell the user
+			 * that the field is truncated.
+			 */
+			LABEL_MARK_TRUNCATED_START(label_str);
+		}
+		break;
+	}
+
+	/* proto_item_append_text() segments */
+	for (; i < nseg; i++) {
+		gsize curlen = strlen(label_str);
+
+		label_format_segment(label_str + curlen, ITEM_LABEL_LENGTH - curlen, label, &pos);
+	}
+
+	g_strlcpy(fi->rep->representation, label_str, ITEM_LABEL_LENGTH);
+	FI_RESET_FLAG(fi, FI_DEFERRED_LABEL);
+}
+
 /* If the protocol tree is to be visible, set the representation of a
    proto_tree entry with the name of the field for the item and with
    the value formatted with the supplied printf-style format and
@@ -3986,26 +4543,14 @@ proto_tree_set_representation_value(proto_item *pi, const char *format, va_list
 	if (PTREE_DATA(pi)->visible && !PROTO_ITEM_IS_HIDDEN(pi)) {
 		int               ret = 0;
 		field_info        *fi = PITEM_FINFO(pi);
-		header_field_info *hf;
 
 		DISSECTOR_ASSERT(fi);
 
-		hf = fi->hfinfo;
-
 		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-		if (hf->bitmask && (hf->type == FT_BOOLEAN || IS_FT_UINT(hf->type))) {
-			guint32 val;
-			char *p;
-
-			val = fvalue_get_uinteger(&fi->value);
-			val <<= hfinfo_bitshift(hf);
-
-			p = decode_bitfield_value(fi->rep->representation, val, hf->bitmask, hfinfo_bitwidth(hf));
-			ret = (int) (p - fi->rep->representation);
-		}
+		if (label_defer(fi, LABEL_DEFER_VALUE, format, ap))
+			return;
 
-		/* put in the hf name */
-		ret += g_snprintf(fi->rep->representation + ret, ITEM_LABEL_LENGTH - ret, "%s: ", hf->name);
+		ret = label_value_prefix(fi, fi->rep->representation);
 
 		/* If possible, Put in the value of the string */
 		if (ret < ITEM_LABEL_LENGTH) {
@@ -4034,6 +4579,9 @@ proto_tree_set_representation(proto_item *pi, const char *format, va_list ap)
 
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
 		ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
+		if (label_defer(fi, LABEL_DEFER_PLAIN, format, ap))
+			return;
+
 		ret = g_vsnprintf(fi->rep->representation, ITEM_LABEL_LENGTH,
 				  format, ap);
 		if (ret >= ITEM_LABEL_LENGTH) {
@@ -4446,6 +4994,7 @@ proto_item_set_text(proto_item *pi, const char *format, ...)
 	if (fi->rep) {
 		ITEM_LABEL_FREE(PNODE_POOL(pi), fi->rep);
 		fi->rep = NULL;
+		FI_RESET_FLAG(fi, FI_DEFERRED_LABEL);
 	}
 
 	va_start(ap, format);
@@ -4473,11 +5022,26 @@ proto_item_append_text(proto_item *pi, const char *format, ...)
 	if (!PROTO_ITEM_IS_HIDDEN(pi)) {
 		/*
 		 * If we don't already have a representation,
-		 * generate the default representation.
+		 * generate the default representation; both it and
+		 * the text we append are only formatted when needed.
 		 */
 		if (fi->rep == NULL) {
 			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
-			proto_item_fill_label(fi, fi->rep->representation);
+			fi->rep->representation[0] = LABEL_DEFER_FILL;
+			fi->rep->representation[1] = 0;
+			fi->rep->representation[2] = LABEL_DEFER_HEADER_LEN;
+			FI_SET_FLAG(fi, FI_DEFERRED_LABEL);
+		}
+
+		if (FI_GET_FLAG(fi, FI_DEFERRED_LABEL)) {
+			gboolean deferred;
+
+			va_start(ap, format);
+			deferred = label_defer_segment(fi->rep->representation, format, ap);
+			va_end(ap);
+			if (deferred)
+				return;
+			proto_item_render_label(fi);
 		}
 
 		curlen = strlen(fi->rep->representation);
@@ -4515,8 +5079,10 @@ proto_item_prepend_text(proto_item *pi, const char *format, ...)
 		if (fi->rep == NULL) {
 			ITEM_LABEL_NEW(PNODE_POOL(pi), fi->rep);
 			proto_item_fill_label(fi, representation);
-		} else
+		} else {
+			proto_item_render_label(fi);
 			g_strlcpy(representation, fi->rep->representation, ITEM_LABEL_LENGTH);
+		}
 
 		va_start(ap, format);
 		g_vsnprintf(fi->rep->representation,
@@ -4611,6 +5177,8 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Keep track of the number of children */
 	pnode->tree_data->count = 0;
 
+	pnode->tree_data->item_chunks = NULL;
+
 	return (proto_tree *)pnode;
 }
 
@@ -6498,7 +7066,7 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 /* Return GPtrArray* of field_info pointers for all hfindex that appear in tree.
  * This only works if the hfindex was "primed" before the dissection
  * took place, as we just pass back the already-created GPtrArray*.
- * The caller should *not* free the GPtrArray*; proto_tree_free_node()
+ * The caller should *not* free the GPtrArray*; proto_tree_free()
  * handles that. */
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
@@ -527,6 +527,10 @@ typedef struct
 /** Field value takes n bits (values from 0x100 - 0x4000) */
 /* if 0, it means that field takes fi->length * 8 */
 #define FI_BITS_SIZE(n)         (((n) & 63) << 8)
+/** The label in field_info.rep has not been formatted yet; it holds the
+ * printf-style format and a copy of its arguments instead.  Call
+ * proto_item_render_label() before reading field_info.rep->representation. */
+#define FI_DEFERRED_LABEL       0x00008000
 
 /** convenience macro to get field_info.flags */
 #define FI_GET_FLAG(fi, flag)   ((fi) ? ((fi)->flags & (flag)) : 0)
@@ -554,6 +558,7 @@ typedef struct {
     gboolean     fake_protocols;
     gint         count;
     struct _packet_info *pinfo;
+    struct _proto_item_chunk *item_chunks; /**< storage for the tree's items, newest chunk first */
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -1818,6 +1823,15 @@ proto_item_append_string(proto_item *pi, const char *str);
 WS_DLL_PUBLIC void
 proto_item_fill_label(field_info *fi, gchar *label_str);
 
+/** Format the label of an item whose text was set with one of the
+ *  proto_tree_add_..._format() or proto_item_{set,append}_text() functions.
+ *  Those only record the format and a copy of their arguments; the text
+ *  itself is produced here, the first time somebody wants to show it.
+ *  Does nothing if the label has already been formatted.
+ @param fi the item whose fi->rep should be made displayable */
+WS_DLL_PUBLIC void
+proto_item_render_label(field_info *fi);
+
 
 /** Register a new protocol.
  @param name the full name of the new protocol
@@ -324,19 +324,23 @@ reassembled_hash(gconstpointer k)
 
 /*
  * For a fragment hash table entry, free the associated fragments.
- * The entry value (fd_chain) is freed herein and the entry is freed
- * when the key freeing routine is called (as a consequence of returning
- * TRUE from this function).
+ * The entry value (fd_chain) and the key are freed herein; the entry
+ * itself is removed from the table as a consequence of returning TRUE
+ * from this function.
  */
 static gboolean
-free_all_fragments(gpointer key_arg _U_, gpointer value, gpointer user_data _U_)
+free_all_fragments(gpointer key_arg, gpointer value, gpointer user_data)
 {
+	reassembly_table *table = (reassembly_table *)user_data;
 	fragment_head *fd_head;
 	fragment_item *tmp_fd;
 
-	/* g_hash_table_new_full() was used to supply a function
-	 * to free the key and anything to which it points
+	/* the table's persistent key destruction function frees the key
+	 * and anything to which it points
 	 */
+	if (table->free_persistent_key_func)
+		table->free_persistent_key_func(key_arg);
+
 	for (fd_head = (fragment_head *)value; fd_head != NULL; fd_head = tmp_fd) {
 		tmp_fd=fd_head->next;
 
@@ -419,6 +423,8 @@ reassembly_table_init(reassembly_table *table,
 		table->persistent_key_func = funcs->persistent_key_func;
 	if (table->free_temporary_key_func == NULL)
 		table->free_temporary_key_func = funcs->free_temporary_key_func;
+	if (table->free_persistent_key_func == NULL)
+		table->free_persistent_key_func = funcs->free_persistent_key_func;
 	if (table->fragment_table != NULL) {
 		/*
 		 * The fragment hash table exists.
@@ -426,15 +432,16 @@ reassembly_table_init(reassembly_table *table,
 		 * Remove all entries and free fragment data for each entry.
 		 *
 		 * The keys, and anything to which they point, are freed by
-		 * calling the table's key freeing function.  The values
-		 * are freed in free_all_fragments().
+		 * calling the table's key freeing function.  Both are
+		 * done in free_all_fragments().
 		 */
-		g_hash_table_foreach_remove(table->fragment_table,
-					    free_all_fragments, NULL);
+		wmem_map_foreach_remove(table->fragment_table,
+					free_all_fragments, table);
 	} else {
-		/* The fragment table does not exist. Create it */
-		table->fragment_table = g_hash_table_new_full(funcs->hash_func,
-		    funcs->equal_func, funcs->free_persistent_key_func, NULL);
+		/* The fragment table does not exist. Create it.  It outlives
+		 * any one capture file, so it is not tied to a wmem scope. */
+		table->fragment_table = wmem_map_new(NULL, funcs->hash_func,
+		    funcs->equal_func);
 	}
 
 	if (table->reassembled_table != NULL) {
@@ -448,14 +455,14 @@ reassembly_table_init(reassembly_table *table,
 		 */
 
 		allocated_fragments = g_ptr_array_new();
-		g_hash_table_foreach_remove(table->reassembled_table,
+		wmem_map_foreach_remove(table->reassembled_table,
 				free_all_reassembled_fragments, allocated_fragments);
 
 		g_ptr_array_foreach(allocated_fragments, free_fragments, NULL);
 		g_ptr_array_free(allocated_fragments, TRUE);
 	} else {
 		/* The fragment table does not exist. Create it */
-		table->reassembled_table = g_hash_table_new(reassembled_hash,
+		table->reassembled_table = wmem_map_new(NULL, reassembled_hash,
 		    reassembled_equal);
 	}
 }
@@ -479,16 +486,16 @@ reassembly_table_destroy(reassembly_table *table)
 		 * Remove all entries and free fragment data for each entry.
 		 *
 		 * The keys, and anything to which they point, are freed by
-		 * calling the table's key freeing function.  The values
-		 * are freed in free_all_fragments().
+		 * calling the table's key freeing function.  Both are
+		 * done in free_all_fragments().
 		 */
-		g_hash_table_foreach_remove(table->fragment_table,
-					    free_all_fragments, NULL);
+		wmem_map_foreach_remove(table->fragment_table,
+					free_all_fragments, table);
 
 		/*
 		 * Now destroy the hash table.
 		 */
-		g_hash_table_destroy(table->fragment_table);
+		wmem_map_destroy(table->fragment_table);
 		table->fragment_table = NULL;
 	}
 	if (table->reassembled_table != NULL) {
@@ -502,7 +509,7 @@ reassembly_table_destroy(reassembly_table *table)
 		 */
 
 		allocated_fragments = g_ptr_array_new();
-		g_hash_table_foreach_remove(table->reassembled_table,
+		wmem_map_foreach_remove(table->reassembled_table,
 				free_all_reassembled_fragments, allocated_fragments);
 
 		g_ptr_array_foreach(allocated_fragments, free_fragments, NULL);
@@ -511,9 +518,15 @@ reassembly_table_destroy(reassembly_table *table)
 		/*
 		 * Now destroy the hash table.
 		 */
-		g_hash_table_destroy(table->reassembled_table);
+		wmem_map_destroy(table->reassembled_table);
 		table->reassembled_table = NULL;
 	}
+
+	/*
+	 * The persistent key destruction function was needed to empty
+	 * the fragment table above, so it is only cleared now.
+	 */
+	table->free_persistent_key_func = NULL;
 }
 
 /*
@@ -533,8 +546,8 @@ lookup_fd_head(reassembly_table *table, const packet_info *pinfo,
 	/*
 	 * Look up the reassembly in the fragment table.
 	 */
-	if (!g_hash_table_lookup_extended(table->fragment_table, key, orig_keyp,
-					  &value))
+	if (!wmem_map_lookup_extended(table->fragment_table, key,
+				      (const void **)orig_keyp, &value))
 		value = NULL;
 	/* Free the key */
 	table->free_temporary_key_func(key);
@@ -556,7 +569,7 @@ insert_fd_head(reassembly_table *table, fragment_head *fd_head,
 	 * so make a persistent version of it.
 	 */
 	key = table->persistent_key_func(pinfo, id, data);
-	g_hash_table_insert(table->fragment_table, key, fd_head);
+	wmem_map_insert(table->fragment_table, key, fd_head);
 	return key;
 }
 
@@ -599,7 +612,9 @@ fragment_delete(reassembly_table *table, const packet_info *pinfo,
 		fd=tmp_fd;
 	}
 	g_slice_free(fragment_head, fd_head);
-	g_hash_table_remove(table->fragment_table, key);
+	wmem_map_remove(table->fragment_table, key);
+	if (table->free_persistent_key_func)
+		table->free_persistent_key_func(key);
 
 	return fd_tvb_data;
 }
@@ -624,7 +639,7 @@ fragment_get_reassembled(reassembly_table *table, const guint32 id)
 	/* create key to search hash with */
 	key.frame = id;
 	key.id = id;
-	fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &key);
+	fd_head = (fragment_head *)wmem_map_lookup(table->reassembled_table, &key);
 
 	return fd_head;
 }
@@ -639,7 +654,7 @@ fragment_get_reassembled_id(reassembly_table *table, const packet_info *pinfo,
 	/* create key to search hash with */
 	key.frame = pinfo->fd->num;
 	key.id = id;
-	fd_head = (fragment_head *)g_hash_table_lookup(table->reassembled_table, &key);
+	fd_head = (fragment_head *)wmem_map_lookup(table->reassembled_table, &key);
 
 	return fd_head;
 }
@@ -773,7 +788,8 @@ fragment_set_partial_reassembly(reassembly_table *table,
  * This function gets rid of an entry from a fragment table, given
  * a pointer to the key for that entry.
  *
- * The key freeing routine will be called by g_hash_table_remove().
+ * The key is freed with the table's key freeing routine once the
+ * entry is gone.
  */
 static void
 fragment_unhash(reassembly_table *table, gpointer key)
@@ -781,7 +797,9 @@ fragment_unhash(reassembly_table *table, gpointer key)
 	/*
 	 * Remove the entry from the fragment table.
 	 */
-	g_hash_table_remove(table->fragment_table, key);
+	wmem_map_remove(table->fragment_table, key);
+	if (table->free_persistent_key_func)
+		table->free_persistent_key_func(key);
 }
 
 /*
@@ -805,7 +823,7 @@ fragment_reassembled(reassembly_table *table, fragment_head *fd_head,
 		new_key = g_slice_new(reassembled_key);
 		new_key->frame = pinfo->fd->num;
 		new_key->id = id;
-		g_hash_table_insert(table->reassembled_table, new_key, fd_head);
+		wmem_map_insert(table->reassembled_table, new_key, fd_head);
 	} else {
 		/*
 		 * Hash it with the frame numbers for all the frames.
@@ -814,7 +832,7 @@ fragment_reassembled(reassembly_table *table, fragment_head *fd_head,
 			new_key = g_slice_new(reassembled_key);
 			new_key->frame = fd->frame;
 			new_key->id = id;
-			g_hash_table_insert(table->reassembled_table, new_key,
+			wmem_map_insert(table->reassembled_table, new_key,
 				fd_head);
 		}
 	}
@@ -1423,12 +1441,12 @@ fragment_add_check(reassembly_table *table, tvbuff_t *tvb, const int offset,
 	if (pinfo->fd->flags.visited) {
 		reass_key.frame = pinfo->fd->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return (fragment_head *)wmem_map_lookup(table->reassembled_table, &reass_key);
 	}
 
-	/* Looks up a key in the GHashTable, returning the original key and the associated value
+	/* Looks up a key in the fragment table, returning the original key and the associated value
 	 * and a gboolean which is TRUE if the key was found. This is useful if you need to free
-	 * the memory allocated for the original key, for example before calling g_hash_table_remove()
+	 * the memory allocated for the original key, for example after calling wmem_map_remove()
 	 */
 	fd_head = lookup_fd_head(table, pinfo, id, data, &orig_key);
 	if (fd_head == NULL) {
@@ -1982,7 +2000,7 @@ fragment_add_seq_check_work(reassembly_table *table, tvbuff_t *tvb,
 	if (pinfo->fd->flags.visited) {
 		reass_key.frame = pinfo->fd->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return (fragment_head *)wmem_map_lookup(table->reassembled_table, &reass_key);
 	}
 
 	fd_head = fragment_add_seq_common(table, tvb, offset, pinfo, id, data,
@@ -2106,7 +2124,7 @@ fragment_end_seq_next(reassembly_table *table, const packet_info *pinfo,
 	if (pinfo->fd->flags.visited) {
 		reass_key.frame = pinfo->fd->num;
 		reass_key.id = id;
-		return (fragment_head *)g_hash_table_lookup(table->reassembled_table, &reass_key);
+		return (fragment_head *)wmem_map_lookup(table->reassembled_table, &reass_key);
 	}
 
 	fd_head = lookup_fd_head(table, pinfo, id, data, &orig_key);
@@ -2136,7 +2154,7 @@ fragment_end_seq_next(reassembly_table *table, const packet_info *pinfo,
 			new_key = g_slice_new(reassembled_key);
 			new_key->frame = pinfo->fd->num;
 			new_key->id = id;
-			g_hash_table_insert(table->reassembled_table, new_key, fd_head);
+			wmem_map_insert(table->reassembled_table, new_key, fd_head);
 		}
 
 		return fd_head;
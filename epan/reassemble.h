@@ -28,6 +28,7 @@
 #define REASSEMBLE_H
 
 #include "ws_symbol_export.h"
+#include "wmem/wmem.h"
 
 /* only in fd_head: packet is defragmented */
 #define FD_DEFRAGMENTED		0x0001
@@ -128,11 +129,12 @@ typedef gpointer (*fragment_persistent_key)(const packet_info *pinfo,
  * Data structure to keep track of fragments and reassemblies.
  */
 typedef struct {
-	GHashTable *fragment_table;
-	GHashTable *reassembled_table;
+	wmem_map_t *fragment_table;
+	wmem_map_t *reassembled_table;
 	fragment_temporary_key temporary_key_func;
 	fragment_persistent_key persistent_key_func;
 	GDestroyNotify free_temporary_key_func;		/* temporary key destruction function */
+	GDestroyNotify free_persistent_key_func;	/* persistent key destruction function */
 } reassembly_table;
 
 /*
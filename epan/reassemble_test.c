@@ -165,7 +165,7 @@ print_fragment_table_chain(gpointer k, gpointer v, gpointer ud) {
 static void
 print_fragment_table(void) {
     printf("\n Fragment Table -------\n");
-    g_hash_table_foreach(fragment_table, print_fragment_table_chain, NULL);
+    wmem_map_foreach(test_reassembly_table.fragment_table, print_fragment_table_chain, NULL);
 }
 
 static void
@@ -179,7 +179,7 @@ print_reassembled_table_chain(gpointer k, gpointer v, gpointer ud) {
 static void
 print_reassembled_table(void) {
     printf("\n Reassembled Table ----\n");
-    g_hash_table_foreach(test_reassembly_table.reassembled_table, print_reassembled_table_chain, NULL);
+    wmem_map_foreach(test_reassembly_table.reassembled_table, print_reassembled_table_chain, NULL);
 }
 
 static void
@@ -217,7 +217,7 @@ test_simple_fragment_add_seq(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                              0, 50, TRUE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* adding the same fragment again should do nothing, even with different
@@ -225,7 +225,7 @@ test_simple_fragment_add_seq(void)
     pinfo.fd->flags.visited = 1;
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                              0, 60, TRUE, 0);
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* start another pdu (just to confuse things) */
@@ -233,7 +233,7 @@ test_simple_fragment_add_seq(void)
     pinfo.fd->num = 2;
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 15, &pinfo, 13, NULL,
                              0, 60, TRUE, 0);
-    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(2,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* now we add the terminal fragment of the first datagram */
@@ -242,7 +242,7 @@ test_simple_fragment_add_seq(void)
                              2, 60, FALSE, 0);
 
     /* we haven't got all the fragments yet ... */
-    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(2,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* finally, add the missing fragment */
@@ -250,7 +250,7 @@ test_simple_fragment_add_seq(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 15, &pinfo, 12, NULL,
                              1, 60, TRUE, 0);
 
-    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(2,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -350,7 +350,7 @@ test_fragment_add_seq_partial_reassembly(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                              0, 50, FALSE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -384,7 +384,7 @@ test_fragment_add_seq_partial_reassembly(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 0, &pinfo, 12, NULL,
                              1, 40, TRUE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     fd_head=fragment_get(&test_reassembly_table, &pinfo, 12, NULL);
@@ -422,7 +422,7 @@ test_fragment_add_seq_partial_reassembly(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 0, &pinfo, 12, NULL,
                              1, 40, TRUE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
     fd_head=fragment_get(&test_reassembly_table, &pinfo, 12, NULL);
     ASSERT_NE(NULL,fd_head);
@@ -466,7 +466,7 @@ test_fragment_add_seq_partial_reassembly(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 20, &pinfo, 12, NULL,
                              2, 100, FALSE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -605,7 +605,7 @@ test_fragment_add_seq_duplicate_first(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                              0, 50, TRUE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Add the 2nd segment */
@@ -614,7 +614,7 @@ test_fragment_add_seq_duplicate_first(void)
                              1, 60, TRUE, 0);
 
     /* we haven't got all the fragments yet ... */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Add the last fragment */
@@ -622,7 +622,7 @@ test_fragment_add_seq_duplicate_first(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                              2, 40, FALSE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* Add the first fragment again */
@@ -631,7 +631,7 @@ test_fragment_add_seq_duplicate_first(void)
                              0, 50, TRUE, 0);
 
     /* Reassembly should have still succeeded */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -704,7 +704,7 @@ test_fragment_add_seq_duplicate_middle(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                              0, 50, TRUE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Add the 2nd segment */
@@ -713,7 +713,7 @@ test_fragment_add_seq_duplicate_middle(void)
                              1, 60, TRUE, 0);
 
     /* we haven't got all the fragments yet ... */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Now, add the 2nd segment again (but in a different frame) */
@@ -722,7 +722,7 @@ test_fragment_add_seq_duplicate_middle(void)
                              1, 60, TRUE, 0);
 
     /* This duplicate fragment should have been ignored */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* finally, add the last fragment */
@@ -730,7 +730,7 @@ test_fragment_add_seq_duplicate_middle(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                              2, 40, FALSE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -802,7 +802,7 @@ test_fragment_add_seq_duplicate_last(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                              0, 50, TRUE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Add the 2nd segment */
@@ -811,7 +811,7 @@ test_fragment_add_seq_duplicate_last(void)
                              1, 60, TRUE, 0);
 
     /* we haven't got all the fragments yet ... */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Add the last fragment */
@@ -819,7 +819,7 @@ test_fragment_add_seq_duplicate_last(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                              2, 40, FALSE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* Add the last fragment again */
@@ -828,7 +828,7 @@ test_fragment_add_seq_duplicate_last(void)
                              2, 40, FALSE, 0);
 
     /* Reassembly should have still succeeded */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -902,7 +902,7 @@ test_fragment_add_seq_duplicate_conflict(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                              0, 50, TRUE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Add the 2nd segment */
@@ -911,7 +911,7 @@ test_fragment_add_seq_duplicate_conflict(void)
                              1, 60, TRUE, 0);
 
     /* we haven't got all the fragments yet ... */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Now, add the 2nd segment again (but in a different frame and with
@@ -922,7 +922,7 @@ test_fragment_add_seq_duplicate_conflict(void)
                              1, 60, TRUE, 0);
 
     /* This duplicate fragment should have been ignored */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* finally, add the last fragment */
@@ -930,7 +930,7 @@ test_fragment_add_seq_duplicate_conflict(void)
     fd_head=fragment_add_seq(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                              2, 40, FALSE, 0);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -1014,16 +1014,16 @@ test_fragment_add_seq_check_work(fragment_head *(*fn)(reassembly_table *,
     fd_head=fn(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                0, 50, TRUE);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* start another pdu (just to confuse things) */
     pinfo.fd->num = 2;
     fd_head=fn(&test_reassembly_table, tvb, 15, &pinfo, 13, NULL,
                0, 60, TRUE);
-    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(2,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* add the terminal fragment of the first datagram */
@@ -1032,8 +1032,8 @@ test_fragment_add_seq_check_work(fragment_head *(*fn)(reassembly_table *,
                2, 60, FALSE);
 
     /* we haven't got all the fragments yet ... */
-    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(2,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* finally, add the missing fragment */
@@ -1041,8 +1041,8 @@ test_fragment_add_seq_check_work(fragment_head *(*fn)(reassembly_table *,
     fd_head=fn(&test_reassembly_table, tvb, 15, &pinfo, 12, NULL,
                1, 60, TRUE);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(3,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(3,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -1111,8 +1111,8 @@ test_fragment_add_seq_check_1(void)
     fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                                    1, 50, FALSE);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* Now add the missing segment */
@@ -1120,8 +1120,8 @@ test_fragment_add_seq_check_1(void)
     fd_head=fragment_add_seq_check(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                                    0, 60, TRUE);
 
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(2,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -1175,8 +1175,8 @@ test_fragment_add_seq_802_11_0(void)
     fd_head=fragment_add_seq_802_11(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                                     10, 50, FALSE);
 
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -1285,8 +1285,8 @@ test_simple_fragment_add_seq_next(void)
     fd_head= fragment_add_seq_next(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                                   50, TRUE);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* adding the same fragment again should do nothing, even with different
@@ -1294,8 +1294,8 @@ test_simple_fragment_add_seq_next(void)
     pinfo.fd->flags.visited = 1;
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                                   60, TRUE);
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* start another pdu (just to confuse things) */
@@ -1303,8 +1303,8 @@ test_simple_fragment_add_seq_next(void)
     pinfo.fd->num = 2;
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 15, &pinfo, 13, NULL,
                                   60, TRUE);
-    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(2,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
 
@@ -1313,8 +1313,8 @@ test_simple_fragment_add_seq_next(void)
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                                   60, FALSE);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(2,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(2,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure */
@@ -1362,8 +1362,8 @@ test_missing_data_fragment_add_seq_next(void)
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 10, &pinfo, 12, NULL,
                                   DATA_LEN-9, TRUE);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure. Reassembly failed so everything
@@ -1385,8 +1385,8 @@ test_missing_data_fragment_add_seq_next(void)
     /* XXX: it's not clear that this is the right result; however it's what the
      * code does...
      */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
 
@@ -1405,15 +1405,15 @@ test_missing_data_fragment_add_seq_next(void)
      * doesn't bother to check fd_head->reassembled_in); however, that's
      * what the code does...
      */
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     pinfo.fd->num = 4;
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 5, &pinfo, 12, NULL,
                                   60, FALSE);
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 }
 
@@ -1433,8 +1433,8 @@ test_missing_data_fragment_add_seq_next_2(void)
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 10, &pinfo, 24, NULL,
                                   50, TRUE);
 
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     pinfo.fd->num = 12;
@@ -1445,8 +1445,8 @@ test_missing_data_fragment_add_seq_next_2(void)
      * the data we had, for a best-effort attempt at dissecting it?
      * And it ought to go into the reassembled table?
      */
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     /* check what happens when we revisit the packets */
@@ -1459,15 +1459,15 @@ test_missing_data_fragment_add_seq_next_2(void)
     /* As before, this returns NULL because the fragment isn't in the
      * reassembled_table. At least this is a bit more consistent than before.
      */
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
     pinfo.fd->num = 12;
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 5, &pinfo, 24, NULL,
                                   DATA_LEN-4, FALSE);
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_EQ(NULL,fd_head);
 
 }
@@ -1486,8 +1486,8 @@ test_missing_data_fragment_add_seq_next_3(void)
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 5, &pinfo, 30, NULL,
                                   DATA_LEN-4, FALSE);
 
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_NE(NULL,fd_head);
 
     /* check the contents of the structure. */
@@ -1507,8 +1507,8 @@ test_missing_data_fragment_add_seq_next_3(void)
     fd_head=fragment_add_seq_next(&test_reassembly_table, tvb, 5, &pinfo, 30, NULL,
                                   DATA_LEN-4, FALSE);
 
-    ASSERT_EQ(0,g_hash_table_size(test_reassembly_table.fragment_table));
-    ASSERT_EQ(1,g_hash_table_size(test_reassembly_table.reassembled_table));
+    ASSERT_EQ(0,wmem_map_size(test_reassembly_table.fragment_table));
+    ASSERT_EQ(1,wmem_map_size(test_reassembly_table.reassembled_table));
     ASSERT_NE(NULL,fd_head);
     ASSERT_EQ(0,fd_head->frame);  /* unused */
     ASSERT_EQ(0,fd_head->offset); /* unused */
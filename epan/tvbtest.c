@@ -494,6 +494,122 @@ run_tests(void)
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
+/* Tests the scanning routines against byte-at-a-time versions. The
+ * lengths and offsets are chosen so that the matches fall before, on and
+ * after the 16 byte boundaries used by the vectorized code. */
+static void
+test_scanning(void)
+{
+	static const guint8 wsp[] = " \t\r\n";
+	guint8		*data;
+	tvbuff_t	*tvb_parent, *tvb_data, *tvb;
+	guint		length, pos, start, i;
+	gint		expected, result, next_offset;
+
+	data = g_new(guint8, 80);
+	for (length = 1; length <= 70; length++) {
+		for (pos = 0; pos < length; pos++) {
+			for (start = 0; start < 4 && start < length; start++) {
+				tvb_parent = tvb_new_real_data("", 0, 0);
+				tvb_data = tvb_new_child_real_data(tvb_parent, data, length, length);
+				tvb = tvb_new_subset_remaining(tvb_data, start);
+
+				/* A line with a LF at pos. */
+				memset(data, 'a', length);
+				data[pos] = '\n';
+				result = tvb_find_line_end(tvb, 0, -1, &next_offset, FALSE);
+				expected = pos >= start ? (gint) (pos - start) : (gint) (length - start);
+				if (result != expected) {
+					printf("Failed tvb_find_line_end: length=%u pos=%u start=%u result=%d expected=%d\n",
+					       length, pos, start, result, expected);
+					failed = TRUE;
+				}
+
+				/* The same line with quotes around the LF. */
+				if (pos > start && pos + 1 < length) {
+					data[pos - 1] = '"';
+					data[pos + 1] = '"';
+					result = tvb_find_line_end_unquoted(tvb, 0, -1, &next_offset);
+					expected = length - start;
+					if (result != expected) {
+						printf("Failed tvb_find_line_end_unquoted: length=%u pos=%u start=%u result=%d expected=%d\n",
+						       length, pos, start, result, expected);
+						failed = TRUE;
+					}
+				}
+
+				/* A NUL at pos. */
+				memset(data, 'a', length);
+				data[pos] = '\0';
+				if (pos >= start) {
+					result = tvb_strsize(tvb, 0);
+					expected = pos - start + 1;
+					if (result != expected) {
+						printf("Failed tvb_strsize: length=%u pos=%u start=%u result=%d expected=%d\n",
+						       length, pos, start, result, expected);
+						failed = TRUE;
+					}
+				}
+
+				/* White space up to pos. */
+				for (i = 0; i < pos; i++)
+					data[i] = wsp[i % 4];
+				data[pos] = 'a';
+				result = tvb_skip_wsp(tvb, 0, length - start);
+				expected = pos >= start ? (gint) (pos - start) : 0;
+				if (result != expected) {
+					printf("Failed tvb_skip_wsp: length=%u pos=%u start=%u result=%d expected=%d\n",
+					       length, pos, start, result, expected);
+					failed = TRUE;
+				}
+
+				tvb_free_chain(tvb_parent);
+			}
+		}
+	}
+	g_free(data);
+
+	/* Searches and pointers across the members of a composite. */
+	data = g_new(guint8, 80);
+	for (i = 0; i < 80; i++)
+		data[i] = i;
+	tvb_parent = tvb_new_real_data(data, 80, 80);
+	tvb = tvb_new_composite();
+	for (i = 0; i < 80; i += 7)
+		tvb_composite_append(tvb, tvb_new_subset(tvb_parent, i, MIN(7, 80 - i), MIN(7, 80 - i)));
+	tvb_composite_finalize(tvb);
+
+	for (pos = 0; pos < 80; pos++) {
+		guint8 needles[3];
+		guchar found = 0;
+
+		result = tvb_find_guint8(tvb, 0, -1, (guint8) pos);
+		if (result != (gint) pos) {
+			printf("Failed composite tvb_find_guint8: pos=%u result=%d\n", pos, result);
+			failed = TRUE;
+		}
+		needles[0] = 200;
+		needles[1] = (guint8) pos;
+		needles[2] = 0;
+		result = tvb_pbrk_guint8(tvb, 0, -1, needles, &found);
+		if (result != (gint) pos && !(pos == 0 && result == -1)) {
+			printf("Failed composite tvb_pbrk_guint8: pos=%u result=%d\n", pos, result);
+			failed = TRUE;
+		}
+		for (length = 1; pos + length <= 80 && length < 20; length++) {
+			if (memcmp(tvb_get_ptr(tvb, pos, length), &data[pos], length) != 0) {
+				printf("Failed composite tvb_get_ptr: pos=%u length=%u\n", pos, length);
+				failed = TRUE;
+			}
+		}
+	}
+	tvb_free_chain(tvb_parent);
+	g_free(data);
+
+	if (!failed)
+		printf("Passed scanning tests\n");
+}
+
 /* Note: valgrind can be used to check for tvbuff memory leaks */
 int
 main(void)
@@ -504,6 +620,7 @@ main(void)
 
 	except_init();
 	run_tests();
+	test_scanning();
 	except_deinit();
 	exit(failed?1:0);
 }
@@ -3218,6 +3218,7 @@ tvb_find_line_end_unquoted(tvbuff_t *tvb, const gint offset, int len, gint *next
 gint
 tvb_skip_wsp(tvbuff_t *tvb, const gint offset, const gint maxlength)
 {
+	static const guint8 wsp[] = " \t\r\n";
 	gint   counter = offset;
 	gint   end, tvb_len;
 	guint8 tempchar;
@@ -3235,6 +3236,11 @@ tvb_skip_wsp(tvbuff_t *tvb, const gint offset, const gint maxlength)
 	}
 
 	/* Skip past spaces, tabs, CRs and LFs until run out or meet something else */
+	if (offset >= 0 && offset < end) {
+		const guint8 *ptr = ensure_contiguous(tvb, offset, end - offset);
+
+		return offset + (gint) ws_memspn(ptr, end - offset, wsp);
+	}
 	for (counter = offset;
 		 counter < end &&
 		  ((tempchar = tvb_get_guint8(tvb,counter)) == ' ' ||
@@ -29,6 +29,23 @@
 #include "tvbuff-int.h"
 #include "proto.h"	/* XXX - only used for DISSECTOR_ASSERT, probably a new header file? */
 
+/*
+ * Maximum number of separately flattened ranges we keep per composite tvb;
+ * past that, or once the ranges would add up to half of the tvb or more,
+ * the whole tvb is flattened once instead.  Pointers into the ranges
+ * already handed out have to stay valid as long as the tvb, so they're
+ * kept until then, but the total memory stays under 1.5 times the size
+ * of the tvb.
+ */
+#define COMPOSITE_MAX_FLAT_RANGES 16
+
+/* A copy of a range of the composite tvb that spans members. */
+typedef struct {
+	guint		offset;
+	guint		length;
+	guint8		*data;
+} tvb_comp_range_t;
+
 typedef struct {
 	GSList		*tvbs;
 
@@ -38,6 +55,14 @@ typedef struct {
 	guint		*start_offsets;
 	guint		*end_offsets;
 
+	/* The members of tvbs, as an array; set up by tvb_composite_finalize() */
+	tvbuff_t	**members;
+	guint		num_members;
+
+	/* Ranges that composite_get_ptr() had to copy, most recent first */
+	GSList		*flat_ranges;
+	guint		num_flat_ranges;
+	guint		flat_ranges_length;	/* their total length */
 } tvb_comp_t;
 
 struct tvb_composite {
@@ -51,11 +76,22 @@ composite_free(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
+	GSList	   *slist;
 
 	g_slist_free(composite->tvbs);
 
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
+	g_free(composite->members);
+
+	for (slist = composite->flat_ranges; slist != NULL; slist = slist->next) {
+		tvb_comp_range_t *range = (tvb_comp_range_t *)slist->data;
+
+		g_free(range->data);
+		g_free(range);
+	}
+	g_slist_free(composite->flat_ranges);
+
 	if (tvb->real_data) {
 		/*
 		 * XXX - do this with a union?
@@ -73,37 +109,89 @@ composite_offset(const tvbuff_t *tvb, const guint counter)
 	return tvb_offset_from_real_beginning_counter(member, counter);
 }
 
+/* Return the index of the member holding abs_offset, or num_members
+ * if abs_offset is past the end of the tvb. */
+static guint
+composite_find_member(const tvb_comp_t *composite, guint abs_offset)
+{
+	guint low = 0, high = composite->num_members;
+
+	while (low < high) {
+		guint mid = low + (high - low) / 2;
+
+		if (abs_offset <= composite->end_offsets[mid])
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	return low;
+}
+
+static void *
+composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_length)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	guint8 *target = (guint8 *) _target;
+
+	guint	    i;
+	tvb_comp_t *composite;
+	tvbuff_t   *member_tvb;
+	guint	    member_offset, member_length;
+
+	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
+
+	composite = &composite_tvb->composite;
+	i = composite_find_member(composite, abs_offset);
+
+	/* special case */
+	if (i == composite->num_members) {
+		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
+		return target;
+	}
+
+	/* Copy the part that's in each member in turn; members are never
+	 * empty, so we always make progress. */
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_tvb    = composite->members[i];
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = MIN(abs_length, member_tvb->length - member_offset);
+
+		tvb_memcpy(member_tvb, target, member_offset, member_length);
+		target     += member_length;
+		abs_offset += member_length;
+		abs_length -= member_length;
+		i++;
+	}
+
+	return _target;
+}
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
 	GSList	   *slist;
+	tvb_comp_range_t *range;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
@@ -113,77 +201,90 @@ composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 		DISSECTOR_ASSERT(!tvb->real_data);
 		return tvb_get_ptr(member_tvb, member_offset, abs_length);
 	}
-	else {
+
+	/*
+	 * The range spans members. Reuse a copy we've already made if
+	 * one covers it; otherwise copy just this range, so that a field
+	 * straddling two segments of a large reassembled PDU doesn't
+	 * cost a copy of the whole PDU.
+	 */
+	for (slist = composite->flat_ranges; slist != NULL; slist = slist->next) {
+		range = (tvb_comp_range_t *)slist->data;
+		if (abs_offset >= range->offset &&
+		    abs_offset + abs_length <= range->offset + range->length)
+			return range->data + (abs_offset - range->offset);
+	}
+
+	if (composite->num_flat_ranges >= COMPOSITE_MAX_FLAT_RANGES ||
+	    composite->flat_ranges_length + abs_length >= tvb->length / 2) {
 		tvb->real_data = (guint8 *)tvb_memdup(NULL, tvb, 0, -1);
 		return tvb->real_data + abs_offset;
 	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	range = g_new(tvb_comp_range_t, 1);
+	range->offset = abs_offset;
+	range->length = abs_length;
+	range->data   = (guint8 *)g_malloc(abs_length);
+	composite_memcpy(tvb, range->data, abs_offset, abs_length);
+
+	composite->flat_ranges = g_slist_prepend(composite->flat_ranges, range);
+	composite->num_flat_ranges++;
+	composite->flat_ranges_length += abs_length;
+
+	return range->data;
 }
 
-static void *
-composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_length)
+/* Search each member in turn rather than flattening the tvb. */
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint8 *target = (guint8 *) _target;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvbuff_t   *member_tvb;
+	guint	    i, member_offset, member_length;
+	gint	    result;
 
-	guint	    i, num_members;
-	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
-	guint	    member_offset, member_length;
-	GSList	   *slist;
+	for (i = composite_find_member(composite, abs_offset);
+	     limit > 0 && i < composite->num_members; i++) {
+		member_tvb    = composite->members[i];
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = MIN(limit, member_tvb->length - member_offset);
 
-	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
+		result = tvb_find_guint8(member_tvb, member_offset, member_length, needle);
+		if (result != -1)
+			return result + composite->start_offsets[i];
 
-	/* Maybe the range specified by offset/length
-	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
+		abs_offset += member_length;
+		limit      -= member_length;
 	}
 
-	/* special case */
-	if (!member_tvb) {
-		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
-		return target;
-	}
-
-	member_offset = abs_offset - composite->start_offsets[i];
-
-	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
-		DISSECTOR_ASSERT(!tvb->real_data);
-		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
-	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		member_length = tvb_length_remaining(member_tvb, member_offset);
+	return -1;
+}
 
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needles, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvbuff_t   *member_tvb;
+	guint	    i, member_offset, member_length;
+	gint	    result;
 
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
+	for (i = composite_find_member(composite, abs_offset);
+	     limit > 0 && i < composite->num_members; i++) {
+		member_tvb    = composite->members[i];
+		member_offset = abs_offset - composite->start_offsets[i];
+		member_length = MIN(limit, member_tvb->length - member_offset);
 
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
-		}
+		result = tvb_pbrk_guint8(member_tvb, member_offset, member_length, needles, found_needle);
+		if (result != -1)
+			return result + composite->start_offsets[i];
 
-		return target;
+		abs_offset += member_length;
+		limit      -= member_length;
 	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	return -1;
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -193,8 +294,8 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_pbrk_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
 };
 
@@ -216,6 +317,11 @@ tvb_new_composite(void)
 	composite->tvbs		 = NULL;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
+	composite->flat_ranges	 = NULL;
+	composite->num_flat_ranges = 0;
+	composite->flat_ranges_length = 0;
 
 	return tvb;
 }
@@ -282,10 +388,13 @@ tvb_composite_finalize(tvbuff_t *tvb)
 
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
+	composite->members = g_new(tvbuff_t *, num_members);
+	composite->num_members = num_members;
 
 	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
 		DISSECTOR_ASSERT((guint) i < num_members);
 		member_tvb = (tvbuff_t *)slist->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
@@ -54,6 +54,7 @@ struct _wmem_allocator_t {
     void                        *private_data;
     enum _wmem_allocator_type_t  type;
     gboolean                     in_scope;
+    gboolean                     frozen;
 };
 
 #ifdef __cplusplus
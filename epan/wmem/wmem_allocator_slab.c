@@ -0,0 +1,607 @@
+/* wmem_allocator_slab.c
+ * Wireshark Memory Manager Size-Class Slab Allocator
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_allocator_slab.h"
+
+/* AUTHOR'S NOTE:
+ *
+ * Most long-lived allocations in Wireshark (conversations, fragment items,
+ * map and tree nodes, per-packet proto data...) come from a handful of small
+ * fixed sizes. The block allocator puts a chunk header in front of each one of
+ * them, which for a 24-byte tree node is a significant fraction of the memory
+ * used. This allocator instead rounds every small request up to one of a fixed
+ * set of size classes, and serves each class out of its own 'slabs' of
+ * identically-sized chunks with no per-chunk metadata at all.
+ *
+ * Every slab is WMEM_SLAB_SIZE bytes long and aligned to WMEM_SLAB_SIZE, and
+ * starts with a small header describing the class it serves. Given a pointer
+ * to a chunk we can therefore find its slab (and so its size) just by masking
+ * off the low bits of the pointer. In order to tell slab chunks apart from
+ * jumbo allocations (which are too big for any class and are simply passed
+ * through to g_malloc with a small list header) we keep a hash set of all the
+ * slab addresses we own. It is only consulted on free and realloc, which are
+ * rare compared to alloc in the pools this allocator is intended for.
+ *
+ * Slabs are carved out of 'superblocks' of WMEM_SLABS_PER_SUPER slabs, with
+ * one slab worth of slack so that we can align them without needing any
+ * platform-specific aligned allocation routine. Slabs that become completely
+ * empty are returned to a pool shared by all classes, so memory freed in one
+ * class can be reused by another; entirely unused superblocks are handed back
+ * to the OS by gc().
+ *
+ * Freed chunks are kept on a per-slab singly-linked list threaded through the
+ * chunks themselves, so both alloc and free are O(1). Each class keeps a
+ * doubly-linked list of its slabs that still have room, and allocates from the
+ * head of that list.
+ */
+
+/* See the comments in wmem_allocator_block.c for the choice of alignment. */
+#define WMEM_ALIGN_AMOUNT (2 * sizeof (gsize))
+#define WMEM_ALIGN_SIZE(SIZE) ((~(WMEM_ALIGN_AMOUNT-1)) & \
+        ((SIZE) + (WMEM_ALIGN_AMOUNT-1)))
+
+/* 64KB slabs hold between 31 (for the largest class) and 4092 (for the
+ * smallest) chunks each, and 32 of them make for 2MB superblocks, the same
+ * size as the fast block allocator uses. */
+#define WMEM_SLAB_SIZE       (64 * 1024)
+#define WMEM_SLAB_MASK       (~((gsize)WMEM_SLAB_SIZE - 1))
+#define WMEM_SLABS_PER_SUPER 32
+
+#define WMEM_SLAB_OF(PTR) ((void *)((gsize)(PTR) & WMEM_SLAB_MASK))
+
+/* Size classes. Each must be a multiple of WMEM_SLAB_CLASS_GRANULE (so that
+ * chunks stay aligned and the lookup table below works) and at least as big as
+ * a pointer (so that the free list fits). Spacing is roughly geometric to bound
+ * the internal fragmentation at about 25%. */
+#define WMEM_SLAB_CLASS_GRANULE 16
+static const guint32 wmem_slab_class_sizes[] = {
+      16,   32,   48,   64,   80,   96,  112,  128,
+     160,  192,  224,  256,  320,  384,  448,  512,
+     640,  768,  896, 1024, 1280, 1536, 1792, 2048
+};
+#define WMEM_SLAB_CLASSES G_N_ELEMENTS(wmem_slab_class_sizes)
+#define WMEM_SLAB_MAX_ALLOC_SIZE 2048
+#define WMEM_SLAB_LOOKUP_SIZE (WMEM_SLAB_MAX_ALLOC_SIZE/WMEM_SLAB_CLASS_GRANULE + 1)
+
+/* One OS-level allocation, holding several slabs */
+typedef struct _wmem_slab_super_t {
+    struct _wmem_slab_super_t *next;
+
+    void   *raw;        /* the pointer we got from wmem_alloc(NULL) */
+    guint8 *first;      /* the first aligned slab */
+    guint   n_slabs;    /* 32 or 33, depending on the alignment of raw */
+    guint   used_slabs; /* slabs not currently in the empty pool */
+} wmem_slab_super_t;
+
+/* The header at the start of every slab */
+typedef struct _wmem_slab_hdr_t {
+    struct _wmem_slab_hdr_t *prev, *next;
+
+    wmem_slab_super_t *super;
+
+    void    *free_list;   /* previously used chunks, threaded through */
+    guint32  bump;        /* offset of the first never-used chunk */
+    guint32  used;        /* chunks currently handed out */
+    guint32  chunk_size;
+    guint8   size_class;
+    gboolean listed;      /* whether we are on our class's partial list */
+} wmem_slab_hdr_t;
+#define WMEM_SLAB_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_hdr_t))
+
+typedef struct _wmem_slab_jumbo_t {
+    struct _wmem_slab_jumbo_t *prev, *next;
+} wmem_slab_jumbo_t;
+#define WMEM_JUMBO_HEADER_SIZE WMEM_ALIGN_SIZE(sizeof(wmem_slab_jumbo_t))
+
+#define WMEM_JUMBO_TO_DATA(JUMBO) ((void*)((guint8*)(JUMBO) + WMEM_JUMBO_HEADER_SIZE))
+#define WMEM_DATA_TO_JUMBO(DATA)  ((wmem_slab_jumbo_t*)((guint8*)(DATA) - WMEM_JUMBO_HEADER_SIZE))
+
+typedef struct _wmem_slab_allocator_t {
+    /* Per-class lists of slabs that have at least one free chunk */
+    wmem_slab_hdr_t   *partial[WMEM_SLAB_CLASSES];
+
+    /* Slabs with no chunks in use, singly-linked through 'next' */
+    wmem_slab_hdr_t   *empty;
+
+    wmem_slab_super_t *supers;
+    wmem_slab_jumbo_t *jumbo_list;
+
+    /* Set of the addresses of all slabs we own */
+    GHashTable        *slabs;
+
+    /* Maps a request size (in granules, rounded up) to its size class */
+    guint8             class_index[WMEM_SLAB_LOOKUP_SIZE];
+} wmem_slab_allocator_t;
+
+/* SLAB LIST HELPERS */
+
+static inline gboolean
+wmem_slab_is_full(const wmem_slab_hdr_t *slab)
+{
+    return slab->free_list == NULL &&
+        slab->bump + slab->chunk_size > WMEM_SLAB_SIZE;
+}
+
+static inline void
+wmem_slab_link(wmem_slab_allocator_t *allocator, wmem_slab_hdr_t *slab)
+{
+    wmem_slab_hdr_t **head = &allocator->partial[slab->size_class];
+
+    slab->prev = NULL;
+    slab->next = *head;
+    if (*head) {
+        (*head)->prev = slab;
+    }
+    *head = slab;
+    slab->listed = TRUE;
+}
+
+static inline void
+wmem_slab_unlink(wmem_slab_allocator_t *allocator, wmem_slab_hdr_t *slab)
+{
+    if (slab->prev) {
+        slab->prev->next = slab->next;
+    }
+    else {
+        allocator->partial[slab->size_class] = slab->next;
+    }
+    if (slab->next) {
+        slab->next->prev = slab->prev;
+    }
+    slab->prev = slab->next = NULL;
+    slab->listed = FALSE;
+}
+
+/* Resets a slab to the unused state and pushes it onto the empty pool. Does
+ * not touch the partial lists or the superblock counters. */
+static inline void
+wmem_slab_release(wmem_slab_allocator_t *allocator, wmem_slab_hdr_t *slab)
+{
+    slab->free_list = NULL;
+    slab->bump      = WMEM_SLAB_HEADER_SIZE;
+    slab->used      = 0;
+    slab->listed    = FALSE;
+    slab->prev      = NULL;
+    slab->next      = allocator->empty;
+
+    allocator->empty = slab;
+}
+
+/* Allocates a new superblock from the OS and adds its slabs to the empty
+ * pool. */
+static void
+wmem_slab_new_super(wmem_slab_allocator_t *allocator)
+{
+    wmem_slab_super_t *super;
+    wmem_slab_hdr_t   *slab;
+    const gsize        raw_size = (WMEM_SLABS_PER_SUPER + 1) * WMEM_SLAB_SIZE;
+    guint              i;
+
+    super = wmem_new(NULL, wmem_slab_super_t);
+
+    super->raw   = wmem_alloc(NULL, raw_size);
+    super->first = (guint8 *)WMEM_SLAB_OF((guint8 *)super->raw +
+            WMEM_SLAB_SIZE - 1);
+    super->n_slabs = (guint)(((guint8 *)super->raw + raw_size -
+            super->first) / WMEM_SLAB_SIZE);
+    super->used_slabs = 0;
+
+    super->next = allocator->supers;
+    allocator->supers = super;
+
+    for (i=0; i<super->n_slabs; i++) {
+        slab = (wmem_slab_hdr_t *)(super->first + i * WMEM_SLAB_SIZE);
+        slab->super = super;
+        wmem_slab_release(allocator, slab);
+        g_hash_table_insert(allocator->slabs, slab, slab);
+    }
+}
+
+/* Takes a slab from the empty pool (allocating more if necessary), assigns it
+ * to the given class and puts it on that class's partial list. */
+static wmem_slab_hdr_t *
+wmem_slab_take_empty(wmem_slab_allocator_t *allocator, guint8 size_class)
+{
+    wmem_slab_hdr_t *slab;
+
+    if (allocator->empty == NULL) {
+        wmem_slab_new_super(allocator);
+    }
+
+    slab = allocator->empty;
+    allocator->empty = slab->next;
+
+    slab->size_class = size_class;
+    slab->chunk_size = wmem_slab_class_sizes[size_class];
+    slab->super->used_slabs++;
+
+    wmem_slab_link(allocator, slab);
+
+    return slab;
+}
+
+/* JUMBO HELPERS */
+
+static void *
+wmem_slab_alloc_jumbo(wmem_slab_allocator_t *allocator, const size_t size)
+{
+    wmem_slab_jumbo_t *jumbo;
+
+    jumbo = (wmem_slab_jumbo_t *)wmem_alloc(NULL,
+            size + WMEM_JUMBO_HEADER_SIZE);
+
+    jumbo->prev = NULL;
+    jumbo->next = allocator->jumbo_list;
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo;
+    }
+    allocator->jumbo_list = jumbo;
+
+    return WMEM_JUMBO_TO_DATA(jumbo);
+}
+
+static void
+wmem_slab_free_jumbo(wmem_slab_allocator_t *allocator, void *ptr)
+{
+    wmem_slab_jumbo_t *jumbo = WMEM_DATA_TO_JUMBO(ptr);
+
+    if (jumbo->prev) {
+        jumbo->prev->next = jumbo->next;
+    }
+    else {
+        allocator->jumbo_list = jumbo->next;
+    }
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo->prev;
+    }
+
+    wmem_free(NULL, jumbo);
+}
+
+static void *
+wmem_slab_realloc_jumbo(wmem_slab_allocator_t *allocator, void *ptr,
+        const size_t size)
+{
+    wmem_slab_jumbo_t *jumbo = WMEM_DATA_TO_JUMBO(ptr);
+
+    jumbo = (wmem_slab_jumbo_t *)wmem_realloc(NULL, jumbo,
+            size + WMEM_JUMBO_HEADER_SIZE);
+
+    if (jumbo->prev) {
+        jumbo->prev->next = jumbo;
+    }
+    else {
+        allocator->jumbo_list = jumbo;
+    }
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo;
+    }
+
+    return WMEM_JUMBO_TO_DATA(jumbo);
+}
+
+/* API */
+
+static void *
+wmem_slab_alloc(void *private_data, const size_t size)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_hdr_t       *slab;
+    guint8                 size_class;
+    void                  *chunk;
+
+    if (size > WMEM_SLAB_MAX_ALLOC_SIZE) {
+        return wmem_slab_alloc_jumbo(allocator, size);
+    }
+
+    size_class = allocator->class_index[
+        (size + WMEM_SLAB_CLASS_GRANULE - 1) / WMEM_SLAB_CLASS_GRANULE];
+
+    slab = allocator->partial[size_class];
+    if (G_UNLIKELY(slab == NULL)) {
+        slab = wmem_slab_take_empty(allocator, size_class);
+    }
+
+    if (slab->free_list) {
+        chunk = slab->free_list;
+        slab->free_list = *(void **)chunk;
+    }
+    else {
+        chunk = (guint8 *)slab + slab->bump;
+        slab->bump += slab->chunk_size;
+    }
+
+    slab->used++;
+
+    if (wmem_slab_is_full(slab)) {
+        wmem_slab_unlink(allocator, slab);
+    }
+
+    return chunk;
+}
+
+static void
+wmem_slab_free(void *private_data, void *ptr)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_hdr_t       *slab;
+
+    slab = (wmem_slab_hdr_t *)g_hash_table_lookup(allocator->slabs,
+            WMEM_SLAB_OF(ptr));
+
+    if (slab == NULL) {
+        wmem_slab_free_jumbo(allocator, ptr);
+        return;
+    }
+
+    g_assert(slab->used > 0);
+
+    *(void **)ptr = slab->free_list;
+    slab->free_list = ptr;
+    slab->used--;
+
+    if (slab->used == 0) {
+        /* Hand the whole slab back to the empty pool so that other classes
+         * can use it. */
+        if (slab->listed) {
+            wmem_slab_unlink(allocator, slab);
+        }
+        slab->super->used_slabs--;
+        wmem_slab_release(allocator, slab);
+    }
+    else if (!slab->listed) {
+        /* it was full, but now it has room again */
+        wmem_slab_link(allocator, slab);
+    }
+}
+
+static void *
+wmem_slab_realloc(void *private_data, void *ptr, const size_t size)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_hdr_t       *slab;
+    void                  *newptr;
+
+    slab = (wmem_slab_hdr_t *)g_hash_table_lookup(allocator->slabs,
+            WMEM_SLAB_OF(ptr));
+
+    if (slab == NULL) {
+        return wmem_slab_realloc_jumbo(allocator, ptr, size);
+    }
+
+    if (size <= slab->chunk_size) {
+        /* it still fits in the same chunk, nothing to do */
+        return ptr;
+    }
+
+    newptr = wmem_slab_alloc(private_data, size);
+    memcpy(newptr, ptr, slab->chunk_size);
+    wmem_slab_free(private_data, ptr);
+
+    return newptr;
+}
+
+static void
+wmem_slab_free_all(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_super_t     *super;
+    wmem_slab_jumbo_t     *cur_jum, *nxt_jum;
+    guint                  i;
+
+    /* put every slab of every superblock back in the empty pool */
+    allocator->empty = NULL;
+    memset(allocator->partial, 0, sizeof(allocator->partial));
+
+    for (super = allocator->supers; super; super = super->next) {
+        for (i=0; i<super->n_slabs; i++) {
+            wmem_slab_release(allocator,
+                    (wmem_slab_hdr_t *)(super->first + i * WMEM_SLAB_SIZE));
+        }
+        super->used_slabs = 0;
+    }
+
+    /* then free all the jumbo allocations */
+    cur_jum = allocator->jumbo_list;
+    while (cur_jum) {
+        nxt_jum = cur_jum->next;
+        wmem_free(NULL, cur_jum);
+        cur_jum = nxt_jum;
+    }
+    allocator->jumbo_list = NULL;
+}
+
+static void
+wmem_slab_gc(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+    wmem_slab_super_t     *super, *nxt, **prev_super;
+    wmem_slab_hdr_t       *slab, **prev_slab;
+    guint                  i;
+
+    /* drop the slabs of completely unused superblocks from the empty pool */
+    prev_slab = &allocator->empty;
+    while ((slab = *prev_slab) != NULL) {
+        if (slab->super->used_slabs == 0) {
+            *prev_slab = slab->next;
+        }
+        else {
+            prev_slab = &slab->next;
+        }
+    }
+
+    /* and then return those superblocks to the OS */
+    prev_super = &allocator->supers;
+    while ((super = *prev_super) != NULL) {
+        nxt = super->next;
+        if (super->used_slabs == 0) {
+            for (i=0; i<super->n_slabs; i++) {
+                g_hash_table_remove(allocator->slabs,
+                        super->first + i * WMEM_SLAB_SIZE);
+            }
+            wmem_free(NULL, super->raw);
+            wmem_free(NULL, super);
+            *prev_super = nxt;
+        }
+        else {
+            prev_super = &super->next;
+        }
+    }
+}
+
+static void
+wmem_slab_allocator_cleanup(void *private_data)
+{
+    wmem_slab_allocator_t *allocator = (wmem_slab_allocator_t*) private_data;
+
+    /* wmem guarantees that free_all() is called directly before this, so
+     * every superblock is unused and gc() will free them all */
+    wmem_slab_gc(private_data);
+
+    g_hash_table_destroy(allocator->slabs);
+    wmem_free(NULL, allocator);
+}
+
+void
+wmem_slab_allocator_init(wmem_allocator_t *allocator)
+{
+    wmem_slab_allocator_t *slab_allocator;
+    guint                  granules, size_class;
+
+    slab_allocator = wmem_new0(NULL, wmem_slab_allocator_t);
+
+    allocator->alloc   = &wmem_slab_alloc;
+    allocator->realloc = &wmem_slab_realloc;
+    allocator->free    = &wmem_slab_free;
+
+    allocator->free_all = &wmem_slab_free_all;
+    allocator->gc       = &wmem_slab_gc;
+    allocator->cleanup  = &wmem_slab_allocator_cleanup;
+
+    allocator->private_data = (void*) slab_allocator;
+
+    slab_allocator->slabs = g_hash_table_new(&g_direct_hash, &g_direct_equal);
+
+    /* build the size -> class lookup table */
+    size_class = 0;
+    for (granules=0; granules<WMEM_SLAB_LOOKUP_SIZE; granules++) {
+        while (wmem_slab_class_sizes[size_class] <
+                granules * WMEM_SLAB_CLASS_GRANULE) {
+            size_class++;
+        }
+        slab_allocator->class_index[granules] = (guint8)size_class;
+    }
+}
+
+/* Exposed only for testing purposes */
+void
+wmem_slab_verify(wmem_allocator_t *allocator)
+{
+    wmem_slab_allocator_t *private_allocator;
+    wmem_slab_super_t     *super;
+    wmem_slab_hdr_t       *slab;
+    void                  *chunk;
+    guint                  i, capacity, free_count;
+    guint                  total_slabs = 0, used_slabs = 0, empty_slabs = 0;
+
+    /* Normally it would be bad for an allocator helper function to depend
+     * on receiving the right type of allocator, but this is for testing only
+     * and is not part of any real API. */
+    g_assert(allocator->type == WMEM_ALLOCATOR_SLAB);
+
+    private_allocator = (wmem_slab_allocator_t*) allocator->private_data;
+
+    for (i=0; i<WMEM_SLAB_CLASSES; i++) {
+        g_assert(wmem_slab_class_sizes[i] % WMEM_SLAB_CLASS_GRANULE == 0);
+        g_assert(wmem_slab_class_sizes[i] >= sizeof(void *));
+
+        for (slab = private_allocator->partial[i]; slab; slab = slab->next) {
+            g_assert(slab->listed);
+            g_assert(slab->size_class == i);
+            g_assert(slab->used > 0);
+            g_assert(!wmem_slab_is_full(slab));
+            if (slab->next) {
+                g_assert(slab->next->prev == slab);
+            }
+        }
+    }
+
+    for (slab = private_allocator->empty; slab; slab = slab->next) {
+        g_assert(!slab->listed);
+        g_assert(slab->used == 0);
+        empty_slabs++;
+    }
+
+    for (super = private_allocator->supers; super; super = super->next) {
+        g_assert(super->n_slabs == WMEM_SLABS_PER_SUPER ||
+                 super->n_slabs == WMEM_SLABS_PER_SUPER + 1);
+        g_assert(super->used_slabs <= super->n_slabs);
+        total_slabs += super->n_slabs;
+        used_slabs  += super->used_slabs;
+
+        for (i=0; i<super->n_slabs; i++) {
+            slab = (wmem_slab_hdr_t *)(super->first + i * WMEM_SLAB_SIZE);
+
+            g_assert(slab->super == super);
+            g_assert(g_hash_table_lookup(private_allocator->slabs, slab) == slab);
+
+            if (slab->used == 0) {
+                continue;
+            }
+
+            /* every chunk below the bump pointer is either in use or on the
+             * free list, never both */
+            capacity = (slab->bump - WMEM_SLAB_HEADER_SIZE) / slab->chunk_size;
+            free_count = 0;
+            for (chunk = slab->free_list; chunk; chunk = *(void **)chunk) {
+                g_assert(WMEM_SLAB_OF(chunk) == (void *)slab);
+                free_count++;
+            }
+            g_assert(free_count + slab->used == capacity);
+            g_assert(slab->listed == !wmem_slab_is_full(slab));
+        }
+    }
+
+    g_assert(g_hash_table_size(private_allocator->slabs) == total_slabs);
+    g_assert(used_slabs + empty_slabs == total_slabs);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
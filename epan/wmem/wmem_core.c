@@ -34,6 +34,7 @@
 #include "wmem_allocator_block.h"
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_strict.h"
+#include "wmem_allocator_slab.h"
 
 /* Set according to the WIRESHARK_DEBUG_WMEM_OVERRIDE environment variable in
  * wmem_init. Should not be set again. */
@@ -48,6 +49,7 @@ wmem_alloc(wmem_allocator_t *allocator, const size_t size)
     }
 
     g_assert(allocator->in_scope);
+    g_assert(!allocator->frozen);
 
     if (size == 0) {
         return NULL;
@@ -79,6 +81,7 @@ wmem_free(wmem_allocator_t *allocator, void *ptr)
     }
 
     g_assert(allocator->in_scope);
+    g_assert(!allocator->frozen);
 
     if (ptr == NULL) {
         return;
@@ -104,6 +107,7 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
     }
 
     g_assert(allocator->in_scope);
+    g_assert(!allocator->frozen);
 
     return allocator->realloc(allocator->private_data, ptr, size);
 }
@@ -111,6 +115,8 @@ wmem_realloc(wmem_allocator_t *allocator, void *ptr, const size_t size)
 static void
 wmem_free_all_real(wmem_allocator_t *allocator, gboolean final)
 {
+    g_assert(!allocator->frozen);
+
     wmem_call_callbacks(allocator,
             final ? WMEM_CB_DESTROY_EVENT : WMEM_CB_FREE_EVENT);
     allocator->free_all(allocator->private_data);
@@ -154,6 +160,7 @@ wmem_allocator_new(const wmem_allocator_type_t type)
     allocator->type      = real_type;
     allocator->callbacks = NULL;
     allocator->in_scope  = TRUE;
+    allocator->frozen    = FALSE;
 
     switch (real_type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -168,6 +175,9 @@ wmem_allocator_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_SLAB:
+            wmem_slab_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             /* This is necessary to squelch MSVC errors; is there
@@ -207,6 +217,9 @@ wmem_init(void)
         else if (strncmp(override_env, "block_fast", strlen("block_fast")) == 0) {
             override_type = WMEM_ALLOCATOR_BLOCK_FAST;
         }
+        else if (strncmp(override_env, "slab", strlen("slab")) == 0) {
+            override_type = WMEM_ALLOCATOR_SLAB;
+        }
         else {
             g_warning("Unrecognized wmem override");
             do_override = FALSE;
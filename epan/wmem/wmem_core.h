@@ -61,11 +61,16 @@ typedef enum _wmem_allocator_type_t {
                 memory usage via things like canaries and scrubbing freed
                 memory. Valgrind is the better choice on platforms that support
                 it. */
-    WMEM_ALLOCATOR_BLOCK_FAST /**< A block allocator like WMEM_ALLOCATOR_BLOCK
+    WMEM_ALLOCATOR_BLOCK_FAST, /**< A block allocator like WMEM_ALLOCATOR_BLOCK
                 but even faster by tracking absolutely minimal metadata and
                 making 'free' a no-op. Useful only for very short-lived scopes
                 where there's no reason to free individual allocations because
                 the next free_all is always just around the corner. */
+    WMEM_ALLOCATOR_SLAB /**< A size-class slab allocator that rounds small
+                allocations up to one of a few fixed sizes and packs them into
+                dense slabs with no per-allocation header. Both alloc and free
+                are O(1). Designed for long-lived pools holding many small
+                objects, like the file scope. */
 } wmem_allocator_type_t;
 
 /** Allocate the requested amount of memory in the given pool.
@@ -21,6 +21,8 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <string.h>
+
 #include <glib.h>
 
 #include "wmem_core.h"
@@ -43,22 +45,54 @@ wmem_init_hashing(void)
     postseed = g_random_int();
 }
 
+/* AUTHOR'S NOTE:
+ *
+ * This is an open-addressing hash table in the style of Google's "Swiss
+ * tables" (https://abseil.io/about/design/swisstables). Items are stored
+ * inline in a flat array of slots, so there is no per-item allocation, and
+ * next to that array is a second array of one-byte "control" entries, one per
+ * slot. A control byte is either EMPTY, DELETED (a tombstone left behind by
+ * wmem_map_remove) or, for a full slot, 7 bits taken from the hash of the key
+ * stored in it.
+ *
+ * Slots are grouped into aligned groups of WMEM_MAP_GROUP_WIDTH (16), and a
+ * key hashes to a group rather than to a slot. To find a key we load the
+ * group's 16 control bytes at once, compare all of them against the key's 7
+ * hash bits, and only call the (comparatively expensive) equality function
+ * for the handful of slots that match. If the key isn't there and the group
+ * has at least one EMPTY slot the key cannot be anywhere else; otherwise we
+ * move on to the next group in a triangular probe sequence, which visits every
+ * group exactly once since the number of groups is a power of two.
+ *
+ * With SSE2 (which is part of the baseline for x86-64) each of those group
+ * operations is a couple of instructions; elsewhere we fall back to a simple
+ * byte loop which gives the same results.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WMEM_MAP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 typedef struct _wmem_map_item_t {
     const void *key;
     void *value;
-    struct _wmem_map_item_t *next;
 } wmem_map_item_t;
 
 struct _wmem_map_t {
-    guint count; /* number of items stored */
+    guint count;      /* number of items stored */
+    guint tombstones; /* number of slots marked DELETED */
 
-    /* The base-2 logarithm of the actual size of the table. We store this
-     * value for efficiency in hashing, since finding the actual capacity
-     * becomes just a left-shift (see the CAPACITY macro) whereas taking
-     * logarithms is expensive. */
+    /* The base-2 logarithm of the actual number of slots in the table. We
+     * store this value for efficiency in hashing, since finding the actual
+     * capacity becomes just a left-shift (see the CAPACITY macro) whereas
+     * taking logarithms is expensive. */
     guint capacity;
 
-    wmem_map_item_t **table;
+    /* A single allocation holding CAPACITY items followed by CAPACITY
+     * control bytes. */
+    wmem_map_item_t *table;
+    guint8          *ctrl;
 
     GHashFunc  hash_func;
     GEqualFunc eql_func;
@@ -66,19 +100,114 @@ struct _wmem_map_t {
     wmem_allocator_t *allocator;
 };
 
+#define WMEM_MAP_GROUP_BITS  4
+#define WMEM_MAP_GROUP_WIDTH (1 << WMEM_MAP_GROUP_BITS)
+
+/* Control byte values. Anything with the high bit clear is a full slot. */
+#define WMEM_MAP_CTRL_EMPTY   ((guint8)0x80)
+#define WMEM_MAP_CTRL_DELETED ((guint8)0xFE)
+#define WMEM_MAP_CTRL_IS_FULL(CTRL) (((CTRL) & 0x80) == 0)
+
 /* As per the comment on the 'capacity' member of the wmem_map_t struct, this is
- * the base-2 logarithm, meaning the actual default capacity is 2^5 = 32 */
-#define WMEM_MAP_DEFAULT_CAPACITY 5
+ * the base-2 logarithm, meaning the actual default capacity is 2^4 = 16, which
+ * is a single group */
+#define WMEM_MAP_DEFAULT_CAPACITY WMEM_MAP_GROUP_BITS
 
 /* Macro for calculating the real capacity of the map by using a left-shift to
  * do the 2^x operation. */
 #define CAPACITY(MAP) ((guint)(1 << (MAP)->capacity))
 
+/* The table is grown (or purged of tombstones) once full slots plus
+ * tombstones exceed 7/8 of the capacity. */
+#define MAX_LOAD(MAP) (CAPACITY(MAP) - (CAPACITY(MAP) >> 3))
+
 /* Efficient universal integer hashing:
  * https://en.wikipedia.org/wiki/Universal_hashing#Avoiding_modular_arithmetic
+ *
+ * The top 7 bits of the result are stored in the control byte, and the next
+ * (capacity - GROUP_BITS) bits pick the group to start probing at. The low
+ * bits of a multiplicative hash are weak, so we never use them.
  */
-#define HASH(MAP, KEY) \
-    ((guint32)(((MAP)->hash_func(KEY) * x) >> (32 - (MAP)->capacity)))
+#define HASH(MAP, KEY) ((guint32)((MAP)->hash_func(KEY) * x))
+#define HASH_H2(HASH) ((guint8)((HASH) >> 25))
+#define HASH_GROUP(MAP, HASH) \
+    (((HASH) & 0x01FFFFFF) >> (25 - ((MAP)->capacity - WMEM_MAP_GROUP_BITS)))
+
+/* Returns a bitmask with bit i set if ctrl[i] == h2, for the 16 control bytes
+ * of a group. */
+static inline guint32
+wmem_map_group_match(const guint8 *ctrl, const guint8 h2)
+{
+#ifdef WMEM_MAP_USE_SSE2
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (guint32)_mm_movemask_epi8(
+            _mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+#else
+    guint32 mask = 0;
+    int     i;
+
+    for (i=0; i<WMEM_MAP_GROUP_WIDTH; i++) {
+        if (ctrl[i] == h2) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/* Returns a bitmask of the EMPTY slots in a group. */
+static inline guint32
+wmem_map_group_match_empty(const guint8 *ctrl)
+{
+    return wmem_map_group_match(ctrl, WMEM_MAP_CTRL_EMPTY);
+}
+
+/* Returns a bitmask of the slots in a group that are EMPTY or DELETED, ie
+ * the ones that have their high bit set. */
+static inline guint32
+wmem_map_group_match_free(const guint8 *ctrl)
+{
+#ifdef WMEM_MAP_USE_SSE2
+    return (guint32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#else
+    guint32 mask = 0;
+    int     i;
+
+    for (i=0; i<WMEM_MAP_GROUP_WIDTH; i++) {
+        if (!WMEM_MAP_CTRL_IS_FULL(ctrl[i])) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/* Index of the lowest set bit of a non-zero mask */
+static inline guint
+wmem_map_lowest_bit(guint32 mask)
+{
+#if defined(__GNUC__)
+    return (guint)__builtin_ctz(mask);
+#else
+    guint i = 0;
+
+    while (!(mask & 1)) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+static void
+wmem_map_alloc_table(wmem_map_t *map)
+{
+    map->table = (wmem_map_item_t *)wmem_alloc(map->allocator,
+            CAPACITY(map) * (sizeof(wmem_map_item_t) + 1));
+    map->ctrl  = (guint8 *)(map->table + CAPACITY(map));
+    memset(map->ctrl, WMEM_MAP_CTRL_EMPTY, CAPACITY(map));
+    map->tombstones = 0;
+}
 
 wmem_map_t *
 wmem_map_new(wmem_allocator_t *allocator,
@@ -90,38 +219,118 @@ wmem_map_new(wmem_allocator_t *allocator,
 
     map->count     = 0;
     map->capacity  = WMEM_MAP_DEFAULT_CAPACITY;
-    map->table     = wmem_alloc0_array(allocator, wmem_map_item_t*, CAPACITY(map));
     map->hash_func = hash_func;
     map->eql_func  = eql_func;
     map->allocator = allocator;
 
+    wmem_map_alloc_table(map);
+
     return map;
 }
 
+/* Finds the slot holding the given key (whose hash is given), or returns -1. */
+static inline gint
+wmem_map_find(wmem_map_t *map, const void *key, const guint32 hash)
+{
+    const guint8  h2        = HASH_H2(hash);
+    const guint   groupmask = (CAPACITY(map) >> WMEM_MAP_GROUP_BITS) - 1;
+    guint         group, probe, slot;
+    guint32       match;
+
+    group = HASH_GROUP(map, hash);
+
+    for (probe=1; probe<=groupmask+1; probe++) {
+        const guint8 *ctrl = map->ctrl + (group << WMEM_MAP_GROUP_BITS);
+
+        match = wmem_map_group_match(ctrl, h2);
+        while (match) {
+            slot = (group << WMEM_MAP_GROUP_BITS) + wmem_map_lowest_bit(match);
+            if (map->eql_func(key, map->table[slot].key)) {
+                return (gint)slot;
+            }
+            match &= match - 1;
+        }
+
+        if (wmem_map_group_match_empty(ctrl)) {
+            /* the key would have been placed in this group if it existed */
+            return -1;
+        }
+
+        group = (group + probe) & groupmask;
+    }
+
+    return -1;
+}
+
+/* Finds the first EMPTY or DELETED slot in the probe sequence for the given
+ * hash. The table is never allowed to fill up, so there always is one. */
+static inline guint
+wmem_map_find_free(wmem_map_t *map, const guint32 hash)
+{
+    const guint groupmask = (CAPACITY(map) >> WMEM_MAP_GROUP_BITS) - 1;
+    guint       group, probe;
+    guint32     match;
+
+    group = HASH_GROUP(map, hash);
+
+    for (probe=1; ; probe++) {
+        match = wmem_map_group_match_free(map->ctrl + (group << WMEM_MAP_GROUP_BITS));
+        if (match) {
+            return (group << WMEM_MAP_GROUP_BITS) + wmem_map_lowest_bit(match);
+        }
+        group = (group + probe) & groupmask;
+    }
+}
+
+/* Marks a full slot as no longer used. If its group still has an EMPTY slot
+ * then no probe sequence can have continued past this group, so the slot can
+ * go straight back to EMPTY; otherwise it has to become a tombstone. */
 static inline void
-wmem_map_grow(wmem_map_t *map)
+wmem_map_clear_slot(wmem_map_t *map, const guint slot)
+{
+    const guint8 *group_ctrl = map->ctrl + (slot & ~(WMEM_MAP_GROUP_WIDTH - 1));
+
+    if (wmem_map_group_match_empty(group_ctrl)) {
+        map->ctrl[slot] = WMEM_MAP_CTRL_EMPTY;
+    }
+    else {
+        map->ctrl[slot] = WMEM_MAP_CTRL_DELETED;
+        map->tombstones++;
+    }
+    map->count--;
+}
+
+/* Rebuilds the table, doubling it if it is more than about half full,
+ * otherwise just getting rid of the tombstones. */
+static void
+wmem_map_rehash(wmem_map_t *map)
 {
-    wmem_map_item_t **old_table, *cur, *nxt;
-    guint             old_cap, i, slot;
+    wmem_map_item_t *old_table;
+    guint8          *old_ctrl;
+    guint            old_cap, i, slot;
+    guint32          hash;
 
     /* store the old table and capacity */
     old_table = map->table;
+    old_ctrl  = map->ctrl;
     old_cap   = CAPACITY(map);
 
-    /* double the size (capacity is base-2 logarithm, so this just means
-     * increment it) and allocate new table */
-    map->capacity++;
-    map->table = wmem_alloc0_array(map->allocator, wmem_map_item_t*, CAPACITY(map));
+    if (map->count >= (old_cap >> 1) - (old_cap >> 3)) {
+        /* double the size (capacity is base-2 logarithm, so this just means
+         * increment it) */
+        map->capacity++;
+        g_assert(map->capacity - WMEM_MAP_GROUP_BITS <= 25);
+    }
+
+    wmem_map_alloc_table(map);
 
     /* copy all the elements over from the old table */
     for (i=0; i<old_cap; i++) {
-        cur = old_table[i];
-        while (cur) {
-            nxt              = cur->next;
-            slot             = HASH(map, cur->key);
-            cur->next        = map->table[slot];
-            map->table[slot] = cur;
-            cur              = nxt;
+        if (WMEM_MAP_CTRL_IS_FULL(old_ctrl[i])) {
+            hash = HASH(map, old_table[i].key);
+            slot = wmem_map_find_free(map, hash);
+            map->ctrl[slot]  = HASH_H2(hash);
+            map->table[slot] = old_table[i];
         }
     }
 
@@ -132,37 +341,36 @@ wmem_map_grow(wmem_map_t *map)
 void *
 wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 {
-    wmem_map_item_t **item;
-    void *old_val;
-
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check existing items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* replace and return old value for this key */
-            old_val = (*item)->value;
-            (*item)->value = value;
-            return old_val;
-        }
-        item = &((*item)->next);
+    gint     found;
+    guint    slot;
+    guint32  hash;
+    void    *old_val;
+
+    hash  = HASH(map, key);
+    found = wmem_map_find(map, key, hash);
+    if (found >= 0) {
+        /* replace and return old value for this key */
+        old_val = map->table[found].value;
+        map->table[found].value = value;
+        return old_val;
     }
 
-    /* insert new item */
-    (*item) = wmem_new(map->allocator, wmem_map_item_t);
+    /* make room if we are over-full */
+    if (map->count + map->tombstones >= MAX_LOAD(map)) {
+        wmem_map_rehash(map);
+    }
 
-    (*item)->key   = key;
-    (*item)->value = value;
-    (*item)->next  = NULL;
+    /* insert new item */
+    slot = wmem_map_find_free(map, hash);
+    if (map->ctrl[slot] == WMEM_MAP_CTRL_DELETED) {
+        map->tombstones--;
+    }
+    map->ctrl[slot]        = HASH_H2(hash);
+    map->table[slot].key   = key;
+    map->table[slot].value = value;
 
     map->count++;
 
-    /* increase size if we are over-full */
-    if (map->count >= CAPACITY(map)) {
-        wmem_map_grow(map);
-    }
-
     /* no previous entry, return NULL */
     return NULL;
 }
@@ -170,47 +378,99 @@ wmem_map_insert(wmem_map_t *map, const void *key, void *value)
 void *
 wmem_map_lookup(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t *item;
+    gint slot;
 
-    /* find correct slot */
-    item = map->table[HASH(map, key)];
+    slot = wmem_map_find(map, key, HASH(map, key));
 
-    /* scan list of items in this slot for the correct value */
-    while (item) {
-        if (map->eql_func(key, item->key)) {
-            return item->value;
-        }
-        item = item->next;
+    return slot >= 0 ? map->table[slot].value : NULL;
+}
+
+gboolean
+wmem_map_lookup_extended(wmem_map_t *map, const void *key,
+        const void **orig_key, void **value)
+{
+    gint slot;
+
+    slot = wmem_map_find(map, key, HASH(map, key));
+    if (slot < 0) {
+        return FALSE;
     }
 
-    return NULL;
+    if (orig_key) {
+        *orig_key = map->table[slot].key;
+    }
+    if (value) {
+        *value = map->table[slot].value;
+    }
+    return TRUE;
+}
+
+gboolean
+wmem_map_contains(wmem_map_t *map, const void *key)
+{
+    return wmem_map_find(map, key, HASH(map, key)) >= 0;
 }
 
 void *
 wmem_map_remove(wmem_map_t *map, const void *key)
 {
-    wmem_map_item_t **item, *tmp;
+    gint  slot;
     void *value;
 
-    /* get a pointer to the slot */
-    item = &(map->table[HASH(map, key)]);
-
-    /* check the items in that slot */
-    while (*item) {
-        if (map->eql_func(key, (*item)->key)) {
-            /* found it */
-            tmp     = (*item);
-            value   = tmp->value;
-            (*item) = tmp->next;
-            wmem_free(map->allocator, tmp);
-            map->count--;
-            return value;
+    slot = wmem_map_find(map, key, HASH(map, key));
+    if (slot < 0) {
+        /* didn't find it */
+        return NULL;
+    }
+
+    value = map->table[slot].value;
+    wmem_map_clear_slot(map, (guint)slot);
+
+    return value;
+}
+
+guint
+wmem_map_size(wmem_map_t *map)
+{
+    return map->count;
+}
+
+void
+wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, gpointer user_data)
+{
+    guint i;
+
+    for (i=0; i<CAPACITY(map); i++) {
+        if (WMEM_MAP_CTRL_IS_FULL(map->ctrl[i])) {
+            foreach_func((gpointer)map->table[i].key, map->table[i].value,
+                    user_data);
         }
-        item = &((*item)->next);
     }
+}
 
-    /* didn't find it */
-    return NULL;
+guint
+wmem_map_foreach_remove(wmem_map_t *map, GHRFunc foreach_func,
+        gpointer user_data)
+{
+    guint i, removed = 0;
+
+    for (i=0; i<CAPACITY(map); i++) {
+        if (WMEM_MAP_CTRL_IS_FULL(map->ctrl[i]) &&
+                foreach_func((gpointer)map->table[i].key,
+                    map->table[i].value, user_data)) {
+            wmem_map_clear_slot(map, i);
+            removed++;
+        }
+    }
+
+    return removed;
+}
+
+void
+wmem_map_destroy(wmem_map_t *map)
+{
+    wmem_free(map->allocator, map->table);
+    wmem_free(map->allocator, map);
 }
 
 /* Borrowed from Perl 5.18. This is based on Bob Jenkin's one-at-a-time
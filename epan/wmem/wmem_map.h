@@ -38,9 +38,9 @@ extern "C" {
  *
  *    A hash map implementation on top of wmem. Provides insertion, deletion and
  *    lookup in expected amortized constant time. Uses universal hashing to map
- *    keys into buckets, and provides a generic strong hash function that makes
- *    it secure against algorithmic complexity attacks, and suitable for use
- *    even with untrusted data.
+ *    keys into groups of slots in an open-addressed table, and provides a
+ *    generic strong hash function that makes it secure against algorithmic
+ *    complexity attacks, and suitable for use even with untrusted data.
  *
  *    @{
  */
@@ -91,6 +91,31 @@ WS_DLL_PUBLIC
 void *
 wmem_map_lookup(wmem_map_t *map, const void *key);
 
+/** Lookup a key in the map, returning both the key as it was originally
+ * inserted and its value. Useful when the value may legitimately be NULL, or
+ * when the caller needs the stored copy of the key.
+ *
+ * @param map The map to search in.
+ * @param key The key to lookup.
+ * @param orig_key Set to the stored key if found. May be NULL.
+ * @param value Set to the stored value if found. May be NULL.
+ * @return TRUE if the key was found.
+ */
+WS_DLL_PUBLIC
+gboolean
+wmem_map_lookup_extended(wmem_map_t *map, const void *key,
+        const void **orig_key, void **value);
+
+/** Check whether a key is present in the map.
+ *
+ * @param map The map to search in.
+ * @param key The key to lookup.
+ * @return TRUE if the key is in the map.
+ */
+WS_DLL_PUBLIC
+gboolean
+wmem_map_contains(wmem_map_t *map, const void *key);
+
 /** Remove a value from the map. If no value is stored at that key, nothing
  * happens.
  *
@@ -102,6 +127,50 @@ WS_DLL_PUBLIC
 void *
 wmem_map_remove(wmem_map_t *map, const void *key);
 
+/** Return the number of items in the map.
+ *
+ * @param map The map to query.
+ * @return The number of items stored.
+ */
+WS_DLL_PUBLIC
+guint
+wmem_map_size(wmem_map_t *map);
+
+/** Run a function against all key/value pairs in the map. The order of the
+ * calls is unpredictable. The map must not be modified from within the
+ * function.
+ *
+ * @param map The map to use.
+ * @param foreach_func The function to call for each pair.
+ * @param user_data User data to pass to the function.
+ */
+WS_DLL_PUBLIC
+void
+wmem_map_foreach(wmem_map_t *map, GHFunc foreach_func, gpointer user_data);
+
+/** Run a function against all key/value pairs in the map, removing each pair
+ * for which the function returns TRUE. The map itself must not be modified
+ * from within the function.
+ *
+ * @param map The map to use.
+ * @param foreach_func The function to call for each pair.
+ * @param user_data User data to pass to the function.
+ * @return The number of pairs removed.
+ */
+WS_DLL_PUBLIC
+guint
+wmem_map_foreach_remove(wmem_map_t *map, GHRFunc foreach_func,
+        gpointer user_data);
+
+/** Free the map itself. Keys and values are not touched. Only needed for maps
+ * created with a NULL allocator; maps in a pool go away with the pool.
+ *
+ * @param map The map to destroy.
+ */
+WS_DLL_PUBLIC
+void
+wmem_map_destroy(wmem_map_t *map);
+
 
 /** Compute a strong hash value for an arbitrary sequence of bytes. Use of this
  * hash value should be secure against algorithmic complexity attacks, even for
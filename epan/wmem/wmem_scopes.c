@@ -47,11 +47,41 @@
  * perfect, but it should stop most of the bad behaviour that emem permitted.
  */
 
-/* TODO: Make these thread-local */
 static wmem_allocator_t *packet_scope = NULL;
 static wmem_allocator_t *file_scope   = NULL;
 static wmem_allocator_t *epan_scope   = NULL;
 
+/* Worker threads that want to dissect concurrently with the main thread each
+ * get their own packet scope (see wmem_init_thread_scopes). The main thread
+ * never registers one, so it keeps using the global packet_scope above. The
+ * file scope is still shared, so it must be frozen (see
+ * wmem_freeze_file_scope) before any worker starts allocating. */
+#if GLIB_CHECK_VERSION(2,31,0)
+static GPrivate thread_packet_scope = G_PRIVATE_INIT(NULL);
+#define THREAD_PACKET_SCOPE_GET() \
+    ((wmem_allocator_t *)g_private_get(&thread_packet_scope))
+#define THREAD_PACKET_SCOPE_SET(ALLOCATOR) \
+    g_private_set(&thread_packet_scope, (ALLOCATOR))
+#else
+static GPrivate *thread_packet_scope = NULL;
+#define THREAD_PACKET_SCOPE_GET() \
+    ((wmem_allocator_t *)g_private_get(thread_packet_scope))
+#define THREAD_PACKET_SCOPE_SET(ALLOCATOR) \
+    g_private_set(thread_packet_scope, (ALLOCATOR))
+#endif
+
+static volatile gint thread_scope_count = 0;
+
+static inline wmem_allocator_t *
+wmem_current_packet_scope(void)
+{
+    wmem_allocator_t *allocator;
+
+    allocator = THREAD_PACKET_SCOPE_GET();
+
+    return allocator ? allocator : packet_scope;
+}
+
 /* Packet Scope */
 
 wmem_allocator_t *
@@ -59,27 +89,35 @@ wmem_packet_scope(void)
 {
     g_assert(packet_scope);
 
-    return packet_scope;
+    return wmem_current_packet_scope();
 }
 
 void
 wmem_enter_packet_scope(void)
 {
+    wmem_allocator_t *allocator;
+
     g_assert(packet_scope);
     g_assert(file_scope->in_scope);
-    g_assert(!packet_scope->in_scope);
 
-    packet_scope->in_scope = TRUE;
+    allocator = wmem_current_packet_scope();
+    g_assert(!allocator->in_scope);
+
+    allocator->in_scope = TRUE;
 }
 
 void
 wmem_leave_packet_scope(void)
 {
+    wmem_allocator_t *allocator;
+
     g_assert(packet_scope);
-    g_assert(packet_scope->in_scope);
 
-    wmem_free_all(packet_scope);
-    packet_scope->in_scope = FALSE;
+    allocator = wmem_current_packet_scope();
+    g_assert(allocator->in_scope);
+
+    wmem_free_all(allocator);
+    allocator->in_scope = FALSE;
 }
 
 /* File Scope */
@@ -97,6 +135,7 @@ wmem_enter_file_scope(void)
 {
     g_assert(file_scope);
     g_assert(!file_scope->in_scope);
+    g_assert(!file_scope->frozen);
 
     file_scope->in_scope = TRUE;
 }
@@ -106,7 +145,9 @@ wmem_leave_file_scope(void)
 {
     g_assert(file_scope);
     g_assert(file_scope->in_scope);
+    g_assert(!file_scope->frozen);
     g_assert(!packet_scope->in_scope);
+    g_assert(g_atomic_int_get(&thread_scope_count) == 0);
 
     wmem_free_all(file_scope);
     file_scope->in_scope = FALSE;
@@ -116,6 +157,34 @@ wmem_leave_file_scope(void)
     wmem_gc(packet_scope);
 }
 
+void
+wmem_freeze_file_scope(void)
+{
+    g_assert(file_scope);
+    g_assert(file_scope->in_scope);
+    g_assert(!file_scope->frozen);
+
+    file_scope->frozen = TRUE;
+}
+
+void
+wmem_thaw_file_scope(void)
+{
+    g_assert(file_scope);
+    g_assert(file_scope->frozen);
+    g_assert(g_atomic_int_get(&thread_scope_count) == 0);
+
+    file_scope->frozen = FALSE;
+}
+
+gboolean
+wmem_file_scope_is_frozen(void)
+{
+    g_assert(file_scope);
+
+    return file_scope->frozen;
+}
+
 /* Epan Scope */
 
 wmem_allocator_t *
@@ -126,6 +195,38 @@ wmem_epan_scope(void)
     return epan_scope;
 }
 
+/* Thread Scopes */
+
+void
+wmem_init_thread_scopes(void)
+{
+    wmem_allocator_t *allocator;
+
+    g_assert(packet_scope);
+    g_assert(THREAD_PACKET_SCOPE_GET() == NULL);
+
+    allocator = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+    allocator->in_scope = FALSE;
+
+    THREAD_PACKET_SCOPE_SET(allocator);
+    g_atomic_int_inc(&thread_scope_count);
+}
+
+void
+wmem_cleanup_thread_scopes(void)
+{
+    wmem_allocator_t *allocator;
+
+    allocator = THREAD_PACKET_SCOPE_GET();
+
+    g_assert(allocator);
+    g_assert(!allocator->in_scope);
+
+    THREAD_PACKET_SCOPE_SET(NULL);
+    wmem_destroy_allocator(allocator);
+    g_atomic_int_add(&thread_scope_count, -1);
+}
+
 /* Scope Management */
 
 void
@@ -135,8 +236,14 @@ wmem_init_scopes(void)
     g_assert(file_scope   == NULL);
     g_assert(epan_scope   == NULL);
 
+#if !GLIB_CHECK_VERSION(2,31,0)
+    if (thread_packet_scope == NULL) {
+        thread_packet_scope = g_private_new(NULL);
+    }
+#endif
+
     packet_scope = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
-    file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+    file_scope   = wmem_allocator_new(WMEM_ALLOCATOR_SLAB);
     epan_scope   = wmem_allocator_new(WMEM_ALLOCATOR_SIMPLE);
 
     /* Scopes are initialized to TRUE by default on creation */
@@ -153,6 +260,7 @@ wmem_cleanup_scopes(void)
 
     g_assert(packet_scope->in_scope == FALSE);
     g_assert(file_scope->in_scope   == FALSE);
+    g_assert(g_atomic_int_get(&thread_scope_count) == 0);
 
     wmem_destroy_allocator(packet_scope);
     wmem_destroy_allocator(file_scope);
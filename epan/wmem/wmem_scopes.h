@@ -64,6 +64,44 @@ WS_DLL_LOCAL
 void
 wmem_leave_file_scope(void);
 
+/** Mark the file scope as read-only. While frozen, any attempt to allocate,
+ * reallocate or free memory in the file scope (or to leave it) throws an
+ * assertion. This makes it safe for several threads to dissect packets
+ * concurrently as long as every file-scoped structure was built during an
+ * earlier (single-threaded) pass.
+ */
+WS_DLL_PUBLIC
+void
+wmem_freeze_file_scope(void);
+
+/** Make the file scope writable again. All thread scopes must have been
+ * cleaned up first.
+ */
+WS_DLL_PUBLIC
+void
+wmem_thaw_file_scope(void);
+
+WS_DLL_PUBLIC
+gboolean
+wmem_file_scope_is_frozen(void);
+
+/* Thread Scopes */
+
+/** Give the calling thread its own packet scope. After this call,
+ * wmem_packet_scope() (and entering and leaving the packet scope) in this
+ * thread refer to the private pool instead of the global one, so packets can
+ * be dissected in parallel with the main thread. Must be balanced by a call to
+ * wmem_cleanup_thread_scopes() from the same thread before it exits.
+ */
+WS_DLL_PUBLIC
+void
+wmem_init_thread_scopes(void);
+
+/** Destroy the calling thread's private packet scope. */
+WS_DLL_PUBLIC
+void
+wmem_cleanup_thread_scopes(void);
+
 /* Scope Management */
 
 WS_DLL_LOCAL
@@ -24,6 +24,7 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <glib.h>
 
 #include "wmem.h"
@@ -32,11 +33,18 @@
 #include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_simple.h"
 #include "wmem_allocator_strict.h"
+#include "wmem_allocator_slab.h"
 
 #define STRING_80               "12345678901234567890123456789012345678901234567890123456789012345678901234567890"
 #define MAX_ALLOC_SIZE          (1024*64)
 #define MAX_SIMULTANEOUS_ALLOCS  1024
 #define CONTAINER_ITERS          10000
+#define THREAD_COUNT             4
+/* enough 32-byte chunks to fill several slabs */
+#define SLAB_TEST_ALLOCS         8192
+/* the slab a chunk is in; slabs are 64KB and aligned to their size */
+#define SLAB_TEST_SLAB_OF(PTR)   ((void *)((gsize)(PTR) & ~((gsize)64*1024 - 1)))
+#define TREE_TIMING_KEYS         (g_test_perf() ? 10000000 : 100000)
 
 typedef void (*wmem_verify_func)(wmem_allocator_t *allocator);
 
@@ -52,6 +60,7 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
     allocator->type = type;
     allocator->callbacks = NULL;
     allocator->in_scope = TRUE;
+    allocator->frozen = FALSE;
 
     switch (type) {
         case WMEM_ALLOCATOR_SIMPLE:
@@ -66,6 +75,9 @@ wmem_allocator_force_new(const wmem_allocator_type_t type)
         case WMEM_ALLOCATOR_STRICT:
             wmem_strict_allocator_init(allocator);
             break;
+        case WMEM_ALLOCATOR_SLAB:
+            wmem_slab_allocator_init(allocator);
+            break;
         default:
             g_assert_not_reached();
             /* This is necessary to squelch MSVC errors; is there
@@ -381,7 +393,7 @@ wmem_time_allocator(wmem_allocator_type_t type)
 static void
 wmem_time_allocators(void)
 {
-    double simple_time, block_time, fast_time;
+    double simple_time, block_time, fast_time, slab_time;
 
     g_test_timer_start();
     wmem_time_allocator(WMEM_ALLOCATOR_SIMPLE);
@@ -395,8 +407,12 @@ wmem_time_allocators(void)
     wmem_time_allocator(WMEM_ALLOCATOR_BLOCK_FAST);
     fast_time = g_test_timer_elapsed();
 
-    printf("(simple: %f; block: %f; fast: %f) ",
-            simple_time, block_time, fast_time);
+    g_test_timer_start();
+    wmem_time_allocator(WMEM_ALLOCATOR_SLAB);
+    slab_time = g_test_timer_elapsed();
+
+    printf("(simple: %f; block: %f; fast: %f; slab: %f) ",
+            simple_time, block_time, fast_time, slab_time);
 
     g_assert(simple_time > block_time);
     g_assert(block_time > fast_time);
@@ -434,6 +450,220 @@ wmem_test_allocator_strict(void)
     wmem_test_allocator_jumbo(WMEM_ALLOCATOR_STRICT, &wmem_strict_check_canaries);
 }
 
+static void
+wmem_test_allocator_slab(void)
+{
+    wmem_allocator_t *allocator;
+    void             *ptrs[MAX_SIMULTANEOUS_ALLOCS];
+    void            **slab_ptrs;
+    GHashTable       *freed, *slabs;
+    int               i;
+
+    wmem_test_allocator(WMEM_ALLOCATOR_SLAB, &wmem_slab_verify,
+            MAX_SIMULTANEOUS_ALLOCS*64);
+    wmem_test_allocator_jumbo(WMEM_ALLOCATOR_SLAB, &wmem_slab_verify);
+
+    /* Fill several slabs of one size class and free every other chunk: the
+     * same class must then get exactly the holes back. */
+    allocator = wmem_allocator_force_new(WMEM_ALLOCATOR_SLAB);
+    slab_ptrs = g_new(void *, SLAB_TEST_ALLOCS);
+    freed     = g_hash_table_new(g_direct_hash, g_direct_equal);
+    slabs     = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    for (i=0; i<SLAB_TEST_ALLOCS; i++) {
+        slab_ptrs[i] = wmem_alloc0(allocator, 24);
+        g_hash_table_insert(slabs, SLAB_TEST_SLAB_OF(slab_ptrs[i]), NULL);
+    }
+    g_assert(g_hash_table_size(slabs) > 1);
+    wmem_slab_verify(allocator);
+
+    for (i=0; i<SLAB_TEST_ALLOCS; i+=2) {
+        g_hash_table_insert(freed, slab_ptrs[i], NULL);
+        wmem_free(allocator, slab_ptrs[i]);
+    }
+    wmem_slab_verify(allocator);
+
+    for (i=0; i<SLAB_TEST_ALLOCS; i+=2) {
+        slab_ptrs[i] = wmem_alloc0(allocator, 32);
+        g_assert(g_hash_table_remove(freed, slab_ptrs[i]));
+    }
+    g_assert(g_hash_table_size(freed) == 0);
+    wmem_slab_verify(allocator);
+
+    /* Empty all of those slabs: a different class must then be served out of
+     * them rather than out of fresh memory. */
+    for (i=0; i<SLAB_TEST_ALLOCS; i++) {
+        wmem_free(allocator, slab_ptrs[i]);
+    }
+    wmem_slab_verify(allocator);
+
+    for (i=0; i<SLAB_TEST_ALLOCS/4; i++) {
+        slab_ptrs[i] = wmem_alloc0(allocator, 64);
+        g_assert(g_hash_table_lookup_extended(slabs, SLAB_TEST_SLAB_OF(slab_ptrs[i]),
+                    NULL, NULL));
+    }
+    wmem_slab_verify(allocator);
+    for (i=0; i<SLAB_TEST_ALLOCS/4; i++) {
+        wmem_free(allocator, slab_ptrs[i]);
+    }
+    wmem_slab_verify(allocator);
+
+    g_hash_table_destroy(slabs);
+    g_hash_table_destroy(freed);
+    g_free(slab_ptrs);
+
+    for (i=0; i<MAX_SIMULTANEOUS_ALLOCS; i++) {
+        ptrs[i] = wmem_alloc0(allocator, 1 + i % 2048);
+    }
+    wmem_slab_verify(allocator);
+    for (i=0; i<MAX_SIMULTANEOUS_ALLOCS; i++) {
+        ptrs[i] = wmem_realloc(allocator, ptrs[i], 1 + (i * 7) % 4096);
+        memset(ptrs[i], 0, 1 + (i * 7) % 4096);
+    }
+    wmem_slab_verify(allocator);
+
+    wmem_free_all(allocator);
+    wmem_slab_verify(allocator);
+    wmem_gc(allocator);
+    wmem_slab_verify(allocator);
+
+    wmem_destroy_allocator(allocator);
+}
+
+/* SCOPE TESTING FUNCTIONS (/wmem/scopes/) */
+
+static GThread *
+wmem_test_thread_new(GThreadFunc func, gpointer data)
+{
+#if GLIB_CHECK_VERSION(2,31,0)
+    return g_thread_new("wmem_test", func, data);
+#else
+    return g_thread_create(func, data, TRUE, NULL);
+#endif
+}
+
+/* Allocates a spread of small objects in the packet scope of whichever thread
+ * calls it, the way a typical dissection would. */
+static void
+wmem_test_packet_scope_allocs(int packets)
+{
+    int   i, j;
+    char *ptr;
+
+    for (i=0; i<packets; i++) {
+        wmem_enter_packet_scope();
+        for (j=0; j<64; j++) {
+            ptr = (char *)wmem_alloc0(wmem_packet_scope(), 8 << (j % 8));
+            ptr[0] = (char)j;
+        }
+        ptr = wmem_strdup_printf(wmem_packet_scope(), "%d-%d", i, j);
+        g_assert(ptr[0] != '\0');
+        wmem_leave_packet_scope();
+    }
+}
+
+static gpointer
+wmem_test_scope_thread(gpointer data)
+{
+    wmem_allocator_t *main_scope = (wmem_allocator_t *)data;
+    wmem_allocator_t *thread_scope;
+
+    wmem_init_thread_scopes();
+
+    thread_scope = wmem_packet_scope();
+    g_assert(thread_scope != main_scope);
+    g_assert(!thread_scope->in_scope);
+
+    wmem_test_packet_scope_allocs(256);
+    g_assert(wmem_packet_scope() == thread_scope);
+
+    /* reading the frozen file scope is fine */
+    g_assert(wmem_file_scope()->in_scope);
+
+    wmem_cleanup_thread_scopes();
+
+    /* and we are back to the global pool */
+    g_assert(wmem_packet_scope() == main_scope);
+
+    return GINT_TO_POINTER(TRUE);
+}
+
+static void
+wmem_test_scopes_threads(void)
+{
+    wmem_allocator_t *main_scope;
+    GThread          *threads[THREAD_COUNT];
+    int               i;
+
+    wmem_enter_file_scope();
+    g_assert(!wmem_file_scope_is_frozen());
+
+    wmem_alloc(wmem_file_scope(), 64);
+    main_scope = wmem_packet_scope();
+
+    wmem_freeze_file_scope();
+    g_assert(wmem_file_scope_is_frozen());
+
+    for (i=0; i<THREAD_COUNT; i++) {
+        threads[i] = wmem_test_thread_new(wmem_test_scope_thread, main_scope);
+    }
+
+    /* the main thread keeps dissecting in the global packet scope */
+    wmem_test_packet_scope_allocs(256);
+    g_assert(wmem_packet_scope() == main_scope);
+
+    for (i=0; i<THREAD_COUNT; i++) {
+        g_assert(GPOINTER_TO_INT(g_thread_join(threads[i])));
+    }
+
+    wmem_thaw_file_scope();
+    g_assert(!wmem_file_scope_is_frozen());
+
+    wmem_alloc(wmem_file_scope(), 64);
+    wmem_leave_file_scope();
+}
+
+static gpointer
+wmem_time_scope_thread(gpointer data)
+{
+    wmem_init_thread_scopes();
+    wmem_test_packet_scope_allocs(GPOINTER_TO_INT(data));
+    wmem_cleanup_thread_scopes();
+
+    return NULL;
+}
+
+static void
+wmem_time_scopes_threads(void)
+{
+    GThread *threads[THREAD_COUNT];
+    double   serial_time, threaded_time;
+    int      i;
+
+    wmem_enter_file_scope();
+    wmem_freeze_file_scope();
+
+    g_test_timer_start();
+    wmem_test_packet_scope_allocs(THREAD_COUNT * 16384);
+    serial_time = g_test_timer_elapsed();
+
+    g_test_timer_start();
+    for (i=0; i<THREAD_COUNT; i++) {
+        threads[i] = wmem_test_thread_new(wmem_time_scope_thread,
+                GINT_TO_POINTER(16384));
+    }
+    for (i=0; i<THREAD_COUNT; i++) {
+        g_thread_join(threads[i]);
+    }
+    threaded_time = g_test_timer_elapsed();
+
+    wmem_thaw_file_scope();
+    wmem_leave_file_scope();
+
+    printf("(1 thread: %f; %d threads: %f) ",
+            serial_time, THREAD_COUNT, threaded_time);
+}
+
 /* UTILITY TESTING FUNCTIONS (/wmem/utils/) */
 
 static void
@@ -523,6 +753,21 @@ wmem_test_strutls(void)
 
 /* DATA STRUCTURE TESTING FUNCTIONS (/wmem/datastruct/) */
 
+static void
+wmem_test_map_foreach_cb(gpointer key _U_, gpointer value,
+        gpointer user_data _U_)
+{
+    g_assert(! value_seen[GPOINTER_TO_INT(value)]);
+    value_seen[GPOINTER_TO_INT(value)] = TRUE;
+}
+
+static gboolean
+wmem_test_map_remove_odd_cb(gpointer key _U_, gpointer value,
+        gpointer user_data _U_)
+{
+    return GPOINTER_TO_INT(value) % 2 == 1;
+}
+
 static void
 wmem_test_array(void)
 {
@@ -688,7 +933,9 @@ wmem_test_map(void)
     wmem_allocator_t *allocator;
     wmem_map_t       *map;
     gchar            *str_key;
-    unsigned int      i;
+    const void       *orig_key;
+    unsigned int      i, count;
+    int               key;
     void             *ret;
 
     allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
@@ -722,11 +969,68 @@ wmem_test_map(void)
 
     /* string keys and for-each */
     for (i=0; i<CONTAINER_ITERS; i++) {
-        str_key = wmem_test_rand_string(allocator, 1, 64);
+        do {
+            str_key = wmem_test_rand_string(allocator, 1, 64);
+        } while (wmem_map_contains(map, str_key));
+        value_seen[i] = FALSE;
         wmem_map_insert(map, str_key, GINT_TO_POINTER(i));
         ret = wmem_map_lookup(map, str_key);
         g_assert(ret == GINT_TO_POINTER(i));
+        g_assert(wmem_map_lookup_extended(map, str_key, &orig_key, &ret));
+        g_assert(orig_key == str_key);
+        g_assert(ret == GINT_TO_POINTER(i));
     }
+    g_assert(wmem_map_size(map) == CONTAINER_ITERS);
+
+    wmem_map_foreach(map, wmem_test_map_foreach_cb, NULL);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert(value_seen[i]);
+    }
+
+    /* remove every odd value */
+    g_assert(wmem_map_foreach_remove(map, wmem_test_map_remove_odd_cb, NULL)
+            == CONTAINER_ITERS / 2);
+    g_assert(wmem_map_size(map) == CONTAINER_ITERS / 2);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        value_seen[i] = FALSE;
+    }
+    wmem_map_foreach(map, wmem_test_map_foreach_cb, NULL);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert(value_seen[i] == ((i % 2) == 0));
+    }
+    wmem_free_all(allocator);
+
+    /* random mix of insertions and removals, checked against a plain array
+     * so that tombstones and rehashing get exercised; keys are all multiples
+     * of 16 to make sure we don't rely on the low bits of the hash */
+    map = wmem_map_new(NULL, g_direct_hash, g_direct_equal);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        value_seen[i] = FALSE;
+    }
+    for (i=0; i<CONTAINER_ITERS*8; i++) {
+        key = g_test_rand_int_range(0, CONTAINER_ITERS);
+        if (value_seen[key]) {
+            ret = wmem_map_remove(map, GINT_TO_POINTER(key * 16 + 16));
+            g_assert(ret == GINT_TO_POINTER(key));
+            value_seen[key] = FALSE;
+        }
+        else {
+            ret = wmem_map_insert(map, GINT_TO_POINTER(key * 16 + 16),
+                    GINT_TO_POINTER(key));
+            g_assert(ret == NULL);
+            value_seen[key] = TRUE;
+        }
+    }
+    count = 0;
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert(wmem_map_contains(map, GINT_TO_POINTER(i * 16 + 16)) ==
+                value_seen[i]);
+        if (value_seen[i]) {
+            count++;
+        }
+    }
+    g_assert(wmem_map_size(map) == count);
+    wmem_map_destroy(map);
 
     wmem_destroy_allocator(allocator);
 }
@@ -886,6 +1190,17 @@ wmem_test_strbuf(void)
     wmem_destroy_allocator(allocator);
 }
 
+static guint32 last_key_seen;
+
+static gboolean
+wmem_test_foreach_ordered_cb(void *value, void *user_data _U_)
+{
+    g_assert(GPOINTER_TO_UINT(value) > last_key_seen);
+    last_key_seen = GPOINTER_TO_UINT(value);
+
+    return FALSE;
+}
+
 static void
 wmem_test_tree(void)
 {
@@ -899,6 +1214,7 @@ wmem_test_tree(void)
 #define WMEM_TREE_MAX_KEY_LEN   4
     int                 key_count;
     wmem_tree_key_t     keys[WMEM_TREE_MAX_KEY_COUNT];
+    guint32            *sorted_keys;
 
     allocator       = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
     extra_allocator = wmem_allocator_new(WMEM_ALLOCATOR_STRICT);
@@ -1034,11 +1350,217 @@ wmem_test_tree(void)
         }
     }
     g_assert(seen_values == 10);
+    wmem_free_all(allocator);
+
+    /* test less-or-equal lookups of sparse random keys against a sorted
+     * array, which crosses plenty of node boundaries */
+    tree = wmem_tree_new(allocator);
+    sorted_keys = wmem_alloc_array(allocator, guint32, CONTAINER_ITERS);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        sorted_keys[i] = (g_test_rand_int() | 1) & 0x7FFFFFFF;
+        wmem_tree_insert32(tree, sorted_keys[i],
+                GUINT_TO_POINTER(sorted_keys[i]));
+    }
+    qsort(sorted_keys, CONTAINER_ITERS, sizeof(guint32), wmem_test_compare_guint32);
+    g_assert(wmem_tree_lookup32_le(tree, sorted_keys[0] - 1) == NULL);
+    for (i=0; i<CONTAINER_ITERS; i++) {
+        g_assert(wmem_tree_lookup32_le(tree, sorted_keys[i]) ==
+                GUINT_TO_POINTER(sorted_keys[i]));
+        g_assert(wmem_tree_lookup32_le(tree, sorted_keys[i] + 1) ==
+                GUINT_TO_POINTER(sorted_keys[i]));
+    }
+    g_assert(wmem_tree_lookup32_le(tree, G_MAXUINT32) ==
+            GUINT_TO_POINTER(sorted_keys[CONTAINER_ITERS-1]));
+
+    /* and that for-each visits them in key order */
+    last_key_seen = 0;
+    wmem_tree_foreach(tree, wmem_test_foreach_ordered_cb, NULL);
+    g_assert(last_key_seen == sorted_keys[CONTAINER_ITERS-1]);
 
     wmem_destroy_allocator(extra_allocator);
     wmem_destroy_allocator(allocator);
 }
 
+/* Wraps an allocator to keep count of the bytes handed out through it, so
+ * that the memory a data structure takes can be reported along with its
+ * speed. Each allocation gets a header holding its size. */
+#define COUNT_HEADER_SIZE 16
+
+typedef struct {
+    wmem_allocator_t real;
+    gsize            in_use;
+} wmem_test_counter_t;
+
+static void *
+wmem_test_count_alloc(void *private_data, const size_t size)
+{
+    wmem_test_counter_t *counter = (wmem_test_counter_t *)private_data;
+    guint8              *buf;
+
+    buf = (guint8 *)counter->real.alloc(counter->real.private_data,
+            size + COUNT_HEADER_SIZE);
+    *(gsize *)(void *)buf = size;
+    counter->in_use += size;
+
+    return buf + COUNT_HEADER_SIZE;
+}
+
+static void
+wmem_test_count_free(void *private_data, void *ptr)
+{
+    wmem_test_counter_t *counter = (wmem_test_counter_t *)private_data;
+    guint8              *buf     = (guint8 *)ptr - COUNT_HEADER_SIZE;
+
+    counter->in_use -= *(gsize *)(void *)buf;
+    counter->real.free(counter->real.private_data, buf);
+}
+
+static void *
+wmem_test_count_realloc(void *private_data, void *ptr, const size_t size)
+{
+    wmem_test_counter_t *counter = (wmem_test_counter_t *)private_data;
+    guint8              *buf     = (guint8 *)ptr - COUNT_HEADER_SIZE;
+
+    counter->in_use -= *(gsize *)(void *)buf;
+    buf = (guint8 *)counter->real.realloc(counter->real.private_data, buf,
+            size + COUNT_HEADER_SIZE);
+    *(gsize *)(void *)buf = size;
+    counter->in_use += size;
+
+    return buf + COUNT_HEADER_SIZE;
+}
+
+static void
+wmem_test_count_free_all(void *private_data)
+{
+    wmem_test_counter_t *counter = (wmem_test_counter_t *)private_data;
+
+    counter->in_use = 0;
+    counter->real.free_all(counter->real.private_data);
+}
+
+static void
+wmem_test_count_gc(void *private_data)
+{
+    wmem_test_counter_t *counter = (wmem_test_counter_t *)private_data;
+
+    counter->real.gc(counter->real.private_data);
+}
+
+static void
+wmem_test_count_cleanup(void *private_data)
+{
+    wmem_test_counter_t *counter = (wmem_test_counter_t *)private_data;
+
+    counter->real.cleanup(counter->real.private_data);
+    g_free(counter);
+}
+
+static wmem_allocator_t *
+wmem_test_counting_allocator_new(wmem_allocator_type_t type,
+        wmem_test_counter_t **counter_out)
+{
+    wmem_allocator_t    *allocator;
+    wmem_test_counter_t *counter;
+
+    allocator = wmem_allocator_force_new(type);
+    counter   = g_new0(wmem_test_counter_t, 1);
+    counter->real = *allocator;
+
+    allocator->alloc        = &wmem_test_count_alloc;
+    allocator->free         = &wmem_test_count_free;
+    allocator->realloc      = &wmem_test_count_realloc;
+    allocator->free_all     = &wmem_test_count_free_all;
+    allocator->gc           = &wmem_test_count_gc;
+    allocator->cleanup      = &wmem_test_count_cleanup;
+    allocator->private_data = counter;
+
+    *counter_out = counter;
+    return allocator;
+}
+
+static void
+wmem_time_tree(void)
+{
+    wmem_allocator_t    *allocator;
+    wmem_test_counter_t *counter;
+    wmem_tree_t         *tree;
+    wmem_tree_key_t      array_key[2];
+    guint32              array_key32[2];
+    guint32             *keys;
+    guint32              i, count;
+    double               seq_insert, seq_lookup, rand_insert, rand_lookup, le_lookup;
+    double               seq_bytes, rand_bytes, small_bytes;
+
+    count     = TREE_TIMING_KEYS;
+    keys      = g_new(guint32, count);
+    allocator = wmem_test_counting_allocator_new(WMEM_ALLOCATOR_BLOCK, &counter);
+
+    for (i=0; i<count; i++) {
+        keys[i] = g_test_rand_int();
+    }
+
+    tree = wmem_tree_new(allocator);
+    g_test_timer_start();
+    for (i=0; i<count; i++) {
+        wmem_tree_insert32(tree, i*2, GUINT_TO_POINTER(i));
+    }
+    seq_insert = g_test_timer_elapsed();
+    seq_bytes  = (double)counter->in_use / count;
+
+    g_test_timer_start();
+    for (i=0; i<count; i++) {
+        g_assert(wmem_tree_lookup32(tree, i*2) == GUINT_TO_POINTER(i));
+    }
+    seq_lookup = g_test_timer_elapsed();
+
+    g_test_timer_start();
+    for (i=0; i<count; i++) {
+        g_assert(wmem_tree_lookup32_le(tree, (keys[i] % count)*2 + 1) ==
+                GUINT_TO_POINTER(keys[i] % count));
+    }
+    le_lookup = g_test_timer_elapsed();
+    wmem_free_all(allocator);
+
+    tree = wmem_tree_new(allocator);
+    g_test_timer_start();
+    for (i=0; i<count; i++) {
+        wmem_tree_insert32(tree, keys[i], GUINT_TO_POINTER(keys[i]));
+    }
+    rand_insert = g_test_timer_elapsed();
+    rand_bytes  = (double)counter->in_use / count;
+
+    g_test_timer_start();
+    for (i=0; i<count; i++) {
+        g_assert(wmem_tree_lookup32(tree, keys[i]) == GUINT_TO_POINTER(keys[i]));
+    }
+    rand_lookup = g_test_timer_elapsed();
+    wmem_free_all(allocator);
+
+    /* Lots of tiny subtrees, as conversation and reassembly tables keyed by
+     * addresses and ports end up with: two keys in each. */
+    tree = wmem_tree_new(allocator);
+    array_key[0].length = 2;
+    array_key[0].key    = array_key32;
+    array_key[1].length = 0;
+    array_key[1].key    = NULL;
+    for (i=0; i<count; i++) {
+        array_key32[0] = i / 2;
+        array_key32[1] = i % 2;
+        wmem_tree_insert32_array(tree, array_key, GUINT_TO_POINTER(i));
+    }
+    small_bytes = (double)counter->in_use / count;
+
+    wmem_destroy_allocator(allocator);
+    g_free(keys);
+
+    printf("(%u keys: seq insert: %f; seq lookup: %f; le lookup: %f; "
+            "rand insert: %f; rand lookup: %f; bytes/key seq: %.1f, "
+            "rand: %.1f, 2-key subtrees: %.1f) ", count,
+            seq_insert, seq_lookup, le_lookup, rand_insert, rand_lookup,
+            seq_bytes, rand_bytes, small_bytes);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1052,8 +1574,11 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/allocator/blk_fast",  wmem_test_allocator_block_fast);
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
+    g_test_add_func("/wmem/allocator/slab",      wmem_test_allocator_slab);
     g_test_add_func("/wmem/allocator/callbacks", wmem_test_allocator_callbacks);
 
+    g_test_add_func("/wmem/scopes/threads", wmem_test_scopes_threads);
+
     g_test_add_func("/wmem/utils/misc",    wmem_test_miscutls);
     g_test_add_func("/wmem/utils/strings", wmem_test_strutls);
 
@@ -1066,6 +1591,8 @@ main(int argc, char **argv)
     g_test_add_func("/wmem/datastruct/tree",   wmem_test_tree);
 
     g_test_add_func("/wmem/timing/allocators", wmem_time_allocators);
+    g_test_add_func("/wmem/timing/threads",    wmem_time_scopes_threads);
+    g_test_add_func("/wmem/timing/tree",       wmem_time_tree);
 
     ret = g_test_run();
 
@@ -1,5 +1,5 @@
 /* wmem_tree.c
- * Wireshark Memory Manager Red-Black Tree
+ * Wireshark Memory Manager B+ Tree
  * Based on the red-black tree implementation in epan/emem.*
  * Copyright 2013, Evan Huus <eapache@gmail.com>
  *
@@ -33,25 +33,43 @@
 #include "wmem_tree.h"
 #include "wmem_user_cb.h"
 
-typedef enum _wmem_node_color_t {
-    WMEM_NODE_COLOR_RED,
-    WMEM_NODE_COLOR_BLACK
-} wmem_node_color_t;
-
+/* Keys per node. Inner nodes always have room for this many. Leaves start
+ * with room for WMEM_TREE_LEAF_MIN_KEYS and double in size as they fill, so
+ * that the many small trees (including the subtrees insert32_array creates)
+ * cost about as much as the red-black nodes they replaced. Must not exceed
+ * 32 since leaves keep a bit per slot in subtree_mask. */
+#define WMEM_TREE_NODE_KEYS     32
+#define WMEM_TREE_LEAF_MIN_KEYS 4
+
+/* Enough for 2^32 keys even if every node were only half full. */
+#define WMEM_TREE_MAX_DEPTH  16
+
+/* The header of a node. It is followed by room for "capacity" keys and then,
+ * aligned for pointers, by "capacity" data pointers for leaves or
+ * "capacity"+1 child pointers for inner nodes. The keys come first since
+ * they are all that's touched while searching an inner node.
+ *
+ * In a leaf, data[i] belongs to keys[i]. In an inner node, children[i] holds
+ * the keys below keys[i], and keys[i] is the smallest key stored under
+ * children[i+1]. */
 struct _wmem_tree_node_t {
-    struct _wmem_tree_node_t *parent;
-    struct _wmem_tree_node_t *left;
-    struct _wmem_tree_node_t *right;
-
-    void    *data;
-    guint32  key32;
-
-    wmem_node_color_t color;
-    gboolean          is_subtree;
+    guint32  subtree_mask; /* leaves only: bit i set if data[i] is a tree */
+    guint16  count;        /* number of keys in use */
+    guint16  capacity;     /* number of keys there is room for */
+    gboolean is_leaf;
 };
 
 typedef struct _wmem_tree_node_t wmem_tree_node_t;
 
+#define NODE_PTRS_OFFSET(capacity) \
+    ((sizeof(wmem_tree_node_t) + (capacity) * sizeof(guint32) + \
+      sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+#define NODE_KEYS(node) ((guint32 *)(void *)((node) + 1))
+#define NODE_PTRS(node) \
+    ((void **)(void *)((guint8 *)(node) + NODE_PTRS_OFFSET((node)->capacity)))
+#define NODE_CHILD(node, i) ((wmem_tree_node_t *)NODE_PTRS(node)[i])
+
 struct _wmem_tree_t {
     wmem_allocator_t *master;
     wmem_allocator_t *allocator;
@@ -60,166 +78,6 @@ struct _wmem_tree_t {
     guint             slave_cb_id;
 };
 
-static wmem_tree_node_t *
-node_uncle(wmem_tree_node_t *node)
-{
-    wmem_tree_node_t *parent, *grandparent;
-
-    parent = node->parent;
-    if (parent == NULL) {
-        return NULL;
-    }
-
-    grandparent = parent->parent;
-    if (grandparent == NULL) {
-        return NULL;
-    }
-
-    if (parent == grandparent->left) {
-        return grandparent->right;
-    }
-    else {
-        return grandparent->left;
-    }
-}
-
-static void rb_insert_case1(wmem_tree_t *tree, wmem_tree_node_t *node);
-static void rb_insert_case2(wmem_tree_t *tree, wmem_tree_node_t *node);
-
-static void
-rotate_left(wmem_tree_t *tree, wmem_tree_node_t *node)
-{
-    if (node->parent) {
-        if (node->parent->left == node) {
-            node->parent->left = node->right;
-        }
-        else {
-            node->parent->right = node->right;
-        }
-    }
-    else {
-        tree->root = node->right;
-    }
-
-    node->right->parent = node->parent;
-    node->parent        = node->right;
-    node->right         = node->right->left;
-    if (node->right) {
-        node->right->parent = node;
-    }
-    node->parent->left = node;
-}
-
-static void
-rotate_right(wmem_tree_t *tree, wmem_tree_node_t *node)
-{
-    if (node->parent) {
-        if (node->parent->left == node) {
-            node->parent->left = node->left;
-        }
-        else {
-            node->parent->right = node->left;
-        }
-    }
-    else {
-        tree->root = node->left;
-    }
-
-    node->left->parent = node->parent;
-    node->parent       = node->left;
-    node->left         = node->left->right;
-    if (node->left) {
-        node->left->parent = node;
-    }
-    node->parent->right = node;
-}
-
-static void
-rb_insert_case5(wmem_tree_t *tree, wmem_tree_node_t *node)
-{
-    wmem_tree_node_t *parent, *grandparent;
-
-    parent      = node->parent;
-    grandparent = parent->parent;
-
-    parent->color      = WMEM_NODE_COLOR_BLACK;
-    grandparent->color = WMEM_NODE_COLOR_RED;
-
-    if (node == parent->left && parent == grandparent->left) {
-        rotate_right(tree, grandparent);
-    }
-    else {
-        rotate_left(tree, grandparent);
-    }
-}
-
-static void
-rb_insert_case4(wmem_tree_t *tree, wmem_tree_node_t *node)
-{
-    wmem_tree_node_t *parent, *grandparent;
-
-    parent      = node->parent;
-    grandparent = parent->parent;
-    if (!grandparent) {
-        return;
-    }
-
-    if (node == parent->right && parent == grandparent->left) {
-        rotate_left(tree, parent);
-        node = node->left;
-    }
-    else if (node == parent->left && parent == grandparent->right) {
-        rotate_right(tree, parent);
-        node = node->right;
-    }
-
-    rb_insert_case5(tree, node);
-}
-
-static void
-rb_insert_case3(wmem_tree_t *tree, wmem_tree_node_t *node)
-{
-    wmem_tree_node_t *parent, *grandparent, *uncle;
-
-    uncle = node_uncle(node);
-
-    if (uncle && uncle->color == WMEM_NODE_COLOR_RED) {
-        parent      = node->parent;
-        grandparent = parent->parent;
-
-        parent->color      = WMEM_NODE_COLOR_BLACK;
-        uncle->color       = WMEM_NODE_COLOR_BLACK;
-        grandparent->color = WMEM_NODE_COLOR_RED;
-
-        rb_insert_case1(tree, grandparent);
-    }
-    else {
-        rb_insert_case4(tree, node);
-    }
-}
-
-static void
-rb_insert_case2(wmem_tree_t *tree, wmem_tree_node_t *node)
-{
-    /* parent is always non-NULL here */
-    if (node->parent->color == WMEM_NODE_COLOR_RED) {
-        rb_insert_case3(tree, node);
-    }
-}
-
-static void
-rb_insert_case1(wmem_tree_t *tree, wmem_tree_node_t *node)
-{
-    wmem_tree_node_t *parent = node->parent;
-
-    if (parent == NULL) {
-        node->color = WMEM_NODE_COLOR_BLACK;
-    }
-    else {
-        rb_insert_case2(tree, node);
-    }
-}
-
 wmem_tree_t *
 wmem_tree_new(wmem_allocator_t *allocator)
 {
@@ -285,83 +143,297 @@ wmem_tree_is_empty(wmem_tree_t *tree)
 }
 
 static wmem_tree_node_t *
-create_node(wmem_allocator_t *allocator, wmem_tree_node_t *parent, guint32 key,
-        void *data, wmem_node_color_t color, gboolean is_subtree)
+create_node(wmem_allocator_t *allocator, gboolean is_leaf, guint capacity)
 {
     wmem_tree_node_t *node;
 
-    node = wmem_new(allocator, wmem_tree_node_t);
+    node = (wmem_tree_node_t *)wmem_alloc(allocator,
+            NODE_PTRS_OFFSET(capacity) +
+            (capacity + (is_leaf ? 0 : 1)) * sizeof(void *));
+
+    node->subtree_mask = 0;
+    node->count        = 0;
+    node->capacity     = (guint16)capacity;
+    node->is_leaf      = is_leaf;
+
+    return node;
+}
+
+/* The smallest leaf capacity that holds count keys */
+static guint
+leaf_capacity(guint count)
+{
+    guint capacity = WMEM_TREE_LEAF_MIN_KEYS;
+
+    while (capacity < count) {
+        capacity *= 2;
+    }
+
+    return capacity;
+}
+
+/* Replaces a full leaf with one twice its size, and frees the old one. The
+ * caller has to update the pointer to the leaf in its parent. */
+static wmem_tree_node_t *
+grow_leaf(wmem_allocator_t *allocator, wmem_tree_node_t *leaf)
+{
+    wmem_tree_node_t *bigger;
+
+    bigger = create_node(allocator, TRUE, leaf->capacity * 2);
+    memcpy(NODE_KEYS(bigger), NODE_KEYS(leaf), leaf->count * sizeof(guint32));
+    memcpy(NODE_PTRS(bigger), NODE_PTRS(leaf), leaf->count * sizeof(void *));
+    bigger->subtree_mask = leaf->subtree_mask;
+    bigger->count        = leaf->count;
 
-    node->left   = NULL;
-    node->right  = NULL;
-    node->parent = parent;
+    wmem_free(allocator, leaf);
 
-    node->key32 = key;
-    node->data  = data;
+    return bigger;
+}
+
+/* Returns the number of keys in the node that are less than or equal to the
+ * given key. For inner nodes this is the index of the child to descend into;
+ * for leaves, if the result is non-zero then slot result-1 holds the greatest
+ * key less than or equal to the given one. */
+static inline guint
+node_upper_bound(const wmem_tree_node_t *node, guint32 key)
+{
+    const guint32 *keys = NODE_KEYS(node);
+    guint          lo = 0, hi = node->count, mid;
 
-    node->color      = color;
-    node->is_subtree = is_subtree;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (keys[mid] <= key) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/* Since every inner key is the smallest key of the subtree to its right and
+ * keys are never removed, the leaf reached for a given key always contains
+ * its predecessor unless the key is smaller than everything in the tree. */
+static wmem_tree_node_t *
+find_leaf(wmem_tree_node_t *node, guint32 key)
+{
+    while (!node->is_leaf) {
+        node = NODE_CHILD(node, node_upper_bound(node, key));
+    }
 
     return node;
 }
 
+/* Inserts key and data into a leaf at position pos. A leaf that is full has
+ * to be at WMEM_TREE_NODE_KEYS (smaller ones are grown first), and is split.
+ * Returns the new right-hand sibling if the leaf was split. */
+static wmem_tree_node_t *
+leaf_insert(wmem_allocator_t *allocator, wmem_tree_node_t *leaf, guint pos,
+        guint32 key, void *data, gboolean is_subtree)
+{
+    wmem_tree_node_t *right;
+    guint32          *leaf_keys = NODE_KEYS(leaf);
+    void            **leaf_data = NODE_PTRS(leaf);
+    guint32           keys[WMEM_TREE_NODE_KEYS + 1];
+    void             *datas[WMEM_TREE_NODE_KEYS + 1];
+    guint64           mask;
+    guint             split;
+
+    /* the subtree mask with a gap opened at pos */
+    mask = leaf->subtree_mask;
+    mask = (mask & ((G_GUINT64_CONSTANT(1) << pos) - 1)) |
+           ((mask >> pos) << (pos + 1)) |
+           ((guint64)(is_subtree ? 1 : 0) << pos);
+
+    if (leaf->count < leaf->capacity) {
+        memmove(&leaf_keys[pos + 1], &leaf_keys[pos],
+                (leaf->count - pos) * sizeof(guint32));
+        memmove(&leaf_data[pos + 1], &leaf_data[pos],
+                (leaf->count - pos) * sizeof(void *));
+        leaf_keys[pos]      = key;
+        leaf_data[pos]      = data;
+        leaf->subtree_mask  = (guint32)mask;
+        leaf->count++;
+        return NULL;
+    }
+
+    g_assert(leaf->capacity == WMEM_TREE_NODE_KEYS);
+
+    memcpy(keys, leaf_keys, pos * sizeof(guint32));
+    memcpy(datas, leaf_data, pos * sizeof(void *));
+    keys[pos]  = key;
+    datas[pos] = data;
+    memcpy(&keys[pos + 1], &leaf_keys[pos],
+            (WMEM_TREE_NODE_KEYS - pos) * sizeof(guint32));
+    memcpy(&datas[pos + 1], &leaf_data[pos],
+            (WMEM_TREE_NODE_KEYS - pos) * sizeof(void *));
+
+    /* Appending to the end is by far the most common pattern (frame numbers,
+     * sequence numbers) so leave the old leaf full in that case instead of
+     * splitting down the middle. The new leaf then starts out small. */
+    split = (pos == WMEM_TREE_NODE_KEYS) ?
+        WMEM_TREE_NODE_KEYS : (WMEM_TREE_NODE_KEYS + 1) / 2;
+
+    right = create_node(allocator, TRUE,
+            leaf_capacity(WMEM_TREE_NODE_KEYS + 1 - split));
+
+    memcpy(leaf_keys, keys, split * sizeof(guint32));
+    memcpy(leaf_data, datas, split * sizeof(void *));
+    leaf->count        = split;
+    leaf->subtree_mask = (guint32)(mask & ((G_GUINT64_CONSTANT(1) << split) - 1));
+
+    memcpy(NODE_KEYS(right), &keys[split],
+            (WMEM_TREE_NODE_KEYS + 1 - split) * sizeof(guint32));
+    memcpy(NODE_PTRS(right), &datas[split],
+            (WMEM_TREE_NODE_KEYS + 1 - split) * sizeof(void *));
+    right->count        = WMEM_TREE_NODE_KEYS + 1 - split;
+    right->subtree_mask = (guint32)(mask >> split);
+
+    return right;
+}
+
+/* Inserts a separator key and the child to its right into an inner node
+ * after child index pos, splitting it if it is full. Returns the new
+ * right-hand sibling if the node was split, with the key to push up into the
+ * parent in *up_key. */
+static wmem_tree_node_t *
+inner_insert(wmem_allocator_t *allocator, wmem_tree_node_t *node, guint pos,
+        guint32 key, wmem_tree_node_t *child, guint32 *up_key)
+{
+    wmem_tree_node_t *right;
+    guint32          *node_keys     = NODE_KEYS(node);
+    void            **node_children = NODE_PTRS(node);
+    guint32           keys[WMEM_TREE_NODE_KEYS + 1];
+    void             *children[WMEM_TREE_NODE_KEYS + 2];
+    guint             split;
+
+    if (node->count < WMEM_TREE_NODE_KEYS) {
+        memmove(&node_keys[pos + 1], &node_keys[pos],
+                (node->count - pos) * sizeof(guint32));
+        memmove(&node_children[pos + 2], &node_children[pos + 1],
+                (node->count - pos) * sizeof(void *));
+        node_keys[pos]         = key;
+        node_children[pos + 1] = child;
+        node->count++;
+        return NULL;
+    }
+
+    memcpy(keys, node_keys, pos * sizeof(guint32));
+    memcpy(children, node_children, (pos + 1) * sizeof(void *));
+    keys[pos]         = key;
+    children[pos + 1] = child;
+    memcpy(&keys[pos + 1], &node_keys[pos],
+            (WMEM_TREE_NODE_KEYS - pos) * sizeof(guint32));
+    memcpy(&children[pos + 2], &node_children[pos + 1],
+            (WMEM_TREE_NODE_KEYS - pos) * sizeof(void *));
+
+    /* keys[split] moves up; see leaf_insert for why appends are special */
+    split = (pos == WMEM_TREE_NODE_KEYS) ?
+        WMEM_TREE_NODE_KEYS : WMEM_TREE_NODE_KEYS / 2;
+
+    right = create_node(allocator, FALSE, WMEM_TREE_NODE_KEYS);
+
+    memcpy(node_keys, keys, split * sizeof(guint32));
+    memcpy(node_children, children, (split + 1) * sizeof(void *));
+    node->count = split;
+
+    *up_key = keys[split];
+
+    memcpy(NODE_KEYS(right), &keys[split + 1],
+            (WMEM_TREE_NODE_KEYS - split) * sizeof(guint32));
+    memcpy(NODE_PTRS(right), &children[split + 1],
+            (WMEM_TREE_NODE_KEYS + 1 - split) * sizeof(void *));
+    right->count = WMEM_TREE_NODE_KEYS - split;
+
+    return right;
+}
+
 #define CREATE_DATA(TRANSFORM, DATA) ((TRANSFORM) ? (TRANSFORM)(DATA) : (DATA))
 static void *
 lookup_or_insert32(wmem_tree_t *tree, guint32 key,
         void*(*func)(void*), void* data, gboolean is_subtree, gboolean replace)
 {
-    wmem_tree_node_t *node     = tree->root;
-    wmem_tree_node_t *new_node = NULL;
+    wmem_tree_node_t *path[WMEM_TREE_MAX_DEPTH];
+    guint             path_pos[WMEM_TREE_MAX_DEPTH];
+    guint             depth = 0;
+    wmem_tree_node_t *node, *split, *new_root;
+    guint32           split_key = 0;
+    guint             pos;
+    void             *new_data;
 
     /* is this the first node ?*/
-    if (!node) {
-        new_node = create_node(tree->allocator, NULL, key,
-                CREATE_DATA(func, data), WMEM_NODE_COLOR_BLACK, is_subtree);
-        tree->root = new_node;
-        return new_node->data;
-    }
-
-    /* it was not the new root so walk the tree until we find where to
-     * insert this new leaf.
-     */
-    while (!new_node) {
-        /* this node already exists, so just return the data pointer*/
-        if (key == node->key32) {
-            if (replace) {
-                node->data = CREATE_DATA(func, data);
-            }
-            return node->data;
-        }
-        else if (key < node->key32) {
-            if (node->left) {
-                node = node->left;
+    if (!tree->root) {
+        tree->root = create_node(tree->allocator, TRUE,
+                WMEM_TREE_LEAF_MIN_KEYS);
+    }
+
+    /* walk down to the leaf, remembering the way back up for splits */
+    node = tree->root;
+    while (!node->is_leaf) {
+        g_assert(depth < WMEM_TREE_MAX_DEPTH);
+        pos = node_upper_bound(node, key);
+        path[depth]     = node;
+        path_pos[depth] = pos;
+        depth++;
+        node = NODE_CHILD(node, pos);
+    }
+
+    pos = node_upper_bound(node, key);
+
+    /* this key already exists, so just return the data pointer */
+    if (pos > 0 && NODE_KEYS(node)[pos - 1] == key) {
+        if (replace) {
+            NODE_PTRS(node)[pos - 1] = CREATE_DATA(func, data);
+            if (is_subtree) {
+                node->subtree_mask |= 1u << (pos - 1);
             }
             else {
-                /* new node to the left */
-                new_node = create_node(tree->allocator, node, key,
-                        CREATE_DATA(func, data), WMEM_NODE_COLOR_RED,
-                        is_subtree);
-                node->left = new_node;
+                node->subtree_mask &= ~(1u << (pos - 1));
             }
         }
-        else if (key > node->key32) {
-            if (node->right) {
-                node = node->right;
-            }
-            else {
-                /* new node to the right */
-                new_node = create_node(tree->allocator, node, key,
-                        CREATE_DATA(func, data), WMEM_NODE_COLOR_RED,
-                        is_subtree);
-                node->right = new_node;
-            }
+        return NODE_PTRS(node)[pos - 1];
+    }
+
+    new_data = CREATE_DATA(func, data);
+
+    /* make room in a small leaf before resorting to a split */
+    if (node->count == node->capacity &&
+            node->capacity < WMEM_TREE_NODE_KEYS) {
+        node = grow_leaf(tree->allocator, node);
+        if (depth > 0) {
+            NODE_PTRS(path[depth - 1])[path_pos[depth - 1]] = node;
         }
+        else {
+            tree->root = node;
+        }
+    }
+
+    split = leaf_insert(tree->allocator, node, pos, key, new_data,
+            is_subtree);
+    if (split) {
+        split_key = NODE_KEYS(split)[0];
     }
 
-    /* node will now point to the newly created node */
-    rb_insert_case1(tree, new_node);
+    /* push any split up the tree */
+    while (split && depth > 0) {
+        depth--;
+        split = inner_insert(tree->allocator, path[depth], path_pos[depth],
+                split_key, split, &split_key);
+    }
+
+    /* the root itself was split, so grow the tree by one level */
+    if (split) {
+        new_root = create_node(tree->allocator, FALSE, WMEM_TREE_NODE_KEYS);
+        NODE_KEYS(new_root)[0] = split_key;
+        NODE_PTRS(new_root)[0] = tree->root;
+        NODE_PTRS(new_root)[1] = split;
+        new_root->count        = 1;
+        tree->root = new_root;
+    }
 
-    return new_node->data;
+    return new_data;
 }
 
 void
@@ -373,18 +445,18 @@ wmem_tree_insert32(wmem_tree_t *tree, guint32 key, void *data)
 void *
 wmem_tree_lookup32(wmem_tree_t *tree, guint32 key)
 {
-    wmem_tree_node_t *node = tree->root;
+    wmem_tree_node_t *leaf;
+    guint             pos;
 
-    while (node) {
-        if (key == node->key32) {
-            return node->data;
-        }
-        else if (key < node->key32) {
-            node = node->left;
-        }
-        else if (key > node->key32) {
-            node = node->right;
-        }
+    if (!tree->root) {
+        return NULL;
+    }
+
+    leaf = find_leaf(tree->root, key);
+    pos  = node_upper_bound(leaf, key);
+
+    if (pos > 0 && NODE_KEYS(leaf)[pos - 1] == key) {
+        return NODE_PTRS(leaf)[pos - 1];
     }
 
     return NULL;
@@ -393,63 +465,22 @@ wmem_tree_lookup32(wmem_tree_t *tree, guint32 key)
 void *
 wmem_tree_lookup32_le(wmem_tree_t *tree, guint32 key)
 {
-    wmem_tree_node_t *node = tree->root;
-
-    while (node) {
-        if (key == node->key32) {
-            return node->data;
-        }
-        else if (key < node->key32) {
-            if (node->left == NULL) {
-                break;
-            }
-            node = node->left;
-        }
-        else if (key > node->key32) {
-            if (node->right == NULL) {
-                break;
-            }
-            node = node->right;
-        }
-    }
+    wmem_tree_node_t *leaf;
+    guint             pos;
 
-    if (!node) {
+    if (!tree->root) {
         return NULL;
     }
 
-    /* If we are still at the root of the tree this means that this node
-     * is either smaller than the search key and then we return this
-     * node or else there is no smaller key available and then
-     * we return NULL.
-     */
-    if (node->parent == NULL) {
-        if (key > node->key32) {
-            return node->data;
-        } else {
-            return NULL;
-        }
-    }
+    leaf = find_leaf(tree->root, key);
+    pos  = node_upper_bound(leaf, key);
 
-    if (node->key32 <= key) {
-        /* if our key is <= the search key, we have the right node */
-        return node->data;
-    }
-    else if (node == node->parent->left) {
-        /* our key is bigger than the search key and we're a left child,
-         * we have to check if any of our ancestors are smaller. */
-        while (node) {
-            if (key > node->key32) {
-                return node->data;
-            }
-            node=node->parent;
-        }
-        return NULL;
-    }
-    else {
-        /* our key is bigger than the search key and we're a right child,
-         * our parent is the one we want */
-        return node->parent->data;
+    /* see find_leaf for why we never need to look at the previous leaf */
+    if (pos > 0) {
+        return NODE_PTRS(leaf)[pos - 1];
     }
+
+    return NULL;
 }
 
 /* Strings are stored as an array of uint32 containing the string characters
@@ -625,31 +656,28 @@ static gboolean
 wmem_tree_foreach_nodes(wmem_tree_node_t* node, wmem_foreach_func callback,
         void *user_data)
 {
-    gboolean stop_traverse = FALSE;
-
-    if (!node) {
+    gboolean stop_traverse;
+    guint    i;
+
+    if (!node->is_leaf) {
+        for (i = 0; i <= node->count; i++) {
+            if (wmem_tree_foreach_nodes(NODE_CHILD(node, i), callback,
+                        user_data)) {
+                return TRUE;
+            }
+        }
         return FALSE;
     }
 
-    if (node->left) {
-        if (wmem_tree_foreach_nodes(node->left, callback, user_data)) {
-            return TRUE;
+    for (i = 0; i < node->count; i++) {
+        if (node->subtree_mask & (1u << i)) {
+            stop_traverse = wmem_tree_foreach((wmem_tree_t *)NODE_PTRS(node)[i],
+                    callback, user_data);
+        } else {
+            stop_traverse = callback(NODE_PTRS(node)[i], user_data);
         }
-    }
 
-    if (node->is_subtree == TRUE) {
-        stop_traverse = wmem_tree_foreach((wmem_tree_t *)node->data,
-                callback, user_data);
-    } else {
-        stop_traverse = callback(node->data, user_data);
-    }
-
-    if (stop_traverse) {
-        return TRUE;
-    }
-
-    if(node->right) {
-        if (wmem_tree_foreach_nodes(node->right, callback, user_data)) {
+        if (stop_traverse) {
             return TRUE;
         }
     }
@@ -672,7 +700,7 @@ static void wmem_print_subtree(wmem_tree_t *tree, guint32 level);
 static void
 wmem_tree_print_nodes(const char *prefix, wmem_tree_node_t *node, guint32 level)
 {
-    guint32 i;
+    guint32 i, j;
 
     if (!node)
         return;
@@ -681,19 +709,27 @@ wmem_tree_print_nodes(const char *prefix, wmem_tree_node_t *node, guint32 level)
         printf("    ");
     }
 
-    printf("%sNODE:%p parent:%p left:%p right:%p colour:%s key:%u %s:%p\n",
-            prefix,
-            (void *)node, (void *)node->parent,
-            (void *)node->left, (void *)node->right,
-            node->color?"Black":"Red", node->key32,
-            node->is_subtree?"tree":"data", node->data);
-    if (node->left)
-        wmem_tree_print_nodes("L-", node->left, level+1);
-    if (node->right)
-        wmem_tree_print_nodes("R-", node->right, level+1);
-
-    if (node->is_subtree)
-        wmem_print_subtree((wmem_tree_t *)node->data, level+1);
+    printf("%sNODE:%p %s keys:%u\n", prefix, (void *)node,
+            node->is_leaf?"leaf":"inner", node->count);
+
+    if (!node->is_leaf) {
+        for (i=0; i<=node->count; i++) {
+            wmem_tree_print_nodes(i ? "C-" : "L-", NODE_CHILD(node, i),
+                    level+1);
+        }
+        return;
+    }
+
+    for (i=0; i<node->count; i++) {
+        for (j=0; j<=level; j++) {
+            printf("    ");
+        }
+        printf("key:%u %s:%p\n", NODE_KEYS(node)[i],
+                (node->subtree_mask & (1u << i))?"tree":"data",
+                NODE_PTRS(node)[i]);
+        if (node->subtree_mask & (1u << i))
+            wmem_print_subtree((wmem_tree_t *)NODE_PTRS(node)[i], level+2);
+    }
 }
 
 static void
@@ -1,5 +1,5 @@
 /* wmem_tree.h
- * Definitions for the Wireshark Memory Manager Red-Black Tree
+ * Definitions for the Wireshark Memory Manager B+ Tree
  * Based on the red-black tree implementation in epan/emem.*
  * Copyright 2013, Evan Huus <eapache@gmail.com>
  *
@@ -33,14 +33,17 @@ extern "C" {
 
 /** @addtogroup wmem
  *  @{
- *    @defgroup wmem-tree Red/Black Tree
+ *    @defgroup wmem-tree B+ Tree
  *
- *    Binary trees are a well-known and popular device in computer science to
+ *    Balanced trees are a well-known and popular device in computer science to
  *    handle storage of objects based on a search key or identity. The
- *    particular binary tree style implemented here is the red/black tree, which
- *    has the nice property of being self-balancing. This guarantees O(log(n))
- *    time for lookups, compared to linked lists that are O(n). This means
- *    red/black trees scale very well when many objects are being stored.
+ *    particular style implemented here is the B+ tree: each node holds up to
+ *    32 sorted keys side by side, and all data lives in the leaves. Leaves
+ *    start out with room for a few keys and grow as needed, so small trees
+ *    stay small. The tree guarantees O(log(n)) time for lookups, compared to
+ *    linked lists that are O(n), while touching far fewer cache lines per
+ *    lookup than a binary tree. This means B+ trees scale very well when many
+ *    objects are being stored.
  *
  *    @{
  */
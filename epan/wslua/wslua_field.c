@@ -227,8 +227,10 @@ static int FieldInfo_get_display(lua_State* L) {
     if (!fi->ws_fi->rep) {
         label_ptr = label_str;
         proto_item_fill_label(fi->ws_fi, label_str);
-    } else
+    } else {
+        proto_item_render_label(fi->ws_fi);
         label_ptr = fi->ws_fi->rep->representation;
+    }
 
     if (!label_ptr) return 0;
 
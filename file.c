@@ -319,6 +319,16 @@ ws_get_user_comment(void *data, const frame_data *fd)
   return cf_get_user_packet_comment(cf, fd);
 }
 
+static const nstime_t *
+ws_get_frame_shift_offset(void *data, const frame_data *fd)
+{
+  capture_file *cf = (capture_file *) data;
+
+  if (cf->frames == NULL)
+    return NULL;
+  return frame_data_sequence_get_shift_offset(cf->frames, fd);
+}
+
 static epan_t *
 ws_epan_new(capture_file *cf)
 {
@@ -328,6 +338,7 @@ ws_epan_new(capture_file *cf)
   epan->get_frame_ts = ws_get_frame_ts;
   epan->get_interface_name = cap_file_get_interface_name;
   epan->get_user_comment = ws_get_user_comment;
+  epan->get_frame_shift_offset = ws_get_frame_shift_offset;
 
   return epan;
 }
@@ -338,10 +349,16 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   wtap  *wth;
   gchar *err_info;
 
+  wtap_set_seek_index(prefs.gui_fileopen_seek_index);
   wth = wtap_open_offline(fname, type, err, &err_info, TRUE);
   if (wth == NULL)
     goto fail;
 
+  /* Temporary files are often still being written, by dumpcap or by us;
+     don't map them, as a mapping doesn't survive the file shrinking. */
+  if (is_tempfile)
+    wtap_disable_mapping(wth);
+
   /* The open succeeded.  Close whatever capture file we had open,
      and fill in the information for this file. */
   cf_close(cf);
@@ -844,6 +861,9 @@ cf_continue_tail(capture_file *cf, volatile int to_read, int *err)
   guint             tap_flags;
   gboolean          compiled;
 
+  /* dumpcap is still writing the file we're tailing. */
+  wtap_disable_mapping(cf->wth);
+
   /* Compile the current display filter.
    * We assume this will not fail since cf->dfilter is only set in
    * cf_filter IFF the filter was valid.
@@ -2460,6 +2480,7 @@ print_packet(capture_file *cf, frame_data *fdata,
   char           *cp;
   int             line_len;
   int             column_len;
+  const gchar    *column_text;
   int             cp_off;
   char            bookmark_name[9+10+1];  /* "__frameNNNNNNNNNN__\0" */
   char            bookmark_title[6+10+1]; /* "Frame NNNNNNNNNN__\0"  */
@@ -2501,7 +2522,8 @@ print_packet(capture_file *cf, frame_data *fdata,
     line_len = 0;
     for (i = 0; i < args->num_visible_cols; i++) {
       /* Find the length of the string for this column. */
-      column_len = (int) strlen(cf->cinfo.col_data[args->visible_cols[i]]);
+      column_text = col_get_data(&cf->cinfo, args->visible_cols[i]);
+      column_len = (int) strlen(column_text);
       if (args->col_widths[i] > column_len)
          column_len = args->col_widths[i];
 
@@ -2517,9 +2539,9 @@ print_packet(capture_file *cf, frame_data *fdata,
 
       /* Right-justify the packet number column. */
       if (cf->cinfo.col_fmt[args->visible_cols[i]] == COL_NUMBER)
-        g_snprintf(cp, column_len+1, "%*s", args->col_widths[i], cf->cinfo.col_data[args->visible_cols[i]]);
+        g_snprintf(cp, column_len+1, "%*s", args->col_widths[i], column_text);
       else
-        g_snprintf(cp, column_len+1, "%-*s", args->col_widths[i], cf->cinfo.col_data[args->visible_cols[i]]);
+        g_snprintf(cp, column_len+1, "%-*s", args->col_widths[i], column_text);
       cp += column_len;
       if (i != args->num_visible_cols - 1)
         *cp++ = ' ';
@@ -3155,6 +3177,7 @@ match_subtree_text(proto_node *node, gpointer data)
 
   /* was a free format label produced? */
   if (fi->rep) {
+    proto_item_render_label(fi);
     label_ptr = fi->rep->representation;
   } else {
     /* no, make a generic label */
@@ -3227,7 +3250,7 @@ match_summary_line(capture_file *cf, frame_data *fdata, void *criterion)
   for (colx = 0; colx < cf->cinfo.num_cols; colx++) {
     if (cf->cinfo.fmt_matx[colx][COL_INFO]) {
       /* Found it.  See if we match. */
-      info_column = edt.pi.cinfo->col_data[colx];
+      info_column = col_get_data(edt.pi.cinfo, colx);
       info_column_len = strlen(info_column);
       for (i = 0; i < info_column_len; i++) {
         c_char = info_column[i];
@@ -4354,6 +4377,8 @@ rescan_file(capture_file *cf, const char *fname, gboolean is_tempfile, int *err)
     cf_open_failure_alert_box(fname, *err, err_info, FALSE, 0);
     return CF_READ_ERROR;
   }
+  if (is_tempfile)
+    wtap_disable_mapping(cf->wth);
 
   /* We're scanning a file whose contents should be the same as what
      we had before, so we don't discard dissection state etc.. */
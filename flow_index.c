@@ -0,0 +1,890 @@
+/* flow_index.c
+ * Flow index files written next to capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>         /* needed to define AF_ values on UNIX */
+#endif
+
+#ifdef HAVE_WINSOCK2_H
+#include <winsock2.h>           /* needed to define AF_ values on Windows */
+#endif
+
+#ifdef NEED_INET_V6DEFS_H
+# include "wsutil/inet_v6defs.h"
+#endif
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+#include <wsutil/pint.h>
+
+#include "flow_index.h"
+
+/*
+ * The file starts with a header:
+ *
+ *   magic "WSFI", version (2 bytes), reserved (2 bytes),
+ *   number of flows (4 bytes), reserved (4 bytes)
+ *
+ * followed by a record for each flow:
+ *
+ *   the flow key (FLOW_KEY_LEN bytes, laid out as in flow_key),
+ *   first and last time stamp, number of packets and of bytes
+ *   (8 bytes each), number of byte ranges (4 bytes), reserved
+ *   (4 bytes), and the start and end offset of each range (8 bytes
+ *   each).
+ *
+ * All numbers are little-endian.
+ */
+#define FLOW_INDEX_MAGIC        "WSFI"
+#define FLOW_INDEX_VERSION      1
+#define FLOW_INDEX_HDR_LEN      16
+#define FLOW_KEY_LEN            44
+#define FLOW_RECORD_LEN         (FLOW_KEY_LEN + 4 * 8 + 8)
+
+/* Packets of a flow less than this far apart in the file share a
+   byte range; a reader skips the other flows' packets in between,
+   but the index stays small. */
+#define FLOW_INDEX_RANGE_GAP    (64 * 1024)
+
+#define ETHERTYPE_IP            0x0800
+#define ETHERTYPE_IPv6          0x86DD
+#define ETHERTYPE_VLAN          0x8100
+#define ETHERTYPE_QINQ          0x88A8
+
+#define IP_PROTO_HOPOPTS        0
+#define IP_PROTO_TCP            6
+#define IP_PROTO_UDP            17
+#define IP_PROTO_ROUTING        43
+#define IP_PROTO_DSTOPTS        60
+
+#define UDP_PORT_ZEP            17754
+
+/*
+ * Flow keys
+ */
+
+/* Put the endpoints of a key in canonical order */
+static void
+flow_key_canonicalize(flow_key *key)
+{
+    int     cmp;
+    guint8  len;
+    guint16 port;
+    guint8  addr[16];
+
+    cmp = (int)key->addr_len[0] - (int)key->addr_len[1];
+    if (cmp == 0)
+        cmp = memcmp(key->addr[0], key->addr[1], sizeof key->addr[0]);
+    if (cmp == 0)
+        cmp = (int)key->port[0] - (int)key->port[1];
+    if (cmp > 0) {
+        len = key->addr_len[0];
+        key->addr_len[0] = key->addr_len[1];
+        key->addr_len[1] = len;
+        port = key->port[0];
+        key->port[0] = key->port[1];
+        key->port[1] = port;
+        memcpy(addr, key->addr[0], sizeof addr);
+        memcpy(key->addr[0], key->addr[1], sizeof addr);
+        memcpy(key->addr[1], addr, sizeof addr);
+    }
+}
+
+/* IEEE 802.15.4 MAC header: frame control, sequence number, addressing */
+static gboolean
+flow_key_wpan(flow_key *key, const guint8 *pd, guint32 caplen)
+{
+    guint16  fcf;
+    guint32  off = 3;
+    guint    mode[2], i;
+    gboolean have_pan = FALSE;
+
+    if (caplen < 3)
+        return FALSE;
+    fcf = pletoh16(pd);
+    /* 2015 frames may leave out the sequence number */
+    if (((fcf >> 12) & 3) == 2 && (fcf & 0x0100))
+        off = 2;
+    mode[0] = (fcf >> 10) & 3;      /* destination addressing mode */
+    mode[1] = (fcf >> 14) & 3;      /* source addressing mode */
+    if (mode[0] == 0 && mode[1] == 0)
+        return FALSE;
+
+    memset(key, 0, sizeof *key);
+    key->type = FLOW_KEY_WPAN;
+    for (i = 0; i < 2; i++) {
+        if (mode[i] == 0)
+            continue;
+        if (mode[i] == 1)
+            return FALSE;           /* reserved */
+        /* the source PAN ID is left out with PAN ID compression */
+        if (i == 0 || !(fcf & 0x0040)) {
+            if (caplen < off + 2)
+                return FALSE;
+            if (!have_pan)
+                key->id = pletoh16(pd + off);
+            have_pan = TRUE;
+            off += 2;
+        }
+        key->addr_len[i] = (mode[i] == 2) ? 2 : 8;
+        if (caplen < off + key->addr_len[i])
+            return FALSE;
+        memcpy(key->addr[i], pd + off, key->addr_len[i]);
+        off += key->addr_len[i];
+    }
+    flow_key_canonicalize(key);
+    return TRUE;
+}
+
+/* IPv4 or IPv6 and, for TCP and UDP, the ports */
+static gboolean
+flow_key_ip(flow_key *key, guint16 ethertype, const guint8 *pd, guint32 caplen)
+{
+    guint32 off, hlen;
+    guint8  proto;
+    gboolean first_fragment = TRUE;
+
+    memset(key, 0, sizeof *key);
+    if (ethertype == ETHERTYPE_IP) {
+        if (caplen < 20 || (pd[0] >> 4) != 4)
+            return FALSE;
+        hlen = (pd[0] & 0x0F) * 4;
+        if (hlen < 20)
+            return FALSE;
+        key->type = FLOW_KEY_IPV4;
+        key->addr_len[0] = key->addr_len[1] = 4;
+        memcpy(key->addr[0], pd + 12, 4);
+        memcpy(key->addr[1], pd + 16, 4);
+        proto = pd[9];
+        if ((pntoh16(pd + 6) & 0x1FFF) != 0)
+            first_fragment = FALSE;
+        off = hlen;
+    } else {
+        if (caplen < 40 || (pd[0] >> 4) != 6)
+            return FALSE;
+        key->type = FLOW_KEY_IPV6;
+        key->addr_len[0] = key->addr_len[1] = 16;
+        memcpy(key->addr[0], pd + 8, 16);
+        memcpy(key->addr[1], pd + 24, 16);
+        proto = pd[6];
+        off = 40;
+        while ((proto == IP_PROTO_HOPOPTS || proto == IP_PROTO_ROUTING ||
+                proto == IP_PROTO_DSTOPTS) && caplen >= off + 8) {
+            proto = pd[off];
+            off += (pd[off + 1] + 1) * 8;
+        }
+    }
+    key->proto = proto;
+
+    /* Later fragments don't have the ports; they are indexed with the
+       addresses only. */
+    if (first_fragment && (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP) &&
+        caplen >= off + 8) {
+        key->port[0] = pntoh16(pd + off);
+        key->port[1] = pntoh16(pd + off + 2);
+
+        /* For ZEP, the 802.15.4 frame inside is what's interesting */
+        if (proto == IP_PROTO_UDP &&
+            (key->port[0] == UDP_PORT_ZEP || key->port[1] == UDP_PORT_ZEP)) {
+            flow_key wpan_key;
+
+            off += 8;
+            if (caplen >= off + 4 && pd[off] == 'E' && pd[off + 1] == 'X') {
+                if (pd[off + 2] == 1)
+                    hlen = 16;
+                else if (pd[off + 2] == 2 && pd[off + 3] == 1)
+                    hlen = 32;
+                else
+                    hlen = 0;
+                if (hlen != 0 && caplen > off + hlen &&
+                    flow_key_wpan(&wpan_key, pd + off + hlen, caplen - off - hlen)) {
+                    *key = wpan_key;
+                    return TRUE;
+                }
+            }
+        }
+    }
+    flow_key_canonicalize(key);
+    return TRUE;
+}
+
+gboolean
+flow_key_from_packet(flow_key *key, flow_link_type link,
+                     const guint8 *pd, guint32 caplen)
+{
+    guint16 ethertype;
+    guint32 off;
+
+    switch (link) {
+
+    case FLOW_LINK_ETHERNET:
+        if (caplen < 14)
+            return FALSE;
+        ethertype = pntoh16(pd + 12);
+        off = 14;
+        while ((ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ) &&
+               caplen >= off + 4) {
+            ethertype = pntoh16(pd + off + 2);
+            off += 4;
+        }
+        if ((ethertype == ETHERTYPE_IP || ethertype == ETHERTYPE_IPv6) &&
+            flow_key_ip(key, ethertype, pd + off, caplen - off))
+            return TRUE;
+        memset(key, 0, sizeof *key);
+        key->type = FLOW_KEY_L2;
+        key->addr_len[0] = key->addr_len[1] = 6;
+        memcpy(key->addr[0], pd, 6);
+        memcpy(key->addr[1], pd + 6, 6);
+        key->id = (ethertype > 1500) ? ethertype : 0;
+        flow_key_canonicalize(key);
+        return TRUE;
+
+    case FLOW_LINK_LINUX_SLL:
+        if (caplen < 16)
+            return FALSE;
+        ethertype = pntoh16(pd + 14);
+        if (ethertype != ETHERTYPE_IP && ethertype != ETHERTYPE_IPv6)
+            return FALSE;
+        return flow_key_ip(key, ethertype, pd + 16, caplen - 16);
+
+    case FLOW_LINK_RAW_IP:
+        if (caplen < 1)
+            return FALSE;
+        ethertype = ((pd[0] >> 4) == 6) ? ETHERTYPE_IPv6 : ETHERTYPE_IP;
+        return flow_key_ip(key, ethertype, pd, caplen);
+
+    case FLOW_LINK_IEEE802_15_4:
+        return flow_key_wpan(key, pd, caplen);
+    }
+    return FALSE;
+}
+
+static void
+flow_addr_to_str(const flow_key *key, guint i, gchar *buf, size_t buflen)
+{
+    const guint8 *a = key->addr[i];
+
+    switch (key->type) {
+
+    case FLOW_KEY_IPV4:
+        inet_ntop(AF_INET, a, buf, (int)buflen);
+        break;
+
+    case FLOW_KEY_IPV6:
+        inet_ntop(AF_INET6, a, buf, (int)buflen);
+        break;
+
+    case FLOW_KEY_L2:
+        g_snprintf(buf, (gulong)buflen, "%02x:%02x:%02x:%02x:%02x:%02x",
+                   a[0], a[1], a[2], a[3], a[4], a[5]);
+        break;
+
+    case FLOW_KEY_WPAN:
+        /* addresses are little-endian in the frame */
+        if (key->addr_len[i] == 2)
+            g_snprintf(buf, (gulong)buflen, "0x%04x", pletoh16(a));
+        else if (key->addr_len[i] == 8)
+            g_snprintf(buf, (gulong)buflen,
+                       "%02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x",
+                       a[7], a[6], a[5], a[4], a[3], a[2], a[1], a[0]);
+        else
+            g_strlcpy(buf, "-", buflen);
+        break;
+
+    default:
+        g_strlcpy(buf, "?", buflen);
+        break;
+    }
+}
+
+gchar *
+flow_key_to_str(const flow_key *key)
+{
+    gchar addr[2][64];
+
+    flow_addr_to_str(key, 0, addr[0], sizeof addr[0]);
+    flow_addr_to_str(key, 1, addr[1], sizeof addr[1]);
+
+    switch (key->type) {
+
+    case FLOW_KEY_IPV4:
+    case FLOW_KEY_IPV6:
+        if (key->proto == IP_PROTO_TCP || key->proto == IP_PROTO_UDP) {
+            return g_strdup_printf(key->type == FLOW_KEY_IPV4 ?
+                                       "%s %s:%u <-> %s:%u" : "%s [%s]:%u <-> [%s]:%u",
+                                   key->proto == IP_PROTO_TCP ? "tcp" : "udp",
+                                   addr[0], key->port[0], addr[1], key->port[1]);
+        }
+        return g_strdup_printf("ip proto %u %s <-> %s", key->proto, addr[0], addr[1]);
+
+    case FLOW_KEY_L2:
+        return g_strdup_printf("eth type 0x%04x %s <-> %s", key->id, addr[0], addr[1]);
+
+    case FLOW_KEY_WPAN:
+        return g_strdup_printf("wpan pan 0x%04x %s <-> %s", key->id, addr[0], addr[1]);
+
+    case FLOW_KEY_OTHER:
+        return g_strdup("other flows");
+    }
+    return g_strdup("unknown");
+}
+
+static guint
+flow_key_hash(gconstpointer k)
+{
+    const guint8 *p = (const guint8 *)k;
+    guint32       h = 2166136261U;
+    size_t        i;
+
+    /* FNV-1a */
+    for (i = 0; i < sizeof(flow_key); i++) {
+        h ^= p[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static gboolean
+flow_key_equal(gconstpointer a, gconstpointer b)
+{
+    return memcmp(a, b, sizeof(flow_key)) == 0;
+}
+
+/*
+ * Writing
+ */
+
+typedef struct {
+    flow_index_entry e;
+    guint            ranges_size;   /* number of ranges allocated */
+} flow_index_flow;
+
+struct flow_index {
+    GHashTable      *flows;         /* flow_key -> flow_index_flow */
+    GPtrArray       *order;         /* flows in the order they first appeared */
+    flow_index_flow *other;         /* flows past FLOW_INDEX_MAX_FLOWS, or NULL */
+};
+
+flow_index *
+flow_index_new(void)
+{
+    flow_index *fi = g_new(flow_index, 1);
+
+    fi->flows = g_hash_table_new(flow_key_hash, flow_key_equal);
+    fi->order = g_ptr_array_new();
+    fi->other = NULL;
+    return fi;
+}
+
+void
+flow_index_add(flow_index *fi, const flow_key *key, guint64 offset,
+               guint32 rec_len, guint32 len, guint64 ts_nsecs)
+{
+    flow_index_flow *flow;
+    guint64         *range;
+
+    flow = (flow_index_flow *)g_hash_table_lookup(fi->flows, key);
+    if (flow == NULL && g_hash_table_size(fi->flows) >= FLOW_INDEX_MAX_FLOWS) {
+        /* No room for another flow; lump it in with the rest. */
+        flow = fi->other;
+        if (flow == NULL) {
+            flow = g_new0(flow_index_flow, 1);
+            flow->e.key.type = FLOW_KEY_OTHER;
+            flow->e.first_ts = ts_nsecs;
+            flow->e.last_ts = ts_nsecs;
+            g_ptr_array_add(fi->order, flow);
+            fi->other = flow;
+        }
+    }
+    if (flow == NULL) {
+        flow = g_new0(flow_index_flow, 1);
+        flow->e.key = *key;
+        flow->e.first_ts = ts_nsecs;
+        flow->e.last_ts = ts_nsecs;
+        g_hash_table_insert(fi->flows, &flow->e.key, flow);
+        g_ptr_array_add(fi->order, flow);
+    }
+    if (ts_nsecs < flow->e.first_ts)
+        flow->e.first_ts = ts_nsecs;
+    if (ts_nsecs > flow->e.last_ts)
+        flow->e.last_ts = ts_nsecs;
+    flow->e.packets++;
+    flow->e.bytes += len;
+
+    range = flow->e.nranges ? &flow->e.ranges[2 * (flow->e.nranges - 1)] : NULL;
+    if (range != NULL && offset <= range[1] + FLOW_INDEX_RANGE_GAP) {
+        range[1] = offset + rec_len;
+        return;
+    }
+    if (flow->e.nranges == flow->ranges_size) {
+        flow->ranges_size = flow->ranges_size ? 2 * flow->ranges_size : 4;
+        flow->e.ranges = (guint64 *)g_realloc(flow->e.ranges,
+                                              2 * flow->ranges_size * sizeof(guint64));
+    }
+    flow->e.ranges[2 * flow->e.nranges] = offset;
+    flow->e.ranges[2 * flow->e.nranges + 1] = offset + rec_len;
+    flow->e.nranges++;
+}
+
+static void
+flow_index_clear(flow_index *fi)
+{
+    flow_index_flow *flow;
+    guint            i;
+
+    g_hash_table_remove_all(fi->flows);
+    for (i = 0; i < fi->order->len; i++) {
+        flow = (flow_index_flow *)g_ptr_array_index(fi->order, i);
+        g_free(flow->e.ranges);
+        g_free(flow);
+    }
+    g_ptr_array_set_size(fi->order, 0);
+    fi->other = NULL;
+}
+
+static void
+flow_put_le16(guint8 *p, guint16 v)
+{
+    p[0] = (guint8)v;
+    p[1] = (guint8)(v >> 8);
+}
+
+static void
+flow_put_le32(guint8 *p, guint32 v)
+{
+    flow_put_le16(p, (guint16)v);
+    flow_put_le16(p + 2, (guint16)(v >> 16));
+}
+
+static void
+flow_put_le64(guint8 *p, guint64 v)
+{
+    flow_put_le32(p, (guint32)v);
+    flow_put_le32(p + 4, (guint32)(v >> 32));
+}
+
+gboolean
+flow_index_write(flow_index *fi, const char *capture_file, int *err)
+{
+    gchar           *name;
+    FILE            *fh;
+    guint8           rec[FLOW_RECORD_LEN];
+    guint8           range[16];
+    flow_index_flow *flow;
+    guint            i, j;
+    gboolean         ok = TRUE;
+
+    name = g_strconcat(capture_file, FLOW_INDEX_SUFFIX, NULL);
+    fh = ws_fopen(name, "wb");
+    g_free(name);
+    if (fh == NULL) {
+        *err = errno;
+        flow_index_clear(fi);
+        return FALSE;
+    }
+
+    memset(rec, 0, FLOW_INDEX_HDR_LEN);
+    memcpy(rec, FLOW_INDEX_MAGIC, 4);
+    flow_put_le16(rec + 4, FLOW_INDEX_VERSION);
+    flow_put_le32(rec + 8, fi->order->len);
+    if (fwrite(rec, 1, FLOW_INDEX_HDR_LEN, fh) != FLOW_INDEX_HDR_LEN)
+        ok = FALSE;
+
+    for (i = 0; ok && i < fi->order->len; i++) {
+        flow = (flow_index_flow *)g_ptr_array_index(fi->order, i);
+        memset(rec, 0, sizeof rec);
+        rec[0] = flow->e.key.type;
+        rec[1] = flow->e.key.proto;
+        rec[2] = flow->e.key.addr_len[0];
+        rec[3] = flow->e.key.addr_len[1];
+        flow_put_le16(rec + 4, flow->e.key.id);
+        flow_put_le16(rec + 6, flow->e.key.port[0]);
+        flow_put_le16(rec + 8, flow->e.key.port[1]);
+        memcpy(rec + 12, flow->e.key.addr, 32);
+        flow_put_le64(rec + FLOW_KEY_LEN, flow->e.first_ts);
+        flow_put_le64(rec + FLOW_KEY_LEN + 8, flow->e.last_ts);
+        flow_put_le64(rec + FLOW_KEY_LEN + 16, flow->e.packets);
+        flow_put_le64(rec + FLOW_KEY_LEN + 24, flow->e.bytes);
+        flow_put_le32(rec + FLOW_KEY_LEN + 32, flow->e.nranges);
+        if (fwrite(rec, 1, sizeof rec, fh) != sizeof rec)
+            ok = FALSE;
+        for (j = 0; ok && j < flow->e.nranges; j++) {
+            flow_put_le64(range, flow->e.ranges[2 * j]);
+            flow_put_le64(range + 8, flow->e.ranges[2 * j + 1]);
+            if (fwrite(range, 1, sizeof range, fh) != sizeof range)
+                ok = FALSE;
+        }
+    }
+    if (!ok)
+        *err = errno;
+    if (fclose(fh) == EOF && ok) {
+        *err = errno;
+        ok = FALSE;
+    }
+
+    flow_index_clear(fi);
+    return ok;
+}
+
+void
+flow_index_free(flow_index *fi)
+{
+    if (fi == NULL)
+        return;
+    flow_index_clear(fi);
+    g_hash_table_destroy(fi->flows);
+    g_ptr_array_free(fi->order, TRUE);
+    g_free(fi);
+}
+
+/*
+ * Reading
+ */
+
+static const char *flow_compression_suffixes[] = { ".gz", ".zst", ".lz4" };
+
+static FILE *
+flow_index_open(const char *capture_file)
+{
+    gchar  *name;
+    FILE   *fh;
+    size_t  len = strlen(capture_file), slen;
+    guint   i;
+
+    name = g_strconcat(capture_file, FLOW_INDEX_SUFFIX, NULL);
+    fh = ws_fopen(name, "rb");
+    g_free(name);
+    if (fh != NULL || errno != ENOENT)
+        return fh;
+
+    for (i = 0; i < G_N_ELEMENTS(flow_compression_suffixes); i++) {
+        slen = strlen(flow_compression_suffixes[i]);
+        if (len > slen &&
+            strcmp(capture_file + len - slen, flow_compression_suffixes[i]) == 0) {
+            name = g_strdup_printf("%.*s%s", (int)(len - slen), capture_file,
+                                   FLOW_INDEX_SUFFIX);
+            fh = ws_fopen(name, "rb");
+            g_free(name);
+            if (fh != NULL)
+                return fh;
+        }
+    }
+    errno = ENOENT;
+    return NULL;
+}
+
+gboolean
+flow_index_read(const char *capture_file, GPtrArray **entries, int *err)
+{
+    FILE             *fh;
+    guint8            rec[FLOW_RECORD_LEN];
+    guint32           nflows, i, j;
+    flow_index_entry *entry;
+
+    *entries = NULL;
+    fh = flow_index_open(capture_file);
+    if (fh == NULL) {
+        *err = errno;
+        return FALSE;
+    }
+
+    if (fread(rec, 1, FLOW_INDEX_HDR_LEN, fh) != FLOW_INDEX_HDR_LEN ||
+        memcmp(rec, FLOW_INDEX_MAGIC, 4) != 0 ||
+        pletoh16(rec + 4) != FLOW_INDEX_VERSION)
+        goto bad;
+    nflows = pletoh32(rec + 8);
+
+    *entries = g_ptr_array_new();
+    for (i = 0; i < nflows; i++) {
+        if (fread(rec, 1, sizeof rec, fh) != sizeof rec)
+            goto bad;
+        entry = g_new0(flow_index_entry, 1);
+        g_ptr_array_add(*entries, entry);
+        entry->key.type = rec[0];
+        entry->key.proto = rec[1];
+        entry->key.addr_len[0] = MIN(rec[2], 16);
+        entry->key.addr_len[1] = MIN(rec[3], 16);
+        entry->key.id = pletoh16(rec + 4);
+        entry->key.port[0] = pletoh16(rec + 6);
+        entry->key.port[1] = pletoh16(rec + 8);
+        memcpy(entry->key.addr, rec + 12, 32);
+        entry->first_ts = pletoh64(rec + FLOW_KEY_LEN);
+        entry->last_ts = pletoh64(rec + FLOW_KEY_LEN + 8);
+        entry->packets = pletoh64(rec + FLOW_KEY_LEN + 16);
+        entry->bytes = pletoh64(rec + FLOW_KEY_LEN + 24);
+        entry->nranges = pletoh32(rec + FLOW_KEY_LEN + 32);
+        /* keep the size of the allocation from overflowing */
+        if (entry->nranges > G_MAXUINT32 / 16)
+            goto bad;
+        entry->ranges = (guint64 *)g_try_malloc(MAX(entry->nranges, 1) * 2 * sizeof(guint64));
+        if (entry->ranges == NULL)
+            goto bad;
+        for (j = 0; j < entry->nranges; j++) {
+            if (fread(rec, 1, 16, fh) != 16)
+                goto bad;
+            entry->ranges[2 * j] = pletoh64(rec);
+            entry->ranges[2 * j + 1] = pletoh64(rec + 8);
+        }
+    }
+    fclose(fh);
+    return TRUE;
+
+bad:
+    fclose(fh);
+    flow_index_entries_free(*entries);
+    *entries = NULL;
+    *err = 0;
+    return FALSE;
+}
+
+void
+flow_index_entries_free(GPtrArray *entries)
+{
+    flow_index_entry *entry;
+    guint             i;
+
+    if (entries == NULL)
+        return;
+    for (i = 0; i < entries->len; i++) {
+        entry = (flow_index_entry *)g_ptr_array_index(entries, i);
+        g_free(entry->ranges);
+        g_free(entry);
+    }
+    g_ptr_array_free(entries, TRUE);
+}
+
+/*
+ * Queries
+ */
+
+struct flow_query {
+    guint8   host_len;              /* 4 or 16, or 0 if not given */
+    guint8   host[16];
+    gboolean has_port;
+    guint16  port;
+    gboolean has_proto;
+    guint8   proto;
+    gboolean has_mac;
+    guint8   mac[6];
+    gboolean has_ethertype;
+    guint16  ethertype;
+    gboolean has_pan;
+    guint16  pan;
+    guint8   wpan_len;              /* 2 or 8, or 0 if not given */
+    guint8   wpan[8];               /* little-endian, as in the frame */
+};
+
+static gboolean
+flow_parse_number(const char *s, guint32 max, guint32 *val)
+{
+    char          *end;
+    unsigned long  n;
+
+    if (*s == '\0' || *s == '-')
+        return FALSE;
+    errno = 0;
+    n = strtoul(s, &end, 0);
+    if (*end != '\0' || errno != 0 || n > max)
+        return FALSE;
+    *val = (guint32)n;
+    return TRUE;
+}
+
+/* Parse "xx:xx:...", with len bytes */
+static gboolean
+flow_parse_hex_addr(const char *s, guint8 *addr, guint len)
+{
+    guint i;
+    int   hi, lo;
+
+    for (i = 0; i < len; i++) {
+        hi = g_ascii_xdigit_value(s[0]);
+        lo = (hi >= 0) ? g_ascii_xdigit_value(s[1]) : -1;
+        if (lo < 0)
+            return FALSE;
+        addr[i] = (guint8)(hi << 4 | lo);
+        s += 2;
+        if (i + 1 < len) {
+            if (*s != ':' && *s != '-')
+                return FALSE;
+            s++;
+        }
+    }
+    return *s == '\0';
+}
+
+flow_query *
+flow_query_new(const char *spec, char **err_msg)
+{
+    flow_query  *query;
+    gchar      **terms, *value;
+    guint32      n;
+    guint        i, j;
+    guint8       ext[8];
+
+    query = g_new0(flow_query, 1);
+    terms = g_strsplit(spec, ",", -1);
+    for (i = 0; terms[i] != NULL; i++) {
+        value = strchr(terms[i], '=');
+        if (value == NULL) {
+            *err_msg = g_strdup_printf("Flow query term \"%s\" isn't of the form <field>=<value>",
+                                       terms[i]);
+            goto fail;
+        }
+        *value++ = '\0';
+        if (strcmp(terms[i], "host") == 0) {
+            if (inet_pton(AF_INET, value, query->host) == 1)
+                query->host_len = 4;
+            else if (inet_pton(AF_INET6, value, query->host) == 1)
+                query->host_len = 16;
+            else
+                goto bad_value;
+        } else if (strcmp(terms[i], "port") == 0) {
+            if (!flow_parse_number(value, G_MAXUINT16, &n))
+                goto bad_value;
+            query->has_port = TRUE;
+            query->port = (guint16)n;
+        } else if (strcmp(terms[i], "proto") == 0) {
+            if (strcmp(value, "tcp") == 0)
+                n = IP_PROTO_TCP;
+            else if (strcmp(value, "udp") == 0)
+                n = IP_PROTO_UDP;
+            else if (!flow_parse_number(value, G_MAXUINT8, &n))
+                goto bad_value;
+            query->has_proto = TRUE;
+            query->proto = (guint8)n;
+        } else if (strcmp(terms[i], "mac") == 0) {
+            if (!flow_parse_hex_addr(value, query->mac, 6))
+                goto bad_value;
+            query->has_mac = TRUE;
+        } else if (strcmp(terms[i], "ethertype") == 0) {
+            if (!flow_parse_number(value, G_MAXUINT16, &n))
+                goto bad_value;
+            query->has_ethertype = TRUE;
+            query->ethertype = (guint16)n;
+        } else if (strcmp(terms[i], "pan") == 0) {
+            if (!flow_parse_number(value, G_MAXUINT16, &n))
+                goto bad_value;
+            query->has_pan = TRUE;
+            query->pan = (guint16)n;
+        } else if (strcmp(terms[i], "wpan") == 0) {
+            if (flow_parse_hex_addr(value, ext, 8)) {
+                for (j = 0; j < 8; j++)
+                    query->wpan[j] = ext[7 - j];
+                query->wpan_len = 8;
+            } else if (flow_parse_number(value, G_MAXUINT16, &n)) {
+                query->wpan[0] = (guint8)n;
+                query->wpan[1] = (guint8)(n >> 8);
+                query->wpan_len = 2;
+            } else {
+                goto bad_value;
+            }
+        } else {
+            *err_msg = g_strdup_printf("Unknown field \"%s\" in flow query; use host, port, "
+                                       "proto, mac, ethertype, pan or wpan", terms[i]);
+            goto fail;
+        }
+        continue;
+
+bad_value:
+        *err_msg = g_strdup_printf("Invalid value \"%s\" for %s in flow query",
+                                   value, terms[i]);
+        goto fail;
+    }
+    g_strfreev(terms);
+    return query;
+
+fail:
+    g_strfreev(terms);
+    g_free(query);
+    return NULL;
+}
+
+/* Does either endpoint of the key have this address? */
+static gboolean
+flow_key_has_addr(const flow_key *key, const guint8 *addr, guint len)
+{
+    return (key->addr_len[0] == len && memcmp(key->addr[0], addr, len) == 0) ||
+           (key->addr_len[1] == len && memcmp(key->addr[1], addr, len) == 0);
+}
+
+gboolean
+flow_query_match(const flow_query *query, const flow_key *key)
+{
+    gboolean is_ip = (key->type == FLOW_KEY_IPV4 || key->type == FLOW_KEY_IPV6);
+
+    /* Any flow could be among those that didn't fit in the index. */
+    if (key->type == FLOW_KEY_OTHER)
+        return TRUE;
+
+    if (query->host_len != 0 &&
+        (!is_ip || !flow_key_has_addr(key, query->host, query->host_len)))
+        return FALSE;
+    if (query->has_port &&
+        (!is_ip || (key->port[0] != query->port && key->port[1] != query->port)))
+        return FALSE;
+    if (query->has_proto && (!is_ip || key->proto != query->proto))
+        return FALSE;
+    if (query->has_mac &&
+        (key->type != FLOW_KEY_L2 || !flow_key_has_addr(key, query->mac, 6)))
+        return FALSE;
+    if (query->has_ethertype &&
+        (key->type != FLOW_KEY_L2 || key->id != query->ethertype))
+        return FALSE;
+    if (query->has_pan && (key->type != FLOW_KEY_WPAN || key->id != query->pan))
+        return FALSE;
+    if (query->wpan_len != 0 &&
+        (key->type != FLOW_KEY_WPAN || !flow_key_has_addr(key, query->wpan, query->wpan_len)))
+        return FALSE;
+    return TRUE;
+}
+
+void
+flow_query_free(flow_query *query)
+{
+    g_free(query);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
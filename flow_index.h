@@ -0,0 +1,165 @@
+/* flow_index.h
+ * Declarations for the flow index files written next to capture files
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __FLOW_INDEX_H__
+#define __FLOW_INDEX_H__
+
+#include <glib.h>
+
+/*
+ * A flow index lists, for each flow in a capture file, when it was
+ * seen, how many packets it had and which byte ranges of the file hold
+ * its packets, so that a flow can be found in a large set of files
+ * without reading them.  dumpcap writes one for each file it writes,
+ * with the name of that file plus FLOW_INDEX_SUFFIX.
+ */
+#define FLOW_INDEX_SUFFIX       ".fidx"
+
+/** The kinds of flow keys */
+typedef enum {
+    FLOW_KEY_L2   = 1,    /**< two MAC addresses and an Ethertype */
+    FLOW_KEY_IPV4 = 2,    /**< two IPv4 addresses and ports, and a protocol */
+    FLOW_KEY_IPV6 = 3,    /**< two IPv6 addresses and ports, and a protocol */
+    FLOW_KEY_WPAN = 4,    /**< an IEEE 802.15.4 PAN ID and two addresses */
+    FLOW_KEY_OTHER = 5    /**< all the flows past FLOW_INDEX_MAX_FLOWS; no fields */
+} flow_key_type;
+
+/** A flow key.  The endpoints are in a canonical order, so that both
+    directions of a flow have the same key; unused bytes are zero, so
+    keys can be compared with memcmp(). */
+typedef struct {
+    guint8  type;         /**< a flow_key_type */
+    guint8  proto;        /**< IP protocol, or 0 */
+    guint8  addr_len[2];  /**< 6, 4, 16, or 0, 2 or 8 for 802.15.4 */
+    guint16 id;           /**< Ethertype, or 802.15.4 PAN ID */
+    guint16 port[2];      /**< TCP/UDP ports, or 0 */
+    guint16 reserved;
+    guint8  addr[2][16];
+} flow_key;
+
+/** Link-layer types flow keys can be taken from */
+typedef enum {
+    FLOW_LINK_ETHERNET,
+    FLOW_LINK_LINUX_SLL,
+    FLOW_LINK_RAW_IP,
+    FLOW_LINK_IEEE802_15_4
+} flow_link_type;
+
+/** Get the flow key of a packet.
+ *
+ * IP packets get an IPv4 or IPv6 key, with the ports for TCP and UDP;
+ * 802.15.4 frames, including those carried in ZEP, get an 802.15.4
+ * key; other Ethernet frames get a link-layer key.
+ *
+ * @return TRUE if the packet has a key, FALSE if not.
+ */
+gboolean flow_key_from_packet(flow_key *key, flow_link_type link,
+                              const guint8 *pd, guint32 caplen);
+
+/** Format a flow key for display.
+ *
+ * @return A g_malloc()ed string.
+ */
+gchar *flow_key_to_str(const flow_key *key);
+
+/* Writing flow indexes */
+
+/** The most flows an index lists separately; the packets of any more
+    flows in the same file are lumped together under a FLOW_KEY_OTHER
+    key, which every query matches. */
+#define FLOW_INDEX_MAX_FLOWS    (128 * 1024)
+
+/** A flow index being collected for a capture file */
+typedef struct flow_index flow_index;
+
+flow_index *flow_index_new(void);
+
+/** Add a packet.
+ *
+ * @param fi The flow index.
+ * @param key The flow key of the packet.
+ * @param offset The offset of the packet's record in the capture file.
+ * @param rec_len The length of the record.
+ * @param len The original length of the packet.
+ * @param ts_nsecs The packet's time stamp, in nanoseconds since the Epoch.
+ */
+void flow_index_add(flow_index *fi, const flow_key *key, guint64 offset,
+                    guint32 rec_len, guint32 len, guint64 ts_nsecs);
+
+/** Write the flow index for a capture file, and empty it.
+ *
+ * @return TRUE on success, FALSE and sets "*err" to an errno value on
+ *         failure.
+ */
+gboolean flow_index_write(flow_index *fi, const char *capture_file, int *err);
+
+void flow_index_free(flow_index *fi);
+
+/* Reading flow indexes */
+
+/** A flow read from a flow index */
+typedef struct {
+    flow_key  key;
+    guint64   first_ts;   /**< first time stamp, in nanoseconds since the Epoch */
+    guint64   last_ts;    /**< last time stamp */
+    guint64   packets;    /**< number of packets */
+    guint64   bytes;      /**< sum of their original lengths */
+    guint     nranges;    /**< number of byte ranges */
+    guint64  *ranges;     /**< start and end offset of each range */
+} flow_index_entry;
+
+/** Read the flow index for a capture file.  For a compressed capture
+ *  file, the index of the uncompressed file is used if there is no
+ *  index for the compressed one; its offsets are in uncompressed data.
+ *
+ * @param capture_file The name of the capture file.
+ * @param entries Set to a GPtrArray of flow_index_entry pointers.
+ * @param err Set to an errno value, or to 0 for a malformed index, on
+ *        failure.
+ * @return TRUE on success, FALSE on failure.
+ */
+gboolean flow_index_read(const char *capture_file, GPtrArray **entries, int *err);
+
+/** Free what flow_index_read() returned. */
+void flow_index_entries_free(GPtrArray *entries);
+
+/** A compiled query for flows */
+typedef struct flow_query flow_query;
+
+/** Compile a query.
+ *
+ * A query is a comma-separated list of terms that all have to match:
+ * "host=<IPv4 or IPv6 address>", "port=<number>", "proto=<tcp, udp or
+ * number>", "mac=<MAC address>", "ethertype=<number>", "pan=<number>"
+ * and "wpan=<802.15.4 short address, or extended address>".
+ *
+ * @param spec The query.
+ * @param err_msg Set to a g_malloc()ed message on error.
+ * @return The query, or NULL on error.
+ */
+flow_query *flow_query_new(const char *spec, char **err_msg);
+
+gboolean flow_query_match(const flow_query *query, const flow_key *key);
+
+void flow_query_free(flow_query *query);
+
+#endif /* __FLOW_INDEX_H__ */
@@ -0,0 +1,753 @@
+/* flow_index_test.c
+ * Tests for flow keys, flow index files and capture slicing
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_LIBPCAP
+#include <pcap.h>
+#endif
+
+#include <glib.h>
+
+#include <wsutil/file_util.h>
+
+#include "flow_index.h"
+#ifdef HAVE_LIBPCAP
+#include "capture_slice.h"
+#endif
+
+static char *capture_path;
+static char *index_path;
+
+/*
+ * Packet building
+ */
+
+static const guint8 mac_a[6] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+static const guint8 mac_b[6] = { 0x00, 0x66, 0x77, 0x88, 0x99, 0xaa };
+static const guint8 ip4_a[4] = { 10, 0, 0, 1 };
+static const guint8 ip4_b[4] = { 10, 0, 0, 2 };
+static const guint8 ip6_a[16] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+static const guint8 ip6_b[16] = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2 };
+
+static void
+put16(guint8 *p, guint16 v)
+{
+    p[0] = (guint8)(v >> 8);
+    p[1] = (guint8)v;
+}
+
+static guint
+build_eth(guint8 *p, const guint8 *src, const guint8 *dst, guint nvlans, guint16 ethertype)
+{
+    guint off = 12, i;
+
+    memcpy(p, dst, 6);
+    memcpy(p + 6, src, 6);
+    for (i = 0; i < nvlans; i++) {
+        put16(p + off, i == 0 && nvlans > 1 ? 0x88A8 : 0x8100);
+        put16(p + off + 2, (guint16)(100 + i));
+        off += 4;
+    }
+    put16(p + off, ethertype);
+    return off + 2;
+}
+
+static guint
+build_ipv4(guint8 *p, const guint8 *src, const guint8 *dst, guint8 proto, guint16 frag)
+{
+    memset(p, 0, 20);
+    p[0] = 0x45;
+    put16(p + 6, frag);
+    p[8] = 64;
+    p[9] = proto;
+    memcpy(p + 12, src, 4);
+    memcpy(p + 16, dst, 4);
+    return 20;
+}
+
+/* IPv6 header followed by a hop-by-hop and a destination options header */
+static guint
+build_ipv6(guint8 *p, const guint8 *src, const guint8 *dst, guint8 proto, gboolean ext)
+{
+    memset(p, 0, 40);
+    p[0] = 0x60;
+    p[6] = ext ? 0 : proto;
+    p[7] = 64;
+    memcpy(p + 8, src, 16);
+    memcpy(p + 24, dst, 16);
+    if (!ext)
+        return 40;
+    memset(p + 40, 0, 24);
+    p[40] = 60;         /* next: destination options */
+    p[41] = 0;          /* 8 bytes */
+    p[48] = proto;
+    p[49] = 1;          /* 16 bytes */
+    return 40 + 8 + 16;
+}
+
+static guint
+build_ports(guint8 *p, guint8 proto, guint16 sport, guint16 dport)
+{
+    guint len = proto == 6 ? 20 : 8;
+
+    memset(p, 0, len);
+    put16(p, sport);
+    put16(p + 2, dport);
+    if (proto == 6)
+        p[12] = 0x50;
+    return len;
+}
+
+/* ZEP header: version 1, version 2 data, or version 2 ack */
+static guint
+build_zep(guint8 *p, guint version, guint type)
+{
+    guint len = version == 1 ? 16 : (type == 2 ? 8 : 32);
+
+    memset(p, 0, len);
+    p[0] = 'E';
+    p[1] = 'X';
+    p[2] = (guint8)version;
+    p[3] = (guint8)type;
+    return len;
+}
+
+/* 802.15.4 data frame, short addresses and PAN ID compression */
+static guint
+build_wpan_short(guint8 *p, guint16 pan, guint16 src, guint16 dst)
+{
+    p[0] = 0x41;
+    p[1] = 0x88;
+    p[2] = 7;
+    p[3] = (guint8)pan;
+    p[4] = (guint8)(pan >> 8);
+    p[5] = (guint8)dst;
+    p[6] = (guint8)(dst >> 8);
+    p[7] = (guint8)src;
+    p[8] = (guint8)(src >> 8);
+    return 9;
+}
+
+/* Ethernet, IPv4, UDP to the ZEP port, ZEP, 802.15.4 */
+static guint
+build_zep_packet(guint8 *p, guint version, guint type)
+{
+    guint off;
+
+    off = build_eth(p, mac_a, mac_b, 0, 0x0800);
+    off += build_ipv4(p + off, ip4_a, ip4_b, 17, 0);
+    off += build_ports(p + off, 17, 40000, 17754);
+    off += build_zep(p + off, version, type);
+    off += build_wpan_short(p + off, 0x1234, 0x0001, 0x0002);
+    return off;
+}
+
+/*
+ * Flow keys
+ */
+
+static void
+test_key_ipv4(void)
+{
+    guint8   pkt[128];
+    flow_key k1, k2;
+    guint    off;
+
+    off = build_eth(pkt, mac_a, mac_b, 0, 0x0800);
+    off += build_ipv4(pkt + off, ip4_b, ip4_a, 6, 0);
+    off += build_ports(pkt + off, 6, 80, 1234);
+    g_assert(flow_key_from_packet(&k1, FLOW_LINK_ETHERNET, pkt, off));
+    g_assert(k1.type == FLOW_KEY_IPV4);
+    g_assert(k1.proto == 6);
+    g_assert(k1.addr_len[0] == 4 && k1.addr_len[1] == 4);
+    g_assert(memcmp(k1.addr[0], ip4_a, 4) == 0);
+    g_assert(k1.port[0] == 1234 && k1.port[1] == 80);
+
+    /* the other direction has the same key */
+    off = build_eth(pkt, mac_b, mac_a, 0, 0x0800);
+    off += build_ipv4(pkt + off, ip4_a, ip4_b, 6, 0);
+    off += build_ports(pkt + off, 6, 1234, 80);
+    g_assert(flow_key_from_packet(&k2, FLOW_LINK_ETHERNET, pkt, off));
+    g_assert(memcmp(&k1, &k2, sizeof k1) == 0);
+
+    /* too short for the ports */
+    g_assert(flow_key_from_packet(&k2, FLOW_LINK_ETHERNET, pkt, 14 + 20 + 4));
+    g_assert(k2.type == FLOW_KEY_IPV4 && k2.port[0] == 0 && k2.port[1] == 0);
+}
+
+static void
+test_key_vlan(void)
+{
+    guint8   pkt[128];
+    flow_key k0, k;
+    guint    off, nvlans;
+
+    off = build_eth(pkt, mac_a, mac_b, 0, 0x0800);
+    off += build_ipv4(pkt + off, ip4_a, ip4_b, 17, 0);
+    off += build_ports(pkt + off, 17, 5000, 53);
+    g_assert(flow_key_from_packet(&k0, FLOW_LINK_ETHERNET, pkt, off));
+
+    for (nvlans = 1; nvlans <= 2; nvlans++) {
+        off = build_eth(pkt, mac_a, mac_b, nvlans, 0x0800);
+        off += build_ipv4(pkt + off, ip4_a, ip4_b, 17, 0);
+        off += build_ports(pkt + off, 17, 5000, 53);
+        g_assert(flow_key_from_packet(&k, FLOW_LINK_ETHERNET, pkt, off));
+        g_assert(memcmp(&k0, &k, sizeof k) == 0);
+    }
+}
+
+static void
+test_key_l2(void)
+{
+    guint8   pkt[64];
+    flow_key k;
+    guint    off;
+
+    /* ARP */
+    off = build_eth(pkt, mac_b, mac_a, 1, 0x0806);
+    memset(pkt + off, 0, 28);
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_ETHERNET, pkt, off + 28));
+    g_assert(k.type == FLOW_KEY_L2);
+    g_assert(k.id == 0x0806);
+    g_assert(k.addr_len[0] == 6 && memcmp(k.addr[0], mac_a, 6) == 0);
+    g_assert(memcmp(k.addr[1], mac_b, 6) == 0);
+
+    g_assert(!flow_key_from_packet(&k, FLOW_LINK_ETHERNET, pkt, 13));
+}
+
+static void
+test_key_ipv6_ext(void)
+{
+    guint8   pkt[160];
+    flow_key k;
+    guint    off;
+
+    off = build_eth(pkt, mac_a, mac_b, 0, 0x86DD);
+    off += build_ipv6(pkt + off, ip6_a, ip6_b, 17, TRUE);
+    off += build_ports(pkt + off, 17, 546, 547);
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_ETHERNET, pkt, off));
+    g_assert(k.type == FLOW_KEY_IPV6);
+    g_assert(k.proto == 17);
+    g_assert(k.addr_len[0] == 16 && memcmp(k.addr[0], ip6_a, 16) == 0);
+    g_assert(k.port[0] == 546 && k.port[1] == 547);
+
+    /* raw IP gets the same key */
+    {
+        flow_key raw;
+
+        g_assert(flow_key_from_packet(&raw, FLOW_LINK_RAW_IP, pkt + 14, off - 14));
+        g_assert(memcmp(&k, &raw, sizeof k) == 0);
+    }
+}
+
+static void
+test_key_fragments(void)
+{
+    guint8   pkt[128];
+    flow_key first, later;
+    guint    off;
+
+    off = build_eth(pkt, mac_a, mac_b, 0, 0x0800);
+    off += build_ipv4(pkt + off, ip4_a, ip4_b, 17, 0x2000);    /* more fragments */
+    off += build_ports(pkt + off, 17, 5000, 5001);
+    g_assert(flow_key_from_packet(&first, FLOW_LINK_ETHERNET, pkt, off));
+    g_assert(first.port[0] == 5000);
+
+    /* a later fragment is indexed by its addresses and protocol only */
+    off = build_eth(pkt, mac_a, mac_b, 0, 0x0800);
+    off += build_ipv4(pkt + off, ip4_a, ip4_b, 17, 0x00b9);
+    off += build_ports(pkt + off, 17, 5000, 5001);
+    g_assert(flow_key_from_packet(&later, FLOW_LINK_ETHERNET, pkt, off));
+    g_assert(later.type == FLOW_KEY_IPV4 && later.proto == 17);
+    g_assert(later.port[0] == 0 && later.port[1] == 0);
+}
+
+static void
+test_key_linux_sll(void)
+{
+    guint8   pkt[128];
+    flow_key k;
+    guint    off;
+
+    memset(pkt, 0, 16);
+    put16(pkt + 14, 0x0800);
+    off = 16 + build_ipv4(pkt + 16, ip4_a, ip4_b, 6, 0);
+    off += build_ports(pkt + off, 6, 22, 40000);
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_LINUX_SLL, pkt, off));
+    g_assert(k.type == FLOW_KEY_IPV4 && k.port[0] == 22);
+
+    /* not IP */
+    put16(pkt + 14, 0x0806);
+    g_assert(!flow_key_from_packet(&k, FLOW_LINK_LINUX_SLL, pkt, off));
+}
+
+static void
+test_key_zep(void)
+{
+    guint8   pkt[160];
+    flow_key k;
+    guint    len;
+
+    len = build_zep_packet(pkt, 1, 0);
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_ETHERNET, pkt, len));
+    g_assert(k.type == FLOW_KEY_WPAN);
+    g_assert(k.id == 0x1234);
+    g_assert(k.addr_len[0] == 2 && k.addr[0][0] == 0x01);
+    g_assert(k.addr_len[1] == 2 && k.addr[1][0] == 0x02);
+
+    len = build_zep_packet(pkt, 2, 1);
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_ETHERNET, pkt, len));
+    g_assert(k.type == FLOW_KEY_WPAN && k.id == 0x1234);
+
+    /* a ZEP ack has no 802.15.4 frame; the UDP flow it is */
+    len = build_zep_packet(pkt, 2, 2);
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_ETHERNET, pkt, len));
+    g_assert(k.type == FLOW_KEY_IPV4 && k.proto == 17);
+    g_assert(k.port[0] == 17754 || k.port[1] == 17754);
+}
+
+static void
+test_key_wpan(void)
+{
+    /* short addresses, PAN ID compression */
+    static const guint8 short_short[] = {
+        0x41, 0x88, 0x01, 0x34, 0x12, 0x02, 0x00, 0x01, 0x00
+    };
+    /* short destination, extended source, both PAN IDs */
+    static const guint8 short_ext[] = {
+        0x01, 0xc8, 0x01, 0x34, 0x12, 0xff, 0xff, 0x78, 0x56,
+        0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08
+    };
+    /* no destination, short source */
+    static const guint8 none_short[] = {
+        0x01, 0x80, 0x01, 0x78, 0x56, 0x09, 0x00
+    };
+    /* 2015 frame without a sequence number */
+    static const guint8 no_seq[] = {
+        0x41, 0xa9, 0x34, 0x12, 0x02, 0x00, 0x01, 0x00
+    };
+    /* reserved destination addressing mode */
+    static const guint8 reserved[] = {
+        0x41, 0x84, 0x01, 0x34, 0x12, 0x02, 0x00, 0x01, 0x00
+    };
+    /* no addresses at all */
+    static const guint8 no_addr[] = { 0x02, 0x00, 0x01 };
+    flow_key k, k2;
+
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_IEEE802_15_4, short_short, sizeof short_short));
+    g_assert(k.type == FLOW_KEY_WPAN && k.id == 0x1234);
+    g_assert(k.addr_len[0] == 2 && k.addr_len[1] == 2);
+
+    g_assert(flow_key_from_packet(&k2, FLOW_LINK_IEEE802_15_4, no_seq, sizeof no_seq));
+    g_assert(memcmp(&k, &k2, sizeof k) == 0);
+
+    /* the destination PAN ID is the one kept */
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_IEEE802_15_4, short_ext, sizeof short_ext));
+    g_assert(k.id == 0x1234);
+    g_assert(k.addr_len[0] == 2 && k.addr_len[1] == 8);
+    g_assert(memcmp(k.addr[1], short_ext + 9, 8) == 0);
+    g_assert(!flow_key_from_packet(&k, FLOW_LINK_IEEE802_15_4, short_ext, sizeof short_ext - 1));
+
+    g_assert(flow_key_from_packet(&k, FLOW_LINK_IEEE802_15_4, none_short, sizeof none_short));
+    g_assert(k.id == 0x5678);
+    g_assert(k.addr_len[0] == 0 && k.addr_len[1] == 2);
+
+    g_assert(!flow_key_from_packet(&k, FLOW_LINK_IEEE802_15_4, reserved, sizeof reserved));
+    g_assert(!flow_key_from_packet(&k, FLOW_LINK_IEEE802_15_4, no_addr, sizeof no_addr));
+    g_assert(!flow_key_from_packet(&k, FLOW_LINK_IEEE802_15_4, short_short, 2));
+}
+
+/*
+ * Flow index files
+ */
+
+static flow_key
+make_key(guint32 n)
+{
+    flow_key key;
+
+    memset(&key, 0, sizeof key);
+    key.type = FLOW_KEY_IPV4;
+    key.proto = 17;
+    key.addr_len[0] = key.addr_len[1] = 4;
+    memcpy(key.addr[0], ip4_a, 4);
+    memcpy(key.addr[1], ip4_b, 4);
+    key.port[0] = (guint16)(n >> 16);
+    key.port[1] = (guint16)n;
+    return key;
+}
+
+static void
+test_index_round_trip(void)
+{
+    flow_index       *fi;
+    GPtrArray        *entries;
+    flow_index_entry *e;
+    flow_key          k0 = make_key(0), k1 = make_key(1);
+    int               err;
+
+    fi = flow_index_new();
+    /* two packets close together, then one far away */
+    flow_index_add(fi, &k0, 100, 50, 60, G_GUINT64_CONSTANT(2000000000));
+    flow_index_add(fi, &k1, 150, 40, 40, G_GUINT64_CONSTANT(1000000000));
+    flow_index_add(fi, &k0, 190, 50, 60, G_GUINT64_CONSTANT(3000000000));
+    flow_index_add(fi, &k0, 1000000, 50, 1500, G_GUINT64_CONSTANT(1500000000));
+    g_assert(flow_index_write(fi, capture_path, &err));
+
+    g_assert(flow_index_read(capture_path, &entries, &err));
+    g_assert(entries->len == 2);
+    e = (flow_index_entry *)g_ptr_array_index(entries, 0);
+    g_assert(memcmp(&e->key, &k0, sizeof k0) == 0);
+    g_assert(e->packets == 3);
+    g_assert(e->bytes == 1620);
+    g_assert(e->first_ts == G_GUINT64_CONSTANT(1500000000));
+    g_assert(e->last_ts == G_GUINT64_CONSTANT(3000000000));
+    g_assert(e->nranges == 2);
+    g_assert(e->ranges[0] == 100 && e->ranges[1] == 240);
+    g_assert(e->ranges[2] == 1000000 && e->ranges[3] == 1000050);
+    e = (flow_index_entry *)g_ptr_array_index(entries, 1);
+    g_assert(memcmp(&e->key, &k1, sizeof k1) == 0);
+    g_assert(e->packets == 1 && e->nranges == 1);
+    flow_index_entries_free(entries);
+
+    /* writing empties the index */
+    g_assert(flow_index_write(fi, capture_path, &err));
+    g_assert(flow_index_read(capture_path, &entries, &err));
+    g_assert(entries->len == 0);
+    flow_index_entries_free(entries);
+    flow_index_free(fi);
+
+    /* a compressed file uses the index of the uncompressed one */
+    {
+        char *gz_path = g_strdup_printf("%s.gz", capture_path);
+
+        g_assert(flow_index_read(gz_path, &entries, &err));
+        flow_index_entries_free(entries);
+        g_free(gz_path);
+    }
+
+    ws_unlink(index_path);
+    g_assert(!flow_index_read(capture_path, &entries, &err));
+    g_assert(err == ENOENT);
+}
+
+static void
+test_index_max_flows(void)
+{
+    flow_index       *fi;
+    GPtrArray        *entries;
+    flow_index_entry *e;
+    flow_query       *query;
+    flow_key          key;
+    char             *err_msg = NULL;
+    gchar            *str;
+    guint32           i;
+    int               err;
+
+    fi = flow_index_new();
+    for (i = 0; i < FLOW_INDEX_MAX_FLOWS + 10; i++) {
+        key = make_key(i);
+        flow_index_add(fi, &key, 100 * (guint64)i, 100, 100, i);
+    }
+    /* a flow that made it in still gets its own packets */
+    key = make_key(0);
+    flow_index_add(fi, &key, 100 * (guint64)i, 100, 100, i);
+    g_assert(flow_index_write(fi, capture_path, &err));
+    flow_index_free(fi);
+
+    g_assert(flow_index_read(capture_path, &entries, &err));
+    g_assert(entries->len == FLOW_INDEX_MAX_FLOWS + 1);
+    e = (flow_index_entry *)g_ptr_array_index(entries, 0);
+    g_assert(e->packets == 2);
+    e = (flow_index_entry *)g_ptr_array_index(entries, FLOW_INDEX_MAX_FLOWS);
+    g_assert(e->key.type == FLOW_KEY_OTHER);
+    g_assert(e->packets == 10);
+    g_assert(e->first_ts == FLOW_INDEX_MAX_FLOWS);
+    g_assert(e->nranges == 1);
+
+    /* whatever's asked for might be in there */
+    query = flow_query_new("host=192.0.2.1,port=443", &err_msg);
+    g_assert(query != NULL);
+    g_assert(flow_query_match(query, &e->key));
+    flow_query_free(query);
+    str = flow_key_to_str(&e->key);
+    g_assert(strcmp(str, "other flows") == 0);
+    g_free(str);
+
+    flow_index_entries_free(entries);
+    ws_unlink(index_path);
+}
+
+static void
+write_raw_index(const guint8 *data, size_t len)
+{
+    FILE *fh;
+
+    fh = ws_fopen(index_path, "wb");
+    g_assert(fh != NULL);
+    g_assert(fwrite(data, 1, len, fh) == len);
+    fclose(fh);
+}
+
+static void
+test_index_malformed(void)
+{
+    guint8     buf[16 + 84 + 16];
+    GPtrArray *entries;
+    int        err;
+
+    /* a good index with one flow and one range */
+    memset(buf, 0, sizeof buf);
+    memcpy(buf, "WSFI", 4);
+    buf[4] = 1;
+    buf[8] = 1;
+    buf[16] = FLOW_KEY_IPV4;
+    buf[16 + 44 + 32] = 1;
+    write_raw_index(buf, sizeof buf);
+    g_assert(flow_index_read(capture_path, &entries, &err));
+    g_assert(entries->len == 1);
+    flow_index_entries_free(entries);
+
+    /* bad magic */
+    buf[0] = 'X';
+    write_raw_index(buf, sizeof buf);
+    err = -1;
+    g_assert(!flow_index_read(capture_path, &entries, &err));
+    g_assert(err == 0 && entries == NULL);
+    buf[0] = 'W';
+
+    /* unknown version */
+    buf[4] = 2;
+    write_raw_index(buf, sizeof buf);
+    g_assert(!flow_index_read(capture_path, &entries, &err));
+    g_assert(err == 0);
+    buf[4] = 1;
+
+    /* short header */
+    write_raw_index(buf, 10);
+    g_assert(!flow_index_read(capture_path, &entries, &err));
+    g_assert(err == 0);
+
+    /* more flows than there are */
+    buf[8] = 2;
+    write_raw_index(buf, sizeof buf);
+    g_assert(!flow_index_read(capture_path, &entries, &err));
+    g_assert(err == 0);
+    buf[8] = 1;
+
+    /* cut short in the ranges */
+    write_raw_index(buf, sizeof buf - 1);
+    g_assert(!flow_index_read(capture_path, &entries, &err));
+    g_assert(err == 0);
+
+    /* absurd number of ranges */
+    memset(buf + 16 + 44 + 32, 0xff, 4);
+    write_raw_index(buf, sizeof buf);
+    g_assert(!flow_index_read(capture_path, &entries, &err));
+    g_assert(err == 0);
+
+    ws_unlink(index_path);
+}
+
+static void
+test_query(void)
+{
+    flow_query *query;
+    flow_key    key = make_key(53);
+    char       *err_msg = NULL;
+
+    query = flow_query_new("host=10.0.0.2,port=53,proto=udp", &err_msg);
+    g_assert(query != NULL);
+    g_assert(flow_query_match(query, &key));
+    key.proto = 6;
+    g_assert(!flow_query_match(query, &key));
+    flow_query_free(query);
+
+    g_assert(flow_query_new("host", &err_msg) == NULL);
+    g_free(err_msg);
+    err_msg = NULL;
+    g_assert(flow_query_new("port=65536", &err_msg) == NULL);
+    g_free(err_msg);
+    err_msg = NULL;
+    g_assert(flow_query_new("color=red", &err_msg) == NULL);
+    g_free(err_msg);
+}
+
+#ifdef HAVE_LIBPCAP
+/*
+ * Slicing
+ */
+
+static guint32
+slice_len(const char *spec, int linktype, const guint8 *pd, guint32 caplen)
+{
+    capture_slice *slice;
+    char          *err_msg = NULL;
+    guint32        len;
+
+    slice = capture_slice_new(spec, &err_msg);
+    g_assert(slice != NULL);
+    len = capture_slice_len(slice, linktype, pd, caplen);
+    capture_slice_free(slice);
+    return len;
+}
+
+static void
+test_slice_spec(void)
+{
+    static const char *bad[] = {
+        "", "tcp", "foo:1", "tcp:", "tcp:-1", "tcp:x", "tcp:1,udp"
+    };
+    char  *err_msg;
+    guint  i;
+
+    for (i = 0; i < G_N_ELEMENTS(bad); i++) {
+        err_msg = NULL;
+        g_assert(capture_slice_new(bad[i], &err_msg) == NULL);
+        g_assert(err_msg != NULL);
+        g_free(err_msg);
+    }
+}
+
+static void
+test_slice_len(void)
+{
+    guint8 pkt[256];
+    guint  off;
+
+    /* Ethernet, IPv4, TCP, 100 bytes of payload */
+    off = build_eth(pkt, mac_a, mac_b, 0, 0x0800);
+    off += build_ipv4(pkt + off, ip4_a, ip4_b, 6, 0);
+    off += build_ports(pkt + off, 6, 1234, 80);
+    memset(pkt + off, 0, 100);
+    off += 100;
+    g_assert(slice_len("tcp:0", DLT_EN10MB, pkt, off) == 54);
+    g_assert(slice_len("tcp:10", DLT_EN10MB, pkt, off) == 64);
+    g_assert(slice_len("ip:8", DLT_EN10MB, pkt, off) == 42);
+    g_assert(slice_len("link:0", DLT_EN10MB, pkt, off) == 14);
+    g_assert(slice_len("ip:8,tcp:0", DLT_EN10MB, pkt, off) == 54);
+    g_assert(slice_len("udp:0", DLT_EN10MB, pkt, off) == off);
+    g_assert(slice_len("tcp:1000", DLT_EN10MB, pkt, off) == off);
+    g_assert(slice_len("tcp:0", DLT_EN10MB, pkt, 40) == 40);
+    g_assert(slice_len("tcp:0", DLT_NULL, pkt, off) == off);
+    g_assert(slice_len("ip:0", DLT_RAW, pkt + 14, off - 14) == 20);
+
+    /* the same, VLAN-tagged twice */
+    off = build_eth(pkt, mac_a, mac_b, 2, 0x0800);
+    off += build_ipv4(pkt + off, ip4_a, ip4_b, 6, 0);
+    off += build_ports(pkt + off, 6, 1234, 80);
+    memset(pkt + off, 0, 100);
+    off += 100;
+    g_assert(slice_len("tcp:0", DLT_EN10MB, pkt, off) == 62);
+    g_assert(slice_len("link:0", DLT_EN10MB, pkt, off) == 22);
+
+    /* a later fragment has no TCP header */
+    off = build_eth(pkt, mac_a, mac_b, 0, 0x0800);
+    off += build_ipv4(pkt + off, ip4_a, ip4_b, 6, 0x00b9);
+    memset(pkt + off, 0, 100);
+    off += 100;
+    g_assert(slice_len("tcp:0", DLT_EN10MB, pkt, off) == off);
+    g_assert(slice_len("tcp:0,ip:0", DLT_EN10MB, pkt, off) == 34);
+
+    /* IPv6 with extension headers, UDP */
+    off = build_eth(pkt, mac_a, mac_b, 0, 0x86DD);
+    off += build_ipv6(pkt + off, ip6_a, ip6_b, 17, TRUE);
+    off += build_ports(pkt + off, 17, 546, 547);
+    memset(pkt + off, 0, 50);
+    off += 50;
+    g_assert(slice_len("udp:0", DLT_EN10MB, pkt, off) == 14 + 64 + 8);
+    g_assert(slice_len("ip:0", DLT_EN10MB, pkt, off) == 14 + 64);
+
+    /* ZEP */
+    off = build_zep_packet(pkt, 1, 0);
+    g_assert(slice_len("zep:0", DLT_EN10MB, pkt, off) == 14 + 20 + 8 + 16);
+    g_assert(slice_len("udp:0,zep:5", DLT_EN10MB, pkt, off) == 14 + 20 + 8 + 16 + 5);
+    off = build_zep_packet(pkt, 2, 1);
+    g_assert(slice_len("zep:0", DLT_EN10MB, pkt, off) == 14 + 20 + 8 + 32);
+    off = build_zep_packet(pkt, 2, 2);
+    g_assert(slice_len("zep:0", DLT_EN10MB, pkt, off) == 14 + 20 + 8 + 8);
+    off = build_zep_packet(pkt, 3, 0);
+    g_assert(slice_len("zep:0", DLT_EN10MB, pkt, off) == off);
+    g_assert(slice_len("zep:0,udp:0", DLT_EN10MB, pkt, off) == 14 + 20 + 8);
+}
+#endif /* HAVE_LIBPCAP */
+
+int
+main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    capture_path = g_strdup_printf("%s" G_DIR_SEPARATOR_S "flow_index_test.%d.pcapng",
+                                   g_get_tmp_dir(), (int)getpid());
+    index_path = g_strconcat(capture_path, FLOW_INDEX_SUFFIX, NULL);
+
+    g_test_add_func("/flow_index/key/ipv4",        test_key_ipv4);
+    g_test_add_func("/flow_index/key/vlan",        test_key_vlan);
+    g_test_add_func("/flow_index/key/l2",          test_key_l2);
+    g_test_add_func("/flow_index/key/ipv6_ext",    test_key_ipv6_ext);
+    g_test_add_func("/flow_index/key/fragments",   test_key_fragments);
+    g_test_add_func("/flow_index/key/linux_sll",   test_key_linux_sll);
+    g_test_add_func("/flow_index/key/zep",         test_key_zep);
+    g_test_add_func("/flow_index/key/wpan",        test_key_wpan);
+
+    g_test_add_func("/flow_index/file/round_trip", test_index_round_trip);
+    g_test_add_func("/flow_index/file/max_flows",  test_index_max_flows);
+    g_test_add_func("/flow_index/file/malformed",  test_index_malformed);
+    g_test_add_func("/flow_index/query",           test_query);
+
+#ifdef HAVE_LIBPCAP
+    g_test_add_func("/capture_slice/spec",         test_slice_spec);
+    g_test_add_func("/capture_slice/len",          test_slice_len);
+#endif
+
+    ret = g_test_run();
+
+    ws_unlink(index_path);
+    g_free(index_path);
+    g_free(capture_path);
+
+    return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
@@ -38,6 +38,11 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+/* O_DIRECT isn't defined on Linux without this */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "config.h"
 
 #include <stdlib.h>
@@ -47,12 +52,23 @@
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 #ifdef _WIN32
 #include <Windows.h>
 #endif
 
 #include <glib.h>
 
+#include <wsutil/file_util.h>
+
 #include "pcapio.h"
 
 /* Magic numbers in "libpcap" files.
@@ -176,22 +192,365 @@ struct option {
 #define ISB_USRDELIV      8
 #define ADD_PADDING(x) ((((x) + 3) >> 2) << 2)
 
+/*
+ * Output streams.
+ *
+ * Blocks are copied into a large buffer, aligned so that it can be
+ * handed to the kernel with O_DIRECT, and each buffer is written out
+ * with a single write call once it's full, rather than doing a
+ * stdio call for each piece of each block.
+ *
+ * With PCAPIO_WRITER_THREADED, there are two buffers; while one of them
+ * is being filled, a separate thread writes the other one out, so that
+ * the caller only has to wait for the disk if it has filled a buffer
+ * before the previous one has been written.
+ *
+ * With PCAPIO_WRITER_DIRECT, the buffers are written with O_DIRECT,
+ * which requires the file offset and length of each write to be a
+ * multiple of the device block size.  Full buffers always are; when
+ * a partially-filled buffer has to be flushed, the part of it that
+ * isn't a multiple of PCAPIO_WRITER_ALIGN is written with O_DIRECT
+ * turned off, and is kept at the beginning of the buffer so that it's
+ * written again, along with what follows it, when the buffer is next
+ * written.
+ */
+#define PCAPIO_WRITER_ALIGN     4096
+
+#if GLIB_CHECK_VERSION(2,32,0)
+#define PCAPIO_WRITER_USE_THREADS
+#endif
+
+struct pcapio_writer {
+        int       fd;
+        guint     flags;        /* PCAPIO_WRITER_ flags actually in effect */
+        guint8   *mem[2];       /* buffers, as allocated */
+        guint8   *buf[2];       /* buffers, aligned to PCAPIO_WRITER_ALIGN */
+        size_t    size;         /* size of each buffer */
+        int       cur;          /* index of the buffer being filled */
+        size_t    used;         /* number of bytes in that buffer */
+        gint64    offset;       /* file offset of the first byte in it */
+        int       err;          /* first error seen, if any */
+#ifdef PCAPIO_WRITER_USE_THREADS
+        GThread  *thread;
+        GMutex    mtx;
+        GCond     cond;
+        guint8   *pending;      /* buffer handed to the thread, or NULL */
+        size_t    pending_len;
+        gint64    pending_offset;
+        int       pending_err;  /* error seen by the thread, if any */
+        gboolean  quit;
+#endif
+};
+
+/* Write all of a buffer, at the given offset if doing direct I/O.
+   Returns 0 on success or an errno value on failure. */
+static int
+pcapio_write_all(pcapio_writer *pw, const guint8 *data, size_t len,
+                 gint64 offset)
+{
+        gssize nwritten;
+
+        while (len != 0) {
+#ifdef O_DIRECT
+                if (pw->flags & PCAPIO_WRITER_DIRECT)
+                        nwritten = pwrite(pw->fd, data, len, (off_t)offset);
+                else
+#endif
+                        nwritten = ws_write(pw->fd, data, (unsigned int)len);
+                if (nwritten < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return errno;
+                }
+                if (nwritten == 0) {
+                        /* Shouldn't happen for a regular file unless the
+                           disk is full. */
+                        return ENOSPC;
+                }
+                data += nwritten;
+                len -= nwritten;
+                offset += nwritten;
+        }
+        return 0;
+}
+
+/* Write out a buffer; see the comment above for direct I/O.
+   Returns 0 on success or an errno value on failure. */
+static int
+pcapio_write_buffer(pcapio_writer *pw, const guint8 *data, size_t len,
+                    gint64 offset)
+{
+#ifdef O_DIRECT
+        if (pw->flags & PCAPIO_WRITER_DIRECT) {
+                size_t aligned = len & ~(size_t)(PCAPIO_WRITER_ALIGN - 1);
+                int    fl, err;
+
+                err = pcapio_write_all(pw, data, aligned, offset);
+                if (err != 0 || aligned == len)
+                        return err;
+                fl = fcntl(pw->fd, F_GETFL);
+                if (fl == -1 || fcntl(pw->fd, F_SETFL, fl & ~O_DIRECT) == -1)
+                        return errno;
+                err = pcapio_write_all(pw, data + aligned, len - aligned,
+                                       offset + aligned);
+                if (fcntl(pw->fd, F_SETFL, fl) == -1 && err == 0)
+                        err = errno;
+                return err;
+        }
+#endif
+        return pcapio_write_all(pw, data, len, offset);
+}
+
+#ifdef PCAPIO_WRITER_USE_THREADS
+static gpointer
+pcapio_writer_thread(gpointer arg)
+{
+        pcapio_writer *pw = (pcapio_writer *)arg;
+        int            err;
+
+        g_mutex_lock(&pw->mtx);
+        for (;;) {
+                while (pw->pending == NULL && !pw->quit)
+                        g_cond_wait(&pw->cond, &pw->mtx);
+                if (pw->pending == NULL)
+                        break;
+                g_mutex_unlock(&pw->mtx);
+                err = pcapio_write_buffer(pw, pw->pending, pw->pending_len,
+                                          pw->pending_offset);
+                g_mutex_lock(&pw->mtx);
+                if (err != 0 && pw->pending_err == 0)
+                        pw->pending_err = err;
+                pw->pending = NULL;
+                g_cond_broadcast(&pw->cond);
+        }
+        g_mutex_unlock(&pw->mtx);
+        return NULL;
+}
+
+/* Wait for the thread to finish writing the buffer it was handed,
+   if any, and pick up any error it saw. */
+static void
+pcapio_writer_wait(pcapio_writer *pw)
+{
+        g_mutex_lock(&pw->mtx);
+        while (pw->pending != NULL)
+                g_cond_wait(&pw->cond, &pw->mtx);
+        if (pw->err == 0)
+                pw->err = pw->pending_err;
+        g_mutex_unlock(&pw->mtx);
+}
+#endif
+
+/* Write out the first "len" bytes of the buffer being filled, which
+   start at pw->offset, and switch to the other buffer if we have two.
+   Returns FALSE, with pw->err set, if an error has been seen. */
+static gboolean
+pcapio_writer_submit(pcapio_writer *pw, size_t len)
+{
+        int err;
+
+#ifdef PCAPIO_WRITER_USE_THREADS
+        if (pw->flags & PCAPIO_WRITER_THREADED) {
+                pcapio_writer_wait(pw);
+                if (pw->err != 0)
+                        return FALSE;
+                g_mutex_lock(&pw->mtx);
+                pw->pending = pw->buf[pw->cur];
+                pw->pending_len = len;
+                pw->pending_offset = pw->offset;
+                g_cond_signal(&pw->cond);
+                g_mutex_unlock(&pw->mtx);
+                pw->cur ^= 1;
+                return TRUE;
+        }
+#endif
+        if (pw->err != 0)
+                return FALSE;
+        err = pcapio_write_buffer(pw, pw->buf[pw->cur], len, pw->offset);
+        if (err != 0) {
+                pw->err = err;
+                return FALSE;
+        }
+        return TRUE;
+}
+
+pcapio_writer *
+pcapio_writer_fdopen(int fd, size_t buffer_size, guint flags, int *err)
+{
+        pcapio_writer *pw;
+        int            i;
+
+        if (buffer_size == 0)
+                buffer_size = PCAPIO_DEFAULT_BUFFER_SIZE;
+        buffer_size = (buffer_size + PCAPIO_WRITER_ALIGN - 1) &
+            ~(size_t)(PCAPIO_WRITER_ALIGN - 1);
+
+        pw = g_new0(pcapio_writer, 1);
+        pw->fd = fd;
+        pw->size = buffer_size;
+        pw->flags = flags;
+#ifndef PCAPIO_WRITER_USE_THREADS
+        pw->flags &= ~PCAPIO_WRITER_THREADED;
+#endif
+#ifdef O_DIRECT
+        if (pw->flags & PCAPIO_WRITER_DIRECT) {
+                ws_statb64 statb;
+                int        fl;
+
+                /* O_DIRECT only makes sense for regular files, and not
+                   all file systems support it. */
+                pw->flags &= ~PCAPIO_WRITER_DIRECT;
+                pw->offset = ws_lseek64(fd, 0, SEEK_CUR);
+                if (ws_fstat64(fd, &statb) == 0 && S_ISREG(statb.st_mode) &&
+                    pw->offset >= 0 &&
+                    (pw->offset & (PCAPIO_WRITER_ALIGN - 1)) == 0 &&
+                    (fl = fcntl(fd, F_GETFL)) != -1 &&
+                    fcntl(fd, F_SETFL, fl | O_DIRECT) != -1)
+                        pw->flags |= PCAPIO_WRITER_DIRECT;
+        }
+#else
+        pw->flags &= ~PCAPIO_WRITER_DIRECT;
+#endif
+        if (!(pw->flags & PCAPIO_WRITER_DIRECT))
+                pw->offset = 0;    /* not used */
+
+        for (i = 0; i < ((pw->flags & PCAPIO_WRITER_THREADED) ? 2 : 1); i++) {
+                pw->mem[i] = (guint8 *)g_try_malloc(buffer_size + PCAPIO_WRITER_ALIGN - 1);
+                if (pw->mem[i] == NULL) {
+                        g_free(pw->mem[0]);
+                        g_free(pw);
+                        *err = ENOMEM;
+                        return NULL;
+                }
+                pw->buf[i] = (guint8 *)(((gsize)pw->mem[i] + PCAPIO_WRITER_ALIGN - 1) &
+                    ~(gsize)(PCAPIO_WRITER_ALIGN - 1));
+        }
+
+#ifdef PCAPIO_WRITER_USE_THREADS
+        if (pw->flags & PCAPIO_WRITER_THREADED) {
+                g_mutex_init(&pw->mtx);
+                g_cond_init(&pw->cond);
+                pw->thread = g_thread_try_new("pcapio writer",
+                                              pcapio_writer_thread, pw, NULL);
+                if (pw->thread == NULL) {
+                        /* Just write from the caller's thread. */
+                        g_mutex_clear(&pw->mtx);
+                        g_cond_clear(&pw->cond);
+                        pw->flags &= ~PCAPIO_WRITER_THREADED;
+                }
+        }
+#endif
+        return pw;
+}
+
+guint
+pcapio_writer_get_flags(pcapio_writer *pw)
+{
+        return pw->flags;
+}
+
+gboolean
+pcapio_writer_flush(pcapio_writer *pw, int *err)
+{
+        size_t   keep = 0;
+        guint8  *old = pw->buf[pw->cur];
+
+        if (pw->used != 0) {
+                if (pw->flags & PCAPIO_WRITER_DIRECT)
+                        keep = pw->used & (PCAPIO_WRITER_ALIGN - 1);
+                if (!pcapio_writer_submit(pw, pw->used)) {
+                        *err = pw->err;
+                        return FALSE;
+                }
+        }
+#ifdef PCAPIO_WRITER_USE_THREADS
+        if (pw->flags & PCAPIO_WRITER_THREADED)
+                pcapio_writer_wait(pw);
+#endif
+        if (pw->err != 0) {
+                *err = pw->err;
+                return FALSE;
+        }
+        if (keep != 0)
+                memmove(pw->buf[pw->cur], old + pw->used - keep, keep);
+        pw->offset += pw->used - keep;
+        pw->used = keep;
+        return TRUE;
+}
+
+gboolean
+pcapio_writer_sync(pcapio_writer *pw, int *err)
+{
+        if (!pcapio_writer_flush(pw, err))
+                return FALSE;
+#ifdef _WIN32
+        if (_commit(pw->fd) == -1) {
+#else
+        if (fsync(pw->fd) == -1) {
+#endif
+                *err = errno;
+                return FALSE;
+        }
+        return TRUE;
+}
+
+gboolean
+pcapio_writer_close(pcapio_writer *pw, int *err)
+{
+        gboolean ret;
+        int      close_err = 0;
+
+        ret = pcapio_writer_flush(pw, err);
+#ifdef PCAPIO_WRITER_USE_THREADS
+        if (pw->flags & PCAPIO_WRITER_THREADED) {
+                g_mutex_lock(&pw->mtx);
+                pw->quit = TRUE;
+                g_cond_signal(&pw->cond);
+                g_mutex_unlock(&pw->mtx);
+                g_thread_join(pw->thread);
+                g_mutex_clear(&pw->mtx);
+                g_cond_clear(&pw->cond);
+        }
+#endif
+        if (ws_close(pw->fd) == -1)
+                close_err = errno;
+        if (ret && close_err != 0) {
+                *err = close_err;
+                ret = FALSE;
+        }
+        g_free(pw->mem[0]);
+        g_free(pw->mem[1]);
+        g_free(pw);
+        return ret;
+}
+
 /* Write to capture file */
 static gboolean
-write_to_file(FILE* pfile, const guint8* data, size_t data_length,
+write_to_file(pcapio_writer* pfile, const guint8* data, size_t data_length,
               guint64 *bytes_written, int *err)
 {
-        size_t nwritten;
-
-        nwritten = fwrite(data, data_length, 1, pfile);
-        if (nwritten != 1) {
-                if (ferror(pfile)) {
-                        *err = errno;
-                } else {
-                        *err = 0;
-                }
+        size_t left = data_length;
+        size_t n;
+
+        if (pfile->err != 0) {
+                *err = pfile->err;
                 return FALSE;
         }
+        while (left != 0) {
+                n = MIN(pfile->size - pfile->used, left);
+                memcpy(pfile->buf[pfile->cur] + pfile->used, data, n);
+                pfile->used += n;
+                data += n;
+                left -= n;
+                if (pfile->used == pfile->size) {
+                        if (!pcapio_writer_submit(pfile, pfile->size)) {
+                                *err = pfile->err;
+                                return FALSE;
+                        }
+                        pfile->offset += pfile->size;
+                        pfile->used = 0;
+                }
+        }
 
         (*bytes_written) += data_length;
         return TRUE;
@@ -203,7 +562,7 @@ write_to_file(FILE* pfile, const guint8* data, size_t data_length,
    Returns TRUE on success, FALSE on failure.
    Sets "*err" to an error code, or 0 for a short write, on failure*/
 gboolean
-libpcap_write_file_header(FILE* pfile, int linktype, int snaplen, gboolean ts_nsecs, guint64 *bytes_written, int *err)
+libpcap_write_file_header(pcapio_writer* pfile, int linktype, int snaplen, gboolean ts_nsecs, guint64 *bytes_written, int *err)
 {
         struct pcap_hdr file_hdr;
 
@@ -222,7 +581,7 @@ libpcap_write_file_header(FILE* pfile, int linktype, int snaplen, gboolean ts_ns
 /* Write a record for a packet to a dump file.
    Returns TRUE on success, FALSE on failure. */
 gboolean
-libpcap_write_packet(FILE* pfile,
+libpcap_write_packet(pcapio_writer* pfile,
                      time_t sec, guint32 usec,
                      guint32 caplen, guint32 len,
                      const guint8 *pd,
@@ -254,7 +613,7 @@ pcapng_count_string_option(const char *option_value)
 }
 
 static gboolean
-pcapng_write_string_option(FILE* pfile,
+pcapng_write_string_option(pcapio_writer* pfile,
                            guint16 option_type, const char *option_value,
                            guint64 *bytes_written, int *err)
 {
@@ -285,7 +644,7 @@ pcapng_write_string_option(FILE* pfile,
 }
 
 gboolean
-pcapng_write_session_header_block(FILE* pfile,
+pcapng_write_session_header_block(pcapio_writer* pfile,
                                   const char *comment,
                                   const char *hw,
                                   const char *os,
@@ -349,7 +708,7 @@ pcapng_write_session_header_block(FILE* pfile,
 }
 
 gboolean
-pcapng_write_interface_description_block(FILE* pfile,
+pcapng_write_interface_description_block(pcapio_writer* pfile,
                                          const char *comment, /* OPT_COMMENT        1 */
                                          const char *name,    /* IDB_NAME           2 */
                                          const char *descr,   /* IDB_DESCRIPTION    3 */
@@ -499,7 +858,7 @@ pcapng_write_interface_description_block(FILE* pfile,
 /* Write a record for a packet to a dump file.
    Returns TRUE on success, FALSE on failure. */
 gboolean
-pcapng_write_enhanced_packet_block(FILE* pfile,
+pcapng_write_enhanced_packet_block(pcapio_writer* pfile,
                                    const char *comment,
                                    time_t sec, guint32 usec,
                                    guint32 caplen, guint32 len,
@@ -539,6 +898,30 @@ pcapng_write_enhanced_packet_block(FILE* pfile,
         epb.timestamp_low = (guint32)(timestamp & 0xffffffff);
         epb.captured_len = caplen;
         epb.packet_len = len;
+
+        /* A block without options that fits in what's left of the
+           buffer is built right there, so that a run of packets ends up
+           as EPBs laid out back to back in one buffer, written out with
+           a single call, without going through write_to_file() for each
+           of their fields. */
+        if (options_length == 0 && pfile->err == 0 &&
+            pfile->size - pfile->used > block_total_length) {
+                guint8 *p = pfile->buf[pfile->cur] + pfile->used;
+
+                memcpy(p, &epb, sizeof(struct epb));
+                p += sizeof(struct epb);
+                memcpy(p, pd, caplen);
+                p += caplen;
+                if (caplen % 4) {
+                        memset(p, 0, 4 - caplen % 4);
+                        p += 4 - caplen % 4;
+                }
+                memcpy(p, &block_total_length, sizeof(guint32));
+                pfile->used += block_total_length;
+                *bytes_written += block_total_length;
+                return TRUE;
+        }
+
         if (!write_to_file(pfile, (const guint8*)&epb, sizeof(struct epb), bytes_written, err))
                 return FALSE;
         if (!write_to_file(pfile, pd, caplen, bytes_written, err))
@@ -570,7 +953,7 @@ pcapng_write_enhanced_packet_block(FILE* pfile,
 }
 
 gboolean
-pcapng_write_interface_statistics_block(FILE* pfile,
+pcapng_write_interface_statistics_block(pcapio_writer* pfile,
                                         guint32 interface_id,
                                         guint64 *bytes_written,
                                         const char *comment,   /* OPT_COMMENT           1 */
@@ -23,19 +23,65 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#ifndef __PCAPIO_H__
+#define __PCAPIO_H__
+
+/* Output streams */
+
+/** An output stream for a capture file. */
+typedef struct pcapio_writer pcapio_writer;
+
+/** Default size of the buffer(s) of an output stream */
+#define PCAPIO_DEFAULT_BUFFER_SIZE      (4*1024*1024)
+
+/** Flags for pcapio_writer_fdopen() */
+#define PCAPIO_WRITER_THREADED  0x00000001  /**< write out full buffers from a separate thread */
+#define PCAPIO_WRITER_DIRECT    0x00000002  /**< bypass the page cache with O_DIRECT, if possible */
+
+/** Open an output stream on a file descriptor.
+   Data is collected in buffers of "buffer_size" bytes (or the
+   default size if it's 0), which are written out as they fill up.
+   "flags" is a combination of PCAPIO_WRITER_ flags; those that can't
+   be honored, e.g. PCAPIO_WRITER_DIRECT for a pipe, are ignored.
+   Returns NULL and sets "*err" on failure. */
+extern pcapio_writer *
+pcapio_writer_fdopen(int fd, size_t buffer_size, guint flags, int *err);
+
+/** Returns the PCAPIO_WRITER_ flags actually in effect for a stream. */
+extern guint
+pcapio_writer_get_flags(pcapio_writer *pw);
+
+/** Write out everything written to the stream so far.
+   Returns TRUE on success, FALSE and sets "*err" on failure, including
+   a failure to write out an earlier buffer. */
+extern gboolean
+pcapio_writer_flush(pcapio_writer *pw, int *err);
+
+/** Write out everything written to the stream so far and wait for
+   the operating system to commit it to disk.
+   Returns TRUE on success, FALSE and sets "*err" on failure. */
+extern gboolean
+pcapio_writer_sync(pcapio_writer *pw, int *err);
+
+/** Flush and close the stream, including its file descriptor, and
+   free it.
+   Returns TRUE on success, FALSE and sets "*err" on failure. */
+extern gboolean
+pcapio_writer_close(pcapio_writer *pw, int *err);
+
 /* Writing pcap files */
 
 /** Write the file header to a dump file.
    Returns TRUE on success, FALSE on failure.
    Sets "*err" to an error code, or 0 for a short write, on failure*/
 extern gboolean
-libpcap_write_file_header(FILE* pfile, int linktype, int snaplen,
+libpcap_write_file_header(pcapio_writer* pfile, int linktype, int snaplen,
                           gboolean ts_nsecs, guint64 *bytes_written, int *err);
 
 /** Write a record for a packet to a dump file.
    Returns TRUE on success, FALSE on failure. */
 extern gboolean
-libpcap_write_packet(FILE* pfile,
+libpcap_write_packet(pcapio_writer* pfile,
                      time_t sec, guint32 usec,
                      guint32 caplen, guint32 len,
                      const guint8 *pd,
@@ -47,7 +93,7 @@ libpcap_write_packet(FILE* pfile,
  *
  */
 extern gboolean
-pcapng_write_session_header_block(FILE* pfile,  /**< Write information */
+pcapng_write_session_header_block(pcapio_writer* pfile,  /**< Write information */
                                   const char *comment,  /**< Comment on the section, Optinon 1 opt_comment
                                                          * A UTF-8 string containing a comment that is associated to the current block.
                                                          */
@@ -66,7 +112,7 @@ pcapng_write_session_header_block(FILE* pfile,  /**< Write information */
                                   );
 
 extern gboolean
-pcapng_write_interface_description_block(FILE* pfile,
+pcapng_write_interface_description_block(pcapio_writer* pfile,
                                          const char *comment,  /* OPT_COMMENT           1 */
                                          const char *name,     /* IDB_NAME              2 */
                                          const char *descr,    /* IDB_DESCRIPTION       3 */
@@ -80,7 +126,7 @@ pcapng_write_interface_description_block(FILE* pfile,
                                          int *err);
 
 extern gboolean
-pcapng_write_interface_statistics_block(FILE* pfile,
+pcapng_write_interface_statistics_block(pcapio_writer* pfile,
                                         guint32 interface_id,
                                         guint64 *bytes_written,
                                         const char *comment,   /* OPT_COMMENT           1 */
@@ -91,7 +137,7 @@ pcapng_write_interface_statistics_block(FILE* pfile,
                                         int *err);
 
 extern gboolean
-pcapng_write_enhanced_packet_block(FILE* pfile,
+pcapng_write_enhanced_packet_block(pcapio_writer* pfile,
                                    const char *comment,
                                    time_t sec, guint32 usec,
                                    guint32 caplen, guint32 len,
@@ -101,3 +147,5 @@ pcapng_write_enhanced_packet_block(FILE* pfile,
                                    guint32 flags,
                                    guint64 *bytes_written,
                                    int *err);
+
+#endif /* __PCAPIO_H__ */
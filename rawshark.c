@@ -1652,6 +1652,7 @@ raw_epan_new(capture_file *cf)
     epan->get_frame_ts = raw_get_frame_ts;
     epan->get_interface_name = cap_file_get_interface_name;
     epan->get_user_comment = NULL;
+    epan->get_frame_shift_offset = NULL;
 
     return epan;
 }
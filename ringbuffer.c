@@ -61,6 +61,15 @@
 
 #include <glib.h>
 
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <wsutil/zstd_seekable.h>
+#endif
+
 #include "ringbuffer.h"
 #include <wsutil/file_util.h>
 
@@ -68,6 +77,8 @@
 /* Ringbuffer file structure */
 typedef struct _rb_file {
   gchar		*name;
+  gchar		*companion;          /* Name of its companion file, or NULL */
+  ringbuf_compression compression;   /* How it was compressed when it was closed */
 } rb_file;
 
 /* Ringbuffer data structure */
@@ -80,12 +91,417 @@ typedef struct _ringbuf_data {
   gboolean      unlimited;           /* TRUE if unlimited number of files */
 
   int           fd;		     /* Current ringbuffer file descriptor */
-  FILE         *pdh;
+  pcapio_writer *pdh;
+  size_t        buffer_size;         /* Buffer size for the output streams */
+  guint         writer_flags;        /* PCAPIO_WRITER_ flags for them */
   gboolean      group_read_access;   /* TRUE if files need to be opened with group read access */
+
+  ringbuf_compression compression;   /* Compression for switched away from files */
+  gboolean      sync_files;          /* TRUE to sync files to disk before closing them */
+  GThread      *worker;              /* Rotation thread, or NULL if not started yet */
+  GAsyncQueue  *jobs;                /* Jobs for the rotation thread */
+  gint          worker_err;          /* First error of the rotation thread, or 0 */
+  const gchar  *companion_suffix;    /* Suffix of companion files, or NULL */
 } ringbuf_data;
 
 static ringbuf_data rb_data;
 
+/*
+ * Closing, syncing and compressing the file we switched away from and
+ * removing the files that dropped out of the ring can take a long time,
+ * so they are handed over to a thread of their own and the capture loop
+ * goes on writing to the next file immediately.  Jobs are run in the
+ * order they were queued, so a file is always compressed before it is
+ * removed.  Errors are reported at the next switch or at the end of the
+ * capture.
+ */
+typedef enum {
+  RB_JOB_CLOSE,                      /* close (and compress) a file */
+  RB_JOB_UNLINK,                     /* remove a file */
+  RB_JOB_QUIT                        /* stop the rotation thread */
+} rb_job_type;
+
+typedef struct _rb_job {
+  rb_job_type    type;
+  pcapio_writer *pdh;                /* RB_JOB_CLOSE: the stream to close */
+  gchar         *name;               /* name of the file */
+  ringbuf_compression compression;   /* how to compress it, or how it was compressed */
+} rb_job;
+
+/* Files are compressed in chunks of this size; with Zstandard, each
+   chunk becomes an independent frame, so that the file can be read
+   with random access. */
+#define RB_COMPRESS_CHUNK        (1U << 20)
+
+#ifdef HAVE_ZSTD
+#define RB_ZSTD_LEVEL            3
+#endif
+
+static gboolean
+ringbuf_write_all(int fd, const guint8 *data, size_t len, int *err)
+{
+  int nwritten;
+
+  while (len != 0) {
+    nwritten = ws_write(fd, data, (unsigned int)MIN(len, G_MAXINT));
+    if (nwritten == -1) {
+      if (errno == EINTR)
+        continue;
+      *err = errno;
+      return FALSE;
+    }
+    if (nwritten == 0) {
+      *err = ENOSPC;
+      return FALSE;
+    }
+    data += nwritten;
+    len -= nwritten;
+  }
+  return TRUE;
+}
+
+/* Read up to RB_COMPRESS_CHUNK bytes; returns the number of bytes read,
+   less than RB_COMPRESS_CHUNK only at the end of the file, or -1 */
+static gssize
+ringbuf_read_chunk(int fd, guint8 *buf, int *err)
+{
+  gsize have = 0;
+  int   nread;
+
+  while (have < RB_COMPRESS_CHUNK) {
+    nread = ws_read(fd, buf + have, RB_COMPRESS_CHUNK - (unsigned int)have);
+    if (nread == -1) {
+      if (errno == EINTR)
+        continue;
+      *err = errno;
+      return -1;
+    }
+    if (nread == 0)
+      break;
+    have += nread;
+  }
+  return (gssize)have;
+}
+
+#ifdef HAVE_LIBZ
+static gboolean
+ringbuf_compress_gzip(int in_fd, int out_fd, guint8 *in, int *err)
+{
+  z_stream  strm;
+  guint8   *out;
+  gssize    have;
+  int       flush, ret;
+  gboolean  ok = TRUE;
+
+  memset(&strm, 0, sizeof strm);
+  /* 15 + 16: a gzip header and trailer instead of a zlib one */
+  if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    *err = ENOMEM;
+    return FALSE;
+  }
+  out = (guint8 *)g_malloc(RB_COMPRESS_CHUNK);
+
+  do {
+    have = ringbuf_read_chunk(in_fd, in, err);
+    if (have == -1) {
+      ok = FALSE;
+      break;
+    }
+    flush = (have < (gssize)RB_COMPRESS_CHUNK) ? Z_FINISH : Z_NO_FLUSH;
+    strm.next_in = in;
+    strm.avail_in = (uInt)have;
+    do {
+      strm.next_out = out;
+      strm.avail_out = RB_COMPRESS_CHUNK;
+      ret = deflate(&strm, flush);
+      if (ret == Z_STREAM_ERROR) {
+        *err = EIO;
+        ok = FALSE;
+        break;
+      }
+      ok = ringbuf_write_all(out_fd, out, RB_COMPRESS_CHUNK - strm.avail_out, err);
+    } while (ok && strm.avail_out == 0);
+  } while (ok && flush != Z_FINISH);
+
+  deflateEnd(&strm);
+  g_free(out);
+  return ok;
+}
+#endif /* HAVE_LIBZ */
+
+#ifdef HAVE_ZSTD
+static gboolean
+ringbuf_compress_zstd(int in_fd, int out_fd, guint8 *in, int *err)
+{
+  ZSTD_CCtx *cctx;
+  guint8    *out, *table;
+  size_t     out_size, len;
+  guint32   *seek_table = NULL;
+  guint      nframes = 0, table_size = 0;
+  gssize     have;
+  gboolean   ok = TRUE;
+
+  cctx = ZSTD_createCCtx();
+  if (cctx == NULL) {
+    *err = ENOMEM;
+    return FALSE;
+  }
+  out_size = ZSTD_compressBound(RB_COMPRESS_CHUNK);
+  out = (guint8 *)g_malloc(out_size);
+
+  for (;;) {
+    have = ringbuf_read_chunk(in_fd, in, err);
+    if (have == -1) {
+      ok = FALSE;
+      break;
+    }
+    if (have == 0)
+      break;
+    len = ZSTD_compressCCtx(cctx, out, out_size, in, have, RB_ZSTD_LEVEL);
+    if (ZSTD_isError(len)) {
+      *err = EIO;
+      ok = FALSE;
+      break;
+    }
+    if (!ringbuf_write_all(out_fd, out, len, err)) {
+      ok = FALSE;
+      break;
+    }
+    if (nframes == table_size) {
+      table_size = table_size ? table_size * 2 : 64;
+      seek_table = (guint32 *)g_realloc(seek_table, table_size * 2 * sizeof(guint32));
+    }
+    seek_table[2 * nframes] = (guint32)len;
+    seek_table[2 * nframes + 1] = (guint32)have;
+    nframes++;
+    if (have < (gssize)RB_COMPRESS_CHUNK)
+      break;
+  }
+
+  if (ok && nframes != 0) {
+    /* append the seek table, in a skippable frame */
+    table = zstd_seek_table_frame(seek_table, nframes, &len);
+    ok = ringbuf_write_all(out_fd, table, len, err);
+    g_free(table);
+  }
+
+  ZSTD_freeCCtx(cctx);
+  g_free(seek_table);
+  g_free(out);
+  return ok;
+}
+#endif /* HAVE_ZSTD */
+
+static const gchar *
+ringbuf_compression_suffix(ringbuf_compression compression)
+{
+  switch (compression) {
+    case RINGBUF_COMPRESS_GZIP:
+      return ".gz";
+    case RINGBUF_COMPRESS_ZSTD:
+      return ".zst";
+    default:
+      return "";
+  }
+}
+
+/*
+ * Compress a closed file into a file with the name plus a suffix for
+ * the compression type, and remove the original.  If that fails, the
+ * original is kept.
+ */
+static gboolean
+ringbuf_compress_file(const gchar *name, ringbuf_compression compression, int *err)
+{
+  gchar    *out_name;
+  guint8   *in;
+  int       in_fd, out_fd;
+  gboolean  ok;
+
+  in_fd = ws_open(name, O_RDONLY|O_BINARY, 0000);
+  if (in_fd == -1) {
+    *err = errno;
+    return FALSE;
+  }
+  out_name = g_strconcat(name, ringbuf_compression_suffix(compression), NULL);
+  out_fd = ws_open(out_name, O_WRONLY|O_BINARY|O_TRUNC|O_CREAT,
+                   rb_data.group_read_access ? 0640 : 0600);
+  if (out_fd == -1) {
+    *err = errno;
+    ws_close(in_fd);
+    g_free(out_name);
+    return FALSE;
+  }
+
+  in = (guint8 *)g_malloc(RB_COMPRESS_CHUNK);
+  switch (compression) {
+#ifdef HAVE_LIBZ
+    case RINGBUF_COMPRESS_GZIP:
+      ok = ringbuf_compress_gzip(in_fd, out_fd, in, err);
+      break;
+#endif
+#ifdef HAVE_ZSTD
+    case RINGBUF_COMPRESS_ZSTD:
+      ok = ringbuf_compress_zstd(in_fd, out_fd, in, err);
+      break;
+#endif
+    default:
+      *err = EINVAL;
+      ok = FALSE;
+      break;
+  }
+  g_free(in);
+  ws_close(in_fd);
+
+#ifdef _WIN32
+  if (ok && rb_data.sync_files && _commit(out_fd) == -1) {
+#else
+  if (ok && rb_data.sync_files && fsync(out_fd) == -1) {
+#endif
+    *err = errno;
+    ok = FALSE;
+  }
+  if (ws_close(out_fd) == -1 && ok) {
+    *err = errno;
+    ok = FALSE;
+  }
+
+  if (ok) {
+    ws_unlink(name);
+  } else {
+    ws_unlink(out_name);
+  }
+  g_free(out_name);
+  return ok;
+}
+
+/*
+ * Remove a file that was closed with the given compression.  Unless
+ * compressing it failed, it now has the compressed name, so try both.
+ */
+static void
+ringbuf_unlink_file(const gchar *name, ringbuf_compression compression)
+{
+  gchar *compressed_name;
+
+  if (compression != RINGBUF_COMPRESS_NONE) {
+    compressed_name = g_strconcat(name, ringbuf_compression_suffix(compression),
+                                  NULL);
+    ws_unlink(compressed_name);
+    g_free(compressed_name);
+  }
+  ws_unlink(name);
+}
+
+static gboolean
+ringbuf_close_file(pcapio_writer *pdh, const gchar *name,
+                   ringbuf_compression compression, int *err)
+{
+  int close_err;
+
+  if (rb_data.sync_files && !pcapio_writer_sync(pdh, err)) {
+    pcapio_writer_close(pdh, &close_err);
+    return FALSE;
+  }
+  if (!pcapio_writer_close(pdh, err)) {
+    return FALSE;
+  }
+  if (compression != RINGBUF_COMPRESS_NONE) {
+    return ringbuf_compress_file(name, compression, err);
+  }
+  return TRUE;
+}
+
+static gpointer
+ringbuf_worker(gpointer data _U_)
+{
+  rb_job *job;
+  int     err;
+
+  for (;;) {
+    job = (rb_job *)g_async_queue_pop(rb_data.jobs);
+    if (job->type == RB_JOB_QUIT) {
+      g_free(job);
+      break;
+    }
+    err = 0;
+    if (job->type == RB_JOB_CLOSE) {
+      ringbuf_close_file(job->pdh, job->name, job->compression, &err);
+    } else {
+      /* remove old file (if any, so ignore error) */
+      ringbuf_unlink_file(job->name, job->compression);
+    }
+    if (err != 0) {
+      /* keep the first error */
+      g_atomic_int_compare_and_exchange(&rb_data.worker_err, 0, err);
+    }
+    g_free(job->name);
+    g_free(job);
+  }
+  return NULL;
+}
+
+static void
+ringbuf_queue_job(rb_job_type type, pcapio_writer *pdh, const gchar *name,
+                  ringbuf_compression compression)
+{
+  rb_job *job;
+
+  if (rb_data.worker == NULL) {
+    rb_data.jobs = g_async_queue_new();
+#if GLIB_CHECK_VERSION(2,31,0)
+    rb_data.worker = g_thread_new("Ringbuffer rotation", ringbuf_worker, NULL);
+#else
+    rb_data.worker = g_thread_create(ringbuf_worker, NULL, TRUE, NULL);
+#endif
+  }
+
+  job = g_new0(rb_job, 1);
+  job->type = type;
+  job->pdh = pdh;
+  job->name = g_strdup(name);
+  job->compression = compression;
+  g_async_queue_push(rb_data.jobs, job);
+}
+
+/*
+ * Wait for the rotation thread to finish the queued jobs and stop it
+ */
+static void
+ringbuf_stop_worker(void)
+{
+  rb_job *job;
+
+  if (rb_data.worker == NULL)
+    return;
+
+  job = g_new0(rb_job, 1);
+  job->type = RB_JOB_QUIT;
+  g_async_queue_push(rb_data.jobs, job);
+  g_thread_join(rb_data.worker);
+  g_async_queue_unref(rb_data.jobs);
+  rb_data.worker = NULL;
+  rb_data.jobs = NULL;
+}
+
+/*
+ * Returns FALSE, and sets "*err", if a job of the rotation thread failed
+ */
+static gboolean
+ringbuf_worker_ok(int *err)
+{
+  int worker_err = g_atomic_int_get(&rb_data.worker_err);
+
+  if (worker_err != 0) {
+    if (err != NULL) {
+      *err = worker_err;
+    }
+    return FALSE;
+  }
+  return TRUE;
+}
+
 
 /*
  * create the next filename and open a new binary file with that name
@@ -98,10 +514,18 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
 
   if (rfile->name != NULL) {
     if (rb_data.unlimited == FALSE) {
-      /* remove old file (if any, so ignore error) */
-      ws_unlink(rfile->name);
+      /* remove old file, after any compression of it */
+      ringbuf_queue_job(RB_JOB_UNLINK, NULL, rfile->name, rfile->compression);
     }
     g_free(rfile->name);
+    rfile->compression = RINGBUF_COMPRESS_NONE;
+  }
+  if (rfile->companion != NULL) {
+    if (rb_data.unlimited == FALSE) {
+      ringbuf_queue_job(RB_JOB_UNLINK, NULL, rfile->companion, RINGBUF_COMPRESS_NONE);
+    }
+    g_free(rfile->companion);
+    rfile->companion = NULL;
   }
 
 #ifdef _WIN32
@@ -119,6 +543,9 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
       *err = ENOMEM;
     return -1;
   }
+  if (rb_data.companion_suffix != NULL) {
+    rfile->companion = g_strconcat(rfile->name, rb_data.companion_suffix, NULL);
+  }
 
   rb_data.fd = ws_open(rfile->name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
                             rb_data.group_read_access ? 0640 : 0600);
@@ -148,6 +575,12 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.fd = -1;
   rb_data.pdh = NULL;
   rb_data.group_read_access = group_read_access;
+  rb_data.compression = RINGBUF_COMPRESS_NONE;
+  rb_data.sync_files = FALSE;
+  rb_data.worker = NULL;
+  rb_data.jobs = NULL;
+  rb_data.worker_err = 0;
+  rb_data.companion_suffix = NULL;
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -206,6 +639,8 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
 
   for (i=0; i < rb_data.num_files; i++) {
     rb_data.files[i].name = NULL;
+    rb_data.files[i].companion = NULL;
+    rb_data.files[i].compression = RINGBUF_COMPRESS_NONE;
   }
 
   /* create the first file */
@@ -217,6 +652,31 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   return rb_data.fd;
 }
 
+/*
+ * Sets what is done with the files we switch away from, other than
+ * closing them
+ */
+void
+ringbuf_set_rotation(ringbuf_compression compression, gboolean sync_files)
+{
+  rb_data.compression = compression;
+  rb_data.sync_files = sync_files;
+}
+
+/*
+ * Sets the suffix of the companion files written next to ringbuffer
+ * files, such as flow indexes; when a file is removed from the ring,
+ * its companion file is removed along with it
+ */
+void
+ringbuf_set_companion_suffix(const gchar *suffix)
+{
+  rb_file *rfile = &rb_data.files[rb_data.curr_file_num % rb_data.num_files];
+
+  rb_data.companion_suffix = suffix;
+  g_free(rfile->companion);
+  rfile->companion = (suffix != NULL) ? g_strconcat(rfile->name, suffix, NULL) : NULL;
+}
 
 const gchar *ringbuf_current_filename(void)
 {
@@ -224,15 +684,22 @@ const gchar *ringbuf_current_filename(void)
 }
 
 /*
- * Calls ws_fdopen() for the current ringbuffer file
+ * Calls pcapio_writer_fdopen() for the current ringbuffer file;
+ * the following files will be opened with the same buffer size and
+ * flags
  */
-FILE *
-ringbuf_init_libpcap_fdopen(int *err)
+pcapio_writer *
+ringbuf_init_libpcap_fdopen(size_t buffer_size, guint writer_flags, int *err)
 {
-  rb_data.pdh = ws_fdopen(rb_data.fd, "wb");
+  int open_err;
+
+  rb_data.buffer_size = buffer_size;
+  rb_data.writer_flags = writer_flags;
+  rb_data.pdh = pcapio_writer_fdopen(rb_data.fd, buffer_size, writer_flags,
+                                     &open_err);
   if (rb_data.pdh == NULL) {
     if (err != NULL) {
-      *err = errno;
+      *err = open_err;
     }
   }
   return rb_data.pdh;
@@ -242,26 +709,26 @@ ringbuf_init_libpcap_fdopen(int *err)
  * Switches to the next ringbuffer file
  */
 gboolean
-ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
+ringbuf_switch_file(pcapio_writer **pdh, gchar **save_file, int *save_file_fd, int *err)
 {
   int     next_file_index;
   rb_file *next_rfile = NULL;
+  rb_file *rfile = &rb_data.files[rb_data.curr_file_num % rb_data.num_files];
 
-  /* close current file */
-
-  if (fclose(rb_data.pdh) == EOF) {
-    if (err != NULL) {
-      *err = errno;
-    }
-    ws_close(rb_data.fd);	/* XXX - the above should have closed this already */
-    rb_data.pdh = NULL;	/* it's still closed, we just got an error while closing */
-    rb_data.fd = -1;
-    return FALSE;
-  }
+  /* hand the current file over to the rotation thread, which closes it */
 
+  ringbuf_queue_job(RB_JOB_CLOSE, rb_data.pdh, rfile->name, rb_data.compression);
   rb_data.pdh = NULL;
   rb_data.fd  = -1;
 
+  /* it keeps its name until the rotation thread has compressed it */
+  rfile->compression = rb_data.compression;
+
+  /* did it fail for one of the previous files? */
+  if (!ringbuf_worker_ok(err)) {
+    return FALSE;
+  }
+
   /* get the next file number and open it */
 
   rb_data.curr_file_num++ /* = next_file_num*/;
@@ -272,7 +739,8 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
     return FALSE;
   }
 
-  if (ringbuf_init_libpcap_fdopen(err) == NULL) {
+  if (ringbuf_init_libpcap_fdopen(rb_data.buffer_size, rb_data.writer_flags,
+                                  err) == NULL) {
     return FALSE;
   }
 
@@ -285,26 +753,34 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
 }
 
 /*
- * Calls fclose() for the current ringbuffer file
+ * Calls pcapio_writer_close() for the current ringbuffer file
  */
 gboolean
 ringbuf_libpcap_dump_close(gchar **save_file, int *err)
 {
   gboolean  ret_val = TRUE;
+  int       close_err;
 
-  /* close current file, if it's open */
+  /* close current file, if it's open; it's left uncompressed, as
+     our parent may still be reading it */
   if (rb_data.pdh != NULL) {
-    if (fclose(rb_data.pdh) == EOF) {
+    if (!ringbuf_close_file(rb_data.pdh, NULL, RINGBUF_COMPRESS_NONE,
+                            &close_err)) {
       if (err != NULL) {
-        *err = errno;
+        *err = close_err;
       }
-      ws_close(rb_data.fd);
       ret_val = FALSE;
     }
     rb_data.pdh = NULL;
     rb_data.fd  = -1;
   }
 
+  /* wait for the previous files to be dealt with */
+  ringbuf_stop_worker();
+  if (ret_val) {
+    ret_val = ringbuf_worker_ok(err);
+  }
+
   /* set the save file name to the current file */
   *save_file = rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
   return ret_val;
@@ -324,6 +800,8 @@ ringbuf_free(void)
 	g_free(rb_data.files[i].name);
 	rb_data.files[i].name = NULL;
       }
+      g_free(rb_data.files[i].companion);
+      rb_data.files[i].companion = NULL;
     }
     g_free(rb_data.files);
     rb_data.files = NULL;
@@ -346,11 +824,13 @@ ringbuf_error_cleanup(void)
 {
   unsigned int i;
 
-  /* try to close via wtap */
+  /* try to close via the output stream; that closes the descriptor
+     even if it fails */
   if (rb_data.pdh != NULL) {
-    if (fclose(rb_data.pdh) == 0) {
-      rb_data.fd = -1;
-    }
+    int close_err;
+
+    pcapio_writer_close(rb_data.pdh, &close_err);
+    rb_data.fd = -1;
     rb_data.pdh = NULL;
   }
 
@@ -360,10 +840,15 @@ ringbuf_error_cleanup(void)
     rb_data.fd = -1;
   }
 
+  ringbuf_stop_worker();
+
   if (rb_data.files != NULL) {
     for (i=0; i < rb_data.num_files; i++) {
       if (rb_data.files[i].name != NULL) {
-        ws_unlink(rb_data.files[i].name);
+        ringbuf_unlink_file(rb_data.files[i].name, rb_data.files[i].compression);
+      }
+      if (rb_data.files[i].companion != NULL) {
+        ws_unlink(rb_data.files[i].companion);
       }
     }
   }
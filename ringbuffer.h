@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include "file.h"
 #include "wiretap/wtap.h"
+#include "pcapio.h"
 
 #define RINGBUFFER_UNLIMITED_FILES 0
 /* Minimum number of ringbuffer files */
@@ -36,10 +37,20 @@
 /* Maximum number for FAT filesystems */
 #define RINGBUFFER_WARN_NUM_FILES 65535
 
+/* Compression applied to ringbuffer files once they have been switched away from */
+typedef enum {
+  RINGBUF_COMPRESS_NONE,
+  RINGBUF_COMPRESS_GZIP,
+  RINGBUF_COMPRESS_ZSTD
+} ringbuf_compression;
+
 int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access);
+void ringbuf_set_rotation(ringbuf_compression compression, gboolean sync_files);
+void ringbuf_set_companion_suffix(const gchar *suffix);
 const gchar *ringbuf_current_filename(void);
-FILE *ringbuf_init_libpcap_fdopen(int *err);
-gboolean ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd,
+pcapio_writer *ringbuf_init_libpcap_fdopen(size_t buffer_size, guint writer_flags,
+                                           int *err);
+gboolean ringbuf_switch_file(pcapio_writer **pdh, gchar **save_file, int *save_file_fd,
                              int *err);
 gboolean ringbuf_libpcap_dump_close(gchar **save_file, int *err);
 void ringbuf_free(void);
@@ -0,0 +1,362 @@
+/* sync_ring.c
+ * Shared-memory ring carrying packets from dumpcap to Wireshark/TShark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* memfd_create() isn't declared on Linux without this */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "sync_ring.h"
+
+#ifdef HAVE_SYNC_RING
+
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include <wsutil/file_util.h>
+#include <wsutil/tempfile.h>
+
+/*
+ * The shared memory starts with a page holding the state of the ring,
+ * followed by the ring itself.  As in dumpcap's per-interface rings,
+ * "head" and "tail" are free-running byte counts, only the child moves
+ * "head" and only the parent moves "tail", and records never wrap
+ * around the end of the buffer; the space left at the end when a
+ * record doesn't fit is taken up by a filler record.
+ */
+#define SYNC_RING_MAGIC         0x57535252      /* "WSRR" */
+#define SYNC_RING_HDR_SIZE      4096
+#define SYNC_RING_MIN_SIZE      (1024*1024)
+#define SYNC_RING_MAX_SIZE      (1024*1024*1024)
+
+#define SYNC_RING_RECLEN(caplen) \
+    (((guint32)sizeof(sync_ring_rec) + (caplen) + 7) & ~7U)
+
+/* Values of "state" */
+#define SYNC_RING_WAITING       0       /* the child hasn't attached yet */
+#define SYNC_RING_OPEN          1       /* the child puts packets into the ring */
+#define SYNC_RING_SHUT          2       /* the child doesn't any more */
+
+typedef struct {
+    guint32       magic;
+    guint32       size;     /* size of the buffer, a power of 2 */
+    volatile gint state;    /* set by the child */
+    volatile gint head;     /* set by the child */
+    volatile gint tail;     /* set by the parent */
+} sync_ring_shared;
+
+struct sync_ring {
+    int               fd;
+    sync_ring_shared *shared;
+    guint8           *buf;
+    guint32           size;
+    size_t            map_len;
+};
+
+static sync_ring *
+sync_ring_map(int fd, size_t map_len, int *err)
+{
+    sync_ring *ring;
+    void      *map;
+
+    map = mmap(NULL, map_len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        *err = errno;
+        return NULL;
+    }
+    ring = g_new(sync_ring, 1);
+    ring->fd = fd;
+    ring->shared = (sync_ring_shared *)map;
+    ring->buf = (guint8 *)map + SYNC_RING_HDR_SIZE;
+    ring->size = (guint32)(map_len - SYNC_RING_HDR_SIZE);
+    ring->map_len = map_len;
+    return ring;
+}
+
+/*
+ * Get a descriptor for memory to share with the child.  Memory from
+ * memfd_create() or shm_open() isn't backed by a file, so the pages of
+ * the ring are never written out to disk; an unlinked temporary file
+ * is only used where neither is available.  The descriptor is handed
+ * down to the child, so it mustn't be closed on exec.
+ */
+static int
+sync_ring_open_shared(void)
+{
+    int   fd;
+#ifdef HAVE_SHM_OPEN
+    char  shm_name[64];
+    int   tries;
+#endif
+    char *name;
+
+#ifdef HAVE_MEMFD_CREATE
+    fd = memfd_create("wireshark_ring", 0);
+    if (fd != -1)
+        return fd;
+#endif
+#ifdef HAVE_SHM_OPEN
+    for (tries = 0; tries < 16; tries++) {
+        g_snprintf(shm_name, sizeof shm_name, "/wireshark_ring.%d.%08x",
+                   (int)getpid(), g_random_int());
+        fd = shm_open(shm_name, O_RDWR|O_CREAT|O_EXCL, 0600);
+        if (fd != -1) {
+            /* The memory only has to live as long as the two
+               processes have it open or mapped. */
+            shm_unlink(shm_name);
+            /* shm_open() sets FD_CLOEXEC */
+            if (fcntl(fd, F_SETFD, 0) != -1)
+                return fd;
+            ws_close(fd);
+            break;
+        }
+        if (errno != EEXIST)
+            break;
+    }
+#endif
+    fd = create_tempfile(&name, "wireshark_ring");
+    if (fd != -1)
+        ws_unlink(name);
+    return fd;
+}
+
+sync_ring *
+sync_ring_create(size_t size, int *err)
+{
+    sync_ring *ring;
+    int        fd;
+    guint32    ring_size;
+
+    for (ring_size = SYNC_RING_MIN_SIZE;
+         ring_size < size && ring_size < SYNC_RING_MAX_SIZE; ring_size <<= 1)
+        ;
+
+    fd = sync_ring_open_shared();
+    if (fd == -1) {
+        *err = errno;
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)SYNC_RING_HDR_SIZE + ring_size) == -1) {
+        *err = errno;
+        ws_close(fd);
+        return NULL;
+    }
+    ring = sync_ring_map(fd, (size_t)SYNC_RING_HDR_SIZE + ring_size, err);
+    if (ring == NULL) {
+        ws_close(fd);
+        return NULL;
+    }
+    ring->shared->magic = SYNC_RING_MAGIC;
+    ring->shared->size = ring_size;
+    ring->shared->state = SYNC_RING_WAITING;
+    ring->shared->head = 0;
+    ring->shared->tail = 0;
+    return ring;
+}
+
+int
+sync_ring_get_fd(sync_ring *ring)
+{
+    return ring->fd;
+}
+
+void
+sync_ring_close_fd(sync_ring *ring)
+{
+    if (ring->fd != -1) {
+        ws_close(ring->fd);
+        ring->fd = -1;
+    }
+}
+
+const sync_ring_rec *
+sync_ring_peek(sync_ring *ring, gboolean *shut)
+{
+    sync_ring_shared *shared = ring->shared;
+    /* Get the state before the head, so that packets put into the ring
+       before it was shut are seen. */
+    gint              state = g_atomic_int_get(&shared->state);
+    guint32           head = (guint32)g_atomic_int_get(&shared->head);
+    guint32           tail = (guint32)shared->tail;
+    guint32           off;
+    sync_ring_rec    *rec;
+
+    while (tail != head) {
+        off = tail & (ring->size - 1);
+        rec = (sync_ring_rec *)(void *)(ring->buf + off);
+        /* The filler at the end of the buffer may be as short as 8 bytes;
+           only its length and "wrap" are there. */
+        if (rec->reclen < 8 || rec->reclen > ring->size - off)
+            break;
+        if (!rec->wrap) {
+            if (rec->reclen < sizeof(sync_ring_rec) ||
+                rec->reclen < SYNC_RING_RECLEN(rec->caplen)) {
+                /* Not something the child would have written; don't
+                   use the ring any more. */
+                break;
+            }
+            *shut = FALSE;
+            return rec;
+        }
+        /* skip the filler */
+        tail += rec->reclen;
+        g_atomic_int_set(&shared->tail, (gint)tail);
+    }
+    *shut = (state != SYNC_RING_OPEN || tail != head);
+    return NULL;
+}
+
+void
+sync_ring_release(sync_ring *ring, const sync_ring_rec *rec)
+{
+    g_atomic_int_set(&ring->shared->tail,
+                     (gint)((guint32)ring->shared->tail + rec->reclen));
+}
+
+sync_ring *
+sync_ring_attach(int fd, int *err)
+{
+    sync_ring  *ring;
+    ws_statb64  statb;
+
+    if (ws_fstat64(fd, &statb) == -1) {
+        *err = errno;
+        return NULL;
+    }
+    if (statb.st_size < SYNC_RING_HDR_SIZE + SYNC_RING_MIN_SIZE ||
+        statb.st_size > (gint64)SYNC_RING_HDR_SIZE + SYNC_RING_MAX_SIZE) {
+        *err = 0;
+        return NULL;
+    }
+    ring = sync_ring_map(fd, (size_t)statb.st_size, err);
+    if (ring == NULL)
+        return NULL;
+    if (ring->shared->magic != SYNC_RING_MAGIC ||
+        ring->shared->size != ring->size ||
+        (ring->size & (ring->size - 1)) != 0) {
+        sync_ring_free(ring);
+        *err = 0;
+        return NULL;
+    }
+    g_atomic_int_set(&ring->shared->state, SYNC_RING_OPEN);
+    return ring;
+}
+
+gboolean
+sync_ring_put(sync_ring *ring, guint32 interface_id, int linktype,
+              gint64 ts_sec, guint32 ts_nsec, guint32 caplen, guint32 len,
+              guint64 offset, const guint8 *pd)
+{
+    sync_ring_shared *shared = ring->shared;
+    guint32           head = (guint32)shared->head;
+    guint32           used = head - (guint32)g_atomic_int_get(&shared->tail);
+    guint32           reclen = SYNC_RING_RECLEN(caplen);
+    guint32           off = head & (ring->size - 1);
+    guint32           fill = 0;
+    sync_ring_rec    *rec;
+
+    if (shared->state != SYNC_RING_OPEN)
+        return FALSE;
+
+    /* records don't wrap around; fill out the end of the buffer if need be */
+    if (off + reclen > ring->size)
+        fill = ring->size - off;
+    if (caplen > ring->size / 2 || used + fill + reclen > ring->size) {
+        sync_ring_shut(ring);
+        return FALSE;
+    }
+
+    if (fill != 0) {
+        rec = (sync_ring_rec *)(void *)(ring->buf + off);
+        rec->reclen = fill;
+        rec->wrap = TRUE;
+        off = 0;
+    }
+    rec = (sync_ring_rec *)(void *)(ring->buf + off);
+    rec->reclen = reclen;
+    rec->wrap = FALSE;
+    rec->interface_id = interface_id;
+    rec->linktype = linktype;
+    rec->ts_sec = ts_sec;
+    rec->ts_nsec = ts_nsec;
+    rec->caplen = caplen;
+    rec->len = len;
+    rec->reserved = 0;
+    rec->offset = offset;
+    memcpy(rec + 1, pd, caplen);
+
+    /* make it visible to the parent */
+    g_atomic_int_set(&shared->head, (gint)(head + fill + reclen));
+    return TRUE;
+}
+
+void
+sync_ring_shut(sync_ring *ring)
+{
+    g_atomic_int_set(&ring->shared->state, SYNC_RING_SHUT);
+}
+
+gboolean
+sync_ring_is_open(sync_ring *ring)
+{
+    return ring->shared->state == SYNC_RING_OPEN;
+}
+
+void
+sync_ring_free(sync_ring *ring)
+{
+    munmap((void *)ring->shared, ring->map_len);
+    if (ring->fd != -1)
+        ws_close(ring->fd);
+    g_free(ring);
+}
+
+#endif /* HAVE_SYNC_RING */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
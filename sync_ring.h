@@ -0,0 +1,142 @@
+/* sync_ring.h
+ * Shared-memory ring carrying packets from dumpcap to Wireshark/TShark
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+/** @file
+ *
+ *  A ring of packet records in memory shared between the capture child
+ *  and its parent.
+ *
+ *  The parent creates the ring and hands its file descriptor to the
+ *  child on the command line; the child puts each packet it writes to
+ *  the capture file into the ring as well, and the parent takes the
+ *  packets the sync pipe tells it about from the ring rather than
+ *  reading them back from the file.
+ *
+ *  If the ring fills up, or the child gets a packet it doesn't put in
+ *  the ring, the child stops using the ring for good; the parent then
+ *  finds the ring empty and shut, and reads the rest of the packets
+ *  from the capture file.
+ */
+
+#ifndef __SYNC_RING_H__
+#define __SYNC_RING_H__
+
+#include <glib.h>
+
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#define HAVE_SYNC_RING
+#endif
+
+#ifdef HAVE_SYNC_RING
+
+/** Default size of the ring, in bytes */
+#define SYNC_RING_DEFAULT_SIZE  (32*1024*1024)
+
+typedef struct sync_ring sync_ring;
+
+/** A packet record in the ring; the packet data follows it. */
+typedef struct {
+    guint32 reclen;         /**< length of the record, including this header */
+    guint32 wrap;           /**< TRUE for the filler at the end of the buffer */
+    guint32 interface_id;   /**< interface the packet was captured on */
+    gint32  linktype;       /**< DLT_ value of that interface */
+    gint64  ts_sec;         /**< time stamp */
+    guint32 ts_nsec;
+    guint32 caplen;         /**< captured length */
+    guint32 len;            /**< original length */
+    guint32 reserved;
+    guint64 offset;         /**< offset of the packet's record in the capture file */
+} sync_ring_rec;
+
+#define SYNC_RING_REC_DATA(rec) ((const guint8 *)((rec) + 1))
+
+/* Parent side */
+
+/** Create a ring of (at least) "size" bytes.
+ *
+ * @return The ring, or NULL with "*err" set to an errno value.
+ */
+extern sync_ring *
+sync_ring_create(size_t size, int *err);
+
+/** The file descriptor the child has to inherit and attach to; it is
+ *  valid until sync_ring_close_fd() is called. */
+extern int
+sync_ring_get_fd(sync_ring *ring);
+
+/** Close the parent's copy of the file descriptor, once the child has
+ *  been started, so that later children don't inherit it. */
+extern void
+sync_ring_close_fd(sync_ring *ring);
+
+/** Get the oldest packet in the ring, without removing it.
+ *
+ * @param ring The ring.
+ * @param shut Set to TRUE if the ring is empty and the child doesn't
+ *        put packets in it any more, or never attached to it.
+ * @return The packet, or NULL if the ring is empty.
+ */
+extern const sync_ring_rec *
+sync_ring_peek(sync_ring *ring, gboolean *shut);
+
+/** Remove the packet sync_ring_peek() returned. */
+extern void
+sync_ring_release(sync_ring *ring, const sync_ring_rec *rec);
+
+/* Child side */
+
+/** Attach to the ring created by the parent.
+ *
+ * @return The ring, or NULL with "*err" set to an errno value, or to 0
+ *         if "fd" isn't a ring.
+ */
+extern sync_ring *
+sync_ring_attach(int fd, int *err);
+
+/** Put a packet into the ring.  If it doesn't fit, the ring is shut,
+ *  and no more packets are put into it.
+ *
+ * @return TRUE if the packet was put into the ring.
+ */
+extern gboolean
+sync_ring_put(sync_ring *ring, guint32 interface_id, int linktype,
+              gint64 ts_sec, guint32 ts_nsec, guint32 caplen, guint32 len,
+              guint64 offset, const guint8 *pd);
+
+/** Stop putting packets into the ring; the parent reads the packets
+ *  that follow from the capture file. */
+extern void
+sync_ring_shut(sync_ring *ring);
+
+/** Is the child still putting packets into the ring? */
+extern gboolean
+sync_ring_is_open(sync_ring *ring);
+
+/* Both sides */
+
+extern void
+sync_ring_free(sync_ring *ring);
+
+#endif /* HAVE_SYNC_RING */
+
+#endif /* __SYNC_RING_H__ */
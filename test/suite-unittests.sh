@@ -61,12 +61,24 @@ unittests_step_test() {
 }
 
 
+unittests_step_file_wrappers_test() {
+	DUT=$SOURCE_DIR/wiretap/file_wrappers_test
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_exntest() {
 	DUT=$SOURCE_DIR/epan/exntest
 	ARGS=
 	unittests_step_test
 }
 
+unittests_step_flow_index_test() {
+	DUT=$SOURCE_DIR/flow_index_test
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_oids_test() {
 	DUT=$SOURCE_DIR/epan/oids_test
 	ARGS=
@@ -99,6 +111,8 @@ unittests_suite() {
 	test_step_set_pre unittests_cleanup_step
 	test_step_set_post unittests_cleanup_step
 	test_step_add "exntest" unittests_step_exntest
+	test_step_add "file_wrappers_test" unittests_step_file_wrappers_test
+	test_step_add "flow_index_test" unittests_step_flow_index_test
 	test_step_add "oids_test" unittests_step_oids_test
 	test_step_add "reassemble_test" unittests_step_reassemble_test
 	test_step_add "tvbtest" unittests_step_tvbtest
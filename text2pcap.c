@@ -120,6 +120,10 @@
 # include <unistd.h>
 #endif
 
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>
+#endif
+
 #include <errno.h>
 #include <assert.h>
 
@@ -254,7 +258,7 @@ static const char *input_filename;
 static FILE       *input_file  = NULL;
 /* Output file */
 static const char *output_filename;
-static FILE       *output_file = NULL;
+static pcapio_writer *output_file = NULL;
 
 /* Offset base to parse */
 static guint32 offset_base = 16;
@@ -1539,6 +1543,8 @@ parse_options (int argc, char *argv[])
 {
     int   c;
     char *p;
+    int   output_fd;
+    int   err;
 
 #ifdef _WIN32
     arg_list_utf_16to8(argc, argv);
@@ -1810,15 +1816,21 @@ parse_options (int argc, char *argv[])
 
     if (strcmp(argv[optind+1], "-")) {
         output_filename = g_strdup(argv[optind+1]);
-        output_file = ws_fopen(output_filename, "wb");
-        if (!output_file) {
+        output_fd = ws_open(output_filename, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666);
+        if (output_fd == -1) {
             fprintf(stderr, "Cannot open file [%s] for writing: %s\n",
                     output_filename, g_strerror(errno));
             exit(1);
         }
     } else {
         output_filename = "Standard output";
-        output_file = stdout;
+        output_fd = 1;
+    }
+    output_file = pcapio_writer_fdopen(output_fd, 0, 0, &err);
+    if (!output_file) {
+        fprintf(stderr, "Cannot open file [%s] for writing: %s\n",
+                output_filename, g_strerror(err));
+        exit(1);
     }
 
     /* Some validation */
@@ -1832,10 +1844,6 @@ parse_options (int argc, char *argv[])
         input_file = stdin;
         input_filename = "Standard input";
     }
-    if (!output_file) {
-        output_file = stdout;
-        output_filename = "Standard output";
-    }
 
     ts_sec = time(0);               /* initialize to current time */
     timecode_default = *localtime(&ts_sec);
@@ -1865,6 +1873,8 @@ parse_options (int argc, char *argv[])
 int
 main(int argc, char *argv[])
 {
+    int err;
+
     parse_options(argc, argv);
 
     assert(input_file  != NULL);
@@ -1903,7 +1913,11 @@ main(int argc, char *argv[])
     write_current_packet(FALSE);
     write_file_trailer();
     fclose(input_file);
-    fclose(output_file);
+    if (!pcapio_writer_close(output_file, &err)) {
+        fprintf(stderr, "File write error [%s] : %s\n",
+                output_filename, g_strerror(err));
+        exit(1);
+    }
     if (debug)
         fprintf(stderr, "\n-------------------------\n");
     if (!quiet) {
@@ -111,6 +111,8 @@
 #include "capture_session.h"
 #include <capchild/capture_sync.h>
 #include "capture_opts.h"
+#include "sync_ring.h"
+#include <wiretap/pcap-encap.h>
 #endif /* HAVE_LIBPCAP */
 #include "log.h"
 #include <epan/funnel.h>
@@ -153,6 +155,7 @@ static gboolean print_packet_info; /* TRUE if we're to print packet information
 static gint print_summary = -1;    /* TRUE if we're to print packet summary information */
 static gboolean print_details;     /* TRUE if we're to print packet details information */
 static gboolean print_hex;         /* TRUE if we're to print hex/ascci information */
+static gboolean adapt_drop_details = FALSE; /* TRUE if we print summaries rather than details to keep up */
 static gboolean line_buffered;
 static gboolean really_quiet = FALSE;
 
@@ -170,9 +173,55 @@ static const char *separator = "";
  */
 static gboolean print_packet_counts;
 
+#define LONGOPT_ADAPTIVE_DISSECTION MIN_NON_CAPTURE_LONGOPT
+#define LONGOPT_ADAPTIVE_SAMPLE     (MIN_NON_CAPTURE_LONGOPT + 1)
+
 static capture_options global_capture_opts;
 static capture_session global_capture_session;
 
+#ifdef HAVE_SYNC_RING
+/* number of packets of the current capture file we got through the
+   packet ring rather than reading them from the file */
+static guint32 ring_file_packets;
+#endif
+
+/*
+ * Adaptive dissection: when dissecting a live capture falls more than
+ * "adapt_max_lag" milliseconds behind, do less work per packet, one stage
+ * at a time, and go back a stage once we've caught up.
+ */
+typedef enum {
+  ADAPT_FULL,           /* dissect as asked */
+  ADAPT_NO_TREE,        /* only build the protocol tree filters and taps need */
+  ADAPT_NO_HEURISTICS,  /* also skip heuristic dissectors nobody refers to */
+  ADAPT_SAMPLE,         /* also only dissect one packet in "adapt_sample_rate" */
+  ADAPT_NUM_STAGES
+} adapt_stage_e;
+
+static const char *adapt_stage_names[ADAPT_NUM_STAGES] = {
+  "full dissection",
+  "no protocol tree",
+  "no unreferenced heuristic dissectors",
+  "sampling"
+};
+
+static guint32       adapt_max_lag = 0;       /* 0 if we don't adapt */
+static guint32       adapt_sample_rate = 10;
+static adapt_stage_e adapt_stage = ADAPT_FULL;
+static GString      *adapt_refs = NULL;       /* filters, fields and taps we were given */
+static GSList       *adapt_heurs = NULL;      /* heuristic dissectors we disabled */
+static nstime_t      adapt_last_ts;           /* time stamp of the last packet of this batch */
+static guint64       adapt_batch = 0;         /* when we were told about this batch, in ms */
+static guint64       adapt_changed = 0;       /* when we last changed stage, in ms */
+static guint32       adapt_sample_count = 0;
+static guint32       adapt_entered[ADAPT_NUM_STAGES];
+static guint32       adapt_packets[ADAPT_NUM_STAGES];
+static guint32       adapt_skipped = 0;
+
+/* How long dumpcap may take to tell us about a packet, in ms; it reports
+   new packets every DUMPCAP_UPD_TIME */
+#define ADAPT_REPORT_TIME 500
+
 #ifdef SIGINFO
 static gboolean infodelay;      /* if TRUE, don't print capture info in SIGINFO handler */
 static gboolean infoprint;      /* if TRUE, print capture info after clearing infodelay */
@@ -180,6 +229,7 @@ static gboolean infoprint;      /* if TRUE, print capture info after clearing in
 
 static gboolean capture(void);
 static void report_counts(void);
+static void adapt_add_ref(const char *ref);
 #ifdef _WIN32
 static BOOL WINAPI capture_cleanup(DWORD);
 #else /* _WIN32 */
@@ -320,6 +370,11 @@ print_usage(gboolean print_ver)
   fprintf(output, "  -b <ringbuffer opt.> ... duration:NUM - switch to next file after NUM secs\n");
   fprintf(output, "                           filesize:NUM - switch to next file after NUM KB\n");
   fprintf(output, "                              files:NUM - ringbuffer: replace after NUM files\n");
+  fprintf(output, "  --adaptive-dissection <ms>\n");
+  fprintf(output, "                           do less work per packet while dissection lags\n");
+  fprintf(output, "                           more than <ms> behind the capture\n");
+  fprintf(output, "  --adaptive-sample <N>    when that isn't enough, dissect only 1 in N packets\n");
+  fprintf(output, "                           for statistics (def: 10)\n");
 #endif  /* HAVE_LIBPCAP */
 #ifdef HAVE_PCAP_REMOTE
   fprintf(output, "RPCAP options:\n");
@@ -950,6 +1005,10 @@ main(int argc, char *argv[])
   static const struct option long_options[] = {
     {(char *)"help", no_argument, NULL, 'h'},
     {(char *)"version", no_argument, NULL, 'v'},
+#ifdef HAVE_LIBPCAP
+    {(char *)"adaptive-dissection", required_argument, NULL, LONGOPT_ADAPTIVE_DISSECTION},
+    {(char *)"adaptive-sample", required_argument, NULL, LONGOPT_ADAPTIVE_SAMPLE},
+#endif
     LONGOPT_CAPTURE_COMMON
     {0, 0, 0, 0 }
   };
@@ -1066,6 +1125,9 @@ main(int argc, char *argv[])
       break;
     case 'O':        /* Only output these protocols */
       output_only = g_strdup(optarg);
+#ifdef HAVE_LIBPCAP
+      adapt_add_ref(optarg);
+#endif
       /* FALLTHROUGH */
     case 'V':        /* Verbose */
       print_details = TRUE;
@@ -1369,6 +1431,9 @@ main(int argc, char *argv[])
     case 'e':
       /* Field entry */
       output_fields_add(output_fields, optarg);
+#ifdef HAVE_LIBPCAP
+      adapt_add_ref(optarg);
+#endif
       break;
     case 'E':
       /* Field option */
@@ -1621,7 +1686,18 @@ main(int argc, char *argv[])
         list_stat_cmd_args();
         return 1;
       }
+#ifdef HAVE_LIBPCAP
+      adapt_add_ref(optarg);
+#endif
+      break;
+#ifdef HAVE_LIBPCAP
+    case LONGOPT_ADAPTIVE_DISSECTION:
+      adapt_max_lag = get_positive_int(optarg, "adaptive dissection lag");
+      break;
+    case LONGOPT_ADAPTIVE_SAMPLE:
+      adapt_sample_rate = get_positive_int(optarg, "adaptive dissection sample rate");
       break;
+#endif
     default:
     case '?':        /* Bad flag - print usage message */
       switch(optopt) {
@@ -2178,6 +2254,13 @@ main(int argc, char *argv[])
     /* For now, assume libpcap gives microsecond precision. */
     timestamp_set_precision(TS_PREC_AUTO_USEC);
 
+    /* Heuristic dissectors of the protocols the filters refer to are
+       kept if we fall behind. */
+    if (rfilter != NULL)
+      adapt_add_ref(rfilter);
+    if (dfilter != NULL)
+      adapt_add_ref(dfilter);
+
     /*
      * XXX - this returns FALSE if an error occurred, but it also
      * returns FALSE if the capture stops because a time limit
@@ -2365,6 +2448,7 @@ tshark_epan_new(capture_file *cf)
   epan->get_frame_ts = tshark_get_frame_ts;
   epan->get_interface_name = cap_file_get_interface_name;
   epan->get_user_comment = NULL;
+  epan->get_frame_shift_offset = NULL;
 
   return epan;
 }
@@ -2411,6 +2495,10 @@ capture(void)
   epan_free(cfile.epan);
   cfile.epan = tshark_epan_new(&cfile);
 
+  /* We start out dissecting fully. */
+  if (adapt_max_lag != 0)
+    adapt_entered[ADAPT_FULL]++;
+
 #ifdef _WIN32
   /* Catch a CTRL+C event and, if we get it, clean up and exit. */
   SetConsoleCtrlHandler(capture_cleanup, TRUE);
@@ -2487,6 +2575,11 @@ capture(void)
   fflush(stderr);
   g_string_free(str, TRUE);
 
+#ifdef HAVE_SYNC_RING
+  /* We only need dumpcap to hand us the packets if we dissect them. */
+  global_capture_opts.use_packet_ring = do_dissection;
+#endif
+
   ret = sync_pipe_start(&global_capture_opts, &global_capture_session, NULL);
 
   if (!ret)
@@ -2634,6 +2727,9 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
 
   /* save the new filename */
   capture_opts->save_file = g_strdup(new_file);
+#ifdef HAVE_SYNC_RING
+  ring_file_packets = 0;
+#endif
 
   /* if we are in real-time mode, open the new file now */
   if (do_dissection) {
@@ -2658,6 +2754,207 @@ capture_input_new_file(capture_session *cap_session, gchar *new_file)
 }
 
 
+static void
+adapt_add_ref(const char *ref)
+{
+  if (adapt_refs == NULL)
+    adapt_refs = g_string_new("");
+  g_string_append_printf(adapt_refs, " %s", ref);
+}
+
+static gboolean
+adapt_is_name_char(char c)
+{
+  return g_ascii_isalnum(c) || c == '_' || c == '-';
+}
+
+/* Does any filter, field or tap argument we were given refer to the
+   protocol with the filter name "name"? */
+static gboolean
+adapt_is_referenced(const char *name)
+{
+  const char *p;
+  size_t      len;
+
+  if (adapt_refs == NULL || name == NULL)
+    return FALSE;
+  len = strlen(name);
+  for (p = strstr(adapt_refs->str, name); p != NULL; p = strstr(p + 1, name)) {
+    if (p > adapt_refs->str && (adapt_is_name_char(p[-1]) || p[-1] == '.'))
+      continue;
+    if (!adapt_is_name_char(p[len]))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static void
+adapt_disable_heur_table(const gchar *table_name _U_, gpointer table,
+                         gpointer user_data _U_)
+{
+  GSList            *entry;
+  heur_dtbl_entry_t *hdtbl_entry;
+
+  for (entry = *(heur_dissector_list_t *)table; entry != NULL; entry = g_slist_next(entry)) {
+    hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+    if (hdtbl_entry->enabled && hdtbl_entry->protocol != NULL &&
+        !adapt_is_referenced(proto_get_protocol_filter_name(proto_get_id(hdtbl_entry->protocol)))) {
+      hdtbl_entry->enabled = FALSE;
+      adapt_heurs = g_slist_prepend(adapt_heurs, hdtbl_entry);
+    }
+  }
+}
+
+static void
+adapt_set_stage(adapt_stage_e stage)
+{
+  GSList *entry;
+
+  if (stage >= ADAPT_NO_HEURISTICS && adapt_stage < ADAPT_NO_HEURISTICS) {
+    dissector_all_heur_tables_foreach_table(adapt_disable_heur_table, NULL);
+  } else if (stage < ADAPT_NO_HEURISTICS && adapt_stage >= ADAPT_NO_HEURISTICS) {
+    for (entry = adapt_heurs; entry != NULL; entry = g_slist_next(entry))
+      ((heur_dtbl_entry_t *)entry->data)->enabled = TRUE;
+    g_slist_free(adapt_heurs);
+    adapt_heurs = NULL;
+  }
+
+  /* Only summary lines can stand in for the protocol tree; PDML and
+     fields output need it. */
+  adapt_drop_details = stage >= ADAPT_NO_TREE && print_details &&
+                       output_action == WRITE_TEXT;
+  adapt_stage = stage;
+  adapt_sample_count = 0;
+  adapt_entered[stage]++;
+}
+
+/*
+ * Get the current time, in ms.
+ */
+static guint64
+adapt_now(void)
+{
+  GTimeVal now;
+
+  g_get_current_time(&now);
+  return (guint64)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+/*
+ * See how far the packets we've just got lag behind, and do more or less
+ * work per packet from now on.  The lag is how long we took to dissect
+ * them since we were told about them, plus however much longer than
+ * ADAPT_REPORT_TIME the last of them waited to be reported, which is
+ * where falling behind shows up; the time dumpcap takes to report
+ * packets, all of ADAPT_REPORT_TIME on a quiet link, doesn't count.  We
+ * change stage at most once per "adapt_max_lag", to give the last change
+ * time to take effect; we only sample packets if we don't print them.
+ */
+static void
+adapt_update(void)
+{
+  guint64       now_ms, ts_ms, lag;
+  adapt_stage_e max_stage = print_packet_info ? ADAPT_NO_HEURISTICS : ADAPT_SAMPLE;
+
+  if (nstime_is_zero(&adapt_last_ts))
+    return;     /* we didn't get any packets this time */
+  now_ms = adapt_now();
+  if (now_ms - adapt_changed < adapt_max_lag)
+    return;
+  ts_ms = (guint64)adapt_last_ts.secs * 1000 + adapt_last_ts.nsecs / 1000000;
+  lag = now_ms > adapt_batch ? now_ms - adapt_batch : 0;
+  if (adapt_batch > ts_ms + ADAPT_REPORT_TIME)
+    lag += adapt_batch - ts_ms - ADAPT_REPORT_TIME;
+
+  if (lag > adapt_max_lag && adapt_stage < max_stage) {
+    adapt_set_stage((adapt_stage_e)(adapt_stage + 1));
+    adapt_changed = now_ms;
+  } else if (lag < adapt_max_lag / 4 && adapt_stage > ADAPT_FULL) {
+    adapt_set_stage((adapt_stage_e)(adapt_stage - 1));
+    adapt_changed = now_ms;
+  }
+}
+
+/* Dissect a packet of a live capture, unless we're sampling packets and
+   it's not one of those we dissect. */
+static gboolean
+capture_input_process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset,
+                             struct wtap_pkthdr *whdr, const guchar *pd, guint tap_flags)
+{
+  adapt_last_ts = whdr->ts;
+  if (adapt_stage == ADAPT_SAMPLE && adapt_sample_count++ % adapt_sample_rate != 0) {
+    adapt_skipped++;
+    return TRUE;
+  }
+  adapt_packets[adapt_stage]++;
+  return process_packet(cf, edt, offset, whdr, pd, tap_flags);
+}
+
+#ifdef HAVE_SYNC_RING
+/*
+ * Take the next packet the capture child told us about from the packet
+ * ring rather than reading it from the capture file.
+ *
+ * Returns FALSE if the packet has to be read from the file, which is the
+ * case once the child has shut the ring and we've taken everything out of
+ * it; we then skip the packets of the file we already got from the ring,
+ * and read from the file from then on.
+ */
+static gboolean
+capture_input_ring_packet(capture_session *cap_session, epan_dissect_t *edt,
+                          guint tap_flags, gboolean *passed)
+{
+  capture_file        *cf = (capture_file *)cap_session->cf;
+  const sync_ring_rec *rec;
+  gboolean             shut;
+  struct wtap_pkthdr   phdr;
+  int                  err;
+  gchar               *err_info;
+  gint64               data_offset;
+
+  rec = sync_ring_peek(cap_session->packet_ring, &shut);
+  if (rec == NULL) {
+    if (!shut) {
+      /* The child counted a packet it didn't write (it does so for
+         packets it gets after it's been told to stop). */
+      *passed = FALSE;
+      return TRUE;
+    }
+    sync_ring_free(cap_session->packet_ring);
+    cap_session->packet_ring = NULL;
+    for (; ring_file_packets != 0; ring_file_packets--) {
+      wtap_cleareof(cf->wth);
+      if (!wtap_read(cf->wth, &err, &err_info, &data_offset)) {
+        g_free(err_info);
+        break;
+      }
+    }
+    ring_file_packets = 0;
+    return FALSE;
+  }
+
+  memset(&phdr, 0, sizeof phdr);
+  phdr.rec_type = REC_TYPE_PACKET;
+  phdr.presence_flags = WTAP_HAS_TS|WTAP_HAS_CAP_LEN;
+  if (global_capture_opts.use_pcapng)
+    phdr.presence_flags |= WTAP_HAS_INTERFACE_ID;
+  phdr.ts.secs = (time_t)rec->ts_sec;
+  phdr.ts.nsecs = (int)rec->ts_nsec;
+  phdr.caplen = rec->caplen;
+  phdr.len = rec->len;
+  phdr.pkt_encap = wtap_pcap_encap_to_wtap_encap(rec->linktype);
+  phdr.interface_id = rec->interface_id;
+  if (phdr.pkt_encap == WTAP_ENCAP_ETHERNET)
+    phdr.pseudo_header.eth.fcs_len = -1;
+
+  *passed = capture_input_process_packet(cf, edt, (gint64)rec->offset, &phdr,
+                                         SYNC_RING_REC_DATA(rec), tap_flags);
+  sync_ring_release(cap_session->packet_ring, rec);
+  ring_file_packets++;
+  return TRUE;
+}
+#endif
+
 /* capture child tells us we have new packets to read */
 void
 capture_input_new_packets(capture_session *cap_session, int to_read)
@@ -2689,7 +2986,12 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
     gboolean create_proto_tree;
     epan_dissect_t *edt;
 
-    if (cf->rfcode || cf->dfcode || print_details || filtering_tap_listeners ||
+    if (adapt_max_lag != 0) {
+      adapt_batch = adapt_now();
+      nstime_set_zero(&adapt_last_ts);
+    }
+
+    if (cf->rfcode || cf->dfcode || (print_details && !adapt_drop_details) || filtering_tap_listeners ||
         (tap_flags & TL_REQUIRES_PROTO_TREE) || have_custom_cols(&cf->cinfo))
       create_proto_tree = TRUE;
     else
@@ -2699,9 +3001,18 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
        printing packet details, which is true if we're printing stuff
        ("print_packet_info" is true) and we're in verbose mode
        ("packet_details" is true). */
-    edt = epan_dissect_new(cf->epan, create_proto_tree, print_packet_info && print_details);
+    edt = epan_dissect_new(cf->epan, create_proto_tree,
+                           print_packet_info && print_details && !adapt_drop_details);
 
     while (to_read-- && cf->wth) {
+#ifdef HAVE_SYNC_RING
+      if (cap_session->packet_ring != NULL &&
+          capture_input_ring_packet(cap_session, edt, tap_flags, &ret)) {
+        if (ret != FALSE)
+          packet_count++;
+        continue;
+      }
+#endif
       wtap_cleareof(cf->wth);
       ret = wtap_read(cf->wth, &err, &err_info, &data_offset);
       if (ret == FALSE) {
@@ -2710,9 +3021,9 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
         wtap_close(cf->wth);
         cf->wth = NULL;
       } else {
-        ret = process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
-                             wtap_buf_ptr(cf->wth),
-                             tap_flags);
+        ret = capture_input_process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
+                                           wtap_buf_ptr(cf->wth),
+                                           tap_flags);
       }
       if (ret != FALSE) {
         /* packet successfully read and gone through the "Read Filter" */
@@ -2722,6 +3033,9 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
 
     epan_dissect_free(edt);
 
+    if (adapt_max_lag != 0)
+      adapt_update();
+
   } else {
     /*
      * Dumpcap's doing all the work; we're not doing any dissection.
@@ -2762,6 +3076,18 @@ report_counts(void)
       fprintf(stderr, "%u packet%s captured\n", packet_count,
             plurality(packet_count, "", "s"));
   }
+  if (adapt_max_lag != 0 && really_quiet == FALSE) {
+    int i;
+
+    for (i = 0; i < ADAPT_NUM_STAGES; i++) {
+      fprintf(stderr, "Adaptive dissection, %s: %u packet%s dissected, entered %u time%s\n",
+              adapt_stage_names[i],
+              adapt_packets[i], plurality(adapt_packets[i], "", "s"),
+              adapt_entered[i], plurality(adapt_entered[i], "", "s"));
+    }
+    fprintf(stderr, "Adaptive dissection: %u packet%s skipped while sampling\n",
+            adapt_skipped, plurality(adapt_skipped, "", "s"));
+  }
 #ifdef SIGINFO
   infoprint = FALSE; /* we just reported it */
 #endif /* SIGINFO */
@@ -3078,6 +3404,7 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   wtapng_section_t            *shb_hdr;
   wtapng_iface_descriptions_t *idb_inf;
   char         appname[100];
+  wtap_compression_type compression_type;
   struct wtap_pkthdr phdr;
   Buffer       buf;
   epan_dissect_t *edt = NULL;
@@ -3111,13 +3438,16 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
         shb_hdr->shb_user_appl = appname;
     }
 
+    /* Compress the output if its name says it's compressed. */
+    compression_type = wtap_extension_to_compression_type(save_file);
+
     if (linktype != WTAP_ENCAP_PER_PACKET &&
         out_file_type == WTAP_FILE_TYPE_SUBTYPE_PCAP)
-        pdh = wtap_dump_open(save_file, out_file_type, linktype,
-            snapshot_length, FALSE /* compressed */, &err);
+        pdh = wtap_dump_open_compressed(save_file, out_file_type, linktype,
+            snapshot_length, compression_type, NULL, NULL, &err);
     else
-        pdh = wtap_dump_open_ng(save_file, out_file_type, linktype,
-            snapshot_length, FALSE /* compressed */, shb_hdr, idb_inf, &err);
+        pdh = wtap_dump_open_compressed(save_file, out_file_type, linktype,
+            snapshot_length, compression_type, shb_hdr, idb_inf, &err);
 
     g_free(idb_inf);
     idb_inf = NULL;
@@ -3136,6 +3466,13 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
           "\"%s\" file.", wtap_file_type_subtype_short_string(out_file_type));
         break;
 
+      case WTAP_ERR_COMPRESSION_NOT_SUPPORTED:
+        cmdarg_err("The %s can't be written as a %s-compressed "
+          "\"%s\" file.", save_file_string,
+          wtap_compression_type_name(compression_type),
+          wtap_file_type_subtype_short_string(out_file_type));
+        break;
+
       case WTAP_ERR_CANT_OPEN:
         cmdarg_err("The %s couldn't be created for some "
           "unknown reason.", save_file_string);
@@ -3529,7 +3866,8 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset, struct wtap
             mode, we print the protocol tree, not the protocol summary.
        or
          3) there is a column mapped as an individual field */
-    if ((tap_flags & TL_REQUIRES_COLUMNS) || (print_packet_info && print_summary) || output_fields_has_cols(output_fields))
+    if ((tap_flags & TL_REQUIRES_COLUMNS) || (print_packet_info && (print_summary || adapt_drop_details)) ||
+        output_fields_has_cols(output_fields))
       cinfo = &cf->cinfo;
     else
       cinfo = NULL;
@@ -3686,6 +4024,7 @@ print_columns(capture_file *cf)
   size_t  buf_offset;
   size_t  column_len;
   size_t  col_len;
+  const gchar *col_text;
 
   line_bufp = get_line_buf(256);
   buf_offset = 0;
@@ -3694,13 +4033,14 @@ print_columns(capture_file *cf)
     /* Skip columns not marked as visible. */
     if (!get_column_visible(i))
       continue;
+    col_text = col_get_data(&cf->cinfo, i);
     switch (cf->cinfo.col_fmt[i]) {
     case COL_NUMBER:
-      column_len = col_len = strlen(cf->cinfo.col_data[i]);
+      column_len = col_len = strlen(col_text);
       if (column_len < 3)
         column_len = 3;
       line_bufp = get_line_buf(buf_offset + column_len);
-      put_spaces_string(line_bufp + buf_offset, cf->cinfo.col_data[i], col_len, column_len);
+      put_spaces_string(line_bufp + buf_offset, col_text, col_len, column_len);
       break;
 
     case COL_CLS_TIME:
@@ -3711,11 +4051,11 @@ print_columns(capture_file *cf)
     case COL_UTC_TIME:
     case COL_UTC_YMD_TIME:  /* XXX - wider */
     case COL_UTC_YDOY_TIME: /* XXX - wider */
-      column_len = col_len = strlen(cf->cinfo.col_data[i]);
+      column_len = col_len = strlen(col_text);
       if (column_len < 10)
         column_len = 10;
       line_bufp = get_line_buf(buf_offset + column_len);
-      put_spaces_string(line_bufp + buf_offset, cf->cinfo.col_data[i], col_len, column_len);
+      put_spaces_string(line_bufp + buf_offset, col_text, col_len, column_len);
       break;
 
     case COL_DEF_SRC:
@@ -3727,11 +4067,11 @@ print_columns(capture_file *cf)
     case COL_DEF_NET_SRC:
     case COL_RES_NET_SRC:
     case COL_UNRES_NET_SRC:
-      column_len = col_len = strlen(cf->cinfo.col_data[i]);
+      column_len = col_len = strlen(col_text);
       if (column_len < 12)
         column_len = 12;
       line_bufp = get_line_buf(buf_offset + column_len);
-      put_spaces_string(line_bufp + buf_offset, cf->cinfo.col_data[i], col_len, column_len);
+      put_spaces_string(line_bufp + buf_offset, col_text, col_len, column_len);
       break;
 
     case COL_DEF_DST:
@@ -3743,17 +4083,17 @@ print_columns(capture_file *cf)
     case COL_DEF_NET_DST:
     case COL_RES_NET_DST:
     case COL_UNRES_NET_DST:
-      column_len = col_len = strlen(cf->cinfo.col_data[i]);
+      column_len = col_len = strlen(col_text);
       if (column_len < 12)
         column_len = 12;
       line_bufp = get_line_buf(buf_offset + column_len);
-      put_string_spaces(line_bufp + buf_offset, cf->cinfo.col_data[i], col_len, column_len);
+      put_string_spaces(line_bufp + buf_offset, col_text, col_len, column_len);
       break;
 
     default:
-      column_len = strlen(cf->cinfo.col_data[i]);
+      column_len = strlen(col_text);
       line_bufp = get_line_buf(buf_offset + column_len);
-      put_string(line_bufp + buf_offset, cf->cinfo.col_data[i], column_len);
+      put_string(line_bufp + buf_offset, col_text, column_len);
       break;
     }
     buf_offset += column_len;
@@ -3904,11 +4244,11 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
 {
   print_args_t print_args;
 
-  if (print_summary || output_fields_has_cols(output_fields)) {
+  if (print_summary || adapt_drop_details || output_fields_has_cols(output_fields)) {
     /* Just fill in the columns. */
     epan_dissect_fill_in_columns(edt, FALSE, TRUE);
 
-    if (print_summary) {
+    if (print_summary || adapt_drop_details) {
       /* Now print them. */
       switch (output_action) {
 
@@ -3926,7 +4266,7 @@ print_packet(capture_file *cf, epan_dissect_t *edt)
       }
     }
   }
-  if (print_details) {
+  if (print_details && !adapt_drop_details) {
     /* Print the information in the protocol tree. */
     switch (output_action) {
 
@@ -4006,6 +4346,7 @@ cf_open(capture_file *cf, const char *fname, unsigned int type, gboolean is_temp
   gchar *err_info;
   char   err_msg[2048+1];
 
+  wtap_set_seek_index(prefs.gui_fileopen_seek_index);
   wth = wtap_open_offline(fname, type, err, &err_info, perform_two_pass_analysis);
   if (wth == NULL)
     goto fail;
@@ -662,6 +662,9 @@ packet_list_change_record(PacketList *packet_list, PacketListRecord *record, gin
 	if (text_col == -1 || record->col_text[text_col] != NULL)
 		return;
 
+	/* Format the column now that we know we need it */
+	col_get_data(cinfo, col);
+
 	switch (cfile.cinfo.col_fmt[col]) {
 		case COL_DEF_SRC:
 		case COL_RES_SRC:	/* COL_DEF_SRC is currently just like COL_RES_SRC */
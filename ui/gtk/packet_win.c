@@ -174,7 +174,7 @@ create_packet_window_title(void)
 	 * frame was dissected.
 	 */
 	for (i = 0; i < cfile.cinfo.num_cols; ++i) {
-		g_string_append(title, cfile.cinfo.col_data[i]);
+		g_string_append(title, col_get_data(&cfile.cinfo, i));
 		g_string_append_c(title, ' ');
 	}
 
@@ -285,8 +285,10 @@ finfo_window_refresh(struct FieldinfoWinData *DataPtr)
 	if (finfo->rep == NULL) {
 		proto_item_fill_label(finfo, label_str);
 		gtk_entry_set_text(GTK_ENTRY(DataPtr->repr), label_str);
-	} else
+	} else {
+		proto_item_render_label(finfo);
 		gtk_entry_set_text(GTK_ENTRY(DataPtr->repr), finfo->rep->representation);
+	}
 
 	epan_dissect_cleanup(&edt);
 	return TRUE;
@@ -438,6 +438,7 @@ static gchar* ph_capture_get_description(capture_file *cf)
 {
 	gchar *buffer = NULL;
 
+	proto_item_render_label(cf->finfo_selected);
 	if(cf->finfo_selected->rep &&
 	   strlen(cf->finfo_selected->rep->representation) > 0)
 	{
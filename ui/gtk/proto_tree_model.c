@@ -157,8 +157,10 @@ fi_get_string(field_info *fi)
 	if (!fi->rep) {
 		label_ptr = label_str;
 		proto_item_fill_label(fi, label_str);
-	} else
+	} else {
+		proto_item_render_label(fi);
 		label_ptr = fi->rep->representation;
+	}
 
 	if (FI_GET_FLAG(fi, FI_GENERATED)) {
 		if (FI_GET_FLAG(fi, FI_HIDDEN))
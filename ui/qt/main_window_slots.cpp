@@ -1423,6 +1423,7 @@ void MainWindow::actionEditCopyTriggered(MainWindow::CopySelected selection_type
 
     switch(selection_type) {
     case CopySelectedDescription:
+        proto_item_render_label(cap_file_->finfo_selected);
         if (cap_file_->finfo_selected->rep &&
                 strlen (cap_file_->finfo_selected->rep->representation) > 0) {
             clip.append(cap_file_->finfo_selected->rep->representation);
@@ -241,6 +241,9 @@ PacketList::PacketList(QWidget *parent) :
     setModel(packet_list_model_);
     packet_list_model_->setColorEnabled(recent.packet_list_colorize);
 
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)),
+            this, SLOT(vScrollBarValueChanged(int)));
+
     // XXX We might want to reimplement setParent() and fill in the context
     // menu there.
     ctx_menu_.addAction(window()->findChild<QAction *>("actionEditMarkPacket"));
@@ -592,6 +595,8 @@ void PacketList::updateAll() {
 
 void PacketList::freeze()
 {
+    // Don't dissect in the background while the file is being (re)read.
+    packet_list_model_->prefetchRows(-1, -1);
     setUpdatesEnabled(false);
     setModel(NULL);
 }
@@ -915,6 +920,19 @@ void PacketList::addRelatedFrame(int related_frame)
     related_packet_delegate_.addRelatedFrame(related_frame);
 }
 
+// Warm the column text cache around the rows we've just scrolled to.
+void PacketList::vScrollBarValueChanged(int)
+{
+    QModelIndex first = indexAt(viewport()->rect().topLeft());
+    QModelIndex last = indexAt(viewport()->rect().bottomLeft());
+
+    if (!first.isValid())
+        return;
+
+    packet_list_model_->prefetchRows(first.row(),
+            last.isValid() ? last.row() : packet_list_model_->rowCount() - 1);
+}
+
 /*
  * Editor modelines
  *
@@ -95,6 +95,7 @@ public slots:
 
 private slots:
     void addRelatedFrame(int related_frame);
+    void vScrollBarValueChanged(int);
 };
 
 #endif // PACKET_LIST_H
@@ -26,22 +26,265 @@
 #include <epan/column.h>
 #include <wsutil/nstime.h>
 #include <epan/prefs.h>
+#include <epan/timestamp.h>
 
 #include "ui/packet_list_utils.h"
+#include "ui/progress_dlg.h"
 #include "ui/recent.h"
 
 #include "color.h"
 #include "color_filters.h"
-#include "frame_tvbuff.h"
 
 #include "wireshark_application.h"
 #include <QColor>
+#include <QElapsedTimer>
 #include <QModelIndex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+
+// Upper bound for the column text cache, in bytes.
+static const int max_col_text_cache_cost_ = 64 * 1024 * 1024;
+// How long a prefetch step may keep the UI thread busy, in milliseconds.
+static const int prefetch_step_ms_ = 20;
+// Don't bother with worker threads when sorting fewer rows than this.
+static const int min_parallel_sort_rows_ = 20000;
+
+// A visible row's sort key. Which value is used depends on the column.
+struct PacketSortKey {
+    PacketListRecord *record;
+    guint32 num;        // Frame number; breaks ties
+    int group;          // Reference time frames sort before all others
+    gint64 int_val;
+    double dbl_val;
+    QByteArray text;
+};
+
+enum PacketSortKeyType { sort_key_int_, sort_key_double_, sort_key_text_ };
+
+class PacketSortKeyLessThan
+{
+public:
+    PacketSortKeyLessThan(PacketSortKeyType type, Qt::SortOrder order) :
+        type_(type), descending_(order == Qt::DescendingOrder) {}
+
+    bool operator()(const PacketSortKey &a, const PacketSortKey &b) const {
+        int ret = compare(a, b);
+        return descending_ ? ret > 0 : ret < 0;
+    }
+
+private:
+    int compare(const PacketSortKey &a, const PacketSortKey &b) const {
+        if (a.group != b.group)
+            return a.group < b.group ? -1 : 1;
+
+        switch (type_) {
+        case sort_key_int_:
+            if (a.int_val != b.int_val)
+                return a.int_val < b.int_val ? -1 : 1;
+            break;
+        case sort_key_double_:
+            if (a.dbl_val != b.dbl_val)
+                return a.dbl_val < b.dbl_val ? -1 : 1;
+            break;
+        case sort_key_text_:
+            // Interned strings share their data.
+            if (a.text.constData() != b.text.constData()) {
+                int ret = qstrcmp(a.text, b.text);
+                if (ret != 0)
+                    return ret;
+            }
+            break;
+        }
+
+        if (a.num != b.num)
+            return a.num < b.num ? -1 : 1;
+        return 0;
+    }
+
+    PacketSortKeyType type_;
+    bool descending_;
+};
+
+// Sorts a range of keys, or merges two sorted neighbouring ranges.
+class PacketSortRunnable : public QRunnable
+{
+public:
+    PacketSortRunnable(PacketSortKey *first, PacketSortKey *middle, PacketSortKey *last,
+                       const PacketSortKeyLessThan &less_than) :
+        first_(first), middle_(middle), last_(last), less_than_(less_than) {}
+
+    void run() {
+        if (middle_)
+            std::inplace_merge(first_, middle_, last_, less_than_);
+        else
+            std::sort(first_, last_, less_than_);
+    }
+
+private:
+    PacketSortKey *first_;
+    PacketSortKey *middle_;
+    PacketSortKey *last_;
+    PacketSortKeyLessThan less_than_;
+};
+
+// Sort the keys in one chunk per core, then merge the chunks pairwise.
+// The comparison only looks at the keys, so it is safe to do this off
+// the UI thread.
+static void
+parallelSortKeys(QVector<PacketSortKey> &keys, const PacketSortKeyLessThan &less_than)
+{
+    int count = keys.count();
+    int chunks = QThread::idealThreadCount();
+    QThreadPool pool;
+    PacketSortKey *base;
+    int chunk_size;
+
+    if (count < 2)
+        return;
+
+    base = keys.data();
+    if (chunks < 2 || count < min_parallel_sort_rows_) {
+        std::sort(base, base + count, less_than);
+        return;
+    }
+
+    pool.setMaxThreadCount(chunks);
+    chunk_size = (count + chunks - 1) / chunks;
+    for (int first = 0; first < count; first += chunk_size) {
+        int last = qMin(first + chunk_size, count);
+        pool.start(new PacketSortRunnable(base + first, NULL, base + last, less_than));
+    }
+    pool.waitForDone();
+
+    for (int width = chunk_size; width < count; width *= 2) {
+        for (int first = 0; first + width < count; first += width * 2) {
+            int last = qMin(first + width * 2, count);
+            pool.start(new PacketSortRunnable(base + first, base + first + width, base + last, less_than));
+        }
+        pool.waitForDone();
+    }
+}
+
+// Sort key of a column based on frame_data, matching frame_data_compare().
+static void
+frameDataSortKey(const struct epan_session *epan, const frame_data *fdata, int col_fmt, PacketSortKey *key)
+{
+    nstime_t ts;
+    guint32 prev_num = 0;
+    gboolean delta = FALSE;
+
+    nstime_set_zero(&ts);
+    switch (col_fmt) {
+    case COL_NUMBER:
+        key->int_val = fdata->num;
+        return;
+    case COL_PACKET_LENGTH:
+        key->int_val = fdata->pkt_len;
+        return;
+    case COL_CUMULATIVE_BYTES:
+        key->int_val = fdata->cum_bytes;
+        return;
+    case COL_CLS_TIME:
+        switch (timestamp_get_type()) {
+        case TS_RELATIVE:
+            prev_num = fdata->frame_ref_num;
+            delta = TRUE;
+            break;
+        case TS_DELTA:
+            prev_num = fdata->num - 1;
+            delta = TRUE;
+            break;
+        case TS_DELTA_DIS:
+            prev_num = fdata->prev_dis_num;
+            delta = TRUE;
+            break;
+        case TS_NOT_SET:
+            key->int_val = 0;
+            return;
+        default:
+            break;
+        }
+        break;
+    case COL_REL_TIME:
+        prev_num = fdata->frame_ref_num;
+        delta = TRUE;
+        break;
+    case COL_DELTA_TIME:
+        prev_num = fdata->num - 1;
+        delta = TRUE;
+        break;
+    case COL_DELTA_TIME_DIS:
+        prev_num = fdata->prev_dis_num;
+        delta = TRUE;
+        break;
+    default:
+        break;
+    }
+
+    if (delta)
+        frame_delta_abs_time(epan, fdata, prev_num, &ts);
+    else
+        ts = fdata->abs_ts;
+    key->group = fdata->flags.ref_time ? 0 : 1;
+    key->int_val = (gint64) ts.secs * G_GINT64_CONSTANT(1000000000) + ts.nsecs;
+}
+
+// Custom columns of these fields are sorted by value, as in the GTK+ UI.
+static bool
+customColumnIsNumeric(const header_field_info *hfi)
+{
+    if (hfi->strings != NULL)
+        return false;
+
+    if ((IS_FT_INT(hfi->type) || IS_FT_UINT(hfi->type)) &&
+        (hfi->display == BASE_DEC || hfi->display == BASE_DEC_HEX || hfi->display == BASE_OCT))
+        return true;
+
+    switch (hfi->type) {
+    case FT_DOUBLE:
+    case FT_FLOAT:
+    case FT_BOOLEAN:
+    case FT_FRAMENUM:
+    case FT_RELATIVE_TIME:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// How the rows of a column are compared.
+static PacketSortKeyType
+sortKeyType(column_info *cinfo, int column)
+{
+    if (col_based_on_frame_data(cinfo, column))
+        return sort_key_int_;
+
+    if (cinfo->col_fmt[column] == COL_CUSTOM) {
+        header_field_info *hfi = proto_registrar_get_byname(cinfo->col_custom_field[column]);
+
+        if (hfi == NULL)
+            return sort_key_int_;   /* Sorted by frame number */
+        if (customColumnIsNumeric(hfi))
+            return sort_key_double_;
+    }
+    return sort_key_text_;
+}
 
 PacketListModel::PacketListModel(QObject *parent, capture_file *cf) :
-    QAbstractItemModel(parent)
+    QAbstractItemModel(parent),
+    col_text_cache_(max_col_text_cache_cost_),
+    sort_column_(-1),
+    sort_order_(Qt::AscendingOrder),
+    sort_in_progress_(false)
 {
     cap_file_ = cf;
+
+    prefetch_timer_.setSingleShot(true);
+    prefetch_timer_.setInterval(0);
+    connect(&prefetch_timer_, SIGNAL(timeout()), this, SLOT(prefetchStep()));
 }
 
 void PacketListModel::setCaptureFile(capture_file *cf)
@@ -92,27 +335,252 @@ guint PacketListModel::recreateVisibleRows()
         }
     }
     endInsertRows();
+    if (sort_column_ >= 0)
+        sort(sort_column_, sort_order_);
     return visible_rows_.count();
 }
 
 void PacketListModel::setColorEnabled(bool enable_color) {
     enable_color_ = enable_color;
+    col_text_cache_.clear();
 }
 
 void PacketListModel::clear() {
     beginResetModel();
+    prefetch_timer_.stop();
+    prefetch_rows_.clear();
+    col_text_cache_.clear();
+    PacketListRecord::clearStringPool();
     physical_rows_.clear();
     visible_rows_.clear();
     number_to_row_.clear();
+    sort_column_ = -1;
     endResetModel();
 }
 
 void PacketListModel::resetColumns()
 {
     beginResetModel();
+    col_text_cache_.clear();
     endResetModel();
 }
 
+// Return the column text for a record, dissecting its frame if we don't
+// have the text cached.
+const ColumnTextList *PacketListModel::columnText(PacketListRecord *record) const
+{
+    frame_data *fdata = record->getFdata();
+    ColumnTextList *col_text = col_text_cache_.object(fdata->num);
+
+    if (col_text)
+        return col_text;
+
+    col_text = record->dissectColumns(cap_file_, enable_color_);
+    if (!col_text)
+        return NULL;
+
+    // QCache deletes the list right away if it can't hold it.
+    if (!col_text_cache_.insert(fdata->num, col_text, PacketListRecord::columnTextCost(col_text)))
+        return NULL;
+
+    return col_text;
+}
+
+// Queue the rows in view, the page below and the page above them for
+// dissection so that scrolling finds them in the cache. Dissection isn't
+// thread safe, so the work is done on the UI thread in short steps
+// between events rather than in a worker thread.
+void PacketListModel::prefetchRows(int first_row, int last_row)
+{
+    int page = last_row - first_row + 1;
+    int row;
+
+    prefetch_rows_.clear();
+    if (!cap_file_ || first_row < 0 || last_row < first_row)
+        return;
+
+    for (row = first_row; row <= last_row + page && row < visible_rows_.count(); row++)
+        prefetch_rows_ << row;
+    for (row = first_row - 1; row >= first_row - page && row >= 0; row--)
+        prefetch_rows_ << row;
+
+    prefetch_timer_.start();
+}
+
+void PacketListModel::prefetchStep()
+{
+    QElapsedTimer step_time;
+
+    if (!cap_file_ || cap_file_->state == FILE_CLOSED) {
+        prefetch_rows_.clear();
+        return;
+    }
+
+    step_time.start();
+    while (!prefetch_rows_.isEmpty() && step_time.elapsed() < prefetch_step_ms_) {
+        int row = prefetch_rows_.takeFirst();
+
+        if (row < visible_rows_.count())
+            columnText(visible_rows_[row]);
+    }
+
+    if (!prefetch_rows_.isEmpty())
+        prefetch_timer_.start();
+}
+
+// Sort the visible rows. Rows are compared by typed keys: frame_data
+// columns by their numbers and times, numeric custom columns by value and
+// everything else by text. Ties are broken by frame number.
+void PacketListModel::sort(int column, Qt::SortOrder order)
+{
+    if (!cap_file_ || sort_in_progress_ || column < 0 || column >= prefs.num_cols)
+        return;
+
+    // Capture order is the order we already keep the rows in.
+    if (cap_file_->cinfo.col_fmt[column] == COL_NUMBER && order == Qt::AscendingOrder) {
+        QVector<PacketListRecord *> rows;
+
+        sort_column_ = -1;
+        foreach (PacketListRecord *record, physical_rows_) {
+            if (record->getFdata()->flags.passed_dfilter || record->getFdata()->flags.ref_time)
+                rows << record;
+        }
+        setVisibleOrder(rows);
+        return;
+    }
+
+    if (visible_rows_.count() < 1)
+        return;
+
+    QVector<PacketSortKey> keys;
+
+    sort_in_progress_ = true;
+    bool filled = fillSortKeys(column, keys);
+    sort_in_progress_ = false;
+
+    if (!filled)
+        return;
+
+    parallelSortKeys(keys, PacketSortKeyLessThan(sortKeyType(&cap_file_->cinfo, column), order));
+
+    QVector<PacketListRecord *> rows;
+    rows.reserve(keys.count());
+    foreach (const PacketSortKey &key, keys) {
+        rows << key.record;
+    }
+    sort_column_ = column;
+    sort_order_ = order;
+    setVisibleOrder(rows);
+}
+
+// Fill in a key for each visible row. Columns that need a dissection are
+// read from the column text cache when possible; otherwise the frame is
+// dissected without displacing the cached rows. Returns false if the user
+// stopped us or the packet list changed under us.
+bool PacketListModel::fillSortKeys(int column, QVector<PacketSortKey> &keys)
+{
+    // Shares its data with visible_rows_ until the list changes.
+    const QVector<PacketListRecord *> rows = visible_rows_;
+    column_info *cinfo = &cap_file_->cinfo;
+    PacketSortKeyType key_type = sortKeyType(cinfo, column);
+    int col_fmt = col_based_on_frame_data(cinfo, column) ? cinfo->col_fmt[column] : COL_NUMBER;
+    int row_count = rows.count();
+    bool changed = false;
+
+    int         progbar_nextstep = 0;
+    int         progbar_quantum = row_count / 100;
+    gboolean    progbar_stop_flag = FALSE;
+    GTimeVal    progbar_start_time;
+    progdlg_t  *progbar = NULL;
+    gchar       progbar_status_str[100];
+
+    g_get_current_time(&progbar_start_time);
+
+    keys.resize(row_count);
+    for (int row = 0; row < row_count; row++) {
+        PacketListRecord *record = rows.at(row);
+        frame_data *fdata = record->getFdata();
+        PacketSortKey *key = &keys[row];
+
+        key->record = record;
+        key->num = fdata->num;
+        key->group = 0;
+        key->int_val = 0;
+        key->dbl_val = 0.0;
+
+        if (key_type == sort_key_int_) {
+            frameDataSortKey(cap_file_->epan, fdata, col_fmt, key);
+            continue;
+        }
+
+        ColumnTextList *col_text = col_text_cache_.object(fdata->num);
+        if (col_text) {
+            key->text = col_text->value(column);
+        } else {
+            col_text = record->dissectColumns(cap_file_, enable_color_);
+            if (col_text)
+                key->text = col_text->value(column);
+            delete col_text;
+        }
+        if (key_type == sort_key_double_)
+            key->dbl_val = g_ascii_strtod(key->text.constData(), NULL);
+
+        if (progbar == NULL)
+            progbar = delayed_create_progress_dlg(cap_file_->window, "Sorting", "Packets",
+                                                  TRUE, &progbar_stop_flag,
+                                                  &progbar_start_time, (gfloat) row / row_count);
+
+        if (row >= progbar_nextstep) {
+            if (progbar != NULL) {
+                g_snprintf(progbar_status_str, sizeof(progbar_status_str),
+                           "%u of %u frames", row + 1, row_count);
+                /* Note: this processes pending events, which may close the file. */
+                update_progress_dlg(progbar, (gfloat) row / row_count, progbar_status_str);
+                changed = cap_file_->state == FILE_CLOSED ||
+                          visible_rows_.constData() != rows.constData();
+            }
+            progbar_nextstep += progbar_quantum;
+        }
+
+        if (progbar_stop_flag || changed)
+            break;
+    }
+
+    if (progbar != NULL)
+        destroy_progress_dlg(progbar);
+
+    if (progbar_stop_flag || changed) {
+        keys.clear();
+        return false;
+    }
+    return true;
+}
+
+// Replace the visible rows, keeping the selection and other persistent
+// indexes on the same packets.
+void PacketListModel::setVisibleOrder(const QVector<PacketListRecord *> &rows)
+{
+    emit layoutAboutToBeChanged();
+
+    visible_rows_ = rows;
+    number_to_row_.clear();
+    for (int row = 0; row < visible_rows_.count(); row++) {
+        number_to_row_[visible_rows_[row]->getFdata()->num] = row;
+    }
+
+    QModelIndexList old_indexes = persistentIndexList();
+    QModelIndexList new_indexes;
+    foreach (const QModelIndex &old_index, old_indexes) {
+        PacketListRecord *record = static_cast<PacketListRecord *>(old_index.internalPointer());
+        int row = record ? packetNumberToRow(record->getFdata()->num) : -1;
+
+        new_indexes << (row < 0 ? QModelIndex() : index(row, old_index.column()));
+    }
+    changePersistentIndexList(old_indexes, new_indexes);
+
+    emit layoutChanged();
+}
+
 int PacketListModel::rowCount(const QModelIndex &parent) const
 {
     if (parent.column() >= prefs.num_cols)
@@ -199,98 +667,14 @@ QVariant PacketListModel::data(const QModelIndex &index, int role) const
     int col_num = index.column();
 //    g_log(NULL, G_LOG_LEVEL_DEBUG, "showing col %d", col_num);
 
-    if (col_num > prefs.num_cols)
+    if (col_num > prefs.num_cols || !cap_file_)
         return QVariant();
 
-    epan_dissect_t edt;
-    column_info *cinfo;
-    gboolean create_proto_tree;
-    struct wtap_pkthdr phdr; /* Packet header */
-    Buffer buf;  /* Packet data */
-    gboolean dissect_columns = TRUE; // XXX - Currently only a placeholder
-
-    if (dissect_columns && cap_file_)
-        cinfo = &cap_file_->cinfo;
-    else
-        cinfo = NULL;
-
-    memset(&phdr, 0, sizeof(struct wtap_pkthdr));
-
-    buffer_init(&buf, 1500);
-    if (!cap_file_ || !cf_read_record_r(cap_file_, fdata, &phdr, &buf)) {
-        /*
-         * Error reading the record.
-         *
-         * Don't set the color filter for now (we might want
-         * to colorize it in some fashion to warn that the
-         * row couldn't be filled in or colorized), and
-         * set the columns to placeholder values, except
-         * for the Info column, where we'll put in an
-         * error message.
-         */
-        if (dissect_columns) {
-            col_fill_in_error(cinfo, fdata, FALSE, FALSE /* fill_fd_columns */);
-
-            //            for(gint col = 0; col < cinfo->num_cols; ++col) {
-            //                /* Skip columns based on frame_data because we already store those. */
-            //                if (!col_based_on_frame_data(cinfo, col))
-            //                    packet_list_change_record(packet_list, record->physical_pos, col, cinfo);
-            //            }
-            //            record->columnized = TRUE;
-        }
-        if (enable_color_) {
-            fdata->color_filter = NULL;
-            //            record->colorized = TRUE;
-        }
-        buffer_free(&buf);
+    const ColumnTextList *col_text = columnText(record);
+    if (!col_text)
         return QVariant();	/* error reading the record */
-    }
-
-    create_proto_tree = (color_filters_used() && enable_color_) ||
-                        (have_custom_cols(cinfo) && dissect_columns);
-
-    epan_dissect_init(&edt, cap_file_->epan,
-                      create_proto_tree,
-                      FALSE /* proto_tree_visible */);
-
-    if (enable_color_)
-        color_filters_prime_edt(&edt);
-    if (dissect_columns)
-        col_custom_prime_edt(&edt, cinfo);
-
-    epan_dissect_run(&edt, cap_file_->cd_t, &phdr, frame_tvbuff_new_buffer(fdata, &buf), fdata, cinfo);
-
-    if (enable_color_)
-        fdata->color_filter = color_filters_colorize_packet(&edt);
-
-    if (dissect_columns) {
-        /* "Stringify" non frame_data vals */
-        epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
-
-        //            for(col = 0; col < cinfo->num_cols; ++col) {
-        //                    /* Skip columns based on frame_data because we already store those. */
-        //                    if (!col_based_on_frame_data(cinfo, col))
-        //                            packet_list_change_record(packet_list, record->physical_pos, col, cinfo);
-        //            }
-//        g_log(NULL, G_LOG_LEVEL_DEBUG, "d_c %d: %s", col_num, cinfo->col_data[col_num]);
-    }
 
-    //    if (dissect_columns)
-    //            record->columnized = TRUE;
-    //    if (enable_color_)
-    //            record->colorized = TRUE;
-
-    epan_dissect_cleanup(&edt);
-    buffer_free(&buf);
-
-    switch (role) {
-    case Qt::DisplayRole:
-        return record->data(col_num, cinfo);
-        break;
-    default:
-        break;
-    }
-    return QVariant();
+    return record->data(col_num, &cap_file_->cinfo, col_text);
 }
 
 QVariant PacketListModel::headerData(int section, Qt::Orientation orientation,
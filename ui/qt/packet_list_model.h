@@ -31,7 +31,9 @@
 #include <epan/packet.h>
 
 #include <QAbstractItemModel>
+#include <QCache>
 #include <QFont>
+#include <QTimer>
 #include <QVector>
 
 #include "packet_list_record.h"
@@ -62,12 +64,21 @@ public:
     frame_data *getRowFdata(int row);
     int visibleIndexOf(frame_data *fdata) const;
     void resetColumns();
+    void prefetchRows(int first_row, int last_row);
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
 
 signals:
 
 public slots:
 
+private slots:
+    void prefetchStep();
+
 private:
+    const ColumnTextList *columnText(PacketListRecord *record) const;
+    bool fillSortKeys(int column, QVector<struct PacketSortKey> &keys);
+    void setVisibleOrder(const QVector<PacketListRecord *> &rows);
+
     capture_file *cap_file_;
     QList<QString> col_names_;
     QVector<PacketListRecord *> visible_rows_;
@@ -77,6 +88,17 @@ private:
 
     int header_height_;
     bool enable_color_;
+
+    // Column text of recently shown rows, keyed by frame number and
+    // bounded by PacketListRecord::columnTextCost().
+    mutable QCache<guint32, ColumnTextList> col_text_cache_;
+    QTimer prefetch_timer_;
+    QList<int> prefetch_rows_;
+
+    // Column the visible rows are sorted by, -1 for capture order.
+    int sort_column_;
+    Qt::SortOrder sort_order_;
+    bool sort_in_progress_;
 };
 
 #endif // PACKET_LIST_MODEL_H
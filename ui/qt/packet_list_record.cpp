@@ -21,30 +21,148 @@
 
 #include "packet_list_record.h"
 
+#include <epan/epan_dissect.h>
+#include <epan/column.h>
+#include <epan/column-info.h>
+
+#include "color.h"
+#include "color_filters.h"
+#include "file.h"
+#include "frame_tvbuff.h"
+
+// Interned strings are dropped when there are this many of them; lists
+// already in the cache keep their (implicitly shared) copies.
+static const int max_string_pool_size_ = 100000;
+
+QSet<QByteArray> PacketListRecord::string_pool_;
+
 PacketListRecord::PacketListRecord(frame_data *frameData) :
-    //col_text_(NULL),
-    //col_text_len_(NULL),
     fdata_(frameData)
 {
 }
 
-QVariant PacketListRecord::data(int col_num, column_info *cinfo) const
+ColumnTextList *PacketListRecord::dissectColumns(capture_file *cap_file, bool dissect_color)
+{
+    g_assert(fdata_);
+
+    if (!cap_file)
+        return NULL;
+
+    epan_dissect_t edt;
+    column_info *cinfo = &cap_file->cinfo;
+    gboolean create_proto_tree;
+    struct wtap_pkthdr phdr; /* Packet header */
+    Buffer buf;  /* Packet data */
+
+    memset(&phdr, 0, sizeof(struct wtap_pkthdr));
+
+    buffer_init(&buf, 1500);
+    if (!cf_read_record_r(cap_file, fdata_, &phdr, &buf)) {
+        /*
+         * Error reading the record.
+         *
+         * Don't set the color filter for now (we might want
+         * to colorize it in some fashion to warn that the
+         * row couldn't be filled in or colorized), and
+         * set the columns to placeholder values, except
+         * for the Info column, where we'll put in an
+         * error message.
+         */
+        col_fill_in_error(cinfo, fdata_, FALSE, FALSE /* fill_fd_columns */);
+        if (dissect_color) {
+            fdata_->color_filter = NULL;
+        }
+        buffer_free(&buf);
+        return NULL;	/* error reading the record */
+    }
+
+    create_proto_tree = (color_filters_used() && dissect_color) ||
+                        have_custom_cols(cinfo);
+
+    epan_dissect_init(&edt, cap_file->epan,
+                      create_proto_tree,
+                      FALSE /* proto_tree_visible */);
+
+    if (dissect_color)
+        color_filters_prime_edt(&edt);
+    col_custom_prime_edt(&edt, cinfo);
+
+    epan_dissect_run(&edt, cap_file->cd_t, &phdr, frame_tvbuff_new_buffer(fdata_, &buf), fdata_, cinfo);
+
+    if (dissect_color)
+        fdata_->color_filter = color_filters_colorize_packet(&edt);
+
+    /* "Stringify" non frame_data vals */
+    epan_dissect_fill_in_columns(&edt, FALSE, FALSE /* fill_fd_columns */);
+
+    ColumnTextList *col_text = new ColumnTextList(cinfo->num_cols);
+    for (int column = 0; column < cinfo->num_cols; ++column) {
+        /* Skip columns based on frame_data because we already store those. */
+        if (col_based_on_frame_data(cinfo, column))
+            continue;
+
+        QByteArray text(col_get_data(cinfo, column));
+
+        /* The Info column is rarely the same twice; everything else is. */
+        if (cinfo->col_fmt[column] != COL_INFO) {
+            QSet<QByteArray>::const_iterator it = string_pool_.constFind(text);
+            if (it != string_pool_.constEnd()) {
+                text = *it;
+            } else {
+                if (string_pool_.size() >= max_string_pool_size_)
+                    string_pool_.clear();
+                string_pool_.insert(text);
+            }
+        }
+        (*col_text)[column] = text;
+    }
+
+    epan_dissect_cleanup(&edt);
+    buffer_free(&buf);
+
+    return col_text;
+}
+
+QVariant PacketListRecord::data(int col_num, column_info *cinfo, const ColumnTextList *col_text) const
 {
     g_assert(fdata_);
 
     if (!cinfo)
         return QVariant();
 
-    if (col_based_on_frame_data(cinfo, col_num))
+    if (col_based_on_frame_data(cinfo, col_num)) {
         col_fill_in_frame_data(fdata_, cinfo, col_num, FALSE);
+        return col_get_data(cinfo, col_num);
+    }
+
+    if (!col_text || col_num >= col_text->size())
+        return QVariant();
 
-    return cinfo->col_data[col_num];
+    return QString::fromUtf8(col_text->at(col_num));
 }
 
 frame_data *PacketListRecord::getFdata() {
     return fdata_;
 }
 
+int PacketListRecord::columnTextCost(const ColumnTextList *col_text)
+{
+    int cost = (int) sizeof(ColumnTextList);
+
+    if (!col_text)
+        return cost;
+
+    foreach (const QByteArray &text, *col_text) {
+        cost += (int) sizeof(QByteArray) + text.size();
+    }
+    return cost;
+}
+
+void PacketListRecord::clearStringPool()
+{
+    string_pool_.clear();
+}
+
 /*
  * Editor modelines
  *
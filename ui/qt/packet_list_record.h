@@ -29,35 +29,39 @@
 #include <epan/column-info.h>
 #include <epan/packet.h>
 
+#include "cfile.h"
+
+#include <QByteArray>
 #include <QList>
+#include <QSet>
 #include <QVariant>
+#include <QVector>
+
+/** The text of a frame's columns, indexed by column number. Columns based
+ * on frame_data are left empty; they are cheap to fill in on the fly. */
+typedef QVector<QByteArray> ColumnTextList;
 
 class PacketListRecord
 {
 public:
     PacketListRecord(frame_data *frameData);
-    QVariant data(int col_num, column_info *cinfo) const;
+    /** Dissect the frame, colorizing it if asked to, and return the text
+     * of its columns. The caller owns the list. Returns NULL if the frame
+     * couldn't be read. */
+    ColumnTextList *dissectColumns(capture_file *cap_file, bool dissect_color);
+    QVariant data(int col_num, column_info *cinfo, const ColumnTextList *col_text) const;
     frame_data *getFdata();
 
-private:
-    /** The column text for some columns */
-    //gchar **col_text_;
-    /**< The length of the column text strings in 'col_text' */
-    //guint *col_text_len_;
+    /** Approximate number of bytes held by a column text list. */
+    static int columnTextCost(const ColumnTextList *col_text);
+    /** Forget the interned strings. Cached lists keep their copies. */
+    static void clearStringPool();
 
+private:
     frame_data *fdata_;
 
-    /** Has this record been columnized? */
-    //gboolean columnized_;
-    /** Has this record been colorized? */
-    //gboolean colorized_;
-
-    /* admin stuff used by the custom list model */
-    /** position within the physical array */
-    //guint physical_pos_;
-    /** position within the visible array */
-    //gint visible_pos_;
-
+    /** Column strings shared between records, e.g. protocol names and addresses */
+    static QSet<QByteArray> string_pool_;
 };
 
 #endif // PACKET_LIST_RECORD_H
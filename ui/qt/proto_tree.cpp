@@ -60,6 +60,7 @@ proto_tree_draw_node(proto_node *node, gpointer data)
     // Fill in our label
     /* was a free format label produced? */
     if (fi->rep) {
+        proto_item_render_label(fi);
         label_ptr = fi->rep->representation;
     }
     else { /* no, make a generic label */
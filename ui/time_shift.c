@@ -34,11 +34,6 @@
 
 #include "ui/ui_util.h"
 
-#define	SHIFT_POS		0
-#define	SHIFT_NEG		1
-#define	SHIFT_SETTOZERO		1
-#define	SHIFT_KEEPOFFSET	0
-
 #define CHECK_YEARS(Y)							\
   if (*Y < 1970) {							\
     return "Years must be larger than 1970";				\
@@ -69,26 +64,6 @@
     return "Seconds must be between [0..59]";		    \
   }
 
-static void
-modify_time_perform(frame_data *fd, int neg, nstime_t *offset, int settozero)
-{
-  /* The actual shift */
-  if (settozero == SHIFT_SETTOZERO) {
-    nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-    nstime_set_zero(&(fd->shift_offset));
-  }
-
-  if (neg == SHIFT_POS) {
-    nstime_add(&(fd->abs_ts), offset);
-    nstime_add(&(fd->shift_offset), offset);
-  } else if (neg == SHIFT_NEG) {
-    nstime_subtract(&(fd->abs_ts), offset);
-    nstime_subtract(&(fd->shift_offset), offset);
-  } else {
-    fprintf(stderr, "Modify_time_perform: neg = %d?\n", neg);
-  }
-}
-
 /*
  * If the line between (OT1, NT1) and (OT2, NT2) is a straight line
  * and (OT3, NT3) is on that line,
@@ -270,7 +245,7 @@ time_string_to_nstime(const gchar *time_text, nstime_t *packettime, nstime_t *ns
 const gchar *
 time_shift_all(capture_file *cf, const gchar *offset_text)
 {
-    nstime_t	offset;
+    nstime_t	offset, delta;
     long double	offset_float = 0;
     guint32	i;
     frame_data	*fd;
@@ -295,14 +270,23 @@ time_shift_all(capture_file *cf, const gchar *offset_text)
     offset_float -= offset.secs;
     offset.nsecs = (int)(offset_float * 1000000000);
 
+    nstime_set_zero(&delta);
+    if (neg)
+        nstime_subtract(&delta, &offset);
+    else
+        nstime_add(&delta, &offset);
+
     if (!frame_data_sequence_find(cf->frames, 1))
         return "No frames found."; /* Shouldn't happen */
 
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->frames, i)) == NULL)
             continue;	/* Shouldn't happen */
-        modify_time_perform(fd, neg ? SHIFT_NEG : SHIFT_POS, &offset, SHIFT_KEEPOFFSET);
+        nstime_add(&(fd->abs_ts), &delta);
     }
+    /* Every frame moves by the same amount, so there's no need to touch
+       their offsets one by one. */
+    frame_data_sequence_add_shift_offset(cf->frames, &delta);
     packet_list_queue_draw();
 
     return NULL;
@@ -328,7 +312,8 @@ time_shift_settime(capture_file *cf, guint packet_num, const gchar *time_text)
      */
     if ((packetfd = frame_data_sequence_find(cf->frames, packet_num)) == NULL)
         return "No packets found.";
-    nstime_delta(&packet_time, &(packetfd->abs_ts), &(packetfd->shift_offset));
+    nstime_delta(&packet_time, &(packetfd->abs_ts),
+                 frame_data_sequence_get_shift_offset(cf->frames, packetfd));
 
     if ((err_str = time_string_to_nstime(time_text, &packet_time, &set_time)) != NULL)
         return err_str;
@@ -341,12 +326,14 @@ time_shift_settime(capture_file *cf, guint packet_num, const gchar *time_text)
     if (!frame_data_sequence_find(cf->frames, 1))
         return "No frames found."; /* Shouldn't happen */
 
-    /* Set everything back to the original time */
+    /* Set everything back to the original time, and shift it from there */
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->frames, i)) == NULL)
             continue;	/* Shouldn't happen */
-        modify_time_perform(fd, SHIFT_POS, &diff_time, SHIFT_SETTOZERO);
+        nstime_subtract(&(fd->abs_ts), frame_data_sequence_get_shift_offset(cf->frames, fd));
+        nstime_add(&(fd->abs_ts), &diff_time);
     }
+    frame_data_sequence_set_all_shift_offsets(cf->frames, &diff_time);
 
     packet_list_queue_draw();
     return NULL;
@@ -387,7 +374,7 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
     if ((packet1fd = frame_data_sequence_find(cf->frames, packet1_num)) == NULL)
         return "No frames found.";
     nstime_copy(&ot1, &(packet1fd->abs_ts));
-    nstime_subtract(&ot1, &(packet1fd->shift_offset));
+    nstime_subtract(&ot1, frame_data_sequence_get_shift_offset(cf->frames, packet1fd));
 
     if ((err_str = time_string_to_nstime(time1_text, &ot1, &nt1)) != NULL)
         return err_str;
@@ -399,7 +386,7 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
     if ((packet2fd = frame_data_sequence_find(cf->frames, packet2_num)) == NULL)
         return "No frames found.";
     nstime_copy(&ot2, &(packet2fd->abs_ts));
-    nstime_subtract(&ot2, &(packet2fd->shift_offset));
+    nstime_subtract(&ot2, frame_data_sequence_get_shift_offset(cf->frames, packet2fd));
 
     if ((err_str = time_string_to_nstime(time2_text, &ot2, &nt2)) != NULL)
         return err_str;
@@ -419,16 +406,17 @@ time_shift_adjtime(capture_file *cf, guint packet1_num, const gchar *time1_text,
             continue;	/* Shouldn't happen */
 
         /* Set everything back to the original time */
-        nstime_subtract(&(fd->abs_ts), &(fd->shift_offset));
-        nstime_set_zero(&(fd->shift_offset));
+        nstime_subtract(&(fd->abs_ts), frame_data_sequence_get_shift_offset(cf->frames, fd));
 
-        /* Add the difference to each packet */
+        /* Add the difference to each packet; each one gets an offset of
+           its own */
         calcNT3(&ot1, &(fd->abs_ts), &nt1, &nt3, &dot, &dnt);
 
         nstime_copy(&d3t, &nt3);
         nstime_subtract(&d3t, &(fd->abs_ts));
 
-        modify_time_perform(fd, SHIFT_POS, &d3t, SHIFT_SETTOZERO);
+        nstime_copy(&(fd->abs_ts), &nt3);
+        frame_data_sequence_set_shift_offset(cf->frames, fd, &d3t);
     }
 
     packet_list_queue_draw();
@@ -453,8 +441,9 @@ time_shift_undo(capture_file *cf)
     for (i = 1; i <= cf->count; i++) {
         if ((fd = frame_data_sequence_find(cf->frames, i)) == NULL)
             continue;	/* Shouldn't happen */
-        modify_time_perform(fd, SHIFT_NEG, &nulltime, SHIFT_SETTOZERO);
+        nstime_subtract(&(fd->abs_ts), frame_data_sequence_get_shift_offset(cf->frames, fd));
     }
+    frame_data_sequence_set_all_shift_offsets(cf->frames, &nulltime);
     packet_list_queue_draw();
     return NULL;
 }
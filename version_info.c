@@ -31,6 +31,14 @@
 #include <zlib.h>	/* to get the libz version number */
 #endif
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>	/* to get the Zstandard version number */
+#endif
+
+#ifdef HAVE_LZ4
+#include <lz4.h>	/* to get the LZ4 version number */
+#endif
+
 #include "version_info.h"
 #include "capture-pcap-util.h"
 #include <wsutil/os_version_info.h>
@@ -120,6 +128,22 @@ get_compiled_version_info(GString *str, void (*prepend_info)(GString *),
 	g_string_append(str, "without libz");
 #endif /* HAVE_LIBZ */
 
+	/* Zstandard */
+	g_string_append(str, ", ");
+#ifdef HAVE_ZSTD
+	g_string_append(str, "with Zstandard " ZSTD_VERSION_STRING);
+#else /* HAVE_ZSTD */
+	g_string_append(str, "without Zstandard");
+#endif /* HAVE_ZSTD */
+
+	/* LZ4 */
+	g_string_append(str, ", ");
+#ifdef HAVE_LZ4
+	g_string_append(str, "with LZ4 " LZ4_VERSION_STRING);
+#else /* HAVE_LZ4 */
+	g_string_append(str, "without LZ4");
+#endif /* HAVE_LZ4 */
+
 #ifndef _WIN32
 	/* This is UN*X-only. */
 	/* LIBCAP */
@@ -1916,7 +1916,7 @@ gboolean wtap_dump_can_open(int file_type_subtype)
 	return TRUE;
 }
 
-#ifdef HAVE_LIBZ
+#if defined(HAVE_LIBZ) || defined(HAVE_FRAME_COMPRESSION)
 gboolean wtap_dump_can_compress(int file_type_subtype)
 {
 	/*
@@ -1937,6 +1937,70 @@ gboolean wtap_dump_can_compress(int file_type_subtype _U_)
 }
 #endif
 
+gboolean wtap_can_write_compression_type(wtap_compression_type compression_type)
+{
+	switch (compression_type) {
+
+	case WTAP_UNCOMPRESSED:
+		return TRUE;
+
+#ifdef HAVE_LIBZ
+	case WTAP_GZIP_COMPRESSED:
+		return TRUE;
+#endif
+
+#ifdef HAVE_ZSTD
+	case WTAP_ZSTD_COMPRESSED:
+		return TRUE;
+#endif
+
+#ifdef HAVE_LZ4
+	case WTAP_LZ4_COMPRESSED:
+		return TRUE;
+#endif
+
+	default:
+		return FALSE;
+	}
+}
+
+static const struct {
+	wtap_compression_type compression_type;
+	const char *extension;
+	const char *name;
+} compression_types[] = {
+	{ WTAP_GZIP_COMPRESSED, "gz",  "gzip" },
+	{ WTAP_ZSTD_COMPRESSED, "zst", "zstd" },
+	{ WTAP_LZ4_COMPRESSED,  "lz4", "LZ4" }
+};
+
+wtap_compression_type wtap_extension_to_compression_type(const char *filename)
+{
+	const char *extensionp;
+	guint i;
+
+	extensionp = strrchr(filename, '.');
+	if (extensionp == NULL)
+		return WTAP_UNCOMPRESSED;
+	extensionp++;
+	for (i = 0; i < G_N_ELEMENTS(compression_types); i++) {
+		if (g_ascii_strcasecmp(extensionp, compression_types[i].extension) == 0)
+			return compression_types[i].compression_type;
+	}
+	return WTAP_UNCOMPRESSED;
+}
+
+const char *wtap_compression_type_name(wtap_compression_type compression_type)
+{
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS(compression_types); i++) {
+		if (compression_types[i].compression_type == compression_type)
+			return compression_types[i].name;
+	}
+	return "uncompressed";
+}
+
 gboolean wtap_dump_has_name_resolution(int file_type_subtype)
 {
 	if (file_type_subtype < 0 || file_type_subtype >= wtap_num_file_types_subtypes
@@ -1960,10 +2024,11 @@ gboolean wtap_dump_supports_comment_types(int file_type_subtype, guint32 comment
 	return FALSE;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean comressed, int *err);
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap,
+					wtap_compression_type compression_type, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err);
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err);
+					wtap_compression_type compression_type, int *err);
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, int *err);
 
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
@@ -1976,13 +2041,14 @@ wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int enc
 }
 
 static wtap_dumper *
-wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean compressed,
-    wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen,
+    wtap_compression_type compression_type, wtapng_section_t *shb_hdr,
+    wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 
 	/* Allocate a data structure for the output stream. */
-	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compressed, err);
+	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compression_type, err);
 	if (wdh == NULL)
 		return NULL;	/* couldn't allocate it */
 
@@ -2018,24 +2084,31 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 
 wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
 				int snaplen, gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+{
+	return wtap_dump_open_compressed(filename, file_type_subtype, encap, snaplen,
+	    compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED, shb_hdr, idb_inf, err);
+}
+
+wtap_dumper* wtap_dump_open_compressed(const char *filename, int file_type_subtype, int encap,
+				int snaplen, wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdr, idb_inf, err);
 	if (wdh == NULL)
 		return NULL;
 
 	/* "-" means stdout */
 	if (strcmp(filename, "-") == 0) {
-		if (compressed) {
+		if (wdh->compressed) {
 			*err = EINVAL;	/* XXX - return a Wiretap error code for this */
 			g_free(wdh);
 			return NULL;	/* compress won't work on stdout */
@@ -2062,7 +2135,7 @@ wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int
 		wdh->fh = fh;
 	}
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		if (wdh->fh != stdout) {
@@ -2083,17 +2156,24 @@ wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snap
 
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 				gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+{
+	return wtap_dump_fdopen_compressed(fd, file_type_subtype, encap, snaplen,
+	    compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED, shb_hdr, idb_inf, err);
+}
+
+wtap_dumper* wtap_dump_fdopen_compressed(int fd, int file_type_subtype, int encap, int snaplen,
+				wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdr, idb_inf, err);
 	if (wdh == NULL)
 		return NULL;
@@ -2120,7 +2200,7 @@ wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int s
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, err)) {
 		wtap_dump_file_close(wdh);
 		g_free(wdh);
 		return NULL;
@@ -2128,7 +2208,8 @@ wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int s
 	return wdh;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err)
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap,
+				     wtap_compression_type compression_type, int *err)
 {
 	if (!wtap_dump_can_open(file_type_subtype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -2151,8 +2232,11 @@ static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean
 	if (*err != 0)
 		return FALSE;
 
-	/* if compression is wanted, do we support this for this file_type_subtype? */
-	if(compressed && !wtap_dump_can_compress(file_type_subtype)) {
+	/* if compression is wanted, do we support this for this file_type_subtype,
+	   and do we support that type of compression? */
+	if(compression_type != WTAP_UNCOMPRESSED &&
+	    (!wtap_dump_can_compress(file_type_subtype) ||
+	     !wtap_can_write_compression_type(compression_type))) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return FALSE;
 	}
@@ -2162,7 +2246,7 @@ static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean
 }
 
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err)
+					wtap_compression_type compression_type, int *err)
 {
 	wtap_dumper *wdh;
 
@@ -2175,19 +2259,20 @@ static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int sn
 	wdh->file_type_subtype = file_type_subtype;
 	wdh->snaplen = snaplen;
 	wdh->encap = encap;
-	wdh->compressed = compressed;
+	wdh->compression_type = compression_type;
+	wdh->compressed = compression_type != WTAP_UNCOMPRESSED;
 	wdh->wslua_data = NULL;
 	return wdh;
 }
 
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err)
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, int *err)
 {
 	int fd;
 	gboolean cant_seek;
 
 	/* Can we do a seek on the file descriptor?
 	   If not, note that fact. */
-	if(compressed) {
+	if(wdh->compressed) {
 		cant_seek = TRUE;
 	} else {
 		fd = fileno((FILE *)wdh->fh);
@@ -2229,9 +2314,14 @@ gboolean wtap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
 void wtap_dump_flush(wtap_dumper *wdh)
 {
 #ifdef HAVE_LIBZ
-	if(wdh->compressed) {
+	if(wdh->compression_type == WTAP_GZIP_COMPRESSED) {
 		gzwfile_flush((GZWFILE_T)wdh->fh);
 	} else
+#endif
+#ifdef HAVE_FRAME_COMPRESSION
+	if(wdh->compressed) {
+		frwfile_flush((FRWFILE_T)wdh->fh);
+	} else
 #endif
 	{
 		fflush((FILE *)wdh->fh);
@@ -2290,38 +2380,40 @@ gboolean wtap_dump_set_addrinfo_list(wtap_dumper *wdh, addrinfo_lists_t *addrinf
 }
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
-	if(wdh->compressed) {
+#ifdef HAVE_LIBZ
+	if(wdh->compression_type == WTAP_GZIP_COMPRESSED) {
 		return gzwfile_open(filename);
-	} else {
+	} else
+#endif
+#ifdef HAVE_FRAME_COMPRESSION
+	if(wdh->compressed) {
+		return frwfile_open(filename, wdh->compression_type);
+	} else
+#endif
+	{
 		return ws_fopen(filename, "wb");
 	}
 }
-#else
-static WFILE_T wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
-{
-	return ws_fopen(filename, "wb");
-}
-#endif
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
-	if(wdh->compressed) {
+#ifdef HAVE_LIBZ
+	if(wdh->compression_type == WTAP_GZIP_COMPRESSED) {
 		return gzwfile_fdopen(fd);
-	} else {
+	} else
+#endif
+#ifdef HAVE_FRAME_COMPRESSION
+	if(wdh->compressed) {
+		return frwfile_fdopen(fd, wdh->compression_type);
+	} else
+#endif
+	{
 		return fdopen(fd, "wb");
 	}
 }
-#else
-static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh _U_, int fd)
-{
-	return fdopen(fd, "wb");
-}
-#endif
 
 /* internally writing raw bytes (compressed or not) */
 gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
@@ -2330,7 +2422,7 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 	size_t nwritten;
 
 #ifdef HAVE_LIBZ
-	if (wdh->compressed) {
+	if (wdh->compression_type == WTAP_GZIP_COMPRESSED) {
 		nwritten = gzwfile_write((GZWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
 		/*
 		 * gzwfile_write() returns 0 on error.
@@ -2340,6 +2432,18 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 			return FALSE;
 		}
 	} else
+#endif
+#ifdef HAVE_FRAME_COMPRESSION
+	if (wdh->compressed) {
+		nwritten = frwfile_write((FRWFILE_T)wdh->fh, buf, (unsigned int) bufsize);
+		/*
+		 * frwfile_write() returns 0 on error.
+		 */
+		if (nwritten == 0) {
+			*err = frwfile_geterr((FRWFILE_T)wdh->fh);
+			return FALSE;
+		}
+	} else
 #endif
 	{
 		nwritten = fwrite(buf, 1, bufsize, (FILE *)wdh->fh);
@@ -2362,9 +2466,14 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 static int wtap_dump_file_close(wtap_dumper *wdh)
 {
 #ifdef HAVE_LIBZ
-	if(wdh->compressed) {
+	if(wdh->compression_type == WTAP_GZIP_COMPRESSED) {
 		return gzwfile_close((GZWFILE_T)wdh->fh);
 	} else
+#endif
+#ifdef HAVE_FRAME_COMPRESSION
+	if(wdh->compressed) {
+		return frwfile_close((FRWFILE_T)wdh->fh);
+	} else
 #endif
 	{
 		return fclose((FILE *)wdh->fh);
@@ -2373,12 +2482,10 @@ static int wtap_dump_file_close(wtap_dumper *wdh)
 
 gint64 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
-#ifdef HAVE_LIBZ
 	if(wdh->compressed) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == fseek((FILE *)wdh->fh, (long)offset, whence)) {
 			*err = errno;
@@ -2392,12 +2499,10 @@ gint64 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err
 gint64 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
-#ifdef HAVE_LIBZ
 	if(wdh->compressed) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
-#endif
 	{
 		if (-1 == (rval = ftell((FILE *)wdh->fh))) {
 			*err = errno;
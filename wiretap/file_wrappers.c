@@ -55,13 +55,45 @@
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
 
+#ifndef O_NOFOLLOW
+#define O_NOFOLLOW 0
+#endif
+
 #ifdef HAVE_LIBZ
 #include <zlib.h>
+
+/*
+ * Inflating the stretches between indexed fast seek points in worker
+ * threads needs Z_BLOCK (to have fast seek points at all) and the
+ * GLib 2.36 threading API.
+ */
+#if defined(Z_BLOCK) && GLIB_CHECK_VERSION(2,36,0)
+#define GZ_PARALLEL
+#endif
 #endif /* HAVE_LIBZ */
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include <wsutil/zstd_seekable.h>
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif /* HAVE_LZ4 */
+
 /*
  * See RFC 1952 for a description of the gzip file format.
  *
+ * See RFC 8878 for a description of the Zstandard file format, and
+ *
+ *	https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ *
+ * for a description of the LZ4 frame format.
+ *
  * Some other compressed file formats we might want to support:
  *
  *	XZ format: http://tukaani.org/xz/
@@ -78,6 +110,12 @@
 static const char *compressed_file_extensions[] = {
 #ifdef HAVE_LIBZ
 	"gz",
+#endif
+#ifdef HAVE_ZSTD
+	"zst",
+#endif
+#ifdef HAVE_LZ4
+	"lz4",
 #endif
 	NULL
 };
@@ -109,7 +147,13 @@ typedef enum {
 	UNCOMPRESSED,	/* uncompressed - copy input directly */
 #ifdef HAVE_LIBZ
 	ZLIB,		/* decompress a zlib stream */
-	GZIP_AFTER_HEADER
+	GZIP_AFTER_HEADER,
+#endif
+#ifdef HAVE_ZSTD
+	ZSTD,		/* decompress a sequence of Zstandard frames */
+#endif
+#ifdef HAVE_LZ4
+	LZ4,		/* decompress a sequence of LZ4 frames */
 #endif
 } compression_t;
 
@@ -142,9 +186,34 @@ struct wtap_reader {
 	z_stream strm;             /* stream structure in-place (not a pointer) */
 	gboolean dont_check_crc;   /* TRUE if we aren't supposed to check the CRC */
 #endif
+#ifdef HAVE_ZSTD
+	ZSTD_DCtx *zstd_dctx;      /* Zstandard decompression context, or NULL */
+#endif
+#ifdef HAVE_LZ4
+	LZ4F_dctx *lz4_dctx;       /* LZ4 decompression context, or NULL */
+#endif
+	gboolean frame_end;        /* TRUE if we're between Zstandard or LZ4 frames */
 	/* fast seeking */
 	GPtrArray *fast_seek;
 	void *fast_seek_cur;
+	char *path;                /* name of the file, for the seek index, or NULL */
+	gboolean sequential;       /* FALSE if opened for random access */
+	gboolean index_checked;    /* TRUE if we've looked for a seek index */
+	gboolean index_loaded;     /* TRUE if fast_seek came from a seek index */
+	gboolean own_fast_seek;    /* TRUE if we allocated fast_seek ourselves */
+#ifdef GZ_PARALLEL
+	/* inflating the segments between fast seek points in other threads */
+	struct zlib_parallel *par; /* worker state, or NULL */
+	gboolean seg_active;       /* TRUE if next points into a segment */
+#endif
+#ifdef HAVE_MMAP
+	/* memory mapping, for uncompressed files opened for random access */
+	gboolean want_map;         /* TRUE if we should map the file */
+	gboolean map_failed;       /* TRUE if mmap() failed; don't try again */
+	unsigned char *map;        /* the mapped file, or NULL */
+	gint64 map_size;           /* size of the mapping */
+	gint64 open_size;          /* size of the file when it was opened */
+#endif
 };
 
 static int	/* gz_load */
@@ -211,6 +280,32 @@ struct zlib_cur_seek_point {
 };
 
 #define SPAN G_GINT64_CONSTANT(1048576)
+
+/*
+ * Fast seek points are at least SPAN apart; further into the file
+ * they're spaced out in proportion to the offset, so that the number
+ * of points (and their 32K windows) grows more slowly than the size
+ * of the uncompressed data, but never more than SPAN_MAX apart, which
+ * bounds how much a random seek has to inflate, and keeps the points
+ * close enough together for parallel inflate.
+ */
+#define SPAN_DIVISOR 1024
+#define SPAN_MAX G_GINT64_CONSTANT(16777216)
+
+static guint span_divisor = SPAN_DIVISOR;
+
+static gint64
+fast_seek_span(gint64 out_pos)
+{
+	gint64 span = out_pos / span_divisor;
+
+	if (span < SPAN)
+		return SPAN;
+	if (span > SPAN_MAX)
+		return SPAN_MAX;
+	return span;
+}
+
 static struct fast_seek_point *
 fast_seek_find(FILE_T file, gint64 pos)
 {
@@ -412,7 +507,7 @@ zlib_fast_seek_add(FILE_T file, struct zlib_cur_seek_point *point, int bits, gin
 	 *      Inserting value in middle of sorted array is expensive, so we want to add only in the end.
 	 *      It's not big deal, cause first-read don't usually invoke seeking
 	 */
-	if (item->out + SPAN < out_pos) {
+	if (item->out + fast_seek_span(out_pos) < out_pos) {
 		struct fast_seek_point *val = g_new(struct fast_seek_point,1);
 		val->in = in_pos;
 		val->out = out_pos;
@@ -574,6 +669,926 @@ zlib_read(FILE_T state, unsigned char *buf, unsigned int count)
 }
 #endif
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/*
+ * Zstandard and LZ4 files are sequences of independently compressed
+ * frames, so the boundaries between frames make fast seek points that
+ * don't need a window of preceding data; restarting at one is just a
+ * matter of resetting the decompression context.
+ */
+static void
+frame_fast_seek_add(FILE_T file, gint64 in_pos, gint64 out_pos)
+{
+	struct fast_seek_point *item;
+
+	if (file->fast_seek == NULL || file->fast_seek->len == 0)
+		return;
+	item = (struct fast_seek_point *)file->fast_seek->pdata[file->fast_seek->len - 1];
+	if (item->out + fast_seek_span(out_pos) < out_pos)
+		fast_seek_header(file, in_pos, out_pos, file->compression);
+}
+
+static gboolean
+is_frame_compression(compression_t compression)
+{
+#ifdef HAVE_ZSTD
+	if (compression == ZSTD)
+		return TRUE;
+#endif
+#ifdef HAVE_LZ4
+	if (compression == LZ4)
+		return TRUE;
+#endif
+	return FALSE;
+}
+
+/*
+ * Get ready to decompress frames of the given type, starting at a
+ * frame boundary.  Returns 0 on success and -1 on error.
+ */
+static int
+frame_reset(FILE_T state, compression_t compression)
+{
+#ifdef HAVE_ZSTD
+	if (compression == ZSTD) {
+		if (state->zstd_dctx == NULL)
+			state->zstd_dctx = ZSTD_createDCtx();
+		else
+			ZSTD_DCtx_reset(state->zstd_dctx, ZSTD_reset_session_only);
+		if (state->zstd_dctx == NULL) {
+			state->err = ENOMEM;
+			state->err_info = NULL;
+			return -1;
+		}
+	}
+#endif
+#ifdef HAVE_LZ4
+	if (compression == LZ4) {
+		if (state->lz4_dctx == NULL) {
+			if (LZ4F_isError(LZ4F_createDecompressionContext(&state->lz4_dctx, LZ4F_VERSION)))
+				state->lz4_dctx = NULL;
+		} else
+			LZ4F_resetDecompressionContext(state->lz4_dctx);
+		if (state->lz4_dctx == NULL) {
+			state->err = ENOMEM;
+			state->err_info = NULL;
+			return -1;
+		}
+	}
+#endif
+	state->compression = compression;
+	state->frame_end = TRUE;
+	return 0;
+}
+
+/*
+ * Get more input for a frame decompressor.  Returns 1 if there's
+ * input (or if we're at the end of the file but the decompressor may
+ * still have output to flush), 0 if we're at the end of the file
+ * between frames, and -1 on error.
+ */
+static int
+frame_fill_in_buffer(FILE_T state)
+{
+	if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+		return -1;
+	if (state->avail_in == 0 && state->frame_end)
+		return 0;
+	return 1;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+	ZSTD_outBuffer output;
+	ZSTD_inBuffer input;
+	size_t ret;
+
+	output.dst = buf;
+	output.size = count;
+	output.pos = 0;
+
+	/* fill output buffer up to end of file or error */
+	do {
+		size_t out_before = output.pos;
+		int fill = frame_fill_in_buffer(state);
+
+		if (fill <= 0)
+			break;
+
+		input.src = state->next_in;
+		input.size = state->avail_in;
+		input.pos = 0;
+		ret = ZSTD_decompressStream(state->zstd_dctx, &output, &input);
+		state->avail_in -= (guint)input.pos;
+		state->next_in += input.pos;
+		if (ZSTD_isError(ret)) {
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = ZSTD_getErrorName(ret);
+			break;
+		}
+		if (ret == 0) {
+			/* end of a frame; the next one starts here */
+			state->frame_end = TRUE;
+			frame_fast_seek_add(state, state->raw_pos - state->avail_in,
+			    state->pos + output.pos);
+		} else if (input.pos != 0)
+			state->frame_end = FALSE;
+		if (input.pos == 0 && output.pos == out_before &&
+		    state->eof && state->avail_in == 0) {
+			/* in the middle of a frame, with no more input */
+			state->err = WTAP_ERR_SHORT_READ;
+			state->err_info = NULL;
+			break;
+		}
+	} while (output.pos < output.size);
+
+	state->next = buf;
+	state->have = (guint)output.pos;
+}
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+	unsigned int got = 0;
+	size_t ret;
+
+	/* fill output buffer up to end of file or error */
+	do {
+		size_t in_size, out_size;
+		int fill = frame_fill_in_buffer(state);
+
+		if (fill <= 0)
+			break;
+
+		in_size = state->avail_in;
+		out_size = count - got;
+		ret = LZ4F_decompress(state->lz4_dctx, buf + got, &out_size,
+		    state->next_in, &in_size, NULL);
+		state->avail_in -= (guint)in_size;
+		state->next_in += in_size;
+		got += (unsigned int)out_size;
+		if (LZ4F_isError(ret)) {
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = LZ4F_getErrorName(ret);
+			break;
+		}
+		if (ret == 0) {
+			/* end of a frame; the next one starts here */
+			state->frame_end = TRUE;
+			frame_fast_seek_add(state, state->raw_pos - state->avail_in,
+			    state->pos + got);
+		} else if (in_size != 0)
+			state->frame_end = FALSE;
+		if (in_size == 0 && out_size == 0 &&
+		    state->eof && state->avail_in == 0) {
+			/* in the middle of a frame, with no more input */
+			state->err = WTAP_ERR_SHORT_READ;
+			state->err_info = NULL;
+			break;
+		}
+	} while (got < count);
+
+	state->next = buf;
+	state->have = got;
+}
+#endif /* HAVE_LZ4 */
+
+/* TRUE if seek indices are to be saved and used */
+static gboolean seek_index_enabled = FALSE;
+
+/* Number of threads to inflate with, or 0 to go by the number of cores */
+static guint inflate_threads = 0;
+
+#if defined(HAVE_LIBZ) && defined(Z_BLOCK)
+/*
+ * Seek index.
+ *
+ * Building the fast seek points for a big compressed file means
+ * inflating all of it, so, once we've done that, we can save them, and
+ * read them back the next time the file is opened; see
+ * file_set_seek_index().  The indices live in the user's cache
+ * directory, each under a hash of the absolute path, size, and
+ * modification time of the file it's for, and are written to a new
+ * temporary file which is then renamed into place, so that nothing
+ * planted there beforehand gets written through.  The index is in host
+ * byte order; an index written on a machine with a different byte
+ * order, or one for a different version of the capture file, is just
+ * ignored.
+ *
+ *	magic "WTGZIX01", byte order mark, number of points,
+ *	size and modification time of the compressed file
+ *
+ * followed by, for each point:
+ *
+ *	in, out, type of point, and, for ZLIB points, bits, CRC,
+ *	total_out, and the 32K window, itself compressed
+ */
+#define GZIDX_DIR	"gzidx"
+#define GZIDX_SUFFIX	".gzidx"
+#define GZIDX_MAGIC	"WTGZIX01"
+#define GZIDX_BOM	0x01020304U
+
+/* Don't bother writing an index for files smaller than this */
+#define GZIDX_MIN_SIZE	G_GINT64_CONSTANT(16777216)
+
+/* values for the type of point in the index */
+#define GZIDX_UNCOMPRESSED	0
+#define GZIDX_ZLIB		1
+#define GZIDX_GZIP_AFTER_HEADER	2
+
+/*
+ * Get the directory the seek indices go in.
+ */
+static char *
+gzidx_dir(void)
+{
+	return g_build_filename(g_get_user_cache_dir(), "wireshark",
+	    GZIDX_DIR, NULL);
+}
+
+/*
+ * Get the pathname of the seek index for the given version of the
+ * file.
+ */
+static char *
+gzidx_name(FILE_T state, const ws_statb64 *statb)
+{
+	char *path, *cwd, *key, *hash, *dir, *name;
+
+	if (g_path_is_absolute(state->path))
+		path = g_strdup(state->path);
+	else {
+		cwd = g_get_current_dir();
+		path = g_build_filename(cwd, state->path, NULL);
+		g_free(cwd);
+	}
+	key = g_strdup_printf("%s\n%" G_GINT64_MODIFIER "d\n%" G_GINT64_MODIFIER "d",
+	    path, (gint64)statb->st_size, (gint64)statb->st_mtime);
+	hash = g_compute_checksum_for_string(G_CHECKSUM_SHA256, key, -1);
+	dir = gzidx_dir();
+	name = g_strdup_printf("%s" G_DIR_SEPARATOR_S "%s" GZIDX_SUFFIX,
+	    dir, hash);
+	g_free(dir);
+	g_free(hash);
+	g_free(key);
+	g_free(path);
+	return name;
+}
+
+static void
+gzidx_free_points(GPtrArray *points)
+{
+	guint i;
+
+	for (i = 0; i < points->len; i++)
+		g_free(points->pdata[i]);
+	g_ptr_array_free(points, TRUE);
+}
+
+/*
+ * Read the seek index for the file, if there is one and it's for this
+ * version of the file, and install it as our fast seek points.
+ * in_pos is the offset of the deflate data of the first gzip member;
+ * the index must start with a point there.
+ */
+static void
+gzidx_load(FILE_T state, gint64 in_pos)
+{
+	ws_statb64 statb;
+	char *name;
+	int fd;
+	FILE *fp;
+	char magic[sizeof GZIDX_MAGIC - 1];
+	guint32 bom, count, i;
+	gint64 size, mtime;
+	GPtrArray *points = NULL;
+	unsigned char *cwin = NULL;
+	uLong cbound = compressBound(ZLIB_WINSIZE);
+	gboolean ok = FALSE;
+
+	state->index_checked = TRUE;
+	if (ws_fstat64(state->fd, &statb) == -1)
+		return;
+	name = gzidx_name(state, &statb);
+	fd = ws_open(name, O_RDONLY|O_BINARY|O_NOFOLLOW, 0000);
+	g_free(name);
+	if (fd == -1)
+		return;
+	fp = ws_fdopen(fd, "rb");
+	if (fp == NULL) {
+		ws_close(fd);
+		return;
+	}
+
+	if (fread(magic, sizeof magic, 1, fp) != 1 ||
+	    memcmp(magic, GZIDX_MAGIC, sizeof magic) != 0 ||
+	    fread(&bom, sizeof bom, 1, fp) != 1 || bom != GZIDX_BOM ||
+	    fread(&count, sizeof count, 1, fp) != 1 || count == 0 ||
+	    fread(&size, sizeof size, 1, fp) != 1 || size != (gint64)statb.st_size ||
+	    fread(&mtime, sizeof mtime, 1, fp) != 1 || mtime != (gint64)statb.st_mtime)
+		goto done;
+
+	points = g_ptr_array_new();
+	cwin = (unsigned char *)g_malloc(cbound);
+	for (i = 0; i < count; i++) {
+		struct fast_seek_point *val, *prev;
+		gint64 in, out;
+		guint32 type, bits, adler, total_out, wlen;
+		uLongf wsize;
+
+		if (fread(&in, sizeof in, 1, fp) != 1 ||
+		    fread(&out, sizeof out, 1, fp) != 1 ||
+		    fread(&type, sizeof type, 1, fp) != 1)
+			goto done;
+		prev = i != 0 ? (struct fast_seek_point *)points->pdata[i - 1] : NULL;
+		if (in < 0 || in > size || out < 0 ||
+		    (prev != NULL && (in < prev->in || out <= prev->out)))
+			goto done;
+
+		val = g_new(struct fast_seek_point, 1);
+		g_ptr_array_add(points, val);
+		val->in = in;
+		val->out = out;
+		switch (type) {
+
+		case GZIDX_UNCOMPRESSED:
+			val->compression = UNCOMPRESSED;
+			break;
+
+		case GZIDX_GZIP_AFTER_HEADER:
+			val->compression = GZIP_AFTER_HEADER;
+			break;
+
+		case GZIDX_ZLIB:
+			val->compression = ZLIB;
+			if (fread(&bits, sizeof bits, 1, fp) != 1 ||
+			    fread(&adler, sizeof adler, 1, fp) != 1 ||
+			    fread(&total_out, sizeof total_out, 1, fp) != 1 ||
+			    fread(&wlen, sizeof wlen, 1, fp) != 1)
+				goto done;
+#ifdef HAVE_INFLATEPRIME
+			if (bits > 7)
+				goto done;
+			val->data.zlib.bits = bits;
+#else
+			if (bits != 0)
+				goto done;
+#endif
+			if (wlen == 0 || wlen > cbound ||
+			    fread(cwin, wlen, 1, fp) != 1)
+				goto done;
+			wsize = ZLIB_WINSIZE;
+			if (uncompress(val->data.zlib.window, &wsize, cwin, wlen) != Z_OK ||
+			    wsize != ZLIB_WINSIZE)
+				goto done;
+			val->data.zlib.adler = adler;
+			val->data.zlib.total_out = total_out;
+			break;
+
+		default:
+			goto done;
+		}
+	}
+
+	/* It has to start where this file's deflate data does. */
+	if (((struct fast_seek_point *)points->pdata[0])->compression != GZIP_AFTER_HEADER ||
+	    ((struct fast_seek_point *)points->pdata[0])->in != in_pos ||
+	    ((struct fast_seek_point *)points->pdata[0])->out != 0)
+		goto done;
+	ok = TRUE;
+
+done:
+	fclose(fp);
+	g_free(cwin);
+	if (!ok) {
+		if (points != NULL)
+			gzidx_free_points(points);
+		return;
+	}
+
+	if (state->fast_seek == NULL) {
+		/* Not opened for random access; the points are ours. */
+		state->fast_seek = points;
+		state->own_fast_seek = TRUE;
+	} else {
+		for (i = 0; i < points->len; i++)
+			g_ptr_array_add(state->fast_seek, points->pdata[i]);
+		g_ptr_array_free(points, TRUE);
+	}
+	state->index_loaded = TRUE;
+}
+
+/*
+ * Write out the fast seek points of a file we've inflated all the way
+ * through.  Failing to do so isn't an error; we'll just have to build
+ * the points again the next time.
+ */
+static void
+gzidx_save(FILE_T state)
+{
+	GPtrArray *points = state->fast_seek;
+	ws_statb64 statb;
+	char *dir, *name, *tmpname;
+	int fd;
+	FILE *fp;
+	unsigned char *cwin;
+	guint32 bom = GZIDX_BOM, count = points->len, i;
+	gint64 size, mtime;
+	gboolean ok;
+
+	/* The index only describes gzip files. */
+	for (i = 0; i < count; i++) {
+		struct fast_seek_point *item = (struct fast_seek_point *)points->pdata[i];
+
+		if (item->compression != UNCOMPRESSED &&
+		    item->compression != ZLIB &&
+		    item->compression != GZIP_AFTER_HEADER)
+			return;
+	}
+
+	if (ws_fstat64(state->fd, &statb) == -1 ||
+	    (gint64)statb.st_size < GZIDX_MIN_SIZE)
+		return;
+	size = statb.st_size;
+	mtime = statb.st_mtime;
+
+	dir = gzidx_dir();
+	if (g_mkdir_with_parents(dir, 0700) == -1) {
+		g_free(dir);
+		return;
+	}
+	g_free(dir);
+
+	/*
+	 * Write to a file that nobody else can have created or pointed
+	 * elsewhere, and only rename it into place once it's complete.
+	 */
+	name = gzidx_name(state, &statb);
+	tmpname = g_strdup_printf("%s.%08x", name, g_random_int());
+	fd = ws_open(tmpname, O_WRONLY|O_CREAT|O_EXCL|O_NOFOLLOW|O_BINARY, 0600);
+	if (fd == -1) {
+		g_free(tmpname);
+		g_free(name);
+		return;
+	}
+	fp = ws_fdopen(fd, "wb");
+	if (fp == NULL) {
+		ws_close(fd);
+		ws_unlink(tmpname);
+		g_free(tmpname);
+		g_free(name);
+		return;
+	}
+
+	cwin = (unsigned char *)g_malloc(compressBound(ZLIB_WINSIZE));
+	ok = fwrite(GZIDX_MAGIC, sizeof GZIDX_MAGIC - 1, 1, fp) == 1 &&
+	    fwrite(&bom, sizeof bom, 1, fp) == 1 &&
+	    fwrite(&count, sizeof count, 1, fp) == 1 &&
+	    fwrite(&size, sizeof size, 1, fp) == 1 &&
+	    fwrite(&mtime, sizeof mtime, 1, fp) == 1;
+	for (i = 0; ok && i < count; i++) {
+		struct fast_seek_point *item = (struct fast_seek_point *)points->pdata[i];
+		guint32 type, bits, wlen;
+		uLongf clen;
+
+		switch (item->compression) {
+
+		case ZLIB:
+			type = GZIDX_ZLIB;
+			break;
+
+		case GZIP_AFTER_HEADER:
+			type = GZIDX_GZIP_AFTER_HEADER;
+			break;
+
+		default:
+			type = GZIDX_UNCOMPRESSED;
+			break;
+		}
+		ok = fwrite(&item->in, sizeof item->in, 1, fp) == 1 &&
+		    fwrite(&item->out, sizeof item->out, 1, fp) == 1 &&
+		    fwrite(&type, sizeof type, 1, fp) == 1;
+		if (!ok || type != GZIDX_ZLIB)
+			continue;
+
+#ifdef HAVE_INFLATEPRIME
+		bits = item->data.zlib.bits;
+#else
+		bits = 0;
+#endif
+		clen = compressBound(ZLIB_WINSIZE);
+		ok = compress2(cwin, &clen, item->data.zlib.window, ZLIB_WINSIZE,
+		    Z_BEST_SPEED) == Z_OK;
+		wlen = (guint32)clen;
+		ok = ok &&
+		    fwrite(&bits, sizeof bits, 1, fp) == 1 &&
+		    fwrite(&item->data.zlib.adler, sizeof item->data.zlib.adler, 1, fp) == 1 &&
+		    fwrite(&item->data.zlib.total_out, sizeof item->data.zlib.total_out, 1, fp) == 1 &&
+		    fwrite(&wlen, sizeof wlen, 1, fp) == 1 &&
+		    fwrite(cwin, wlen, 1, fp) == 1;
+	}
+	g_free(cwin);
+	if (fclose(fp) != 0)
+		ok = FALSE;
+	if (!ok || ws_rename(tmpname, name) == -1)
+		ws_unlink(tmpname);
+	g_free(tmpname);
+	g_free(name);
+}
+#endif /* HAVE_LIBZ && Z_BLOCK */
+
+/*
+ * Save the fast seek points of big gzip files we've read all the way
+ * through, and use them, and inflate the file in parallel, when the
+ * file is opened again.
+ */
+void
+file_set_seek_index(gboolean enable)
+{
+	seek_index_enabled = enable;
+}
+
+/*
+ * Set the number of threads to inflate indexed files with, other than
+ * the one reading them; 0 means one fewer than the number of cores.
+ */
+void
+file_set_inflate_threads(guint nthreads)
+{
+	inflate_threads = nthreads;
+}
+
+/*
+ * Set how far apart, in proportion to the offset, fast seek points are
+ * put; 0 means the default.  Lets the tests get to SPAN_MAX without a
+ * file of many gigabytes.
+ */
+void
+file_set_seek_span_divisor(guint divisor)
+{
+	span_divisor = divisor != 0 ? divisor : SPAN_DIVISOR;
+}
+
+#ifdef GZ_PARALLEL
+/*
+ * Parallel inflate.
+ *
+ * Once we have an index, each stretch of deflate data between two
+ * fast seek points can be inflated on its own: start at the first
+ * point as file_seek() would, and stop after the number of bytes up
+ * to the second.  The sequential stream hands those "segments" out to
+ * worker threads, each with its own descriptor for the file, and then
+ * reads the inflated data from them in order, which makes opening a
+ * big compressed file a matter of the number of cores rather than the
+ * speed of inflate().
+ *
+ * Each segment is checked against the CRC saved in the point at its
+ * end; if that doesn't match, or anything else goes wrong, we just
+ * inflate that part of the file ourselves.
+ */
+#define PARALLEL_MAX_THREADS	8
+#define PARALLEL_INBUF		65536
+
+/*
+ * Don't hand out segments bigger than this.  Points are SPAN_MAX apart
+ * at most, plus the rest of the deflate block the span ends in, so
+ * this leaves out only segments that aren't between two such points.
+ */
+#define PARALLEL_MAX_SEGMENT	(2 * SPAN_MAX)
+
+/*
+ * How far past the start of the segment being read the workers may
+ * start on a segment.  The inflated data held at any one time runs
+ * from the start of the segment before the one being read to the end
+ * of the last one started, so it's at most this plus two segments,
+ * i.e. 128MB.
+ */
+#define PARALLEL_AHEAD		(G_GINT64_CONSTANT(1) << 26)
+
+typedef enum {
+	SEG_QUEUED,	/* not yet picked up by a worker */
+	SEG_RUNNING,	/* being inflated */
+	SEG_DONE,	/* inflated; data is valid */
+	SEG_FAILED,	/* couldn't be inflated, or failed the CRC check */
+	SEG_GONE	/* skipped, or already read and freed */
+} segment_state_t;
+
+struct zlib_segment {
+	struct fast_seek_point *start;	/* point the segment starts at */
+	struct fast_seek_point *end;	/* point the segment ends at */
+	unsigned char *data;		/* inflated data, if SEG_DONE */
+	segment_state_t state;
+};
+
+struct zlib_parallel {
+	GMutex lock;
+	GCond cond;
+	GThread *threads[PARALLEL_MAX_THREADS];
+	guint nthreads;
+	char *path;			/* file for the workers to open */
+	struct zlib_segment *segs;	/* segments, in file order */
+	guint nsegs;
+	guint next_job;			/* next segment for a worker to take */
+	guint cur;			/* segment being read */
+	gboolean stop;			/* TRUE if the workers should quit */
+};
+
+/* Inflate one segment, reading from fd.  Returns TRUE on success. */
+static gboolean
+zlib_inflate_segment(int fd, z_stream *strm, unsigned char *in,
+    struct zlib_segment *seg)
+{
+	struct fast_seek_point *start = seg->start;
+	guint len = (guint)(seg->end->out - start->out);
+	unsigned char *data;
+	gint64 off = start->in;
+	int bits = 0;
+	ssize_t n;
+	int ret;
+	uLong crc;
+
+#ifdef HAVE_INFLATEPRIME
+	if (start->compression == ZLIB)
+		bits = start->data.zlib.bits;
+#endif
+	if (bits)
+		off--;
+	if (ws_lseek64(fd, off, SEEK_SET) == -1)
+		return FALSE;
+	data = (unsigned char *)g_try_malloc(len);
+	if (data == NULL)
+		return FALSE;
+
+	inflateReset(strm);
+	strm->next_out = data;
+	strm->avail_out = len;
+	strm->avail_in = 0;
+#ifdef HAVE_INFLATEPRIME
+	if (bits) {
+		unsigned char ch;
+
+		if (ws_read(fd, &ch, 1) != 1)
+			goto fail;
+		(void)inflatePrime(strm, bits, ch >> (8 - bits));
+	}
+#endif
+	if (start->compression == ZLIB)
+		(void)inflateSetDictionary(strm, start->data.zlib.window, ZLIB_WINSIZE);
+
+	while (strm->avail_out != 0) {
+		if (strm->avail_in == 0) {
+			n = ws_read(fd, in, PARALLEL_INBUF);
+			if (n <= 0)
+				goto fail;
+			strm->next_in = in;
+			strm->avail_in = (unsigned)n;
+		}
+		ret = inflate(strm, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END && strm->avail_out != 0)
+			goto fail;
+		if (ret != Z_OK && ret != Z_STREAM_END)
+			goto fail;
+	}
+
+	/* The CRC at the end point covers everything up to it. */
+	crc = start->compression == ZLIB ? start->data.zlib.adler : crc32(0L, Z_NULL, 0);
+	crc = crc32(crc, data, len);
+	if ((guint32)crc != seg->end->data.zlib.adler)
+		goto fail;
+
+	seg->data = data;
+	return TRUE;
+
+fail:
+	g_free(data);
+	return FALSE;
+}
+
+static gpointer
+zlib_parallel_worker(gpointer arg)
+{
+	struct zlib_parallel *par = (struct zlib_parallel *)arg;
+	struct zlib_segment *seg;
+	guint job;
+	z_stream strm;
+	unsigned char *in;
+	int fd;
+	gboolean usable, ok;
+
+	memset(&strm, 0, sizeof strm);
+	usable = inflateInit2(&strm, -15) == Z_OK;      /* raw inflate */
+	fd = ws_open(par->path, O_RDONLY|O_BINARY, 0000);
+	if (fd == -1)
+		usable = FALSE;
+	in = (unsigned char *)g_malloc(PARALLEL_INBUF);
+
+	g_mutex_lock(&par->lock);
+	for (;;) {
+		/* Wait until the reader has caught up enough. */
+		while (!par->stop && par->next_job < par->nsegs &&
+		    par->segs[par->next_job].start->out -
+		    par->segs[par->cur].start->out >= PARALLEL_AHEAD)
+			g_cond_wait(&par->cond, &par->lock);
+		if (par->stop || par->next_job >= par->nsegs)
+			break;
+
+		job = par->next_job++;
+		seg = &par->segs[job];
+		if (job < par->cur) {
+			/* The reader has already gone past it. */
+			seg->state = SEG_GONE;
+			continue;
+		}
+		seg->state = SEG_RUNNING;
+		g_mutex_unlock(&par->lock);
+
+		ok = usable && zlib_inflate_segment(fd, &strm, in, seg);
+
+		g_mutex_lock(&par->lock);
+		if (ok && job + 1 < par->cur) {
+			/* The reader went past it while we were at it. */
+			g_free(seg->data);
+			seg->data = NULL;
+			seg->state = SEG_GONE;
+		} else
+			seg->state = ok ? SEG_DONE : SEG_FAILED;
+		g_cond_broadcast(&par->cond);
+	}
+	g_mutex_unlock(&par->lock);
+
+	g_free(in);
+	if (fd != -1)
+		ws_close(fd);
+	inflateEnd(&strm);
+	return NULL;
+}
+
+static void
+zlib_parallel_stop(FILE_T state)
+{
+	struct zlib_parallel *par = state->par;
+	guint i;
+
+	g_mutex_lock(&par->lock);
+	par->stop = TRUE;
+	g_cond_broadcast(&par->cond);
+	g_mutex_unlock(&par->lock);
+	for (i = 0; i < par->nthreads; i++)
+		g_thread_join(par->threads[i]);
+
+	for (i = 0; i < par->nsegs; i++)
+		g_free(par->segs[i].data);
+	g_free(par->segs);
+	g_free(par->path);
+	g_cond_clear(&par->cond);
+	g_mutex_clear(&par->lock);
+	g_free(par);
+	state->par = NULL;
+	state->seg_active = FALSE;
+}
+
+/*
+ * Split the indexed file into segments and start the workers on them.
+ */
+static void
+zlib_parallel_start(FILE_T state)
+{
+	GPtrArray *points = state->fast_seek;
+	struct zlib_parallel *par;
+	struct fast_seek_point *a, *b;
+	guint nthreads, nsegs, i;
+
+	if (inflate_threads != 0)
+		nthreads = inflate_threads;
+	else {
+		nthreads = (guint)g_get_num_processors();
+		if (nthreads < 2)
+			return;
+		nthreads--;     /* leave one for the reader */
+	}
+	if (nthreads > PARALLEL_MAX_THREADS)
+		nthreads = PARALLEL_MAX_THREADS;
+
+	/*
+	 * A segment runs from the start of a gzip member's deflate data,
+	 * or a point within it, to the next point within it.
+	 */
+	nsegs = 0;
+	for (i = 0; i + 1 < points->len; i++) {
+		a = (struct fast_seek_point *)points->pdata[i];
+		b = (struct fast_seek_point *)points->pdata[i + 1];
+		if ((a->compression == ZLIB || a->compression == GZIP_AFTER_HEADER) &&
+		    b->compression == ZLIB && b->out - a->out <= PARALLEL_MAX_SEGMENT)
+			nsegs++;
+	}
+	if (nsegs < 2)
+		return;
+
+	par = g_new0(struct zlib_parallel, 1);
+	par->segs = g_new0(struct zlib_segment, nsegs);
+	for (i = 0; i + 1 < points->len; i++) {
+		a = (struct fast_seek_point *)points->pdata[i];
+		b = (struct fast_seek_point *)points->pdata[i + 1];
+		if ((a->compression == ZLIB || a->compression == GZIP_AFTER_HEADER) &&
+		    b->compression == ZLIB && b->out - a->out <= PARALLEL_MAX_SEGMENT) {
+			par->segs[par->nsegs].start = a;
+			par->segs[par->nsegs].end = b;
+			par->segs[par->nsegs].state = SEG_QUEUED;
+			par->nsegs++;
+		}
+	}
+	par->path = g_strdup(state->path);
+	g_mutex_init(&par->lock);
+	g_cond_init(&par->cond);
+	state->par = par;
+
+	for (i = 0; i < nthreads; i++) {
+		par->threads[par->nthreads] = g_thread_try_new("gzip inflate",
+		    zlib_parallel_worker, par, NULL);
+		if (par->threads[par->nthreads] == NULL)
+			break;
+		par->nthreads++;
+	}
+	if (par->nthreads == 0)
+		zlib_parallel_stop(state);
+}
+
+/*
+ * Find the segment containing pos, wait for it to be inflated, and
+ * return it, or return NULL if there is no such segment or it couldn't
+ * be inflated; in the latter case, set *failed.
+ */
+static struct zlib_segment *
+zlib_parallel_get(FILE_T state, gint64 pos, gboolean *failed)
+{
+	struct zlib_parallel *par = state->par;
+	struct zlib_segment *seg;
+	guint low, high, mid, i;
+
+	g_mutex_lock(&par->lock);
+
+	/* Usually it's the current or the next one. */
+	i = par->cur;
+	if (!(pos >= par->segs[i].start->out && pos < par->segs[i].end->out)) {
+		i = par->nsegs;
+		for (low = 0, high = par->nsegs; low < high; ) {
+			mid = (low + high) / 2;
+			if (pos < par->segs[mid].start->out)
+				high = mid;
+			else if (pos >= par->segs[mid].end->out)
+				low = mid + 1;
+			else {
+				i = mid;
+				break;
+			}
+		}
+		if (i == par->nsegs) {
+			g_mutex_unlock(&par->lock);
+			return NULL;
+		}
+	}
+	seg = &par->segs[i];
+
+	if (i > par->cur) {
+		/*
+		 * Moving on; free what's before the previous segment (we
+		 * keep that one for short seeks back), and let the
+		 * workers get further ahead.
+		 */
+		guint j;
+
+		for (j = par->cur > 0 ? par->cur - 1 : 0; j + 1 < i; j++) {
+			if (par->segs[j].state == SEG_DONE) {
+				g_free(par->segs[j].data);
+				par->segs[j].data = NULL;
+				par->segs[j].state = SEG_GONE;
+			}
+		}
+		par->cur = i;
+		g_cond_broadcast(&par->cond);
+	}
+
+	/*
+	 * A queued segment at or after next_job will be picked up;
+	 * one before it has been, or has been skipped.
+	 */
+	while (seg->state == SEG_RUNNING ||
+	    (seg->state == SEG_QUEUED && i >= par->next_job))
+		g_cond_wait(&par->cond, &par->lock);
+	if (seg->state == SEG_FAILED)
+		*failed = TRUE;
+	if (seg->state != SEG_DONE)
+		seg = NULL;
+	g_mutex_unlock(&par->lock);
+	return seg;
+}
+#endif /* GZ_PARALLEL */
+
 static int
 gz_head(FILE_T state)
 {
@@ -666,6 +1681,21 @@ gz_head(FILE_T state)
 			state->compression = ZLIB;
 			state->is_compressed = TRUE;
 #ifdef Z_BLOCK
+			/*
+			 * If we're at the start of the file, and have no
+			 * fast seek points yet, see whether we saved them
+			 * the last time.
+			 */
+			if (seek_index_enabled &&
+			    state->pos == 0 && state->path != NULL &&
+			    !state->index_checked &&
+			    (state->fast_seek == NULL || state->fast_seek->len == 0))
+				gzidx_load(state, state->raw_pos - state->avail_in);
+#ifdef GZ_PARALLEL
+			if (state->index_loaded && state->sequential &&
+			    state->par == NULL)
+				zlib_parallel_start(state);
+#endif
 			if (state->fast_seek) {
 				struct zlib_cur_seek_point *cur = g_new(struct zlib_cur_seek_point,1);
 
@@ -684,6 +1714,33 @@ gz_head(FILE_T state)
 		}
 	}
 #endif
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	/* look for the Zstandard or LZ4 frame magic number */
+	if (state->have == 0 && state->avail_in >= 4) {
+		compression_t compression = UNKNOWN;
+
+#ifdef HAVE_ZSTD
+		/* 0xFD2FB528, little-endian */
+		if (state->next_in[0] == 0x28 && state->next_in[1] == 0xB5 &&
+		    state->next_in[2] == 0x2F && state->next_in[3] == 0xFD)
+			compression = ZSTD;
+#endif
+#ifdef HAVE_LZ4
+		/* 0x184D2204, little-endian */
+		if (state->next_in[0] == 0x04 && state->next_in[1] == 0x22 &&
+		    state->next_in[2] == 0x4D && state->next_in[3] == 0x18)
+			compression = LZ4;
+#endif
+		if (compression != UNKNOWN) {
+			if (frame_reset(state, compression) == -1)
+				return -1;
+			state->is_compressed = TRUE;
+			if (state->fast_seek)
+				fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, compression);
+			return 0;
+		}
+	}
+#endif
 #ifdef HAVE_LIBXZ
 	/* { 0xFD, '7', 'z', 'X', 'Z', 0x00 } */
 	/* FD 37 7A 58 5A 00 */
@@ -701,9 +1758,215 @@ gz_head(FILE_T state)
 		state->have += state->avail_in;
 		state->avail_in = 0;
 	}
-	state->compression = UNCOMPRESSED;
-	return 0;
+	state->compression = UNCOMPRESSED;
+	return 0;
+}
+
+/*
+ * Restart reading at a fast seek point at or before pos, leaving a
+ * skip request pending for the rest of the way to pos.
+ */
+static int
+fast_seek_restart(FILE_T file, struct fast_seek_point *here, gint64 pos, int *err)
+{
+	gint64 off, off2;
+
+#ifdef HAVE_LIBZ
+	if (here->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+		off = here->in - (here->data.zlib.bits ? 1 : 0);
+#else
+		off = here->in;
+#endif
+		off2 = here->out;
+	} else if (here->compression == GZIP_AFTER_HEADER) {
+		off = here->in;
+		off2 = here->out;
+	} else
+#endif
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	if (is_frame_compression(here->compression)) {
+		/* at the start of a frame */
+		off = here->in;
+		off2 = here->out;
+	} else
+#endif
+	{
+		off2 = pos;
+		off = here->in + (off2 - here->out);
+	}
+
+	if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
+		*err = errno;
+		return -1;
+	}
+	fast_seek_reset(file);
+
+	file->raw_pos = off;
+	file->have = 0;
+	file->eof = FALSE;
+	file->seek_pending = FALSE;
+	file->err = 0;
+	file->err_info = NULL;
+	file->avail_in = 0;
+
+#ifdef HAVE_LIBZ
+	if (here->compression == ZLIB) {
+		z_stream *strm = &file->strm;
+
+		inflateReset(strm);
+		strm->adler = here->data.zlib.adler;
+		strm->total_out = here->data.zlib.total_out;
+#ifdef HAVE_INFLATEPRIME
+		if (here->data.zlib.bits) {
+			FILE_T state = file;
+			int ret = GZ_GETC();
+
+			if (ret == -1) {
+				if (state->err == 0) {
+					/* EOF */
+					*err = WTAP_ERR_SHORT_READ;
+				} else
+					*err = state->err;
+				return -1;
+			}
+			(void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
+		}
+#endif
+		(void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
+		file->compression = ZLIB;
+	} else if (here->compression == GZIP_AFTER_HEADER) {
+		z_stream *strm = &file->strm;
+
+		inflateReset(strm);
+		strm->adler = crc32(0L, Z_NULL, 0);
+		file->compression = ZLIB;
+	} else
+#endif
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	if (is_frame_compression(here->compression)) {
+		if (frame_reset(file, here->compression) == -1) {
+			*err = file->err;
+			return -1;
+		}
+	} else
+#endif
+		file->compression = here->compression;
+
+	file->pos = off2;
+	if (pos != off2) {
+		file->seek_pending = TRUE;
+		file->skip = pos - off2;
+	}
+	return 0;
+}
+
+#ifdef HAVE_MMAP
+#ifndef S_ISREG
+#define S_ISREG(mode)   (((mode) & S_IFMT) == S_IFREG)
+#endif
+
+/* Largest part of the mapping we hand out as output data at once */
+#define MAP_WINDOW	(1U << 30)
+
+/*
+ * Drop the mapping, giving back the output data we haven't delivered,
+ * and put the file descriptor where the raw i/o code expects it.
+ */
+static void
+file_unmap(FILE_T state)
+{
+	if (state->map == NULL)
+		return;
+
+	state->raw_pos -= state->have;
+	state->have = 0;
+	state->next = state->out;
+	munmap(state->map, (size_t)state->map_size);
+	state->map = NULL;
+	state->map_size = 0;
+	if (state->fd != -1)
+		ws_lseek64(state->fd, state->raw_pos, SEEK_SET);
+}
+
+/*
+ * Remember the size of the file as it was opened; a file that doesn't
+ * have that size any more is being written, or was truncated, and isn't
+ * mapped.
+ */
+static void
+file_map_note_stat(FILE_T state)
+{
+	ws_statb64 statb;
+
+	if (state->fd == -1 || ws_fstat64(state->fd, &statb) == -1 ||
+	    !S_ISREG(statb.st_mode)) {
+		state->want_map = FALSE;
+		return;
+	}
+	state->open_size = statb.st_size;
+}
+
+/*
+ * Touching a page of the mapping past the end of a file that another
+ * process has truncated raises SIGBUS, where read() would just come up
+ * short, so we only map files that still have the size they were
+ * opened with.  One that has grown is still being written; one that
+ * has shrunk was truncated under us.  Either way we unmap it and read
+ * it for good, and read() reports the truncation as a short read.
+ *
+ * The size is checked when the file is mapped and whenever reading
+ * gets to the end of the mapping, which is where a file being written
+ * or truncated shows up; seeks and reads within the mapping don't make
+ * any system calls.  Returns TRUE if the file still has its size.
+ */
+static gboolean
+file_map_check(FILE_T state)
+{
+	ws_statb64 statb;
+
+	if (ws_fstat64(state->fd, &statb) == -1 || !S_ISREG(statb.st_mode) ||
+	    statb.st_size != state->open_size) {
+		file_unmap(state);
+		state->want_map = FALSE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * Make sure the mapping covers raw_pos, mapping the file as necessary.
+ * Only called when we have no output data.  Returns TRUE if raw_pos is
+ * mapped.
+ */
+static gboolean
+file_map(FILE_T state)
+{
+	void *map;
+
+	if (state->map != NULL && state->raw_pos < state->map_size)
+		return TRUE;
+	if (state->map_failed || state->fd == -1)
+		return FALSE;
+	if (!file_map_check(state))
+		return FALSE;
+	if (state->open_size <= state->raw_pos ||
+	    (gint64)(size_t)state->open_size != state->open_size)
+		return FALSE;
+
+	map = mmap(NULL, (size_t)state->open_size, PROT_READ, MAP_SHARED, state->fd, 0);
+	if (map == MAP_FAILED) {
+		/* Fall back on read(); the descriptor is still where it was. */
+		state->map_failed = TRUE;
+		return FALSE;
+	}
+	state->map = (unsigned char *)map;
+	state->map_size = state->open_size;
+	return TRUE;
 }
+#endif /* HAVE_MMAP */
+
+static int gz_skip(FILE_T state, gint64 len);
 
 static int /* gz_make */
 fill_out_buffer(FILE_T state)
@@ -715,14 +1978,95 @@ fill_out_buffer(FILE_T state)
 			return 0;
 	}
 	if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_MMAP
+		/*
+		 * If the file is mapped, hand out the mapped data itself,
+		 * saving a read() and a copy.
+		 */
+		if (state->want_map && !state->is_compressed) {
+			if (file_map(state)) {
+				gint64 left = state->map_size - state->raw_pos;
+
+				state->next = state->map + state->raw_pos;
+				state->have = left > MAP_WINDOW ? MAP_WINDOW : (guint)left;
+				state->raw_pos += state->have;
+				return 0;
+			}
+			if (state->map != NULL) {
+				/* Mapped, and we're at the end of the file. */
+				state->eof = TRUE;
+				return 0;
+			}
+		}
+#endif
 		if (raw_read(state, state->out, state->size /* << 1 */, &(state->have)) == -1)
 			return -1;
 		state->next = state->out;
 	}
 #ifdef HAVE_LIBZ
 	else if (state->compression == ZLIB) {      /* decompress */
+#ifdef GZ_PARALLEL
+		if (state->par != NULL) {
+			gboolean failed = FALSE;
+			struct zlib_segment *seg = zlib_parallel_get(state, state->pos, &failed);
+
+			if (seg != NULL) {
+				/* A worker has inflated this part for us. */
+				state->next = seg->data + (state->pos - seg->start->out);
+				state->have = (guint)(seg->end->out - state->pos);
+				state->raw_pos = seg->end->in;
+				state->seg_active = TRUE;
+				return 0;
+			}
+			if (state->seg_active) {
+				/*
+				 * Past the segments, or at one that failed;
+				 * inflate from the nearest point ourselves.
+				 * If it failed, the file doesn't match its
+				 * index, or is damaged; stick to inflating
+				 * it ourselves, so we get to check the CRC
+				 * at the end of the gzip member.
+				 */
+				struct fast_seek_point *here = fast_seek_find(state, state->pos);
+				int err;
+
+				state->seg_active = FALSE;
+				if (failed)
+					zlib_parallel_stop(state);
+				if (here == NULL) {
+					state->err = WTAP_ERR_DECOMPRESS;
+					state->err_info = "no seek point for inflated segment";
+					return -1;
+				}
+				if (fast_seek_restart(state, here, state->pos, &err) == -1) {
+					state->err = err;
+					state->err_info = NULL;
+					return -1;
+				}
+				if (state->seek_pending) {
+					state->seek_pending = FALSE;
+					if (gz_skip(state, state->skip) == -1)
+						return -1;
+				}
+				if (state->have == 0 && state->err == 0 &&
+				    !(state->eof && state->avail_in == 0))
+					return fill_out_buffer(state);
+				return 0;
+			}
+			if (failed)
+				zlib_parallel_stop(state);
+		}
+#endif
 		zlib_read(state, state->out, state->size << 1);
 	}
+#endif
+#ifdef HAVE_ZSTD
+	else if (state->compression == ZSTD)
+		zstd_read(state, state->out, state->size << 1);
+#endif
+#ifdef HAVE_LZ4
+	else if (state->compression == LZ4)
+		lz4_read(state, state->out, state->size << 1);
 #endif
 	return 0;
 }
@@ -796,6 +2140,29 @@ file_fdopen(int fd)
 
 	state->fast_seek_cur = NULL;
 	state->fast_seek = NULL;
+	state->path = NULL;
+	state->sequential = TRUE;
+	state->index_checked = FALSE;
+	state->index_loaded = FALSE;
+	state->own_fast_seek = FALSE;
+#ifdef HAVE_ZSTD
+	state->zstd_dctx = NULL;
+#endif
+#ifdef HAVE_LZ4
+	state->lz4_dctx = NULL;
+#endif
+	state->frame_end = FALSE;
+#ifdef GZ_PARALLEL
+	state->par = NULL;
+	state->seg_active = FALSE;
+#endif
+#ifdef HAVE_MMAP
+	state->want_map = FALSE;
+	state->map_failed = FALSE;
+	state->map = NULL;
+	state->map_size = 0;
+	state->open_size = 0;
+#endif
 
 	/* open the file with the appropriate mode (or just use fd) */
 	state->fd = fd;
@@ -907,15 +2274,42 @@ file_open(const char *path)
 		if (g_ascii_strcasecmp(suffixp, ".caz") == 0)
 			ft->dont_check_crc = TRUE;
 	}
+
+	/* Remember the name, for the seek index. */
+	ft->path = g_strdup(path);
 #endif
 
 	return ft;
 }
 
 void
-file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
+file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek)
 {
 	stream->fast_seek = seek;
+	stream->sequential = !random_flag;
+#ifdef HAVE_MMAP
+	/*
+	 * Random access reads jump all over the file, one packet at a
+	 * time; serve them straight from a mapping of the file rather
+	 * than with an lseek() and a read() per packet.
+	 */
+	stream->want_map = random_flag;
+	if (random_flag)
+		file_map_note_stat(stream);
+#else
+	(void)random_flag;
+#endif
+}
+
+void
+file_disable_mapping(FILE_T stream)
+{
+#ifdef HAVE_MMAP
+	file_unmap(stream);
+	stream->want_map = FALSE;
+#else
+	(void)stream;
+#endif
 }
 
 gint64
@@ -940,6 +2334,44 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 		offset += file->skip;
 	file->seek_pending = FALSE;
 
+#ifdef GZ_PARALLEL
+	if (file->seg_active) {
+		/*
+		 * We're reading inflated segments; just move to the new
+		 * position, and let fill_out_buffer() find it.
+		 */
+		if (file->pos + offset < 0) {
+			*err = EINVAL;
+			return -1;
+		}
+		file->pos += offset;
+		file->have = 0;
+		file->next = file->out;
+		return file->pos;
+	}
+#endif
+
+#ifdef HAVE_MMAP
+	if (file->map != NULL) {
+		/*
+		 * Mapped; just move to the new position.  If that's past
+		 * the end of the mapping, fill_out_buffer() checks whether
+		 * the file has changed.
+		 */
+		if (file->pos + offset < 0) {
+			*err = EINVAL;
+			return -1;
+		}
+		file->raw_pos += offset - file->have;
+		file->pos += offset;
+		file->have = 0;
+		file->eof = FALSE;
+		file->err = 0;
+		file->err_info = NULL;
+		return file->pos;
+	}
+#endif
+
 	if (offset < 0 && file->next) {
 		/*
 		 * This is guaranteed to fit in an unsigned int.
@@ -969,85 +2401,14 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 	}
 
 	/* XXX, profile */
-	if ((here = fast_seek_find(file, file->pos + offset)) && (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED)) {
-		gint64 off, off2;
-
-#ifdef HAVE_LIBZ
-		if (here->compression == ZLIB) {
-#ifdef HAVE_INFLATEPRIME
-			off = here->in - (here->data.zlib.bits ? 1 : 0);
-#else
-			off = here->in;
-#endif
-			off2 = here->out;
-		} else if (here->compression == GZIP_AFTER_HEADER) {
-			off = here->in;
-			off2 = here->out;
-		} else
-#endif
-		{
-			off2 = (file->pos + offset);
-			off = here->in + (off2 - here->out);
-		}
+	if ((here = fast_seek_find(file, file->pos + offset)) &&
+	    (offset < 0 || (offset > SPAN && here->out > file->pos) || here->compression == UNCOMPRESSED)) {
+		gint64 pos = file->pos + offset;
 
-		if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
-			*err = errno;
+		if (fast_seek_restart(file, here, pos, err) == -1)
 			return -1;
-		}
-		fast_seek_reset(file);
-
-		file->raw_pos = off;
-		file->have = 0;
-		file->eof = FALSE;
-		file->seek_pending = FALSE;
-		file->err = 0;
-		file->err_info = NULL;
-		file->avail_in = 0;
-
-#ifdef HAVE_LIBZ
-		if (here->compression == ZLIB) {
-			z_stream *strm = &file->strm;
-
-			inflateReset(strm);
-			strm->adler = here->data.zlib.adler;
-			strm->total_out = here->data.zlib.total_out;
-#ifdef HAVE_INFLATEPRIME
-			if (here->data.zlib.bits) {
-				FILE_T state = file;
-				int ret = GZ_GETC();
-
-				if (ret == -1) {
-					if (state->err == 0) {
-						/* EOF */
-						*err = WTAP_ERR_SHORT_READ;
-					} else
-						*err = state->err;
-					return -1;
-				}
-				(void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
-			}
-#endif
-			(void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
-			file->compression = ZLIB;
-		} else if (here->compression == GZIP_AFTER_HEADER) {
-			z_stream *strm = &file->strm;
-
-			inflateReset(strm);
-			strm->adler = crc32(0L, Z_NULL, 0);
-			file->compression = ZLIB;
-		} else
-#endif
-			file->compression = here->compression;
-
-		offset = (file->pos + offset) - off2;
-		file->pos = off2;
 		/* g_print("OK! %ld\n", offset); */
-
-		if (offset) {
-			file->seek_pending = TRUE;
-			file->skip = offset;
-		}
-		return file->pos + offset;
+		return pos;
 	}
 
 	/* if within raw area while reading, just go there */
@@ -1380,6 +2741,9 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+#ifdef HAVE_MMAP
+	file_unmap(file);
+#endif
 	ws_close(file->fd);
 	file->fd = -1;
 }
@@ -1392,6 +2756,13 @@ file_fdreopen(FILE_T file, const char *path)
 	if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
 		return FALSE;
 	file->fd = fd;
+#ifdef HAVE_MMAP
+	/* The file may have been replaced; map the new one when needed. */
+	file_unmap(file);
+	file->map_failed = FALSE;
+	if (file->want_map)
+		file_map_note_stat(file);
+#endif
 	return TRUE;
 }
 
@@ -1400,6 +2771,27 @@ file_close(FILE_T file)
 {
 	int fd = file->fd;
 
+#ifdef GZ_PARALLEL
+	if (file->par != NULL)
+		zlib_parallel_stop(file);
+#endif
+#if defined(HAVE_LIBZ) && defined(Z_BLOCK)
+	/*
+	 * If we've just inflated all of a compressed file, and built the
+	 * fast seek points doing so, save them for next time.
+	 */
+	if (seek_index_enabled &&
+	    file->sequential && file->path != NULL && fd != -1 &&
+	    file->is_compressed && file->fast_seek != NULL &&
+	    !file->own_fast_seek && !file->index_loaded &&
+	    file->eof && file->avail_in == 0 && file->have == 0 &&
+	    file->err == 0)
+		gzidx_save(file);
+	if (file->own_fast_seek)
+		gzidx_free_points(file->fast_seek);
+#endif
+	g_free(file->path);
+
 	/* free memory and close file */
 	if (file->size) {
 #ifdef HAVE_LIBZ
@@ -1408,7 +2800,18 @@ file_close(FILE_T file)
 		g_free(file->out);
 		g_free(file->in);
 	}
+#ifdef HAVE_ZSTD
+	ZSTD_freeDCtx(file->zstd_dctx);
+#endif
+#ifdef HAVE_LZ4
+	if (file->lz4_dctx != NULL)
+		LZ4F_freeDecompressionContext(file->lz4_dctx);
+#endif
 	g_free(file->fast_seek_cur);
+#ifdef HAVE_MMAP
+	if (file->map != NULL)
+		munmap(file->map, (size_t)file->map_size);
+#endif
 	file->err = 0;
 	file->err_info = NULL;
 	g_free(file);
@@ -1693,3 +3096,304 @@ gzwfile_geterr(GZWFILE_T state)
     return state->err;
 }
 #endif
+
+#ifdef HAVE_FRAME_COMPRESSION
+/*
+ * Zstandard and LZ4 output is written as a sequence of independently
+ * compressed frames of FRAME_SIZE bytes of uncompressed data each, so
+ * that a reader can start decompressing at any frame boundary.
+ */
+#define FRAME_SIZE              (1U << 20)
+
+#ifdef HAVE_ZSTD
+#define FRAME_ZSTD_LEVEL        3
+#endif
+
+/* internal frame compressor state data structure for writing */
+struct wtap_frame_writer {
+    int fd;                 /* file descriptor */
+    wtap_compression_type compression_type; /* type of compression */
+    unsigned char *in;      /* uncompressed data for the current frame */
+    guint have;             /* amount of data in the current frame */
+    unsigned char *out;     /* compressed frame */
+    size_t out_size;        /* size of the compressed frame buffer */
+    int err;                /* error code */
+#ifdef HAVE_ZSTD
+    ZSTD_CCtx *cctx;        /* Zstandard compression context */
+    guint32 *seek_table;    /* compressed, uncompressed size of each frame */
+    guint nframes;          /* number of frames written */
+    guint seek_table_size;  /* number of frames seek_table has room for */
+#endif
+};
+
+#ifdef HAVE_LZ4
+static void
+frame_lz4_prefs(LZ4F_preferences_t *prefs, size_t content_size)
+{
+    memset(prefs, 0, sizeof *prefs);
+    prefs->frameInfo.blockMode = LZ4F_blockIndependent;
+    prefs->frameInfo.contentSize = content_size;
+    prefs->frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+}
+#endif
+
+FRWFILE_T
+frwfile_open(const char *path, wtap_compression_type compression_type)
+{
+    int fd;
+    FRWFILE_T state;
+    int save_errno;
+
+    fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
+    if (fd == -1)
+        return NULL;
+    state = frwfile_fdopen(fd, compression_type);
+    if (state == NULL) {
+        save_errno = errno;
+        close(fd);
+        errno = save_errno;
+    }
+    return state;
+}
+
+FRWFILE_T
+frwfile_fdopen(int fd, wtap_compression_type compression_type)
+{
+    FRWFILE_T state;
+#ifdef HAVE_LZ4
+    LZ4F_preferences_t prefs;
+#endif
+
+    /* allocate wtap_frame_writer structure to return */
+    state = (FRWFILE_T)g_try_malloc0(sizeof *state);
+    if (state == NULL)
+        return NULL;
+    state->fd = fd;
+    state->compression_type = compression_type;
+
+    switch (compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        state->out_size = ZSTD_compressBound(FRAME_SIZE);
+        state->cctx = ZSTD_createCCtx();
+        if (state->cctx == NULL) {
+            g_free(state);
+            errno = ENOMEM;
+            return NULL;
+        }
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        frame_lz4_prefs(&prefs, FRAME_SIZE);
+        state->out_size = LZ4F_compressFrameBound(FRAME_SIZE, &prefs);
+        break;
+#endif
+
+    default:
+        g_free(state);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* allocate buffers */
+    state->in = (unsigned char *)g_try_malloc(FRAME_SIZE);
+    state->out = (unsigned char *)g_try_malloc(state->out_size);
+    if (state->in == NULL || state->out == NULL) {
+        g_free(state->out);
+        g_free(state->in);
+#ifdef HAVE_ZSTD
+        ZSTD_freeCCtx(state->cctx);
+#endif
+        g_free(state);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    /* return stream */
+    return state;
+}
+
+/* Write len bytes from buf.  Return -1 on error, 0 on success. */
+static int
+frame_write_all(FRWFILE_T state, const unsigned char *buf, size_t len)
+{
+    ssize_t got;
+
+    got = write(state->fd, buf, (unsigned int)len);
+    if (got < 0) {
+        state->err = errno;
+        return -1;
+    }
+    if ((size_t)got != len) {
+        state->err = WTAP_ERR_SHORT_WRITE;
+        return -1;
+    }
+    return 0;
+}
+
+/* Compress and write out the current frame.  Return -1 on error, 0 on
+   success. */
+static int
+frame_comp(FRWFILE_T state)
+{
+    size_t len;
+
+    if (state->have == 0)
+        return 0;
+
+    switch (state->compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        len = ZSTD_compressCCtx(state->cctx, state->out, state->out_size,
+                                state->in, state->have, FRAME_ZSTD_LEVEL);
+        if (ZSTD_isError(len)) {
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        /* note where the frame is, for the seek table */
+        if (state->seek_table != NULL || state->nframes == 0) {
+            if (state->nframes == state->seek_table_size) {
+                if (state->nframes >= ZSTD_SEEKABLE_MAX_FRAMES) {
+                    /* Too many frames; don't write a seek table. */
+                    g_free(state->seek_table);
+                    state->seek_table = NULL;
+                } else {
+                    state->seek_table_size = state->seek_table_size ? state->seek_table_size * 2 : 64;
+                    state->seek_table = (guint32 *)g_realloc(state->seek_table,
+                        state->seek_table_size * 2 * sizeof (guint32));
+                }
+            }
+            if (state->seek_table != NULL) {
+                state->seek_table[2 * state->nframes] = (guint32)len;
+                state->seek_table[2 * state->nframes + 1] = state->have;
+            }
+        }
+        state->nframes++;
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+    {
+        LZ4F_preferences_t prefs;
+
+        frame_lz4_prefs(&prefs, state->have);
+        len = LZ4F_compressFrame(state->out, state->out_size,
+                                 state->in, state->have, &prefs);
+        if (LZ4F_isError(len)) {
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        break;
+    }
+#endif
+
+    default:
+        state->err = WTAP_ERR_INTERNAL;
+        return -1;
+    }
+
+    state->have = 0;
+    return frame_write_all(state, state->out, len);
+}
+
+#ifdef HAVE_ZSTD
+/* Write out the seek table.  Return -1 on error, 0 on success. */
+static int
+frame_zstd_seek_table(FRWFILE_T state)
+{
+    unsigned char *table;
+    size_t len;
+    int ret;
+
+    if (state->seek_table == NULL)
+        return 0;
+
+    table = zstd_seek_table_frame(state->seek_table, state->nframes, &len);
+    ret = frame_write_all(state, table, (guint)len);
+    g_free(table);
+    return ret;
+}
+#endif
+
+/* Write out len bytes from buf.  Returns 0 on error (in which case
+   state->err is set), or len on success. */
+guint
+frwfile_write(FRWFILE_T state, const void *buf, guint len)
+{
+    guint put = len;
+    guint n;
+
+    /* check for an existing error */
+    if (state->err != 0)
+        return 0;
+
+    /* copy to the frame buffer, compressing each frame as it fills */
+    while (len) {
+        n = FRAME_SIZE - state->have;
+        if (n > len)
+            n = len;
+        memcpy(state->in + state->have, buf, n);
+        state->have += n;
+        buf = (const char *)buf + n;
+        len -= n;
+        if (state->have == FRAME_SIZE && frame_comp(state) == -1)
+            return 0;
+    }
+
+    /* input was all buffered or compressed */
+    return put;
+}
+
+/* Flush out what we've written so far, ending the current frame.
+   Returns -1, and sets state->err, on error; returns 0 on success. */
+int
+frwfile_flush(FRWFILE_T state)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return -1;
+
+    if (frame_comp(state) == -1)
+        return -1;
+    return 0;
+}
+
+/* Flush out all data written, and close the file.  Returns a Wiretap
+   error on failure; returns 0 on success. */
+int
+frwfile_close(FRWFILE_T state)
+{
+    int ret = 0;
+
+    /* flush, free memory, and close file */
+    if (state->err == 0 && frame_comp(state) == -1)
+        ret = state->err;
+#ifdef HAVE_ZSTD
+    if (ret == 0 && state->err == 0 &&
+        state->compression_type == WTAP_ZSTD_COMPRESSED &&
+        frame_zstd_seek_table(state) == -1)
+        ret = state->err;
+    ZSTD_freeCCtx(state->cctx);
+    g_free(state->seek_table);
+#endif
+    if (ret == 0)
+        ret = state->err;
+    g_free(state->out);
+    g_free(state->in);
+    if (close(state->fd) == -1 && ret == 0)
+        ret = errno;
+    g_free(state);
+    return ret;
+}
+
+int
+frwfile_geterr(FRWFILE_T state)
+{
+    return state->err;
+}
+#endif /* HAVE_FRAME_COMPRESSION */
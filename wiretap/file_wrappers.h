@@ -29,6 +29,10 @@
 extern FILE_T file_open(const char *path);
 extern FILE_T file_fdopen(int fildes);
 extern void file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek);
+extern void file_disable_mapping(FILE_T stream);
+extern void file_set_seek_index(gboolean enable);
+extern void file_set_inflate_threads(guint nthreads);
+extern void file_set_seek_span_divisor(guint divisor);
 WS_DLL_PUBLIC gint64 file_seek(FILE_T stream, gint64 offset, int whence, int *err);
 extern gboolean file_skip(FILE_T file, gint64 delta, int *err);
 WS_DLL_PUBLIC gint64 file_tell(FILE_T stream);
@@ -57,4 +61,17 @@ extern int gzwfile_close(GZWFILE_T state);
 extern int gzwfile_geterr(GZWFILE_T state);
 #endif /* HAVE_LIBZ */
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+#define HAVE_FRAME_COMPRESSION
+
+typedef struct wtap_frame_writer *FRWFILE_T;
+
+extern FRWFILE_T frwfile_open(const char *path, wtap_compression_type compression_type);
+extern FRWFILE_T frwfile_fdopen(int fd, wtap_compression_type compression_type);
+extern guint frwfile_write(FRWFILE_T state, const void *buf, guint len);
+extern int frwfile_flush(FRWFILE_T state);
+extern int frwfile_close(FRWFILE_T state);
+extern int frwfile_geterr(FRWFILE_T state);
+#endif /* HAVE_ZSTD || HAVE_LZ4 */
+
 #endif /* __FILE_H__ */
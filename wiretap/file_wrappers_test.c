@@ -0,0 +1,628 @@
+/* file_wrappers_test.c
+ * Tests for the saved seek index and parallel inflate of gzipped files,
+ * and for mapped random access to uncompressed ones
+ *
+ * Wiretap Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "wtap-int.h"
+#include "file_wrappers.h"
+
+#if defined(HAVE_LIBZ)
+#include <zlib.h>
+#endif
+
+/*
+ * Big enough, once gzipped, to get an index saved, and to be split
+ * into a good number of segments for parallel inflate.
+ */
+#define DATA_SIZE	(20*1024*1024)
+#define READ_SIZE	65536
+
+static char *tmp_dir;
+static char *capture_path;
+static char *index_dir;
+static guint8 *data;
+
+#if defined(HAVE_LIBZ) && defined(Z_BLOCK)
+
+/* Data that doesn't compress, so that the gzipped file is big, too. */
+static void
+make_data(void)
+{
+	guint32 x = 2463534242U;
+	guint i;
+
+	data = (guint8 *)g_malloc(DATA_SIZE);
+	for (i = 0; i < DATA_SIZE; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		data[i] = (guint8)x;
+	}
+}
+
+static void
+write_capture(void)
+{
+	gzFile gz;
+	guint off;
+
+	gz = gzopen(capture_path, "wb1");
+	g_assert(gz != NULL);
+	for (off = 0; off < DATA_SIZE; off += READ_SIZE)
+		g_assert(gzwrite(gz, data + off, READ_SIZE) == READ_SIZE);
+	g_assert(gzclose(gz) == Z_OK);
+}
+
+/* Remove all the indices. */
+static void
+clear_indices(void)
+{
+	GDir *dir;
+	const char *entry;
+	char *path;
+
+	dir = g_dir_open(index_dir, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((entry = g_dir_read_name(dir)) != NULL) {
+		path = g_build_filename(index_dir, entry, NULL);
+		ws_unlink(path);
+		g_free(path);
+	}
+	g_dir_close(dir);
+}
+
+/* Get the path of the index, if there's exactly one. */
+static char *
+find_index(void)
+{
+	GDir *dir;
+	const char *entry;
+	char *path = NULL;
+	guint count = 0;
+
+	dir = g_dir_open(index_dir, 0, NULL);
+	if (dir == NULL)
+		return NULL;
+	while ((entry = g_dir_read_name(dir)) != NULL) {
+		count++;
+		g_free(path);
+		path = g_build_filename(index_dir, entry, NULL);
+	}
+	g_dir_close(dir);
+	if (count != 1) {
+		g_free(path);
+		return NULL;
+	}
+	return path;
+}
+
+static void
+free_points(GPtrArray *points)
+{
+	guint i;
+
+	for (i = 0; i < points->len; i++)
+		g_free(points->pdata[i]);
+	g_ptr_array_free(points, TRUE);
+}
+
+/*
+ * Read the capture file all the way through, as the sequential stream
+ * of a wtap would, and check what we read.  Returns the number of fast
+ * seek points there were after reading the first byte, which is more
+ * than a few only if they came from an index.  If points isn't NULL,
+ * the fast seek points are handed back rather than freed.
+ */
+static guint
+read_capture(GPtrArray **points)
+{
+	FILE_T fh;
+	GPtrArray *seek;
+	guint8 *buf;
+	guint off, first_points;
+	int n;
+
+	fh = file_open(capture_path);
+	g_assert(fh != NULL);
+	seek = g_ptr_array_new();
+	file_set_random_access(fh, FALSE, seek);
+
+	buf = (guint8 *)g_malloc(READ_SIZE);
+	g_assert(file_read(buf, 1, fh) == 1);
+	g_assert(buf[0] == data[0]);
+	first_points = seek->len;
+	for (off = 1; off < DATA_SIZE; off += n) {
+		n = file_read(buf, READ_SIZE, fh);
+		g_assert(n > 0);
+		g_assert(memcmp(buf, data + off, n) == 0);
+	}
+	g_assert(file_read(buf, READ_SIZE, fh) == 0);
+	g_assert(file_error(fh, NULL) == 0);
+	g_free(buf);
+	file_close(fh);
+
+	if (points != NULL)
+		*points = seek;
+	else
+		free_points(seek);
+	return first_points;
+}
+
+static gchar *
+read_index(gsize *len)
+{
+	char *path;
+	gchar *contents;
+
+	path = find_index();
+	g_assert(path != NULL);
+	g_assert(g_file_get_contents(path, &contents, len, NULL));
+	g_free(path);
+	return contents;
+}
+
+static void
+write_index(const gchar *contents, gsize len)
+{
+	char *path;
+
+	path = find_index();
+	g_assert(path != NULL);
+	g_assert(g_file_set_contents(path, contents, len, NULL));
+	g_free(path);
+}
+
+/* Nothing gets saved unless asked for. */
+static void
+test_seek_index_off(void)
+{
+	file_set_seek_index(FALSE);
+	clear_indices();
+	read_capture(NULL);
+	g_assert(find_index() == NULL);
+}
+
+/* An index saved by one read is used by the next. */
+static void
+test_seek_index_round_trip(void)
+{
+	char *path;
+
+	file_set_seek_index(TRUE);
+	clear_indices();
+	g_assert(read_capture(NULL) < 10);
+	path = find_index();
+	g_assert(path != NULL);
+	g_free(path);
+
+	/* Nothing goes next to the capture file. */
+	path = g_strdup_printf("%s.gzidx", capture_path);
+	g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+	g_free(path);
+
+	/* It starts off with all of them, and inflates in parallel. */
+	g_assert(read_capture(NULL) >= 10);
+}
+
+/*
+ * Inflating with any number of threads gives the same data, and
+ * stopping part way through leaves no thread behind.
+ */
+static void
+test_parallel_inflate(void)
+{
+	FILE_T fh;
+	guint8 *buf;
+	guint nthreads;
+
+	file_set_seek_index(TRUE);
+	clear_indices();
+	read_capture(NULL);
+	for (nthreads = 1; nthreads <= 4; nthreads++) {
+		file_set_inflate_threads(nthreads);
+		g_assert(read_capture(NULL) >= 10);
+
+		fh = file_open(capture_path);
+		g_assert(fh != NULL);
+		buf = (guint8 *)g_malloc(DATA_SIZE / 4);
+		g_assert(file_read(buf, DATA_SIZE / 4, fh) == DATA_SIZE / 4);
+		g_assert(memcmp(buf, data, DATA_SIZE / 4) == 0);
+		g_free(buf);
+		file_close(fh);
+	}
+	file_set_inflate_threads(0);
+}
+
+/*
+ * Get the largest gap between a fast seek point within a gzip member
+ * and the one before it, from the index.
+ */
+static gint64
+index_max_gap(void)
+{
+	gchar *contents;
+	gsize len, off;
+	guint32 count, type, wlen, i;
+	gint64 out, prev = -1, gap = 0;
+
+	contents = read_index(&len);
+	memcpy(&count, contents + 12, sizeof count);
+	off = 32;
+	for (i = 0; i < count; i++) {
+		/* offset in the file, offset in the data, type */
+		g_assert(off + 20 <= len);
+		memcpy(&out, contents + off + 8, sizeof out);
+		memcpy(&type, contents + off + 16, sizeof type);
+		off += 20;
+		if (type == 1) {
+			/* bits, adler, total out, compressed window */
+			if (prev != -1 && out - prev > gap)
+				gap = out - prev;
+			g_assert(off + 16 <= len);
+			memcpy(&wlen, contents + off + 12, sizeof wlen);
+			off += 16 + wlen;
+		}
+		prev = type != 0 ? out : -1;
+	}
+	g_assert(off == len);
+	g_free(contents);
+	return gap;
+}
+
+/*
+ * Far enough into a file, fast seek points are still close enough
+ * together to inflate in parallel, and to seek to quickly.  Putting
+ * them half as far apart as the offset gets us there in a file of tens
+ * of megabytes rather than tens of gigabytes.
+ */
+#define BIG_COPIES	4
+#define MAX_SEGMENT	(32*1024*1024)	/* PARALLEL_MAX_SEGMENT */
+
+static void
+test_seek_span_max(void)
+{
+	char *path;
+	gzFile gz;
+	FILE_T fh;
+	GPtrArray *seek;
+	guint8 *buf;
+	gint64 off;
+	guint copy;
+	int n, err, i;
+
+	path = g_build_filename(tmp_dir, "big.gz", NULL);
+	gz = gzopen(path, "wb1");
+	g_assert(gz != NULL);
+	for (copy = 0; copy < BIG_COPIES; copy++)
+		g_assert(gzwrite(gz, data, DATA_SIZE) == DATA_SIZE);
+	g_assert(gzclose(gz) == Z_OK);
+
+	file_set_seek_index(TRUE);
+	file_set_seek_span_divisor(2);
+	clear_indices();
+	buf = (guint8 *)g_malloc(READ_SIZE);
+	for (i = 0; i < 2; i++) {
+		/* The first time writes the index, the second inflates in parallel. */
+		file_set_inflate_threads(i == 0 ? 0 : 2);
+		fh = file_open(path);
+		g_assert(fh != NULL);
+		seek = g_ptr_array_new();
+		file_set_random_access(fh, FALSE, seek);
+		for (off = 0; off < (gint64)BIG_COPIES * DATA_SIZE; off += n) {
+			n = file_read(buf, READ_SIZE, fh);
+			g_assert(n > 0);
+			g_assert(memcmp(buf, data + off % DATA_SIZE, n) == 0);
+		}
+		g_assert(file_read(buf, READ_SIZE, fh) == 0);
+		g_assert(file_error(fh, NULL) == 0);
+		file_close(fh);
+		if (i == 0)
+			free_points(seek);
+	}
+	file_set_inflate_threads(0);
+	file_set_seek_span_divisor(0);
+
+	g_assert(index_max_gap() <= MAX_SEGMENT);
+
+	fh = file_open(path);
+	g_assert(fh != NULL);
+	file_set_random_access(fh, TRUE, seek);
+	for (i = 0; i < 16; i++) {
+		off = g_test_rand_int_range(2 * DATA_SIZE, BIG_COPIES * DATA_SIZE - READ_SIZE);
+		g_assert(file_seek(fh, off, SEEK_SET, &err) == off);
+		g_assert(file_read(buf, READ_SIZE, fh) == READ_SIZE);
+		g_assert(memcmp(buf, data + off % DATA_SIZE, READ_SIZE) == 0);
+	}
+	file_close(fh);
+	free_points(seek);
+	g_free(buf);
+
+	clear_indices();
+	ws_unlink(path);
+	g_free(path);
+}
+
+/*
+ * The segments inflated in parallel line up with what random access
+ * reads from the same points.
+ */
+static void
+test_seek_index_random_access(void)
+{
+	GPtrArray *seek;
+	FILE_T fh;
+	guint8 *buf;
+	gint64 off;
+	int err, i;
+
+	file_set_seek_index(TRUE);
+	clear_indices();
+	read_capture(NULL);
+	file_set_inflate_threads(2);
+	read_capture(&seek);
+	file_set_inflate_threads(0);
+
+	fh = file_open(capture_path);
+	g_assert(fh != NULL);
+	file_set_random_access(fh, TRUE, seek);
+	buf = (guint8 *)g_malloc(READ_SIZE);
+	for (i = 0; i < 64; i++) {
+		off = g_test_rand_int_range(0, DATA_SIZE - READ_SIZE);
+		g_assert(file_seek(fh, off, SEEK_SET, &err) == off);
+		g_assert(file_read(buf, READ_SIZE, fh) == READ_SIZE);
+		g_assert(memcmp(buf, data + off, READ_SIZE) == 0);
+	}
+	g_free(buf);
+	file_close(fh);
+	free_points(seek);
+}
+
+/*
+ * An index that's for another version of the file, or that's been
+ * damaged, is ignored, and replaced by a good one.
+ */
+static void
+test_seek_index_rejected(void)
+{
+	gchar *good, *bad;
+	gsize len;
+	gint64 size;
+	guint32 count;
+
+	file_set_seek_index(TRUE);
+	clear_indices();
+	read_capture(NULL);
+	good = read_index(&len);
+	g_assert(len > 40);
+
+	/* size of the file, after the magic, byte order mark, and count */
+	bad = (gchar *)g_memdup(good, (guint)len);
+	memcpy(&size, bad + 16, sizeof size);
+	size++;
+	memcpy(bad + 16, &size, sizeof size);
+	write_index(bad, len);
+	g_assert(read_capture(NULL) < 10);
+	g_assert(read_capture(NULL) >= 10);
+	g_free(bad);
+
+	/* magic */
+	bad = (gchar *)g_memdup(good, (guint)len);
+	bad[0] = 'X';
+	write_index(bad, len);
+	g_assert(read_capture(NULL) < 10);
+	g_free(bad);
+
+	/* more points than there are */
+	bad = (gchar *)g_memdup(good, (guint)len);
+	memcpy(&count, bad + 12, sizeof count);
+	count++;
+	memcpy(bad + 12, &count, sizeof count);
+	write_index(bad, len);
+	g_assert(read_capture(NULL) < 10);
+	g_free(bad);
+
+	/* cut short in the middle of the points */
+	write_index(good, len / 2);
+	g_assert(read_capture(NULL) < 10);
+
+	/* first point at a bad offset */
+	bad = (gchar *)g_memdup(good, (guint)len);
+	memset(bad + 32, 0xff, 8);
+	write_index(bad, len);
+	g_assert(read_capture(NULL) < 10);
+	g_free(bad);
+
+	g_assert(read_capture(NULL) >= 10);
+	g_free(good);
+}
+
+#ifndef _WIN32
+/*
+ * Something planted where the index goes is replaced, not written
+ * through.
+ */
+static void
+test_seek_index_symlink(void)
+{
+	char *path, *victim;
+	gchar *contents;
+	gsize len;
+
+	file_set_seek_index(TRUE);
+	clear_indices();
+	read_capture(NULL);
+	path = find_index();
+	g_assert(path != NULL);
+	ws_unlink(path);
+
+	victim = g_build_filename(tmp_dir, "victim", NULL);
+	g_assert(g_file_set_contents(victim, "precious", -1, NULL));
+	g_assert(symlink(victim, path) == 0);
+
+	g_assert(read_capture(NULL) < 10);
+	g_assert(g_file_get_contents(victim, &contents, &len, NULL));
+	g_assert(len == 8 && memcmp(contents, "precious", 8) == 0);
+	g_free(contents);
+	g_assert(!g_file_test(path, G_FILE_TEST_IS_SYMLINK));
+	g_assert(read_capture(NULL) >= 10);
+
+	ws_unlink(victim);
+	g_free(victim);
+	g_free(path);
+}
+#endif /* _WIN32 */
+#endif /* HAVE_LIBZ && Z_BLOCK */
+
+#ifdef HAVE_MMAP
+#define GROW_SIZE	(256*1024)
+
+/*
+ * Random access to a file that's mapped and then grows reads what was
+ * added once it gets to the end of the mapping, rather than stopping
+ * where the file ended when it was mapped.
+ */
+static void
+test_map_growing(void)
+{
+	char *path;
+	FILE *fp;
+	FILE_T fh;
+	guint8 *contents, buf[1024];
+	int err, i;
+
+	contents = (guint8 *)g_malloc(2 * GROW_SIZE);
+	for (i = 0; i < 2 * GROW_SIZE; i++)
+		contents[i] = (guint8)(i * 7 + i / 251);
+	path = g_build_filename(tmp_dir, "growing", NULL);
+	fp = ws_fopen(path, "wb");
+	g_assert(fp != NULL);
+	g_assert(fwrite(contents, 1, GROW_SIZE, fp) == GROW_SIZE);
+	g_assert(fflush(fp) == 0);
+
+	fh = file_open(path);
+	g_assert(fh != NULL);
+	file_set_random_access(fh, TRUE, NULL);
+	g_assert(file_seek(fh, GROW_SIZE / 2, SEEK_SET, &err) == GROW_SIZE / 2);
+	g_assert(file_read(buf, sizeof buf, fh) == sizeof buf);
+	g_assert(memcmp(buf, contents + GROW_SIZE / 2, sizeof buf) == 0);
+
+	g_assert(fwrite(contents + GROW_SIZE, 1, GROW_SIZE, fp) == GROW_SIZE);
+	g_assert(fclose(fp) == 0);
+
+	/* Straddle the old end of the file... */
+	g_assert(file_seek(fh, GROW_SIZE - 100, SEEK_SET, &err) == GROW_SIZE - 100);
+	g_assert(file_read(buf, sizeof buf, fh) == sizeof buf);
+	g_assert(memcmp(buf, contents + GROW_SIZE - 100, sizeof buf) == 0);
+
+	/* ...and go back to before it, and on to the new end. */
+	g_assert(file_seek(fh, 10, SEEK_SET, &err) == 10);
+	g_assert(file_read(buf, sizeof buf, fh) == sizeof buf);
+	g_assert(memcmp(buf, contents + 10, sizeof buf) == 0);
+	g_assert(file_seek(fh, 2 * GROW_SIZE - 10, SEEK_SET, &err) == 2 * GROW_SIZE - 10);
+	g_assert(file_read(buf, sizeof buf, fh) == 10);
+	g_assert(memcmp(buf, contents + 2 * GROW_SIZE - 10, 10) == 0);
+	g_assert(file_error(fh, NULL) == 0);
+
+	file_close(fh);
+	ws_unlink(path);
+	g_free(path);
+	g_free(contents);
+}
+#endif /* HAVE_MMAP */
+
+int
+main(int argc, char **argv)
+{
+	char *cache_dir, *ws_cache_dir;
+	int ret;
+
+	g_test_init(&argc, &argv, NULL);
+
+	/* Keep the indices we write out of the user's cache directory. */
+	tmp_dir = g_strdup_printf("%s" G_DIR_SEPARATOR_S "file_wrappers_test.%d",
+	    g_get_tmp_dir(), (int)getpid());
+	g_assert(g_mkdir_with_parents(tmp_dir, 0700) == 0);
+	cache_dir = g_build_filename(tmp_dir, "cache", NULL);
+	g_setenv("XDG_CACHE_HOME", cache_dir, TRUE);
+	ws_cache_dir = g_build_filename(g_get_user_cache_dir(), "wireshark", NULL);
+	index_dir = g_build_filename(ws_cache_dir, "gzidx", NULL);
+	capture_path = g_build_filename(tmp_dir, "capture.gz", NULL);
+
+#if defined(HAVE_LIBZ) && defined(Z_BLOCK)
+	make_data();
+	write_capture();
+
+	g_test_add_func("/file_wrappers/seek_index/off", test_seek_index_off);
+	g_test_add_func("/file_wrappers/seek_index/round_trip", test_seek_index_round_trip);
+	g_test_add_func("/file_wrappers/seek_index/random_access", test_seek_index_random_access);
+	g_test_add_func("/file_wrappers/parallel_inflate", test_parallel_inflate);
+	g_test_add_func("/file_wrappers/seek_span_max", test_seek_span_max);
+	g_test_add_func("/file_wrappers/seek_index/rejected", test_seek_index_rejected);
+#ifndef _WIN32
+	g_test_add_func("/file_wrappers/seek_index/symlink", test_seek_index_symlink);
+#endif
+#endif
+#ifdef HAVE_MMAP
+	g_test_add_func("/file_wrappers/map/growing", test_map_growing);
+#endif
+
+	ret = g_test_run();
+
+#if defined(HAVE_LIBZ) && defined(Z_BLOCK)
+	clear_indices();
+#endif
+	g_rmdir(index_dir);
+	g_rmdir(ws_cache_dir);
+	g_rmdir(cache_dir);
+	ws_unlink(capture_path);
+	g_rmdir(tmp_dir);
+	g_free(capture_path);
+	g_free(index_dir);
+	g_free(ws_cache_dir);
+	g_free(cache_dir);
+	g_free(tmp_dir);
+	g_free(data);
+
+	return ret;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
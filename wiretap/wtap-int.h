@@ -81,7 +81,7 @@ struct wtap {
 struct wtap_dumper;
 
 /*
- * This could either be a FILE * or a gzFile.
+ * This could be a FILE *, a GZWFILE_T, or a FRWFILE_T.
  */
 typedef void *WFILE_T;
 
@@ -96,6 +96,7 @@ struct wtap_dumper {
     int                     snaplen;
     int                     encap;
     gboolean                compressed;
+    wtap_compression_type   compression_type;
     gint64                  bytes_dumped;
 
     void                    *priv;       /* this one holds per-file state and is free'd automatically by wtap_dump_close() */
@@ -908,6 +908,19 @@ wtap_fdclose(wtap *wth)
 		file_fdclose(wth->random_fh);
 }
 
+void
+wtap_disable_mapping(wtap *wth)
+{
+	if (wth->random_fh != NULL)
+		file_disable_mapping(wth->random_fh);
+}
+
+void
+wtap_set_seek_index(gboolean enable)
+{
+	file_set_seek_index(enable);
+}
+
 void
 wtap_close(wtap *wth)
 {
@@ -1377,6 +1377,14 @@ WS_DLL_PUBLIC
 struct wtap* wtap_open_offline(const char *filename, unsigned int type, int *err,
     gchar **err_info, gboolean do_random);
 
+/**
+ * Set whether to keep an index of the seek points of big gzipped files
+ * in the user's cache directory, and use it to open them faster the
+ * next time.  Off by default.
+ */
+WS_DLL_PUBLIC
+void wtap_set_seek_index(gboolean enable);
+
 /**
  * If we were compiled with zlib and we're at EOF, unset EOF so that
  * wtap_read/gzread has a chance to succeed. This is necessary if
@@ -1447,6 +1455,11 @@ void wtap_fdclose(wtap *wth);
 WS_DLL_PUBLIC
 gboolean wtap_fdreopen(wtap *wth, const char *filename, int *err);
 
+/*** read the file for random access rather than mapping it, as it's a
+     temporary file or still being written ***/
+WS_DLL_PUBLIC
+void wtap_disable_mapping(wtap *wth);
+
 /*** close the current file ***/
 WS_DLL_PUBLIC
 void wtap_sequential_close(wtap *wth);
@@ -1471,6 +1484,37 @@ int wtap_dump_file_encap_type(const GArray *file_encaps);
 WS_DLL_PUBLIC
 gboolean wtap_dump_can_compress(int filetype);
 
+/**
+ * Types of compression for a capture file being written.
+ */
+typedef enum {
+    WTAP_UNCOMPRESSED,      /**< not compressed */
+    WTAP_GZIP_COMPRESSED,   /**< gzip */
+    WTAP_ZSTD_COMPRESSED,   /**< zstd, in independent frames with a seek table */
+    WTAP_LZ4_COMPRESSED     /**< LZ4 frames */
+} wtap_compression_type;
+
+/**
+ * Return TRUE if this build can write files with the given type of
+ * compression, FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_can_write_compression_type(wtap_compression_type compression_type);
+
+/**
+ * Return the type of compression implied by the extension of a file
+ * name ("gz", "zst" or "lz4"), or WTAP_UNCOMPRESSED if it has none
+ * of those.
+ */
+WS_DLL_PUBLIC
+wtap_compression_type wtap_extension_to_compression_type(const char *filename);
+
+/**
+ * Return a short name for a type of compression, for messages.
+ */
+WS_DLL_PUBLIC
+const char *wtap_compression_type_name(wtap_compression_type compression_type);
+
 /**
  * Return TRUE if this capture file format supports storing name
  * resolution information in it, FALSE if not.
@@ -1501,6 +1545,20 @@ WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int filetype, int encap, int snaplen,
                 gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
 
+/**
+ * Like wtap_dump_open_ng() and wtap_dump_fdopen_ng(), but with a choice
+ * of the type of compression rather than just gzip or none.
+ */
+WS_DLL_PUBLIC
+wtap_dumper* wtap_dump_open_compressed(const char *filename, int filetype, int encap,
+    int snaplen, wtap_compression_type compression_type, wtapng_section_t *shb_hdr,
+    wtapng_iface_descriptions_t *idb_inf, int *err);
+
+WS_DLL_PUBLIC
+wtap_dumper* wtap_dump_fdopen_compressed(int fd, int filetype, int encap, int snaplen,
+    wtap_compression_type compression_type, wtapng_section_t *shb_hdr,
+    wtapng_iface_descriptions_t *idb_inf, int *err);
+
 
 WS_DLL_PUBLIC
 gboolean wtap_dump(wtap_dumper *, const struct wtap_pkthdr *, const guint8 *, int *err);
@@ -28,6 +28,8 @@
 #endif
 #include "ws_mempbrk.h"
 
+#include <string.h>
+
 const guint8 *
 _ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles)
 {
@@ -47,11 +49,31 @@ _ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles)
 	return NULL;
 }
 
+size_t
+_ws_memspn(const guint8* haystack, size_t haystacklen, const guint8 *accept)
+{
+	gchar         tmp[256] = { 0 };
+	size_t        i;
+
+	while (*accept)
+		tmp[*accept++] = 1;
+
+	for (i = 0; i < haystacklen; i++) {
+		if (!tmp[haystack[i]])
+			break;
+	}
+
+	return i;
+}
+
 WS_DLL_PUBLIC const guint8 *
 ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles)
 {
 #ifdef HAVE_SSE4_2
 	static int have_sse42 = -1;
+#endif
+#ifdef WS_HAVE_SSE2
+	size_t needleslen;
 #endif
 	if (*needles == 0)
 		return NULL;
@@ -64,5 +86,29 @@ ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles)
 		return _ws_mempbrk_sse42(haystack, haystacklen, needles);
 #endif
 
+#ifdef WS_HAVE_SSE2
+	needleslen = strlen((const char *) needles);
+	if (haystacklen >= 16 && needleslen <= WS_SSE2_MAX_NEEDLES)
+		return _ws_mempbrk_sse2(haystack, haystacklen, needles, needleslen);
+#endif
+
 	return _ws_mempbrk(haystack, haystacklen, needles);
 }
+
+WS_DLL_PUBLIC size_t
+ws_memspn(const guint8* haystack, size_t haystacklen, const guint8 *accept)
+{
+#ifdef WS_HAVE_SSE2
+	size_t acceptlen;
+#endif
+	if (*accept == 0 || haystacklen == 0)
+		return 0;
+
+#ifdef WS_HAVE_SSE2
+	acceptlen = strlen((const char *) accept);
+	if (haystacklen >= 16 && acceptlen <= WS_SSE2_MAX_NEEDLES)
+		return _ws_memspn_sse2(haystack, haystacklen, accept, acceptlen);
+#endif
+
+	return _ws_memspn(haystack, haystacklen, accept);
+}
@@ -24,13 +24,33 @@
 
 #include "ws_symbol_export.h"
 
+/* SSE2 is part of the x86-64 baseline, so it needs neither extra compiler
+ * flags nor a run-time check there. */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WS_HAVE_SSE2 1
+/* The SSE2 routines compare against at most this many needles. */
+#define WS_SSE2_MAX_NEEDLES 4
+#endif
+
+/** Find the first byte in haystack that is one of the bytes in the
+ * NUL-terminated string needles. Returns NULL if there is none. */
 WS_DLL_PUBLIC const guint8 *ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles);
 
+/** Return the number of bytes at the start of haystack that are all
+ * one of the bytes in the NUL-terminated string accept. */
+WS_DLL_PUBLIC size_t ws_memspn(const guint8* haystack, size_t haystacklen, const guint8 *accept);
+
 #ifdef HAVE_SSE4_2
 const char *_ws_mempbrk_sse42(const char* haystack, size_t haystacklen, const char *needles);
 #endif
 
+#ifdef WS_HAVE_SSE2
+const guint8 *_ws_mempbrk_sse2(const guint8* haystack, size_t haystacklen, const guint8 *needles, size_t needleslen);
+size_t _ws_memspn_sse2(const guint8* haystack, size_t haystacklen, const guint8 *accept, size_t acceptlen);
+#endif
+
 const guint8 *_ws_mempbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles);
+size_t _ws_memspn(const guint8* haystack, size_t haystacklen, const guint8 *accept);
 
 
 #endif /* __WS_MEMPBRK_H__ */
@@ -0,0 +1,74 @@
+/* zstd_seekable.c
+ * Seek table of the Zstandard seekable format
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include <wsutil/zstd_seekable.h>
+
+static void
+put_le32(guint8 *p, guint32 val)
+{
+	p[0] = (guint8)(val);
+	p[1] = (guint8)(val >> 8);
+	p[2] = (guint8)(val >> 16);
+	p[3] = (guint8)(val >> 24);
+}
+
+guint8 *
+zstd_seek_table_frame(const guint32 *sizes, guint nframes, size_t *len)
+{
+	guint32 frame_len = nframes * 8 + 9;
+	guint8 *frame, *p;
+	guint i;
+
+	frame = (guint8 *)g_malloc(8 + frame_len);
+	p = frame;
+	put_le32(p, ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC);
+	put_le32(p + 4, frame_len);
+	p += 8;
+	for (i = 0; i < nframes; i++) {
+		put_le32(p, sizes[2 * i]);
+		put_le32(p + 4, sizes[2 * i + 1]);
+		p += 8;
+	}
+	put_le32(p, nframes);
+	p[4] = 0;	/* seek table descriptor: no checksums */
+	put_le32(p + 5, ZSTD_SEEKABLE_MAGIC);
+
+	*len = 8 + frame_len;
+	return frame;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
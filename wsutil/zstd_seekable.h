@@ -0,0 +1,58 @@
+/* zstd_seekable.h
+ * Seek table of the Zstandard seekable format
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __ZSTD_SEEKABLE_H__
+#define __ZSTD_SEEKABLE_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The Zstandard seekable format: a skippable frame at the end of the
+ * file, listing the compressed and uncompressed size of each frame.
+ * See contrib/seekable_format in the Zstandard sources.
+ */
+#define ZSTD_SKIPPABLE_SEEK_TABLE_MAGIC	0x184D2A5E
+#define ZSTD_SEEKABLE_MAGIC		0x8F92EAB1
+
+/* Most frames a seek table can list */
+#define ZSTD_SEEKABLE_MAX_FRAMES	0x8000000U
+
+/*
+ * Build the skippable frame holding the seek table, given the
+ * compressed and uncompressed size of each of the nframes frames, in
+ * that order, in sizes.  Returns the frame, which is to be freed with
+ * g_free(), and puts its length into *len.
+ */
+WS_DLL_PUBLIC guint8 *zstd_seek_table_frame(const guint32 *sizes,
+    guint nframes, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __ZSTD_SEEKABLE_H__ */